@@ -0,0 +1,258 @@
+#define LOG_CATEGORY LogCategory::Web
+
+#include "ApiEncoding.h"
+
+namespace {
+    using ApiEncoding::Format;
+
+    // Largest "*Hex" field converted to a byte string (a full RTU frame fits).
+    static constexpr size_t MAX_HEX_BYTES = 260;
+
+    // CBOR major types
+    static constexpr uint8_t CBOR_UINT = 0;
+    static constexpr uint8_t CBOR_NINT = 1;
+    static constexpr uint8_t CBOR_BYTES = 2;
+    static constexpr uint8_t CBOR_TEXT = 3;
+    static constexpr uint8_t CBOR_ARRAY = 4;
+    static constexpr uint8_t CBOR_MAP = 5;
+
+    void writeBE(Print& out, uint8_t marker, uint64_t v, uint8_t bytes) {
+        uint8_t buf[9];
+        buf[0] = marker;
+        for (uint8_t i = 0; i < bytes; i++) {
+            buf[bytes - i] = (uint8_t)(v >> (8 * i));
+        }
+        out.write(buf, bytes + 1);
+    }
+
+    void cborHead(Print& out, uint8_t major, uint64_t v) {
+        const uint8_t mt = major << 5;
+        if (v < 24) out.write((uint8_t)(mt | v));
+        else if (v <= 0xFF) writeBE(out, mt | 24, v, 1);
+        else if (v <= 0xFFFF) writeBE(out, mt | 25, v, 2);
+        else if (v <= 0xFFFFFFFFULL) writeBE(out, mt | 26, v, 4);
+        else writeBE(out, mt | 27, v, 8);
+    }
+
+    // MessagePack length-prefixed header: fixed form below fixLimit, then 8/16/32-bit lengths.
+    // A marker of 0 means the width is not available for that type.
+    void msgpackHead(Print& out, uint8_t fixBase, size_t fixLimit,
+                     uint8_t m8, uint8_t m16, uint8_t m32, size_t n) {
+        if (n < fixLimit) out.write((uint8_t)(fixBase | n));
+        else if (m8 && n <= 0xFF) writeBE(out, m8, n, 1);
+        else if (n <= 0xFFFF) writeBE(out, m16, n, 2);
+        else writeBE(out, m32, n, 4);
+    }
+
+    void writeInt(Print& out, Format f, int64_t v) {
+        if (v >= 0) ApiEncoding::writeUint(out, f, (uint64_t)v);
+        else if (f == Format::Cbor) cborHead(out, CBOR_NINT, (uint64_t)(-1 - v));
+        else if (v >= -32) out.write((uint8_t)v);
+        else if (v >= INT8_MIN) writeBE(out, 0xD0, (uint64_t)v, 1);
+        else if (v >= INT16_MIN) writeBE(out, 0xD1, (uint64_t)v, 2);
+        else if (v >= INT32_MIN) writeBE(out, 0xD2, (uint64_t)v, 4);
+        else writeBE(out, 0xD3, (uint64_t)v, 8);
+    }
+
+    void writeDouble(Print& out, Format f, double d) {
+        // Register values are floats; keep them at 32 bits when that is lossless.
+        const float fl = (float)d;
+        if ((double)fl == d) {
+            uint32_t bits;
+            memcpy(&bits, &fl, sizeof(bits));
+            writeBE(out, f == Format::Cbor ? 0xFA : 0xCA, bits, 4);
+        } else {
+            uint64_t bits;
+            memcpy(&bits, &d, sizeof(bits));
+            writeBE(out, f == Format::Cbor ? 0xFB : 0xCB, bits, 8);
+        }
+    }
+
+    void writeText(Print& out, Format f, const char* s, size_t len) {
+        if (f == Format::Cbor) cborHead(out, CBOR_TEXT, len);
+        else msgpackHead(out, 0xA0, 32, 0xD9, 0xDA, 0xDB, len);
+        out.write((const uint8_t*)s, len);
+    }
+
+    int hexNibble(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Decodes "01 03 0A", "0103" or "0x1234". Returns byte count, -1 if not hex.
+    int decodeHex(const char* s, uint8_t* buf, size_t cap) {
+        if (!s) return -1;
+        if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) s += 2;
+        size_t n = 0;
+        while (*s) {
+            if (*s == ' ') { s++; continue; }
+            const int hi = hexNibble(s[0]);
+            const int lo = hi < 0 ? -1 : hexNibble(s[1]);
+            if (lo < 0 || n >= cap) return -1;
+            buf[n++] = (uint8_t)((hi << 4) | lo);
+            s += 2;
+        }
+        return (int)n;
+    }
+
+    bool endsWith(const char* s, size_t len, const char* suffix) {
+        const size_t sl = strlen(suffix);
+        return len >= sl && strcmp(s + len - sl, suffix) == 0;
+    }
+
+    enum class KeyAction : uint8_t { Keep, Drop, Bytes };
+
+    // Decide how a member is encoded; for Bytes, binKey receives the new key.
+    KeyAction classify(JsonObjectConst obj, const char* key, JsonVariantConst value,
+                       char* binKey, size_t binKeyCap) {
+        const size_t len = strlen(key);
+        if (strcmp(key, "iso") == 0 || endsWith(key, len, "IsoUtc")) return KeyAction::Drop;
+        if (!value.is<const char*>()) return KeyAction::Keep;
+
+        if (strcmp(key, "hex") == 0) {
+            strlcpy(binKey, "bytes", binKeyCap);
+        } else if (len > 3 && len - 3 < binKeyCap && endsWith(key, len, "Hex")) {
+            memcpy(binKey, key, len - 3);
+            binKey[len - 3] = '\0';
+            if (!obj[binKey].isNull()) return KeyAction::Drop;  // numeric twin already present
+        } else {
+            return KeyAction::Keep;
+        }
+
+        uint8_t scratch[MAX_HEX_BYTES];
+        return decodeHex(value.as<const char*>(), scratch, sizeof(scratch)) >= 0 ? KeyAction::Bytes
+                                                                                 : KeyAction::Keep;
+    }
+
+    void writeValue(Print& out, Format f, JsonVariantConst v);
+
+    void writeObject(Print& out, Format f, JsonObjectConst obj) {
+        char binKey[48];
+        size_t entries = 0;
+        for (JsonPairConst kv : obj) {
+            if (classify(obj, kv.key().c_str(), kv.value(), binKey, sizeof(binKey)) != KeyAction::Drop) entries++;
+        }
+
+        ApiEncoding::writeMapHeader(out, f, entries);
+        for (JsonPairConst kv : obj) {
+            const char* key = kv.key().c_str();
+            switch (classify(obj, key, kv.value(), binKey, sizeof(binKey))) {
+                case KeyAction::Drop:
+                    break;
+                case KeyAction::Keep:
+                    writeText(out, f, key, kv.key().size());
+                    writeValue(out, f, kv.value());
+                    break;
+                case KeyAction::Bytes: {
+                    uint8_t buf[MAX_HEX_BYTES];
+                    const int n = decodeHex(kv.value().as<const char*>(), buf, sizeof(buf));
+                    ApiEncoding::writeString(out, f, binKey);
+                    ApiEncoding::writeBytes(out, f, buf, (size_t)n);
+                    break;
+                }
+            }
+        }
+    }
+
+    void writeValue(Print& out, Format f, JsonVariantConst v) {
+        if (v.is<JsonObjectConst>()) {
+            writeObject(out, f, v.as<JsonObjectConst>());
+        } else if (v.is<JsonArrayConst>()) {
+            JsonArrayConst arr = v.as<JsonArrayConst>();
+            ApiEncoding::writeArrayHeader(out, f, arr.size());
+            for (JsonVariantConst item : arr) writeValue(out, f, item);
+        } else if (v.is<bool>()) {
+            ApiEncoding::writeBool(out, f, v.as<bool>());
+        } else if (v.is<uint64_t>()) {
+            ApiEncoding::writeUint(out, f, v.as<uint64_t>());
+        } else if (v.is<int64_t>()) {
+            writeInt(out, f, v.as<int64_t>());
+        } else if (v.is<double>()) {
+            writeDouble(out, f, v.as<double>());
+        } else if (v.is<JsonString>()) {
+            JsonString s = v.as<JsonString>();
+            writeText(out, f, s.c_str(), s.size());
+        } else {
+            out.write((uint8_t)(f == Format::Cbor ? 0xF6 : 0xC0));  // null
+        }
+    }
+}
+
+namespace ApiEncoding {
+    Format negotiate(AsyncWebServerRequest* request) {
+        String want;
+        if (request->hasParam("format")) {
+            want = request->getParam("format")->value();
+        } else if (request->hasHeader("Accept")) {
+            want = request->getHeader("Accept")->value();
+        }
+        if (want.indexOf("cbor") >= 0) return Format::Cbor;
+        if (want.indexOf("msgpack") >= 0) return Format::MsgPack;
+        return Format::Json;
+    }
+
+    const char* contentType(Format format) {
+        switch (format) {
+            case Format::Cbor:    return "application/cbor";
+            case Format::MsgPack: return "application/msgpack";
+            default:              return "application/json";
+        }
+    }
+
+    void serialize(JsonVariantConst value, Print& out, Format format) {
+        if (format == Format::Json) serializeJson(value, out);
+        else writeValue(out, format, value);
+    }
+
+    void send(AsyncWebServerRequest* request, int code, JsonVariantConst value) {
+        const Format format = negotiate(request);
+        AsyncResponseStream* response = request->beginResponseStream(contentType(format));
+        response->setCode(code);
+        response->addHeader("Vary", "Accept");
+        serialize(value, *response, format);
+        request->send(response);
+    }
+
+    void writeMapHeader(Print& out, Format format, size_t entries) {
+        if (format == Format::Cbor) cborHead(out, CBOR_MAP, entries);
+        else msgpackHead(out, 0x80, 16, 0, 0xDE, 0xDF, entries);
+    }
+
+    void writeArrayHeader(Print& out, Format format, size_t items) {
+        if (format == Format::Cbor) cborHead(out, CBOR_ARRAY, items);
+        else msgpackHead(out, 0x90, 16, 0, 0xDC, 0xDD, items);
+    }
+
+    void writeString(Print& out, Format format, const char* s) {
+        writeText(out, format, s, strlen(s));
+    }
+
+    void writeBytes(Print& out, Format format, const uint8_t* data, size_t len) {
+        if (format == Format::Cbor) cborHead(out, CBOR_BYTES, len);
+        else msgpackHead(out, 0, 0, 0xC4, 0xC5, 0xC6, len);
+        if (len > 0) out.write(data, len);
+    }
+
+    void writeUint(Print& out, Format format, uint64_t v) {
+        if (format == Format::Cbor) {
+            cborHead(out, CBOR_UINT, v);
+        } else if (v < 128) {
+            out.write((uint8_t)v);
+        } else if (v <= 0xFF) {
+            writeBE(out, 0xCC, v, 1);
+        } else if (v <= 0xFFFF) {
+            writeBE(out, 0xCD, v, 2);
+        } else if (v <= 0xFFFFFFFFULL) {
+            writeBE(out, 0xCE, v, 4);
+        } else {
+            writeBE(out, 0xCF, v, 8);
+        }
+    }
+
+    void writeBool(Print& out, Format format, bool v) {
+        if (format == Format::Cbor) out.write((uint8_t)(v ? 0xF5 : 0xF4));
+        else out.write((uint8_t)(v ? 0xC3 : 0xC2));
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+
+/**
+ * Response encodings for the REST API (content negotiation).
+ *
+ * Handlers build a JsonDocument as before and hand it to send(), which picks
+ * JSON, CBOR (RFC 8949) or MessagePack from the Accept header, or from a
+ * ?format=json|cbor|msgpack query parameter.
+ *
+ * The binary encodings carry the same data model with two simplifications
+ * for machine clients:
+ * - "<name>Hex" strings become byte strings under "<name>" ("hex" -> "bytes"),
+ *   unless "<name>" is already present (e.g. "crc" next to "crcHex").
+ * - Human readable timestamps ("<name>IsoUtc", "iso") are dropped; the numeric
+ *   epoch next to them is kept.
+ */
+namespace ApiEncoding {
+    enum class Format : uint8_t { Json, Cbor, MsgPack };
+
+    // Pick the response format for a request.
+    Format negotiate(AsyncWebServerRequest* request);
+
+    const char* contentType(Format format);
+
+    // Serialize a document in the given format.
+    void serialize(JsonVariantConst value, Print& out, Format format);
+
+    // Negotiate, serialize into a streamed response and send it.
+    void send(AsyncWebServerRequest* request, int code, JsonVariantConst value);
+
+    // Building blocks for binary responses that are streamed piecewise
+    // (CBOR / MessagePack only; JSON callers print text directly).
+    void writeMapHeader(Print& out, Format format, size_t entries);
+    void writeArrayHeader(Print& out, Format format, size_t items);
+    void writeString(Print& out, Format format, const char* s);
+    void writeBytes(Print& out, Format format, const uint8_t* data, size_t len);
+    void writeUint(Print& out, Format format, uint64_t v);
+    void writeBool(Print& out, Format format, bool v);
+}
@@ -0,0 +1,100 @@
+#define LOG_CATEGORY LogCategory::System
+
+#include "BootStats.h"
+#include "KvStore.h"
+#include "ResetDiagnostics.h"
+#include "ResetManager.h"
+#include "LoggingFeature.h"
+#include "WebServerFeature.h"
+#include "ApiEncoding.h"
+#include <esp_timer.h>
+
+namespace {
+    constexpr const char* BOOTS_KEY = "boots";
+    constexpr const char* TOTAL_KEY = "uptime.total";
+    constexpr const char* LAST_KEY = "uptime.last";
+
+    KvStore* s_store = nullptr;
+    uint32_t s_totalBeforeS = 0;    // accumulated by the previous boots
+    uint32_t s_previousS = 0;
+    uint32_t s_lastSaveMs = 0;
+
+    // millis() wraps after 49 days
+    uint32_t uptimeS() {
+        return (uint32_t)(esp_timer_get_time() / 1000000);
+    }
+
+    String reasonKey(esp_reset_reason_t reason) {
+        return String("boots.") + ResetDiagnostics::resetReasonString(reason);
+    }
+}
+
+namespace BootStats {
+    void setup(KvStore& store) {
+        if (s_store || !store.isReady()) return;
+        s_store = &store;
+        ResetDiagnostics::init();
+
+        store.put(BOOTS_KEY, store.get<uint32_t>(BOOTS_KEY, 0) + 1);
+        const String key = reasonKey(ResetDiagnostics::resetReason());
+        store.put(key.c_str(), store.get<uint32_t>(key.c_str(), 0) + 1);
+
+        s_totalBeforeS = store.get<uint32_t>(TOTAL_KEY, 0);
+        s_previousS = store.get<uint32_t>(LAST_KEY, 0);
+        save();
+        ResetManager::onRestart([]() { save(); });
+
+        LOG_I("Boot %u (%u %s), previous boot up %u s, %u s in total",
+              (unsigned)boots(), (unsigned)boots(ResetDiagnostics::resetReason()),
+              ResetDiagnostics::resetReasonString(), (unsigned)s_previousS, (unsigned)totalUptimeS());
+    }
+
+    void loop() {
+        if (!s_store || (uint32_t)(millis() - s_lastSaveMs) < BOOT_STATS_SAVE_INTERVAL_MS) return;
+        save();
+    }
+
+    bool save() {
+        if (!s_store) return false;
+        s_lastSaveMs = millis();
+        const uint32_t upS = uptimeS();
+        return s_store->put(LAST_KEY, upS) && s_store->put(TOTAL_KEY, s_totalBeforeS + upS);
+    }
+
+    uint32_t boots() {
+        return s_store ? s_store->get<uint32_t>(BOOTS_KEY, 0) : 0;
+    }
+
+    uint32_t boots(esp_reset_reason_t reason) {
+        return s_store ? s_store->get<uint32_t>(reasonKey(reason).c_str(), 0) : 0;
+    }
+
+    uint32_t totalUptimeS() {
+        return s_totalBeforeS + uptimeS();
+    }
+
+    uint32_t previousUptimeS() {
+        return s_previousS;
+    }
+
+    void toJson(JsonObject obj) {
+        obj["boots"] = boots();
+        JsonObject reasons = obj["reasons"].to<JsonObject>();
+        for (int r = ESP_RST_UNKNOWN; r <= ESP_RST_SDIO; r++) {
+            const uint32_t n = boots((esp_reset_reason_t)r);
+            if (n > 0) reasons[ResetDiagnostics::resetReasonString((esp_reset_reason_t)r)] = n;
+        }
+        obj["uptimeS"] = uptimeS();
+        obj["previousUptimeS"] = s_previousS;
+        obj["totalUptimeS"] = totalUptimeS();
+    }
+
+    void setup(WebServerFeature& server) {
+        server.getServer()->on("/api/boots", HTTP_GET, [&server](AsyncWebServerRequest* request) {
+            if (!server.authenticate(request)) return request->requestAuthentication();
+            JsonDocument doc;
+            toJson(doc.to<JsonObject>());
+            ApiEncoding::send(request, 200, doc);
+        });
+    }
+}
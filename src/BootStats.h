@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+class KvStore;
+class WebServerFeature;
+
+// Flash wear: the uptime counters are one KvStore append each per save
+#ifndef BOOT_STATS_SAVE_INTERVAL_MS
+#define BOOT_STATS_SAVE_INTERVAL_MS 600000
+#endif
+
+/**
+ * Boot and uptime counters that survive power loss.
+ *
+ * ResetDiagnostics keeps its boot count in RTC memory, which a power-on
+ * clears. These counters live in the KvStore instead: boots in total and
+ * per reset reason, the accumulated uptime and the uptime the previous boot
+ * reached (saved every BOOT_STATS_SAVE_INTERVAL_MS and on planned restarts,
+ * so after a crash or power loss it lags by at most one interval).
+ *
+ * Usage:
+ *   Once the store is ready: BootStats::setup(kvStore);
+ *   In loop(): BootStats::loop();
+ *   For /api/boots: BootStats::setup(webServer);
+ */
+namespace BootStats {
+    // Counts this boot; call once. Hooks the uptime save into planned restarts.
+    void setup(KvStore& store);
+
+    // Periodic uptime saves
+    void loop();
+
+    // Write the uptime counters now
+    bool save();
+
+    uint32_t boots();
+    uint32_t boots(esp_reset_reason_t reason);
+    uint32_t totalUptimeS();            // all boots including this one
+    uint32_t previousUptimeS();         // as last saved by the previous boot
+
+    void toJson(JsonObject obj);
+
+    // GET /api/boots
+    void setup(WebServerFeature& server);
+}
@@ -1,5 +1,8 @@
+#define LOG_CATEGORY LogCategory::System
+
 #include "CpuMonitor.h"
 #include "LoggingFeature.h"
+#include "Hal.h"
 
 namespace {
     // Measurement window (how often stats roll over)
@@ -37,7 +40,7 @@ namespace {
         s_busyAccumUs = 0;
         s_idleAccumUs = 0;
         s_loopCount = 0;
-        s_windowStartUs = (uint32_t)micros();
+        s_windowStartUs = (uint32_t)Hal::micros();
     }
 }
 
@@ -45,13 +48,13 @@ namespace CpuMonitor {
     void init() {
         if (s_initialized) return;
         s_initialized = true;
-        s_windowStartUs = (uint32_t)micros();
+        s_windowStartUs = (uint32_t)Hal::micros();
         s_loopEndUs = s_windowStartUs;
     }
 
     void markLoopStart() {
         init();
-        const uint32_t now = (uint32_t)micros();
+        const uint32_t now = (uint32_t)Hal::micros();
 
         // Time since last loop end = idle time
         if (s_loopEndUs != 0) {
@@ -66,7 +69,7 @@ namespace CpuMonitor {
     void markLoopEnd() {
         if (!s_inLoop) return;
 
-        const uint32_t now = (uint32_t)micros();
+        const uint32_t now = (uint32_t)Hal::micros();
 
         // Time since loop start = busy time
         uint32_t busy = now - s_loopStartUs;
@@ -82,7 +85,7 @@ namespace CpuMonitor {
 
             // Periodic logging if enabled
             if (s_logIntervalMs > 0) {
-                const uint32_t nowMs = (uint32_t)millis();
+                const uint32_t nowMs = (uint32_t)Hal::millis();
                 if ((nowMs - s_lastLogMs) >= s_logIntervalMs) {
                     s_lastLogMs = nowMs;
                     LOG_I("CPU: %.1f%%, loops/s=%u, avgLoop=%uus, heap=%u",
@@ -132,13 +135,13 @@ namespace CpuMonitor {
         s_lastBusyUs = 0;
         s_lastIdleUs = 0;
         s_lastLoopCount = 0;
-        s_windowStartUs = (uint32_t)micros();
+        s_windowStartUs = (uint32_t)Hal::micros();
         s_loopEndUs = s_windowStartUs;
         s_inLoop = false;
     }
 
     void setLogInterval(uint32_t intervalMs) {
         s_logIntervalMs = intervalMs;
-        s_lastLogMs = (uint32_t)millis();
+        s_lastLogMs = (uint32_t)Hal::millis();
     }
 }
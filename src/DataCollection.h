@@ -6,6 +6,7 @@
 #include <time.h>
 #include "StorageFeature.h"
 #include "TimeUtils.h"
+#include "Hal.h"
 
 #ifndef FIRMWARE_NAME
 #define FIRMWARE_NAME "ESP32-Firmware"
@@ -101,8 +102,7 @@ public:
         // Auto-fill timestamp field if present
         for (size_t i = 0; i < _fieldCount; i++) {
             if (_schema[i].influxType == InfluxType::TIMESTAMP) {
-                time_t now;
-                time(&now);
+                const time_t now = Hal::time();
                 uint32_t* tsPtr = (uint32_t*)((uint8_t*)&entry + _schema[i].offset);
                 *tsPtr = (uint32_t)now;
                 break;
@@ -119,7 +119,7 @@ public:
         }
         
         _dirty = true;
-        _lastModified = millis();
+        _lastModified = Hal::millis();
     }
     
     /**
@@ -166,7 +166,7 @@ public:
         _tail = 0;
         _count = 0;
         _dirty = true;
-        _lastModified = millis();
+        _lastModified = Hal::millis();
     }
     
     /**
@@ -183,13 +183,18 @@ public:
     }
     
     /**
-     * @brief Force write to filesystem
+     * @brief Write to filesystem now
+     * Goes through the StorageFeature write-back cache, which writes the
+     * newest content once its delay has passed.
      */
     void flush() {
         if (!_persistEnabled || !_storage) return;
-        String json = toJson();
-        _storage->writeFile(_filename, json);
-        _dirty = false;
+        JsonDocument doc;
+        toJsonDocument(doc);
+        String content;
+        content.reserve(measureJson(doc));
+        serializeJson(doc, content);
+        if (_storage->writeFile(_filename, content)) _dirty = false;
     }
     
     /**
@@ -198,24 +203,43 @@ public:
     void load() {
         if (!_persistEnabled || !_storage) return;
         if (!_storage->exists(_filename)) return;
-        String json = _storage->readFile(_filename);
-        if (json.length() > 0) {
-            fromJson(json);
+        StorageFeature::Reader reader = _storage->openReader(_filename);
+        if (reader && reader.size() > 0) {
+            fromJson(reader);
             _dirty = false;
         }
     }
     
     /**
-     * @brief Convert all entries to JSON array
+     * @brief Fill a document with all entries as array
      */
-    String toJson() const {
-        JsonDocument doc;
+    void toJsonDocument(JsonDocument& doc) const {
         JsonArray arr = doc.to<JsonArray>();
         
         for (size_t i = 0; i < _count; i++) {
             JsonObject obj = arr.add<JsonObject>();
             entryToJson(get(i), obj);
         }
+    }
+    
+    /**
+     * @brief Fill a document with a single entry as object
+     * @return false if index is out of range
+     */
+    bool toJsonDocument(size_t index, JsonDocument& doc) const {
+        if (index >= _count) return false;
+        
+        JsonObject obj = doc.to<JsonObject>();
+        entryToJson(get(index), obj);
+        return true;
+    }
+    
+    /**
+     * @brief Convert all entries to JSON array
+     */
+    String toJson() const {
+        JsonDocument doc;
+        toJsonDocument(doc);
         
         String result;
         serializeJson(doc, result);
@@ -226,11 +250,8 @@ public:
      * @brief Convert single entry to JSON object
      */
     String toJson(size_t index) const {
-        if (index >= _count) return "{}";
-        
         JsonDocument doc;
-        JsonObject obj = doc.to<JsonObject>();
-        entryToJson(get(index), obj);
+        if (!toJsonDocument(index, doc)) return "{}";
         
         String result;
         serializeJson(doc, result);
@@ -245,7 +266,24 @@ public:
         JsonDocument doc;
         DeserializationError err = deserializeJson(doc, json);
         if (err) return false;
-        
+        return fromJsonDocument(doc);
+    }
+    
+    /**
+     * @brief Load from a JSON stream (e.g. StorageFeature::Reader)
+     */
+    bool fromJson(Stream& json) {
+        JsonDocument doc;
+        DeserializationError err = deserializeJson(doc, json);
+        if (err) return false;
+        return fromJsonDocument(doc);
+    }
+    
+    /**
+     * @brief Add entries from a parsed JSON array
+     */
+    bool fromJsonDocument(JsonDocument& doc) {
+
         JsonArray arr = doc.as<JsonArray>();
         for (JsonObject obj : arr) {
             T entry;
@@ -291,7 +329,7 @@ public:
     void loop() {
         if (!_persistEnabled || !_dirty) return;
         
-        if (_persistDelayMs == 0 || (millis() - _lastModified >= _persistDelayMs)) {
+        if (_persistDelayMs == 0 || (Hal::millis() - _lastModified >= _persistDelayMs)) {
             flush();
         }
     }
@@ -116,7 +116,7 @@ public:
             serializeJson(doc, payload);
             
             mqtt->publish(discoveryTopic.c_str(), payload.c_str(), true);
-            LOG_D("HA discovery: %s", discoveryTopic.c_str());
+            LOG_CAT_D(LogCategory::MQTT, "HA discovery: %s", discoveryTopic.c_str());
         }
     }
     
@@ -136,7 +136,7 @@ public:
         String json = collection.toJson(collection.count() - 1);
         
         mqtt->publish(stateTopic.c_str(), json.c_str(), false);
-        LOG_D("MQTT publish: %s", stateTopic.c_str());
+        LOG_CAT_D(LogCategory::MQTT, "MQTT publish: %s", stateTopic.c_str());
     }
     
     /**
@@ -5,6 +5,7 @@
 #include <ESPAsyncWebServer.h>
 #include "DataCollection.h"
 #include "WebServerFeature.h"
+#include "ApiEncoding.h"
 
 /**
  * @brief Helper to register web endpoints for a DataCollection
@@ -64,12 +65,13 @@ public:
         });
     }
 
-    // Register endpoints using WebServerFeature (enforces auth if enabled)
+    // Register endpoints using WebServerFeature (enforces auth if enabled).
+    // API responses honour Accept: application/cbor / application/msgpack (see ApiEncoding).
     static void registerEndpoints(
         WebServerFeature& serverFeature,
         const char* basePath,
-        std::function<String()> getJsonCallback,
-        std::function<String()> getLatestJsonCallback,
+        std::function<void(JsonDocument&)> fillAllCallback,
+        std::function<bool(JsonDocument&)> fillLatestCallback,
         std::function<String()> getSchemaCallback,
         uint32_t refreshIntervalMs = 5000
     ) {
@@ -83,19 +85,21 @@ public:
         char* viewPathStr = strdup(viewPath.c_str());
         
         // API endpoint - all data
-        server->on(apiPathStr, HTTP_GET, [getJsonCallback, &serverFeature](AsyncWebServerRequest* request) {
+        server->on(apiPathStr, HTTP_GET, [fillAllCallback, &serverFeature](AsyncWebServerRequest* request) {
             if (!serverFeature.authenticate(request)) return request->requestAuthentication();
-            request->send(200, "application/json", getJsonCallback());
+            JsonDocument doc;
+            fillAllCallback(doc);
+            ApiEncoding::send(request, 200, doc);
         });
         
         // API endpoint - latest entry
-        server->on(strdup(apiLatestPath.c_str()), HTTP_GET, [getLatestJsonCallback, &serverFeature](AsyncWebServerRequest* request) {
+        server->on(strdup(apiLatestPath.c_str()), HTTP_GET, [fillLatestCallback, &serverFeature](AsyncWebServerRequest* request) {
             if (!serverFeature.authenticate(request)) return request->requestAuthentication();
-            String json = getLatestJsonCallback();
-            if (json.length() == 0 || json == "{}") {
+            JsonDocument doc;
+            if (!fillLatestCallback(doc)) {
                 request->send(404, "application/json", "{\"error\":\"No data available\"}");
             } else {
-                request->send(200, "application/json", json);
+                ApiEncoding::send(request, 200, doc);
             }
         });
         
@@ -151,10 +155,10 @@ public:
         registerEndpoints(
             serverFeature,
             basePath,
-            [&collection]() { return collection.toJson(); },
-            [&collection]() { 
-                if (collection.isEmpty()) return String("{}");
-                return collection.toJson(collection.count() - 1);
+            [&collection](JsonDocument& doc) { collection.toJsonDocument(doc); },
+            [&collection](JsonDocument& doc) {
+                if (collection.isEmpty()) return false;
+                return collection.toJsonDocument(collection.count() - 1, doc);
             },
             getSchema,
             refreshIntervalMs
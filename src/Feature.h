@@ -1,6 +1,8 @@
 #ifndef FEATURE_H
 #define FEATURE_H
 
+#include <stdint.h>
+
 /**
  * @brief Base class for all features
  * 
@@ -9,6 +11,11 @@
  * for network, sensor not ready), the method should return and retry on the 
  * next call. Use state machines or flags to track progress across multiple 
  * invocations.
+ *
+ * The main loop only calls loop() when dueInMs() returns 0 and sleeps until
+ * the earliest deadline of all features. A feature waiting for an event
+ * (UART data, network) should have its event source call
+ * LoopScheduler::wake(), so it is asked again right away.
  */
 class Feature {
 public:
@@ -25,6 +32,54 @@ public:
      * MUST be non-blocking - never use delay() or blocking waits
      */
     virtual void loop() {}
+
+    // Returned by dueInMs() when only an event can create work for loop()
+    static constexpr uint32_t NOT_DUE = UINT32_MAX;
+
+    /**
+     * @brief Milliseconds until loop() has something to do (0 = now)
+     * Asked before and after every pass, so it must be cheap.
+     * Default: loop() is called on every pass
+     */
+    virtual uint32_t dueInMs() { return 0; }
+
+    /**
+     * @brief Execution context of loop()
+     * stackBytes 0 runs the feature in the Arduino loop task. Otherwise
+     * FeatureTasks gives it a task of its own; loop() must then only share
+     * data with other tasks through queues or locks.
+     */
+    struct TaskConfig {
+        uint32_t stackBytes;
+        uint8_t priority;
+        int8_t core;            // -1: any core
+    };
+
+    virtual TaskConfig taskConfig() const { return TaskConfig{0, 1, -1}; }
+
+    // Readiness conditions a setup() can wait for (see Startup)
+    enum Needs : uint8_t {
+        NEEDS_NOTHING = 0,
+        NEEDS_STORAGE = 0x01,   // filesystem set up (mounted unless that failed)
+        NEEDS_UART = 0x02,      // Modbus serial port open
+        NEEDS_WIFI = 0x04,      // station connected
+        NEEDS_TIME = 0x08,      // clock synced
+        NEEDS_WEB = 0x10,       // web server started, routes can be added
+        NEEDS_NETWORK = 0x20    // WiFi and TCP/IP stack started, station may still connect
+    };
+
+    /**
+     * @brief Conditions (Needs bits) to meet before setup() is called
+     * Default: none, setup() runs right away
+     */
+    virtual uint8_t dependencies() const { return NEEDS_NOTHING; }
+
+    /**
+     * @brief True if setup() may block (e.g. waits for a connection)
+     * Startup then calls it in a helper task while the loop carries on;
+     * loop() is only called after setup() returned.
+     */
+    virtual bool setupBlocks() const { return false; }
     
     /**
      * @brief Returns feature name for logging/debugging
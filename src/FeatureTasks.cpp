@@ -0,0 +1,141 @@
+#define LOG_CATEGORY LogCategory::System
+
+#include "FeatureTasks.h"
+#include "LoopScheduler.h"
+#include "LoggingFeature.h"
+#include "LoopProfiler.h"
+#include "ResetDiagnostics.h"
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+namespace {
+    // Passes without sleeping before a feature task gives up the CPU for a tick
+    static constexpr uint8_t MAX_BUSY_PASSES = 8;
+
+    struct Slot {
+        Feature* feature;
+        Feature::TaskConfig config;
+        HeapTag heapTag;
+        TaskHandle_t handle;
+        volatile uint32_t heartbeatMs;      // start of the last pass
+        volatile uint32_t passes;           // loop() calls
+        std::atomic<uint64_t> busyUs;       // time in loop(), read by the loop task
+        bool stallReported;
+    };
+
+    Slot s_slots[FEATURE_TASK_MAX];
+    size_t s_slotCount = 0;
+
+    void featureTask(void* arg) {
+        Slot& slot = *static_cast<Slot*>(arg);
+        uint8_t busyInRow = 0;
+
+        for (;;) {
+            slot.heartbeatMs = (uint32_t)millis();
+            uint32_t due = slot.feature->dueInMs();
+            if (due == 0) {
+                HeapMonitor::Scope heap(slot.heapTag);
+                const int64_t startUs = esp_timer_get_time();
+                slot.feature->loop();
+                const uint32_t durUs = (uint32_t)(esp_timer_get_time() - startUs);
+                slot.busyUs.fetch_add(durUs, std::memory_order_relaxed);
+                slot.passes++;
+                ResetDiagnostics::recordLoopDurationUs(slot.feature->getName(), durUs);
+                LoopProfiler::record(slot.feature->getName(), durUs);
+                due = slot.feature->dueInMs();
+            }
+
+            if (due == 0 && ++busyInRow < MAX_BUSY_PASSES) {
+                taskYIELD();
+                continue;
+            }
+            busyInRow = 0;
+            if (due > FEATURE_TASK_MAX_SLEEP_MS) due = FEATURE_TASK_MAX_SLEEP_MS;
+            const TickType_t ticks = pdMS_TO_TICKS(due);
+            ulTaskNotifyTake(pdTRUE, ticks ? ticks : 1);
+        }
+    }
+
+    const Slot* findSlot(const Feature* feature) {
+        for (size_t i = 0; i < s_slotCount; i++) {
+            if (s_slots[i].feature == feature) return &s_slots[i];
+        }
+        return nullptr;
+    }
+}
+
+namespace FeatureTasks {
+    void start(Feature* const* features, size_t count, HeapTagFn heapTag) {
+        for (size_t i = 0; i < count; i++) {
+            Feature* feature = features[i];
+            const Feature::TaskConfig config = feature->taskConfig();
+            if (config.stackBytes == 0 || findSlot(feature)) continue;
+            if (s_slotCount >= FEATURE_TASK_MAX) {
+                LOG_W("No task slot left for %s, it stays in the loop task", feature->getName());
+                continue;
+            }
+
+            Slot& slot = s_slots[s_slotCount];
+            slot.feature = feature;
+            slot.config = config;
+            slot.heapTag = heapTag ? heapTag(feature) : HeapTag::Other;
+            slot.handle = nullptr;
+            slot.heartbeatMs = (uint32_t)millis();
+            slot.passes = 0;
+            slot.busyUs.store(0, std::memory_order_relaxed);
+            slot.stallReported = false;
+
+            const BaseType_t core = config.core < 0 ? tskNO_AFFINITY : (BaseType_t)config.core;
+            if (xTaskCreatePinnedToCore(featureTask, feature->getName(), config.stackBytes, &slot,
+                                        config.priority, &slot.handle, core) != pdPASS) {
+                LOG_E("Task for %s could not be created, it stays in the loop task", feature->getName());
+                continue;
+            }
+            s_slotCount++;
+            LoopScheduler::addTask(slot.handle);
+            LOG_I("%s runs in its own task (core %d, priority %u, %lu bytes stack)",
+                  feature->getName(), (int)config.core, (unsigned)config.priority,
+                  (unsigned long)config.stackBytes);
+        }
+    }
+
+    bool isDetached(const Feature* feature) {
+        return findSlot(feature) != nullptr;
+    }
+
+    void loop() {
+        const uint32_t now = (uint32_t)millis();
+        for (size_t i = 0; i < s_slotCount; i++) {
+            Slot& slot = s_slots[i];
+            const uint32_t sinceMs = now - slot.heartbeatMs;
+            if (sinceMs >= FEATURE_TASK_STALL_MS) {
+                if (!slot.stallReported) {
+                    slot.stallReported = true;
+                    LOG_W("Feature task %s has not come round for %lu ms",
+                          slot.feature->getName(), (unsigned long)sinceMs);
+                }
+            } else if (slot.stallReported) {
+                slot.stallReported = false;
+                LOG_I("Feature task %s is running again", slot.feature->getName());
+            }
+        }
+    }
+
+    void toJson(JsonArray arr) {
+        const uint32_t now = (uint32_t)millis();
+        for (size_t i = 0; i < s_slotCount; i++) {
+            const Slot& slot = s_slots[i];
+            JsonObject o = arr.add<JsonObject>();
+            o["name"] = slot.feature->getName();
+            o["core"] = slot.config.core;
+            o["priority"] = slot.config.priority;
+            o["stackBytes"] = slot.config.stackBytes;
+            o["passes"] = (uint32_t)slot.passes;
+            o["busyMs"] = (uint32_t)(slot.busyUs.load(std::memory_order_relaxed) / 1000);
+            o["sinceHeartbeatMs"] = (uint32_t)(now - slot.heartbeatMs);
+            o["stalled"] = slot.stallReported;
+        }
+    }
+}
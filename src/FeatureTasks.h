@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "Feature.h"
+#include "HeapMonitor.h"
+
+// Feature tasks may not sleep longer than this between deadline checks
+#ifndef FEATURE_TASK_MAX_SLEEP_MS
+#define FEATURE_TASK_MAX_SLEEP_MS 1000
+#endif
+
+// A feature task that has not come round for this long is reported as stalled
+#ifndef FEATURE_TASK_STALL_MS
+#define FEATURE_TASK_STALL_MS 5000
+#endif
+
+#ifndef FEATURE_TASK_MAX
+#define FEATURE_TASK_MAX 4
+#endif
+
+/**
+ * Runs features with a Feature::TaskConfig stack size in tasks of their own.
+ *
+ * Each task is named after its feature (so /api/tasks shows its CPU share
+ * and stack) and runs the same schedule as the loop task: loop() when
+ * dueInMs() is 0, otherwise a sleep until the deadline or a
+ * LoopScheduler::wake(). The loop task supervises the tasks and warns when
+ * one stops coming round. If a task can't be created, its feature stays in
+ * the loop task.
+ *
+ * Usage:
+ *   In setup(), after all Feature::setup(): FeatureTasks::start(features, count, heapTagFor);
+ *   In loop(): if (!FeatureTasks::isDetached(feature)) ...; FeatureTasks::loop();
+ */
+namespace FeatureTasks {
+    using HeapTagFn = HeapTag (*)(const Feature*);
+
+    void start(Feature* const* features, size_t count, HeapTagFn heapTag);
+
+    // True if the feature runs in a task of its own
+    bool isDetached(const Feature* feature);
+
+    // Stall supervision; call from loop()
+    void loop();
+
+    void toJson(JsonArray arr);
+}
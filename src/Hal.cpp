@@ -0,0 +1,115 @@
+#include "Hal.h"
+#include "HalUart.h"
+
+#if HAL_HOST
+
+#include <atomic>
+
+namespace {
+    // Read by task threads of the host RTOS shim while the test advances it
+    std::atomic<uint64_t> s_nowUs{0};
+    time_t s_epoch = 0;             // Unix time at s_epochAtUs, 0: not synced
+    uint64_t s_epochAtUs = 0;
+    bool s_networkConnected = false;
+}
+
+namespace Hal {
+    uint32_t millis() {
+        return (uint32_t)(s_nowUs / 1000);
+    }
+
+    uint32_t micros() {
+        return (uint32_t)s_nowUs;
+    }
+
+    time_t time() {
+        if (s_epoch == 0) return 0;
+        return s_epoch + (time_t)((s_nowUs - s_epochAtUs) / 1000000);
+    }
+
+    bool networkConnected() {
+        return s_networkConnected;
+    }
+
+    namespace VirtualClock {
+        void reset() {
+            s_nowUs = 0;
+            s_epoch = 0;
+            s_epochAtUs = 0;
+            s_networkConnected = false;
+        }
+
+        void advanceUs(uint64_t us) {
+            s_nowUs += us;
+        }
+
+        void setEpoch(time_t unixSeconds) {
+            s_epoch = unixSeconds;
+            s_epochAtUs = s_nowUs;
+        }
+
+        void setNetworkConnected(bool connected) {
+            s_networkConnected = connected;
+        }
+
+        uint64_t nowUs() {
+            return s_nowUs;
+        }
+    }
+
+    void HostUart::begin(uint32_t baudRate, uint32_t config, int8_t rxPin, int8_t txPin) {
+        (void)config;
+        (void)rxPin;
+        (void)txPin;
+        if (baudRate > 0) _charTimeUs = (10 * 1000000UL) / baudRate;
+        _rx.clear();
+        _tx.clear();
+    }
+
+    int HostUart::available() {
+        const uint64_t now = VirtualClock::nowUs();
+        int n = 0;
+        for (const RxByte& b : _rx) {
+            if (b.atUs > now) break;
+            n++;
+        }
+        return n;
+    }
+
+    int HostUart::read() {
+        if (_rx.empty() || _rx.front().atUs > VirtualClock::nowUs()) return -1;
+        const uint8_t value = _rx.front().value;
+        _rx.pop_front();
+        return value;
+    }
+
+    size_t HostUart::write(uint8_t byte) {
+        _tx.push_back(byte);
+        return 1;
+    }
+
+    void HostUart::inject(const uint8_t* data, size_t len, uint64_t atUs) {
+        for (size_t i = 0; i < len; i++) {
+            _rx.push_back(RxByte{atUs + (uint64_t)i * _charTimeUs, data[i]});
+        }
+        if (_onReceive) _onReceive();
+    }
+
+    std::vector<uint8_t> HostUart::takeWritten() {
+        std::vector<uint8_t> out;
+        out.swap(_tx);
+        return out;
+    }
+}
+
+#else
+
+#include <WiFi.h>
+
+namespace Hal {
+    bool networkConnected() {
+        return WiFi.status() == WL_CONNECTED;
+    }
+}
+
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// 1: build against the host back end (virtual clock, scripted UART) instead
+// of the ESP32 Arduino core
+#ifndef HAL_HOST
+#define HAL_HOST 0
+#endif
+
+#if !HAL_HOST
+#include <Arduino.h>
+#endif
+
+/**
+ * Hardware abstraction for the timing and I/O the features depend on.
+ *
+ * Features read time and network state through Hal:: instead of calling
+ * millis(), micros(), time() and WiFi.status() directly, and ModbusRTU talks
+ * to a Hal::Uart (HalUart.h) instead of a HardwareSerial. On the ESP32 the
+ * calls are inline forwards to the Arduino core, so they cost nothing.
+ *
+ * With -D HAL_HOST=1 the same code runs on a host against a virtual clock
+ * that only moves when the test advances it, so a day of polling, uploads
+ * and backoff runs in as long as the code takes to execute:
+ *
+ *   Hal::VirtualClock::setEpoch(1700000000);
+ *   Hal::VirtualClock::setNetworkConnected(true);
+ *   for (...) {
+ *       feature.loop();
+ *       Hal::VirtualClock::advanceMs(std::max<uint32_t>(1, feature.dueInMs()));
+ *   }
+ */
+namespace Hal {
+#if HAL_HOST
+    // Milliseconds/microseconds since the (virtual) boot, wrapping like on the ESP32
+    uint32_t millis();
+    uint32_t micros();
+
+    // Unix time, 0 until VirtualClock::setEpoch() (like an unsynced clock)
+    time_t time();
+
+    // Station connected to an access point
+    bool networkConnected();
+
+    namespace VirtualClock {
+        // Back to boot: time 0, no epoch, network down
+        void reset();
+
+        void advanceUs(uint64_t us);
+        inline void advanceMs(uint32_t ms) { advanceUs((uint64_t)ms * 1000); }
+
+        // Unix time at the current virtual instant
+        void setEpoch(time_t unixSeconds);
+
+        void setNetworkConnected(bool connected);
+
+        uint64_t nowUs();
+    }
+#else
+    inline uint32_t millis() { return ::millis(); }
+    inline uint32_t micros() { return ::micros(); }
+    inline time_t time() { return ::time(nullptr); }
+
+    bool networkConnected();
+#endif
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Hal.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#if HAL_HOST
+#include <deque>
+#include <vector>
+#else
+#include <HardwareSerial.h>
+#endif
+
+namespace Hal {
+    /**
+     * @brief Byte stream of a serial port, as used by ModbusRTUFeature
+     */
+    class Uart {
+    public:
+        using ReceiveCallback = void (*)();
+
+        virtual ~Uart() = default;
+
+        /**
+         * @brief Open the port
+         * @param rxPin RX pin (-1 for default)
+         * @param txPin TX pin (-1 for default)
+         */
+        virtual void begin(uint32_t baudRate, uint32_t config, int8_t rxPin, int8_t txPin) = 0;
+
+        // Bytes that can be read without waiting
+        virtual int available() = 0;
+
+        // Next byte, -1 if none
+        virtual int read() = 0;
+
+        virtual size_t write(uint8_t byte) = 0;
+
+        // Waits until all written bytes are on the wire
+        virtual void flush() = 0;
+
+        // Called (from a driver task) when bytes arrived
+        virtual void onReceive(ReceiveCallback callback) = 0;
+    };
+
+#if HAL_HOST
+    /**
+     * @brief Scripted UART on the virtual clock
+     * Bytes injected for a virtual instant become available() once the
+     * clock got there; written bytes are collected for the test to check.
+     */
+    class HostUart : public Uart {
+    public:
+        void begin(uint32_t baudRate, uint32_t config, int8_t rxPin, int8_t txPin) override;
+        int available() override;
+        int read() override;
+        size_t write(uint8_t byte) override;
+        void flush() override {}
+        void onReceive(ReceiveCallback callback) override { _onReceive = callback; }
+
+        /**
+         * @brief Queue bytes that arrive atUs (virtual), one char time apart
+         */
+        void inject(const uint8_t* data, size_t len, uint64_t atUs);
+
+        // Bytes written since the last call
+        std::vector<uint8_t> takeWritten();
+
+        uint32_t charTimeUs() const { return _charTimeUs; }
+
+    private:
+        struct RxByte {
+            uint64_t atUs;
+            uint8_t value;
+        };
+
+        std::deque<RxByte> _rx;
+        std::vector<uint8_t> _tx;
+        ReceiveCallback _onReceive = nullptr;
+        uint32_t _charTimeUs = 1042;    // 9600 8N1
+    };
+#else
+    /**
+     * @brief Uart on an ESP32 HardwareSerial (Serial1, Serial2)
+     */
+    class HardwareUart : public Uart {
+    public:
+        explicit HardwareUart(HardwareSerial& serial) : _serial(serial) {}
+
+        void begin(uint32_t baudRate, uint32_t config, int8_t rxPin, int8_t txPin) override {
+            _serial.begin(baudRate, config, rxPin, txPin);
+        }
+        int available() override { return _serial.available(); }
+        int read() override { return _serial.read(); }
+        size_t write(uint8_t byte) override { return _serial.write(byte); }
+        void flush() override { _serial.flush(); }
+        void onReceive(ReceiveCallback callback) override { _serial.onReceive(callback); }
+
+    private:
+        HardwareSerial& _serial;
+    };
+#endif
+}
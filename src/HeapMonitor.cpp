@@ -0,0 +1,372 @@
+#define LOG_CATEGORY LogCategory::System
+
+#include "HeapMonitor.h"
+#include "LoggingFeature.h"
+#include "WebServerFeature.h"
+#include "ApiEncoding.h"
+#include "MutexLock.h"
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+namespace {
+    static constexpr uint16_t HEADER_MAGIC = 0xA11C;
+    static constexpr size_t TAG_COUNT = (size_t)HeapTag::Count;
+
+    // Precedes every tagged allocation; keeps malloc's alignment
+    struct Header {
+        uint32_t size;
+        uint8_t tag;
+        uint8_t reserved;
+        uint16_t magic;
+    };
+    static_assert(sizeof(Header) == 8, "Header must keep 8 byte alignment");
+
+    // Constant initialized: operator new runs before dynamic initialization
+    struct Counters {
+        std::atomic<int32_t> liveBytes{0};
+        std::atomic<uint32_t> liveAllocs{0};
+        std::atomic<uint32_t> allocs{0};
+        std::atomic<uint32_t> allocBytes{0};
+    };
+    Counters s_counters[TAG_COUNT];
+
+    struct TaskTag {
+        TaskHandle_t task;
+        volatile uint8_t tag;
+    };
+    TaskTag s_tasks[HEAP_MONITOR_MAX_TASKS];
+    volatile int s_taskCount = 0;
+    portMUX_TYPE s_taskMux = portMUX_INITIALIZER_UNLOCKED;
+
+    struct HeapSample {
+        uint32_t uptimeS;
+        uint32_t freeInternal;
+        uint32_t minFreeInternal;
+        uint32_t largestInternal;
+        uint32_t free8;
+        uint32_t minFree8;
+        uint32_t largest8;
+    };
+
+    SemaphoreHandle_t s_mutex = nullptr;   // guards history and rates
+    HeapSample s_history[HEAP_MONITOR_HISTORY];
+    size_t s_historyCount = 0;
+    size_t s_historyHead = 0;              // next write position
+    uint32_t s_lastSampleMs = 0;
+    bool s_sampled = false;
+
+    struct Rate {
+        uint32_t prevAllocs;
+        uint32_t prevBytes;
+        float allocsPerSec;
+        float bytesPerSec;
+    };
+    Rate s_rates[TAG_COUNT];
+
+    HeapTag defaultTagFor(TaskHandle_t task) {
+        const char* name = pcTaskGetName(task);
+        if (name && strcmp(name, "async_tcp") == 0) return HeapTag::Web;
+        return HeapTag::Other;
+    }
+
+    int slotFor(TaskHandle_t task) {
+        const int count = s_taskCount;
+        for (int i = 0; i < count; i++) {
+            if (s_tasks[i].task == task) return i;
+        }
+
+        int slot = -1;
+        portENTER_CRITICAL(&s_taskMux);
+        for (int i = count; i < s_taskCount; i++) {
+            if (s_tasks[i].task == task) slot = i;
+        }
+        if (slot < 0 && s_taskCount < HEAP_MONITOR_MAX_TASKS) {
+            slot = s_taskCount;
+            s_tasks[slot].task = task;
+            s_tasks[slot].tag = (uint8_t)defaultTagFor(task);
+            s_taskCount = slot + 1;
+        }
+        portEXIT_CRITICAL(&s_taskMux);
+        return slot;
+    }
+
+    HeapTag currentTag() {
+        TaskHandle_t task = xTaskGetCurrentTaskHandle();
+        if (!task) return HeapTag::Other;  // before the scheduler runs
+        const int slot = slotFor(task);
+        return slot >= 0 ? (HeapTag)s_tasks[slot].tag : defaultTagFor(task);
+    }
+
+    void countAlloc(uint8_t tag, size_t size) {
+        Counters& c = s_counters[tag];
+        c.liveBytes += (int32_t)size;
+        c.liveAllocs++;
+        c.allocs++;
+        c.allocBytes += (uint32_t)size;
+    }
+
+    void countFree(uint8_t tag, size_t size) {
+        Counters& c = s_counters[tag];
+        c.liveBytes -= (int32_t)size;
+        c.liveAllocs--;
+    }
+
+    void* allocTagged(size_t size, HeapTag tag) {
+#if HEAP_MONITOR_TAGGING
+        Header* h = (Header*)malloc(sizeof(Header) + size);
+        if (!h) return nullptr;
+        h->size = size;
+        h->tag = (uint8_t)tag;
+        h->reserved = 0;
+        h->magic = HEADER_MAGIC;
+        countAlloc(h->tag, size);
+        return h + 1;
+#else
+        (void)tag;
+        return malloc(size);
+#endif
+    }
+
+    void* reallocTagged(void* ptr, size_t size, HeapTag tag) {
+#if HEAP_MONITOR_TAGGING
+        if (!ptr) return allocTagged(size, tag);
+        Header* h = (Header*)ptr - 1;
+        if (h->magic != HEADER_MAGIC) return realloc(ptr, size);
+
+        const uint8_t oldTag = h->tag;
+        const size_t oldSize = h->size;
+        Header* n = (Header*)realloc(h, sizeof(Header) + size);
+        if (!n) return nullptr;
+        countFree(oldTag, oldSize);
+        n->size = size;
+        countAlloc(n->tag, size);
+        s_counters[n->tag].allocs--;  // a resize, not a new allocation
+        return n + 1;
+#else
+        (void)tag;
+        return realloc(ptr, size);
+#endif
+    }
+
+    class JsonHeapAllocator : public ArduinoJson::Allocator {
+    public:
+        void* allocate(size_t size) override { return allocTagged(size, HeapTag::Json); }
+        void deallocate(void* ptr) override { HeapMonitor::release(ptr); }
+        void* reallocate(void* ptr, size_t size) override { return reallocTagged(ptr, size, HeapTag::Json); }
+    };
+    JsonHeapAllocator s_jsonAllocator;
+
+    void sampleHeap(uint32_t nowMs) {
+        HeapSample s;
+        s.uptimeS = nowMs / 1000;
+        s.freeInternal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        s.minFreeInternal = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        s.largestInternal = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        s.free8 = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        s.minFree8 = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+        s.largest8 = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+        const float elapsedS = s_sampled ? (uint32_t)(nowMs - s_lastSampleMs) / 1000.0f : 0.0f;
+
+        MutexLock lock(s_mutex);
+        s_history[s_historyHead] = s;
+        s_historyHead = (s_historyHead + 1) % HEAP_MONITOR_HISTORY;
+        if (s_historyCount < HEAP_MONITOR_HISTORY) s_historyCount++;
+
+        for (size_t i = 0; i < TAG_COUNT; i++) {
+            const uint32_t allocs = s_counters[i].allocs;
+            const uint32_t bytes = s_counters[i].allocBytes;
+            if (elapsedS > 0.0f) {
+                s_rates[i].allocsPerSec = (uint32_t)(allocs - s_rates[i].prevAllocs) / elapsedS;
+                s_rates[i].bytesPerSec = (uint32_t)(bytes - s_rates[i].prevBytes) / elapsedS;
+            }
+            s_rates[i].prevAllocs = allocs;
+            s_rates[i].prevBytes = bytes;
+        }
+        s_lastSampleMs = nowMs;
+        s_sampled = true;
+    }
+
+    void heapJson(JsonObject obj, uint32_t caps) {
+        const uint32_t freeBytes = heap_caps_get_free_size(caps);
+        const uint32_t largest = heap_caps_get_largest_free_block(caps);
+        obj["free"] = freeBytes;
+        obj["minFree"] = heap_caps_get_minimum_free_size(caps);
+        obj["largestBlock"] = largest;
+        obj["fragmentationPercent"] = freeBytes ? 100 - (uint32_t)((uint64_t)largest * 100 / freeBytes) : 0;
+    }
+}
+
+namespace HeapMonitor {
+    Scope::Scope(HeapTag tag) : _slot(-1), _previous(HeapTag::Other) {
+        TaskHandle_t task = xTaskGetCurrentTaskHandle();
+        if (!task) return;
+        _slot = slotFor(task);
+        if (_slot < 0) return;
+        _previous = (HeapTag)s_tasks[_slot].tag;
+        s_tasks[_slot].tag = (uint8_t)tag;
+    }
+
+    Scope::~Scope() {
+        if (_slot >= 0) s_tasks[_slot].tag = (uint8_t)_previous;
+    }
+
+    const char* tagName(HeapTag tag) {
+        switch (tag) {
+            case HeapTag::Other:   return "Other";
+            case HeapTag::Modbus:  return "Modbus";
+            case HeapTag::Influx:  return "Influx";
+            case HeapTag::MQTT:    return "MQTT";
+            case HeapTag::Web:     return "Web";
+            case HeapTag::Json:    return "Json";
+            case HeapTag::Storage: return "Storage";
+            default:               return "?";
+        }
+    }
+
+    TagStats tagStats(HeapTag tag) {
+        TagStats s{};
+        if ((size_t)tag >= TAG_COUNT) return s;
+        const Counters& c = s_counters[(size_t)tag];
+        s.liveBytes = c.liveBytes;
+        s.liveAllocs = c.liveAllocs;
+        s.allocs = c.allocs;
+        s.allocBytes = c.allocBytes;
+        MutexLock lock(s_mutex);
+        s.allocsPerSec = s_rates[(size_t)tag].allocsPerSec;
+        s.bytesPerSec = s_rates[(size_t)tag].bytesPerSec;
+        return s;
+    }
+
+    void* allocate(size_t size) {
+        return allocTagged(size, currentTag());
+    }
+
+    void* reallocate(void* ptr, size_t size) {
+        return reallocTagged(ptr, size, currentTag());
+    }
+
+    void release(void* ptr) {
+        if (!ptr) return;
+#if HEAP_MONITOR_TAGGING
+        Header* h = (Header*)ptr - 1;
+        if (h->magic == HEADER_MAGIC) {
+            countFree(h->tag, h->size);
+            h->magic = 0;  // a second free of the same block is not counted twice
+            free(h);
+            return;
+        }
+#endif
+        free(ptr);
+    }
+
+    ArduinoJson::Allocator* jsonAllocator() {
+        return &s_jsonAllocator;
+    }
+
+    void loop() {
+        if (!s_mutex) s_mutex = xSemaphoreCreateMutex();
+        const uint32_t now = (uint32_t)millis();
+        if (s_sampled && (uint32_t)(now - s_lastSampleMs) < HEAP_MONITOR_INTERVAL_MS) return;
+        sampleHeap(now);
+    }
+
+    void toJson(JsonObject obj) {
+        obj["tagging"] = (bool)HEAP_MONITOR_TAGGING;
+        heapJson(obj["internal"].to<JsonObject>(), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        heapJson(obj["heap8bit"].to<JsonObject>(), MALLOC_CAP_8BIT);
+
+        JsonArray tags = obj["tags"].to<JsonArray>();
+        for (size_t i = 0; i < TAG_COUNT; i++) {
+            const TagStats s = tagStats((HeapTag)i);
+            JsonObject t = tags.add<JsonObject>();
+            t["tag"] = tagName((HeapTag)i);
+            t["liveBytes"] = s.liveBytes;
+            t["liveAllocs"] = s.liveAllocs;
+            t["allocs"] = s.allocs;
+            t["allocsPerSec"] = s.allocsPerSec;
+            t["bytesPerSec"] = s.bytesPerSec;
+        }
+
+        JsonObject history = obj["history"].to<JsonObject>();
+        history["intervalMs"] = (uint32_t)HEAP_MONITOR_INTERVAL_MS;
+        JsonArray fields = history["fields"].to<JsonArray>();
+        for (const char* f : {"uptimeS", "freeInternal", "minFreeInternal", "largestInternal",
+                              "free8bit", "minFree8bit", "largest8bit"}) {
+            fields.add(f);
+        }
+
+        // Oldest first
+        MutexLock lock(s_mutex);
+        JsonArray samples = history["samples"].to<JsonArray>();
+        const size_t start = (s_historyHead + HEAP_MONITOR_HISTORY - s_historyCount) % HEAP_MONITOR_HISTORY;
+        for (size_t i = 0; i < s_historyCount; i++) {
+            const HeapSample& s = s_history[(start + i) % HEAP_MONITOR_HISTORY];
+            JsonArray row = samples.add<JsonArray>();
+            row.add(s.uptimeS);
+            row.add(s.freeInternal);
+            row.add(s.minFreeInternal);
+            row.add(s.largestInternal);
+            row.add(s.free8);
+            row.add(s.minFree8);
+            row.add(s.largest8);
+        }
+    }
+
+    void setup(WebServerFeature& server) {
+        if (!s_mutex) s_mutex = xSemaphoreCreateMutex();
+
+        server.getServer()->on("/api/heap", HTTP_GET, [&server](AsyncWebServerRequest* request) {
+            if (!server.authenticate(request)) return request->requestAuthentication();
+            JsonDocument doc;
+            toJson(doc.to<JsonObject>());
+            ApiEncoding::send(request, 200, doc);
+        });
+    }
+}
+
+#if HEAP_MONITOR_TAGGING
+// Replacements of the global allocation functions; aligned variants keep the defaults
+
+namespace {
+    [[noreturn]] void outOfMemory() {
+#if defined(__cpp_exceptions)
+        throw std::bad_alloc();
+#else
+        abort();
+#endif
+    }
+}
+
+void* operator new(size_t size) {
+    void* p = HeapMonitor::allocate(size);
+    if (!p) outOfMemory();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    void* p = HeapMonitor::allocate(size);
+    if (!p) outOfMemory();
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return HeapMonitor::allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return HeapMonitor::allocate(size);
+}
+
+void operator delete(void* ptr) noexcept { HeapMonitor::release(ptr); }
+void operator delete[](void* ptr) noexcept { HeapMonitor::release(ptr); }
+void operator delete(void* ptr, size_t) noexcept { HeapMonitor::release(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { HeapMonitor::release(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { HeapMonitor::release(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { HeapMonitor::release(ptr); }
+#endif
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+class WebServerFeature;
+
+// Attribute C++ heap allocations (new/delete) to tags. Costs 8 bytes per allocation.
+#ifndef HEAP_MONITOR_TAGGING
+#define HEAP_MONITOR_TAGGING 1
+#endif
+
+// Heap statistics sampling interval and number of samples kept
+#ifndef HEAP_MONITOR_INTERVAL_MS
+#define HEAP_MONITOR_INTERVAL_MS 30000
+#endif
+
+#ifndef HEAP_MONITOR_HISTORY
+#define HEAP_MONITOR_HISTORY 60
+#endif
+
+// Tasks that can have a tag of their own (scopes or a default by task name)
+#ifndef HEAP_MONITOR_MAX_TASKS
+#define HEAP_MONITOR_MAX_TASKS 16
+#endif
+
+enum class HeapTag : uint8_t {
+    Other,
+    Modbus,
+    Influx,
+    MQTT,
+    Web,
+    Json,
+    Storage,
+    Count
+};
+
+/**
+ * Heap instrumentation.
+ *
+ * Every C++ allocation (operator new, so containers, std::function, new'd
+ * objects) is attributed to the current tag of the allocating task and
+ * carries it in a small header, so the free is attributed to the same tag.
+ * Plain malloc() users (String, lwIP) are not tagged; ArduinoJson documents
+ * are if they use jsonAllocator().
+ *
+ * The tag of a task is set with a Scope; the async_tcp task defaults to Web.
+ * Independent of tagging, free/min-free/largest-block of the internal and
+ * the 8-bit heap are sampled every HEAP_MONITOR_INTERVAL_MS into a history.
+ *
+ * Usage:
+ *   { HeapMonitor::Scope heap(HeapTag::Modbus); modbus.loop(); }
+ *   JsonDocument doc(HeapMonitor::jsonAllocator());
+ *   In loop(): HeapMonitor::loop();
+ */
+namespace HeapMonitor {
+    class Scope {
+    public:
+        explicit Scope(HeapTag tag);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        int _slot;
+        HeapTag _previous;
+    };
+
+    struct TagStats {
+        int32_t liveBytes;          // allocated minus freed
+        uint32_t liveAllocs;
+        uint32_t allocs;            // since boot
+        uint32_t allocBytes;        // since boot (wraps)
+        float allocsPerSec;         // last interval
+        float bytesPerSec;
+    };
+
+    const char* tagName(HeapTag tag);
+    TagStats tagStats(HeapTag tag);
+
+    // Counts allocations into the current tag; for malloc() based allocators
+    void* allocate(size_t size);
+    void* reallocate(void* ptr, size_t size);
+    void release(void* ptr);
+
+    // ArduinoJson allocator that attributes document memory to HeapTag::Json
+    ArduinoJson::Allocator* jsonAllocator();
+
+    // Samples the heap when the interval has elapsed; call from loop()
+    void loop();
+
+    void toJson(JsonObject obj);
+
+    // GET /api/heap
+    void setup(WebServerFeature& server);
+}
@@ -1,6 +1,10 @@
+#define LOG_CATEGORY LogCategory::InfluxDB
+
 #include "InfluxDBFeature.h"
 #include "LoggingFeature.h"
-#include <WiFi.h>
+#include "Hal.h"
+#include "LoopScheduler.h"
+#include "Trace.h"
 
 // InfluxDB 2.x constructor
 InfluxDBFeature::InfluxDBFeature(const char* serverUrl,
@@ -95,10 +99,21 @@ void InfluxDBFeature::setup() {
     _ready = true;
 }
 
+uint32_t InfluxDBFeature::dueInMs() {
+    if (!_enabled || !_ready) return NOT_DUE;
+    if (!_incoming.empty()) return 0;                               // queue() wakes us
+    if (_buffer.empty()) return NOT_DUE;
+    if (!Hal::networkConnected()) return NOT_DUE;                   // WiFi events wake the loop
+    if (_buffer.size() >= _batchSize) return 0;
+    if (_batchIntervalMs == 0) return NOT_DUE;
+    return LoopScheduler::remainingMs(Hal::millis() - _lastUploadTime, _batchIntervalMs);
+}
+
 void InfluxDBFeature::loop() {
     if (!_enabled || !_ready) return;
+    if (!_incoming.empty()) drainIncoming();
     if (_buffer.empty()) return;
-    if (WiFi.status() != WL_CONNECTED) return;
+    if (!Hal::networkConnected()) return;
     
     bool shouldUpload = false;
     
@@ -108,7 +123,7 @@ void InfluxDBFeature::loop() {
     }
     
     // Check interval trigger
-    if (_batchIntervalMs > 0 && (millis() - _lastUploadTime >= _batchIntervalMs)) {
+    if (_batchIntervalMs > 0 && (Hal::millis() - _lastUploadTime >= _batchIntervalMs)) {
         shouldUpload = true;
     }
     
@@ -120,34 +135,49 @@ void InfluxDBFeature::loop() {
 void InfluxDBFeature::queue(const String& lineProtocol) {
     if (!_enabled) return;
     if (lineProtocol.length() == 0) return;
-    
-    // Handle multi-line input (split by newlines)
-    int start = 0;
-    int end;
-    while ((end = lineProtocol.indexOf('\n', start)) != -1) {
-        String line = lineProtocol.substring(start, end);
-        line.trim();
-        if (line.length() > 0) {
-            _buffer.push_back(line);
+
+    if (!_incoming.push(lineProtocol)) {
+        const uint32_t dropped = ++_dropped;
+        if (dropped == 1 || dropped % 100 == 0) {
+            LOG_W("InfluxDB queue full, %lu writes dropped so far", (unsigned long)dropped);
         }
-        start = end + 1;
+        return;
     }
-    
-    // Handle last line (or single line without newline)
-    if (start < (int)lineProtocol.length()) {
-        String line = lineProtocol.substring(start);
-        line.trim();
-        if (line.length() > 0) {
-            _buffer.push_back(line);
+    LoopScheduler::wake();
+}
+
+void InfluxDBFeature::drainIncoming() {
+    String lineProtocol;
+    while (_incoming.pop(lineProtocol)) {
+        // Handle multi-line input (split by newlines)
+        int start = 0;
+        int end;
+        while ((end = lineProtocol.indexOf('\n', start)) != -1) {
+            String line = lineProtocol.substring(start, end);
+            line.trim();
+            if (line.length() > 0) {
+                _buffer.push_back(line);
+            }
+            start = end + 1;
+        }
+
+        // Handle last line (or single line without newline)
+        if (start < (int)lineProtocol.length()) {
+            String line = lineProtocol.substring(start);
+            line.trim();
+            if (line.length() > 0) {
+                _buffer.push_back(line);
+            }
         }
     }
-    
-    LOG_V("InfluxDB: queued %u lines, buffer size: %u", 1, _buffer.size());
+    _bufferedLines = _buffer.size();
+    LOG_V("InfluxDB: buffer size: %u", _buffer.size());
 }
 
 bool InfluxDBFeature::upload() {
     if (!_enabled || _buffer.empty()) return true;
-    if (WiFi.status() != WL_CONNECTED) {
+    TRACE_SCOPE("influx.upload", _buffer.size());
+    if (!Hal::networkConnected()) {
         LOG_W("InfluxDB upload skipped: WiFi not connected");
         return false;
     }
@@ -166,18 +196,19 @@ bool InfluxDBFeature::upload() {
     if (sendData(payload)) {
         _stats.successCount++;
         _stats.totalPointsWritten += lineCount;
-        _stats.lastUploadMs = millis();
+        _stats.lastUploadMs = Hal::millis();
         _connected = true;
         _buffer.clear();
-        _lastUploadTime = millis();
+        _bufferedLines = 0;
+        _lastUploadTime = Hal::millis();
         LOG_D("InfluxDB upload successful");
         return true;
     } else {
         _stats.failCount++;
         _connected = false;
-        if (millis() - _lastErrorLog >= _errorLogIntervalMs) {
+        if (Hal::millis() - _lastErrorLog >= _errorLogIntervalMs) {
             LOG_W("InfluxDB upload failed, keeping %u lines in buffer", _buffer.size());
-            _lastErrorLog = millis();
+            _lastErrorLog = Hal::millis();
         } else {
             LOG_V("InfluxDB upload failed (throttled), buffer=%u", _buffer.size());
         }
@@ -232,9 +263,9 @@ bool InfluxDBFeature::sendData(const String& data) {
     } else if (httpCode > 0) {
         // Got response but not success
         String response = http.getString();
-        if (millis() - _lastErrorLog >= _errorLogIntervalMs) {
+        if (Hal::millis() - _lastErrorLog >= _errorLogIntervalMs) {
             LOG_E("InfluxDB error %d: %s", httpCode, response.c_str());
-            _lastErrorLog = millis();
+            _lastErrorLog = Hal::millis();
         } else {
             LOG_V("InfluxDB error %d (throttled)", httpCode);
         }
@@ -242,9 +273,9 @@ bool InfluxDBFeature::sendData(const String& data) {
         return false;
     } else {
         // Connection error
-        if (millis() - _lastErrorLog >= _errorLogIntervalMs) {
+        if (Hal::millis() - _lastErrorLog >= _errorLogIntervalMs) {
             LOG_E("InfluxDB connection error: %s", http.errorToString(httpCode).c_str());
-            _lastErrorLog = millis();
+            _lastErrorLog = Hal::millis();
         } else {
             LOG_V("InfluxDB connection error (throttled)");
         }
@@ -3,8 +3,29 @@
 
 #include <Arduino.h>
 #include <HTTPClient.h>
+#include <atomic>
 #include <vector>
 #include "Feature.h"
+#include "MpscQueue.h"
+
+// queue() calls that may wait for the InfluxDB task before data is dropped
+#ifndef INFLUXDB_QUEUE_DEPTH
+#define INFLUXDB_QUEUE_DEPTH 32
+#endif
+
+// Stack of the upload task; 0 keeps uploads in the loop task
+#ifndef INFLUXDB_TASK_STACK
+#define INFLUXDB_TASK_STACK 8192
+#endif
+
+// Core 0 is shared with WiFi and lwIP, which the upload mostly waits for
+#ifndef INFLUXDB_TASK_CORE
+#define INFLUXDB_TASK_CORE 0
+#endif
+
+#ifndef INFLUXDB_TASK_PRIORITY
+#define INFLUXDB_TASK_PRIORITY 1
+#endif
 
 /**
  * @brief InfluxDB data writer using line protocol over HTTP
@@ -48,11 +69,17 @@ public:
     
     void setup() override;
     void loop() override;
+    uint8_t dependencies() const override { return NEEDS_NETWORK; }
+    uint32_t dueInMs() override;
+    TaskConfig taskConfig() const override {
+        // No task for an unconfigured server
+        return TaskConfig{_enabled ? (uint32_t)INFLUXDB_TASK_STACK : 0u, INFLUXDB_TASK_PRIORITY, INFLUXDB_TASK_CORE};
+    }
     const char* getName() const override { return "InfluxDB"; }
     bool isReady() const override { return _ready; }
     
     /**
-     * @brief Queue line protocol data for batch upload
+     * @brief Queue line protocol data for batch upload (any task)
      * @param lineProtocol Line protocol formatted string (single or multi-line)
      */
     void queue(const String& lineProtocol);
@@ -69,9 +96,25 @@ public:
     bool isConnected() const { return _connected; }
     
     /**
-     * @brief Get number of pending lines
+     * @brief Get number of pending lines (plus queue() calls not yet split into lines)
      */
-    size_t pendingCount() const { return _buffer.size(); }
+    size_t pendingCount() const { return _bufferedLines.load() + _incoming.size(); }
+
+    /**
+     * @brief queue() calls dropped because the upload task fell behind
+     */
+    uint32_t droppedCount() const { return _dropped.load(); }
+
+    /**
+     * @brief Get upload statistics
+     */
+    struct Stats {
+        uint32_t successCount;
+        uint32_t failCount;
+        uint32_t totalPointsWritten;
+        uint32_t lastUploadMs;
+    };
+    const Stats& getStats() const { return _stats; }
 
 private:
     // Throttle repeated error logging to avoid spamming the serial console
@@ -87,26 +130,16 @@ private:
     /**
      * @brief Clear pending buffer
      */
-    void clearBuffer() { _buffer.clear(); }
+    void clearBuffer() { _buffer.clear(); _bufferedLines = 0; }
     
     /**
      * @brief Set batch interval
      */
     void setBatchInterval(uint32_t ms) { _batchIntervalMs = ms; }
     
-    /**
-     * @brief Get upload statistics
-     */
-    struct Stats {
-        uint32_t successCount;
-        uint32_t failCount;
-        uint32_t totalPointsWritten;
-        uint32_t lastUploadMs;
-    };
-    const Stats& getStats() const { return _stats; }
-
 private:
     bool sendData(const String& data);
+    void drainIncoming();
     
     // Constructor for internal use (V1 mode)
     InfluxDBFeature(const char* serverUrl,
@@ -129,7 +162,10 @@ private:
     size_t _batchSize;
     bool _isV1;             // true = InfluxDB 1.x, false = 2.x
     
-    std::vector<String> _buffer;
+    MpscQueue<String> _incoming{INFLUXDB_QUEUE_DEPTH};  // queue() to the task running loop()
+    std::vector<String> _buffer;                        // only touched by the task running loop()
+    std::atomic<size_t> _bufferedLines{0};
+    std::atomic<uint32_t> _dropped{0};
     bool _ready;
     bool _connected;
     bool _enabled;
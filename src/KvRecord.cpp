@@ -0,0 +1,52 @@
+#include "KvRecord.h"
+#include <string.h>
+#include <esp_rom_crc.h>
+
+namespace {
+    uint32_t recordCrc(const KvRecord::Header& h, const char* key, const void* value) {
+        uint32_t crc = esp_rom_crc32_le(0, &h.keyLen, sizeof(h.keyLen) + sizeof(h.valueLen));
+        crc = esp_rom_crc32_le(crc, (const uint8_t*)key, h.keyLen);
+        if (h.valueLen != KvRecord::TOMBSTONE && h.valueLen > 0) {
+            crc = esp_rom_crc32_le(crc, (const uint8_t*)value, h.valueLen);
+        }
+        return crc;
+    }
+}
+
+namespace KvRecord {
+    size_t encode(const char* key, size_t keyLen, const void* value, uint16_t valueLen, uint8_t* out) {
+        const size_t dataLen = valueLen == TOMBSTONE ? 0 : valueLen;
+        if (keyLen == 0 || keyLen > KV_MAX_KEY || dataLen > KV_MAX_VALUE) return 0;
+
+        Header h;
+        h.magic = MAGIC;
+        h.keyLen = (uint8_t)keyLen;
+        h.valueLen = valueLen;
+        h.crc = recordCrc(h, key, value);
+
+        memcpy(out, &h, sizeof(h));
+        memcpy(out + sizeof(h), key, keyLen);
+        if (dataLen > 0) memcpy(out + sizeof(h) + keyLen, value, dataLen);
+        return size(keyLen, dataLen);
+    }
+
+    size_t replay(const ReadFn& read, const ApplyFn& apply) {
+        size_t good = 0;
+        Header h;
+        char key[KV_MAX_KEY + 1];
+        uint8_t value[KV_MAX_VALUE];
+        while (read((uint8_t*)&h, sizeof(h)) == sizeof(h)) {
+            if (h.magic != MAGIC || h.keyLen == 0 || h.keyLen > KV_MAX_KEY) break;
+            const size_t valueLen = h.valueLen == TOMBSTONE ? 0 : h.valueLen;
+            if (valueLen > KV_MAX_VALUE) break;
+            if (read((uint8_t*)key, h.keyLen) != h.keyLen) break;
+            if (valueLen > 0 && read(value, valueLen) != valueLen) break;
+            if (recordCrc(h, key, value) != h.crc) break;
+
+            key[h.keyLen] = '\0';
+            apply(key, h.valueLen == TOMBSTONE ? nullptr : value, valueLen);
+            good += size(h.keyLen, valueLen);
+        }
+        return good;
+    }
+}
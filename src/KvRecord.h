@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+#ifndef KV_MAX_KEY
+#define KV_MAX_KEY 32
+#endif
+
+#ifndef KV_MAX_VALUE
+#define KV_MAX_VALUE 256
+#endif
+
+/**
+ * Record format of the KvStore log.
+ *
+ * Encoding and replay without any file system, so the native env can test
+ * recovery from torn and corrupt logs (test/). KvStore adds the file, the
+ * in-RAM index and compaction around them.
+ *
+ * A record is a header (magic, key length, value length, CRC-32 over
+ * lengths, key and value) followed by the key and the value. A value
+ * length of TOMBSTONE marks a removed key and carries no value.
+ */
+namespace KvRecord {
+    constexpr uint8_t MAGIC = 0xA5;
+    constexpr uint16_t TOMBSTONE = 0xFFFF;
+
+    struct Header {
+        uint8_t magic;
+        uint8_t keyLen;
+        uint16_t valueLen;      // TOMBSTONE = removed
+        uint32_t crc;           // over keyLen, valueLen, key and value
+    };
+
+    constexpr size_t size(size_t keyLen, size_t valueLen) { return sizeof(Header) + keyLen + valueLen; }
+
+    constexpr size_t MAX_SIZE = size(KV_MAX_KEY, KV_MAX_VALUE);
+
+    /**
+     * @brief Encode one record
+     * @param valueLen TOMBSTONE to remove the key (value is ignored)
+     * @param out At least MAX_SIZE bytes
+     * @return Record size, 0 if the key or value is too long
+     */
+    size_t encode(const char* key, size_t keyLen, const void* value, uint16_t valueLen, uint8_t* out);
+
+    // Reads up to len bytes, fewer only at the end of the log
+    using ReadFn = std::function<size_t(uint8_t* buffer, size_t len)>;
+
+    // One replayed record; value is nullptr for a removed key. key is terminated.
+    using ApplyFn = std::function<void(const char* key, const uint8_t* value, size_t valueLen)>;
+
+    /**
+     * @brief Replay a log up to the first incomplete or corrupt record
+     * @return Bytes of valid records; less than the log size means a damaged tail
+     */
+    size_t replay(const ReadFn& read, const ApplyFn& apply);
+}
@@ -0,0 +1,224 @@
+#define LOG_CATEGORY LogCategory::Storage
+
+#include "KvStore.h"
+#include "LoggingFeature.h"
+#include "LoopScheduler.h"
+#include "MutexLock.h"
+
+KvStore::KvStore(StorageFeature& storage, const char* path)
+    : _storage(storage)
+    , _path(path)
+    , _loaded(false)
+    , _loadAttempted(false)
+    , _liveBytes(0)
+    , _logBytes(0)
+    , _appends(0)
+    , _compactions(0)
+    , _discardedBytes(0)
+    , _mutex(nullptr)
+{
+}
+
+void KvStore::setup() {
+    if (!_mutex) _mutex = xSemaphoreCreateMutex();
+    if (_loadAttempted || !_storage.isReady()) return;  // retried from loop()
+
+    _loadAttempted = true;
+    MutexLock lock(_mutex);
+    _loaded = load();
+    if (_loaded) {
+        LOG_I("KV store %s: %u keys, %u/%u bytes live", _path, _values.size(), _liveBytes, _logBytes);
+    } else {
+        LOG_E("KV store %s unavailable", _path);
+    }
+}
+
+uint32_t KvStore::dueInMs() {
+    if (!_loaded) return _loadAttempted ? NOT_DUE : 0;
+    return (_logBytes < KV_COMPACT_MIN_BYTES || _logBytes < 2 * _liveBytes) ? NOT_DUE : 0;
+}
+
+void KvStore::loop() {
+    if (!_loaded) {
+        if (!_loadAttempted) setup();
+        return;
+    }
+
+    // Compaction only here, never on the put() path
+    if (_logBytes < KV_COMPACT_MIN_BYTES || _logBytes < 2 * _liveBytes) return;
+    MutexLock lock(_mutex);
+    const size_t before = _logBytes;
+    if (compact()) {
+        LOG_D("KV store compacted: %u -> %u bytes", before, _logBytes);
+    }
+}
+
+bool KvStore::openLog() {
+    const uint32_t t0 = micros();
+    _log = LittleFS.open(_path, "a");
+    StorageFeature::recordOp(StorageFeature::FsOp::Open, t0);
+    if (!_log) {
+        LOG_E("Failed to open %s for appending", _path);
+        return false;
+    }
+    return true;
+}
+
+bool KvStore::load() {
+    _values.clear();
+
+    File file = LittleFS.open(_path, "r");
+    if (!file) {
+        _logBytes = 0;
+        _liveBytes = 0;
+        return openLog();
+    }
+
+    // Replay records; the first one that is incomplete or fails its CRC ends the log
+    StorageFeature::Reader reader(file);
+    const size_t size = reader.size();
+    const size_t good = KvRecord::replay(
+        [&reader](uint8_t* buffer, size_t len) { return reader.read(buffer, len); },
+        [this](const char* key, const uint8_t* value, size_t valueLen) {
+            if (value) {
+                _values[key].assign(value, value + valueLen);
+            } else {
+                _values.erase(key);
+            }
+        });
+    reader.close();
+
+    _liveBytes = 0;
+    for (const auto& kv : _values) _liveBytes += KvRecord::size(kv.first.length(), kv.second.size());
+
+    if (good < size) {
+        // Appends after the damaged tail would never be replayed: rewrite the valid part
+        _discardedBytes = size - good;
+        LOG_W("KV store %s: dropped %u bytes of incomplete records", _path, _discardedBytes);
+        return compact();
+    }
+
+    _logBytes = size;
+    return openLog();
+}
+
+bool KvStore::append(const char* key, size_t keyLen, const void* data, uint16_t valueLen) {
+    uint8_t record[KvRecord::MAX_SIZE];
+    const size_t n = KvRecord::encode(key, keyLen, data, valueLen, record);
+
+    // One write per record; a reset in between leaves a torn tail that load() drops
+    uint32_t t0 = micros();
+    const size_t written = _log ? _log.write(record, n) : 0;
+    StorageFeature::recordOp(StorageFeature::FsOp::Write, t0, written);
+    if (written != n) {
+        LOG_E("KV store append failed (%s)", key);
+        compact();
+        return false;
+    }
+    t0 = micros();
+    _log.flush();
+    StorageFeature::recordOp(StorageFeature::FsOp::Sync, t0);
+    _logBytes += n;
+    _appends++;
+    return true;
+}
+
+bool KvStore::compact() {
+    if (_log) _log.close();
+
+    StorageFeature::Writer writer = _storage.openWriter(_path, StorageFeature::WRITE_ATOMIC);
+    if (!writer) {
+        openLog();
+        return false;
+    }
+
+    uint8_t record[KvRecord::MAX_SIZE];
+    for (const auto& kv : _values) {
+        const size_t n = KvRecord::encode(kv.first.c_str(), kv.first.length(), kv.second.data(),
+                                          (uint16_t)kv.second.size(), record);
+        writer.write(record, n);
+    }
+    if (!writer.close()) {
+        LOG_E("KV store compaction failed");
+        openLog();
+        return false;
+    }
+
+    _logBytes = _liveBytes;
+    _compactions++;
+    return openLog();
+}
+
+bool KvStore::putBytes(const char* key, const void* data, size_t len) {
+    const size_t keyLen = key ? strlen(key) : 0;
+    if (!_loaded || keyLen == 0 || keyLen > KV_MAX_KEY || len > KV_MAX_VALUE) return false;
+
+    MutexLock lock(_mutex);
+    auto it = _values.find(key);
+    if (it != _values.end() && it->second.size() == len &&
+        (len == 0 || memcmp(it->second.data(), data, len) == 0)) {
+        return true;  // unchanged, nothing to write
+    }
+    if (!append(key, keyLen, data, (uint16_t)len)) return false;
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    if (it != _values.end()) {
+        _liveBytes -= KvRecord::size(keyLen, it->second.size());
+        it->second.assign(bytes, bytes + len);
+    } else {
+        _values[key].assign(bytes, bytes + len);
+    }
+    _liveBytes += KvRecord::size(keyLen, len);
+    return true;
+}
+
+size_t KvStore::getBytes(const char* key, void* data, size_t maxLen) const {
+    MutexLock lock(_mutex);
+    auto it = _values.find(key);
+    if (it == _values.end() || it->second.size() > maxLen) return 0;
+    memcpy(data, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+bool KvStore::putString(const char* key, const String& value) {
+    return putBytes(key, value.c_str(), value.length());
+}
+
+String KvStore::getString(const char* key, const String& defaultValue) const {
+    MutexLock lock(_mutex);
+    auto it = _values.find(key);
+    if (it == _values.end()) return defaultValue;
+    String result;
+    result.concat((const char*)it->second.data(), it->second.size());
+    return result;
+}
+
+bool KvStore::contains(const char* key) const {
+    MutexLock lock(_mutex);
+    return _values.count(key) > 0;
+}
+
+bool KvStore::remove(const char* key) {
+    if (!_loaded || !key) return false;
+
+    MutexLock lock(_mutex);
+    auto it = _values.find(key);
+    if (it == _values.end()) return true;
+    const size_t keyLen = it->first.length();
+    if (!append(key, keyLen, nullptr, KvRecord::TOMBSTONE)) return false;
+    _liveBytes -= KvRecord::size(keyLen, it->second.size());
+    _values.erase(it);
+    return true;
+}
+
+KvStore::Stats KvStore::getStats() const {
+    MutexLock lock(_mutex);
+    Stats s;
+    s.keys = _values.size();
+    s.liveBytes = _liveBytes;
+    s.logBytes = _logBytes;
+    s.appends = _appends;
+    s.compactions = _compactions;
+    s.discardedBytes = _discardedBytes;
+    return s;
+}
@@ -0,0 +1,117 @@
+#ifndef KV_STORE_H
+#define KV_STORE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <map>
+#include <type_traits>
+#include <vector>
+#include "Feature.h"
+#include "KvRecord.h"
+#include "StorageFeature.h"
+
+// Compact when the log is this big and at least twice the live data
+#ifndef KV_COMPACT_MIN_BYTES
+#define KV_COMPACT_MIN_BYTES 8192
+#endif
+
+/**
+ * @brief Persistent key/value store for small, frequently updated state
+ *
+ * Every put()/remove() appends one checksummed record (KvRecord) to a log
+ * file, so an update costs a few dozen bytes of flash instead of a file
+ * rewrite. All
+ * live values are kept in RAM; get() never touches flash.
+ *
+ * On load the log is replayed up to the first torn or corrupt record (power
+ * loss during an append); everything before it is kept. Superseded records
+ * are dropped by compaction from loop(), which writes the live set to a new
+ * file and renames it over the log, so a reset at any point leaves either
+ * the old or the new log.
+ *
+ * Thread safe; values are limited to KV_MAX_VALUE bytes, keys to KV_MAX_KEY.
+ */
+class KvStore : public Feature {
+public:
+    struct Stats {
+        size_t keys;
+        size_t liveBytes;       // bytes the live records need on flash
+        size_t logBytes;        // current log file size
+        uint32_t appends;
+        uint32_t compactions;
+        uint32_t discardedBytes; // torn/corrupt tail dropped at load
+    };
+
+    KvStore(StorageFeature& storage, const char* path = "/kv.log");
+
+    void setup() override;
+    void loop() override;
+    uint8_t dependencies() const override { return NEEDS_STORAGE; }
+    uint32_t dueInMs() override;
+    const char* getName() const override { return "KvStore"; }
+    bool isReady() const override { return _loaded; }
+
+    /**
+     * @brief Store a trivially copyable value (number, struct, array)
+     * @return false if not loaded, key/value too long or the append failed
+     */
+    template <typename T>
+    bool put(const char* key, const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "use putBytes() or putString()");
+        return putBytes(key, &value, sizeof(T));
+    }
+
+    /**
+     * @brief Read a value stored with put<T>()
+     * @return false if missing or stored with a different size
+     */
+    template <typename T>
+    bool get(const char* key, T& value) const {
+        static_assert(std::is_trivially_copyable<T>::value, "use getBytes() or getString()");
+        return getBytes(key, &value, sizeof(T)) == sizeof(T);
+    }
+
+    template <typename T>
+    T get(const char* key, const T& defaultValue) const {
+        T value;
+        return get(key, value) ? value : defaultValue;
+    }
+
+    bool putString(const char* key, const String& value);
+    String getString(const char* key, const String& defaultValue = String()) const;
+
+    bool putBytes(const char* key, const void* data, size_t len);
+
+    /**
+     * @brief Copy a value
+     * @return Value size if it fits into maxLen, 0 if missing or too big
+     */
+    size_t getBytes(const char* key, void* data, size_t maxLen) const;
+
+    bool contains(const char* key) const;
+    bool remove(const char* key);
+
+    Stats getStats() const;
+
+private:
+    bool load();
+    bool append(const char* key, size_t keyLen, const void* data, uint16_t valueLen);
+    bool compact();
+    bool openLog();
+
+    StorageFeature& _storage;
+    const char* _path;
+    bool _loaded;
+    bool _loadAttempted;
+    File _log;                  // open for appending
+    std::map<String, std::vector<uint8_t>> _values;
+    size_t _liveBytes;
+    size_t _logBytes;
+    uint32_t _appends;
+    uint32_t _compactions;
+    uint32_t _discardedBytes;
+    SemaphoreHandle_t _mutex;
+};
+
+#endif // KV_STORE_H
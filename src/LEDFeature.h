@@ -2,6 +2,7 @@
 #define LED_FEATURE_H
 
 #include "Feature.h"
+#include "LoopScheduler.h"
 #include <Arduino.h>
 
 /**
@@ -50,6 +51,11 @@ public:
         }
     }
     
+    uint32_t dueInMs() override {
+        if (!_setupComplete || !_isPulsing) return NOT_DUE;
+        return LoopScheduler::remainingMs(millis() - _pulseStartTime, _pulseDurationMs);
+    }
+    
     const char* getName() const override {
         return "LED";
     }
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+
+/**
+ * @brief Latency histogram with power-of-two microsecond buckets
+ *
+ * Bucket 0 counts durations below 16 us, bucket i (1..14) durations in
+ * [2^(i+3), 2^(i+4)) us, the last bucket everything from 262 ms up.
+ * Recording is a few instructions under a spinlock, so it can be used on
+ * hot paths and from any task.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 16;
+
+    struct Snapshot {
+        uint32_t count;
+        uint64_t sumUs;
+        uint32_t maxUs;
+        uint32_t buckets[BUCKETS];
+
+        uint32_t avgUs() const { return count ? (uint32_t)(sumUs / count) : 0; }
+
+        /**
+         * @brief Upper bound of the bucket holding the given percentile
+         * @param p Percentile 0..100
+         */
+        uint32_t percentileUs(uint8_t p) const {
+            if (count == 0) return 0;
+            const uint64_t rank = ((uint64_t)count * p + 99) / 100;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < BUCKETS; i++) {
+                seen += buckets[i];
+                if (seen >= rank && seen > 0) return i + 1 < BUCKETS ? upperBoundUs(i) : maxUs;
+            }
+            return maxUs;
+        }
+
+        /**
+         * @brief count, avgUs, maxUs, p50Us, p90Us, p95Us, p99Us and the bucket counts
+         */
+        void toJson(JsonObject obj) const {
+            obj["count"] = count;
+            obj["avgUs"] = avgUs();
+            obj["maxUs"] = maxUs;
+            obj["p50Us"] = percentileUs(50);
+            obj["p90Us"] = percentileUs(90);
+            obj["p95Us"] = percentileUs(95);
+            obj["p99Us"] = percentileUs(99);
+            JsonArray arr = obj["buckets"].to<JsonArray>();
+            for (size_t i = 0; i < BUCKETS; i++) arr.add(buckets[i]);
+        }
+    };
+
+    // Exclusive upper bound of bucket i in microseconds (last bucket: open ended)
+    static constexpr uint32_t upperBoundUs(size_t i) { return 16u << i; }
+
+    void record(uint32_t us) {
+        const uint32_t bits = us ? 32 - __builtin_clz(us) : 0;
+        size_t i = bits <= 4 ? 0 : bits - 4;
+        if (i >= BUCKETS) i = BUCKETS - 1;
+
+        portENTER_CRITICAL(&_mux);
+        _buckets[i]++;
+        _count++;
+        _sumUs += us;
+        if (us > _maxUs) _maxUs = us;
+        portEXIT_CRITICAL(&_mux);
+    }
+
+    Snapshot snapshot() const {
+        Snapshot s;
+        portENTER_CRITICAL(&_mux);
+        s.count = _count;
+        s.sumUs = _sumUs;
+        s.maxUs = _maxUs;
+        memcpy(s.buckets, _buckets, sizeof(_buckets));
+        portEXIT_CRITICAL(&_mux);
+        return s;
+    }
+
+    void reset() {
+        portENTER_CRITICAL(&_mux);
+        memset(_buckets, 0, sizeof(_buckets));
+        _count = 0;
+        _sumUs = 0;
+        _maxUs = 0;
+        portEXIT_CRITICAL(&_mux);
+    }
+
+private:
+    mutable portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    uint32_t _buckets[BUCKETS] = {};
+    uint32_t _count = 0;
+    uint64_t _sumUs = 0;
+    uint32_t _maxUs = 0;
+};
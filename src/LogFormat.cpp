@@ -0,0 +1,91 @@
+#include "LogFormat.h"
+#include <stdio.h>
+#include <algorithm>
+
+namespace LogFormat {
+    void render(const char* format, const uint8_t* args, size_t argBytes, char* out, size_t size) {
+        const uint8_t* arg = args;
+        const uint8_t* argEnd = arg + argBytes;
+        size_t n = 0;
+
+        for (const char* f = format; *f && n + 1 < size;) {
+            if (*f != '%') {
+                out[n++] = *f++;
+                continue;
+            }
+            if (f[1] == '%') {
+                out[n++] = '%';
+                f += 2;
+                continue;
+            }
+
+            // Rebuild the conversion as %[flags][width][.precision]<conv>; the length
+            // modifier is implied by the stored argument type
+            char spec[16];
+            size_t sl = 0;
+            spec[sl++] = *f++;
+            while (*f && strchr("-+ #0123456789.", *f) && sl < sizeof(spec) - 4) spec[sl++] = *f++;
+            while (*f && strchr("hlLjzt", *f)) f++;
+            if (!*f) break;
+            const char conv = *f++;
+
+            const char type = arg < argEnd ? (char)*arg++ : 0;
+            int written = -1;
+            switch (type) {
+                case 'i': {
+                    uint32_t v;
+                    memcpy(&v, arg, sizeof(v));
+                    arg += sizeof(v);
+                    spec[sl++] = conv;
+                    spec[sl] = 0;
+                    if (conv == 'd' || conv == 'i' || conv == 'c') written = snprintf(out + n, size - n, spec, (int)v);
+                    else if (strchr("ouxX", conv)) written = snprintf(out + n, size - n, spec, (unsigned)v);
+                    break;
+                }
+                case 'l': {
+                    uint64_t v;
+                    memcpy(&v, arg, sizeof(v));
+                    arg += sizeof(v);
+                    spec[sl++] = 'l';
+                    spec[sl++] = 'l';
+                    spec[sl++] = conv;
+                    spec[sl] = 0;
+                    if (conv == 'd' || conv == 'i') written = snprintf(out + n, size - n, spec, (long long)v);
+                    else if (strchr("ouxX", conv)) written = snprintf(out + n, size - n, spec, (unsigned long long)v);
+                    break;
+                }
+                case 'd': {
+                    double v;
+                    memcpy(&v, arg, sizeof(v));
+                    arg += sizeof(v);
+                    spec[sl++] = conv;
+                    spec[sl] = 0;
+                    if (strchr("fFeEgGaA", conv)) written = snprintf(out + n, size - n, spec, v);
+                    break;
+                }
+                case 's': {
+                    const char* v = (const char*)arg;
+                    arg += strnlen(v, argEnd - arg) + 1;
+                    spec[sl++] = conv;
+                    spec[sl] = 0;
+                    if (conv == 's') written = snprintf(out + n, size - n, spec, v);
+                    break;
+                }
+                case 'p': {
+                    uintptr_t v;
+                    memcpy(&v, arg, sizeof(v));
+                    arg += sizeof(v);
+                    if (conv == 'p') written = snprintf(out + n, size - n, "%p", (void*)v);
+                    break;
+                }
+                default:
+                    break;  // argument missing (did not fit)
+            }
+
+            // Argument type does not match the conversion, or is missing
+            if (written < 0) written = snprintf(out + n, size - n, "?");
+            n += std::min((size_t)written, size - n - 1);
+        }
+        out[n] = 0;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+/**
+ * Deferred log message encoding.
+ *
+ * LOG_x calls only pack their arguments behind the format literal
+ * (ArgWriter); the drain task turns them into text later (render). Pure
+ * functions without queue, clock or output, so the native env can test and
+ * benchmark both halves (test/).
+ */
+namespace LogFormat {
+    // Serializes arguments as <type><value>: 'i' 32 bit, 'l' 64 bit, 'd' double,
+    // 's' zero terminated copy, 'p' pointer. Arguments that don't fit are dropped.
+    struct ArgWriter {
+        uint8_t* p;
+        uint8_t* end;
+
+        template<typename V>
+        void raw(char type, V v) {
+            if ((size_t)(end - p) < 1 + sizeof(V)) { p = end; return; }
+            *p++ = (uint8_t)type;
+            memcpy(p, &v, sizeof(V));
+            p += sizeof(V);
+        }
+
+        void string(const char* s) {
+            if (!s) s = "(null)";
+            if (end - p < 2) { p = end; return; }
+            *p++ = 's';
+            const size_t n = strnlen(s, end - p - 1);
+            memcpy(p, s, n);
+            p += n;
+            *p++ = 0;
+        }
+
+        template<typename T>
+        void put(T v) {
+            if constexpr (std::is_same<T, const char*>::value || std::is_same<T, char*>::value) {
+                string(v);
+            } else if constexpr (std::is_floating_point<T>::value) {
+                raw('d', (double)v);
+            } else if constexpr (std::is_integral<T>::value || std::is_enum<T>::value) {
+                if constexpr (sizeof(T) <= 4) raw('i', (uint32_t)v);
+                else raw('l', (uint64_t)v);
+            } else if constexpr (std::is_null_pointer<T>::value) {
+                raw('p', (uintptr_t)0);
+            } else if constexpr (std::is_pointer<T>::value) {
+                raw('p', (uintptr_t)v);
+            } else {
+                static_assert(sizeof(T) == 0, "unsupported log argument type");
+            }
+        }
+    };
+
+    /**
+     * @brief Format packed arguments like printf would have
+     * Length modifiers of the format are ignored (the packed type decides);
+     * a missing or mismatching argument prints "?". Output is truncated to
+     * size - 1 characters and always terminated.
+     * @param format printf format the arguments were packed for
+     * @param args Output of an ArgWriter
+     * @param argBytes Bytes the ArgWriter used
+     */
+    void render(const char* format, const uint8_t* args, size_t argBytes, char* out, size_t size);
+}
@@ -0,0 +1,136 @@
+#include "LogRing.h"
+#include "MutexLock.h"
+
+namespace {
+    // Headers hold an int64_t; keep every record 8 byte aligned
+    inline size_t align8(size_t n) { return (n + 7) & ~(size_t)7; }
+}
+
+LogRing::LogRing()
+    : _buf(nullptr)
+    , _capacity(0)
+    , _head(0)
+    , _tail(0)
+    , _wrapAt(0)
+    , _count(0)
+    , _firstSeq(1)
+    , _nextSeq(1)
+    , _mutex(nullptr)
+{
+}
+
+bool LogRing::begin(size_t capacity) {
+    if (_buf || capacity < 256) return _buf != nullptr;
+
+    _mutex = xSemaphoreCreateMutex();
+    if (!_mutex) return false;
+    _buf = (uint8_t*)malloc(capacity);
+    if (!_buf) {
+        vSemaphoreDelete(_mutex);
+        _mutex = nullptr;
+        return false;
+    }
+    _capacity = capacity & ~(size_t)7;
+    _wrapAt = _capacity;
+    return true;
+}
+
+void LogRing::evictOldest() {
+    const Header* h = (const Header*)(_buf + _tail);
+    _tail += h->size;
+    _count--;
+    _firstSeq++;
+    if (_tail >= _wrapAt) {
+        _tail = 0;
+        _wrapAt = _capacity;
+    }
+}
+
+void LogRing::append(uint8_t level, uint8_t category, int64_t us, const char* text) {
+    if (!_buf) return;
+
+    size_t len = strlen(text);
+    const size_t maxLen = std::min<size_t>(_capacity / 4, UINT16_MAX) - sizeof(Header) - 8;
+    if (len > maxLen) len = maxLen;
+    const size_t need = align8(sizeof(Header) + len + 1);
+
+    MutexLock lock(_mutex);
+    for (;;) {
+        if (_count == 0) {
+            _head = _tail = 0;
+            _wrapAt = _capacity;
+        }
+        if (_count == 0 || _head > _tail) {
+            // Free space is [head, capacity)
+            if (_head + need <= _capacity) break;
+            _wrapAt = _head;
+            _head = 0;
+        } else {
+            // Free space is [head, tail)
+            if (_head + need <= _tail) break;
+            evictOldest();
+        }
+    }
+
+    Header* h = (Header*)(_buf + _head);
+    h->size = (uint16_t)need;
+    h->level = level;
+    h->category = category;
+    h->seq = _nextSeq++;
+    h->us = us;
+    char* dst = (char*)(h + 1);
+    memcpy(dst, text, len);
+    dst[len] = 0;
+
+    _head += need;
+    _count++;
+}
+
+bool LogRing::next(Cursor& cursor, Entry& entry, char* text, size_t textSize) {
+    if (!_buf) return false;
+
+    MutexLock lock(_mutex);
+    if (_count == 0 || (int32_t)(cursor.seq - (_nextSeq - 1)) >= 0) return false;
+
+    size_t pos;
+    if ((int32_t)(cursor.seq - _firstSeq) < 0) {
+        // Everything after the cursor is still here (or it fell behind): oldest record
+        pos = _tail;
+    } else if (cursor.pos != NO_POS) {
+        // The record at cursor.seq is still here, so the one after it has not moved
+        pos = cursor.pos >= _wrapAt ? 0 : cursor.pos;
+    } else {
+        // Unknown position: skip the records the reader already has
+        pos = _tail;
+        for (uint32_t skip = cursor.seq - _firstSeq + 1; skip > 0; skip--) {
+            pos += ((const Header*)(_buf + pos))->size;
+            if (pos >= _wrapAt) pos = 0;
+        }
+    }
+
+    const Header* h = (const Header*)(_buf + pos);
+    entry.seq = h->seq;
+    entry.us = h->us;
+    entry.level = h->level;
+    entry.category = h->category;
+    if (textSize > 0) {
+        strncpy(text, (const char*)(h + 1), textSize - 1);
+        text[textSize - 1] = 0;
+    }
+
+    cursor.seq = h->seq;
+    cursor.pos = pos + h->size;
+    return true;
+}
+
+uint32_t LogRing::firstSeq() {
+    if (!_buf) return 0;
+    MutexLock lock(_mutex);
+    return _firstSeq;
+}
+
+uint32_t LogRing::lastSeq() {
+    if (!_buf) return 0;
+    MutexLock lock(_mutex);
+    return _nextSeq - 1;
+}
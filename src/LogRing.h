@@ -0,0 +1,87 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+/**
+ * @brief RAM history of recent log messages
+ *
+ * Variable length records in a fixed byte buffer; the oldest records are
+ * overwritten. Each record gets a sequence number (starting at 1, no gaps),
+ * so readers can resume with "everything after seq N" and detect what they
+ * missed by comparing N with firstSeq().
+ *
+ * The buffer is allocated once in begin(). One writer (the log drain task)
+ * and any number of readers; access is serialized by a mutex, never taken
+ * on the logging call path.
+ */
+class LogRing {
+public:
+    struct Entry {
+        uint32_t seq;
+        int64_t us;         // esp_timer time of the logging call
+        uint8_t level;
+        uint8_t category;
+    };
+
+    LogRing();
+
+    /**
+     * @brief Allocate the buffer (0 = disabled)
+     */
+    bool begin(size_t capacity);
+
+    bool isEnabled() const { return _buf != nullptr; }
+
+    void append(uint8_t level, uint8_t category, int64_t us, const char* text);
+
+    /**
+     * @brief Read position of a reader
+     * Remembers where the record after seq starts, so reading on costs the
+     * same for every record instead of a walk from the oldest one.
+     */
+    struct Cursor {
+        uint32_t seq;       // last record read (0 = none)
+        size_t pos;         // offset of the record after seq, NO_POS if unknown
+
+        explicit Cursor(uint32_t afterSeq = 0) : seq(afterSeq), pos(NO_POS) {}
+    };
+
+    /**
+     * @brief Copy the oldest record with a sequence number > cursor.seq
+     * and move the cursor past it
+     * @return false if there is none
+     */
+    bool next(Cursor& cursor, Entry& entry, char* text, size_t textSize);
+
+    uint32_t firstSeq();    // oldest record still available
+    uint32_t lastSeq();     // newest record (0 = none yet)
+    size_t capacity() const { return _capacity; }
+
+private:
+    static constexpr size_t NO_POS = (size_t)-1;
+
+    struct Header {
+        uint16_t size;      // bytes including header and padding
+        uint8_t level;
+        uint8_t category;
+        uint32_t seq;
+        int64_t us;
+    };
+
+    void evictOldest();
+
+    uint8_t* _buf;
+    size_t _capacity;
+    size_t _head;           // next write offset
+    size_t _tail;           // oldest record offset
+    size_t _wrapAt;         // records end here and continue at 0 (== _capacity if not wrapped)
+    size_t _count;
+    uint32_t _firstSeq;
+    uint32_t _nextSeq;
+    SemaphoreHandle_t _mutex;
+};
+
+#endif // LOG_RING_H
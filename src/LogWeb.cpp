@@ -0,0 +1,202 @@
+#define LOG_CATEGORY LogCategory::Web
+
+#include "LogWeb.h"
+#include "LogRing.h"
+#include "LoggingFeature.h"
+#include "WebServerFeature.h"
+#include "ApiEncoding.h"
+#include <ArduinoJson.h>
+#include <atomic>
+#include <memory>
+
+namespace {
+    static constexpr size_t DEFAULT_LIMIT = 50;
+    static constexpr size_t MAX_LIMIT = 100;
+    static constexpr int MAX_STREAMS = 2;
+    static constexpr uint32_t KEEPALIVE_MS = 15000;
+
+    std::atomic<int> s_streams{0};
+
+    void fillEntry(JsonObject obj, const LogRing::Entry& e, const char* text) {
+        obj["seq"] = e.seq;
+        obj["us"] = e.us;
+        obj["level"] = LoggingFeature::levelLabel(e.level);
+        obj["cat"] = LoggingFeature::categoryName((LogCategory)e.category);
+        obj["msg"] = text;
+    }
+
+    uint32_t parseSeq(const String& s) {
+        return (uint32_t)strtoul(s.c_str(), nullptr, 10);
+    }
+
+    struct Stream {
+        LogRing::Cursor cursor;
+        uint32_t lastSendMs{0};
+        String pending;
+        size_t pendingPos{0};
+
+        Stream() { s_streams++; }
+        ~Stream() { s_streams--; }
+    };
+
+    // Next SSE event (or keepalive comment) into st.pending; false if nothing to send
+    bool nextEvent(Stream& st, LogRing& ring) {
+        LogRing::Entry e;
+        char text[LOG_MESSAGE_MAX];
+        if (ring.next(st.cursor, e, text, sizeof(text))) {
+            JsonDocument doc;
+            fillEntry(doc.to<JsonObject>(), e, text);
+            st.pending = "id: ";
+            st.pending += e.seq;
+            st.pending += "\nevent: log\ndata: ";
+            serializeJson(doc, st.pending);
+            st.pending += "\n\n";
+            return true;
+        }
+        if ((uint32_t)(millis() - st.lastSendMs) >= KEEPALIVE_MS) {
+            st.pending = ": keepalive\n\n";
+            return true;
+        }
+        return false;
+    }
+}
+
+void LogWeb::setup(WebServerFeature& server) {
+    // Sub-paths first: a handler for /api/logs also matches /api/logs/...
+    server.getServer()->on("/api/logs/levels", HTTP_GET, [&server](AsyncWebServerRequest* request) {
+        if (!server.authenticate(request)) return request->requestAuthentication();
+
+        LoggingFeature* logging = LoggingFeature::getInstance();
+        if (!logging) {
+            request->send(503, "application/json", "{\"error\":\"Logging not available\"}");
+            return;
+        }
+
+        JsonDocument doc;
+        doc["serial"] = LoggingFeature::levelLabel(logging->getSerialLogLevel());
+        doc["syslog"] = LoggingFeature::levelLabel(logging->isSyslogEnabled() ? logging->getSyslogLogLevel() : LOG_LEVEL_OFF);
+        doc["ring"] = LoggingFeature::levelLabel(logging->getRingLogLevel());
+        JsonObject categories = doc["categories"].to<JsonObject>();
+        for (size_t i = 0; i < (size_t)LogCategory::Count; i++) {
+            categories[LoggingFeature::categoryName((LogCategory)i)] =
+                LoggingFeature::levelLabel(logging->getCategoryLevel((LogCategory)i));
+        }
+        ApiEncoding::send(request, 200, doc);
+    });
+
+    server.getServer()->on("/api/logs/levels", HTTP_POST, [&server](AsyncWebServerRequest* request) {
+        if (!server.authenticate(request)) return request->requestAuthentication();
+
+        LoggingFeature* logging = LoggingFeature::getInstance();
+        if (!logging) {
+            request->send(503, "application/json", "{\"error\":\"Logging not available\"}");
+            return;
+        }
+        if (!request->hasParam("category", true) || !request->hasParam("level", true)) {
+            request->send(400, "application/json", "{\"error\":\"Missing category or level parameter\"}");
+            return;
+        }
+
+        const String category = request->getParam("category", true)->value();
+        const String level = request->getParam("level", true)->value();
+        bool persisted = false;
+        if (!logging->applyCategoryLevel(category.c_str(), level.c_str(), true, &persisted)) {
+            request->send(400, "application/json", "{\"error\":\"Unknown category or level\"}");
+            return;
+        }
+
+        JsonDocument doc;
+        doc["category"] = category;
+        doc["level"] = level;
+        doc["persisted"] = persisted;
+        ApiEncoding::send(request, 200, doc);
+    });
+
+    server.getServer()->on("/api/logs/stream", HTTP_GET, [&server](AsyncWebServerRequest* request) {
+        if (!server.authenticate(request)) return request->requestAuthentication();
+
+        LoggingFeature* logging = LoggingFeature::getInstance();
+        if (!logging || !logging->getRing().isEnabled()) {
+            request->send(503, "application/json", "{\"error\":\"Log history disabled\"}");
+            return;
+        }
+        if (s_streams.load() >= MAX_STREAMS) {
+            request->send(503, "application/json", "{\"error\":\"Too many log streams\"}");
+            return;
+        }
+        LogRing& ring = logging->getRing();
+
+        auto st = std::make_shared<Stream>();
+        if (request->hasHeader("Last-Event-ID")) {
+            st->cursor = LogRing::Cursor(parseSeq(request->getHeader("Last-Event-ID")->value()));
+        } else if (request->hasParam("after")) {
+            st->cursor = LogRing::Cursor(parseSeq(request->getParam("after")->value()));
+        } else {
+            st->cursor = LogRing::Cursor(ring.lastSeq());  // live tail only
+        }
+        st->pending = "retry: 2000\n\n";
+        st->lastSendMs = millis();
+
+        // Chunked response that never ends; the filler is polled again when it
+        // returns RESPONSE_TRY_AGAIN, so no task is blocked while waiting for logs
+        AsyncWebServerResponse* response = request->beginChunkedResponse(
+            "text/event-stream",
+            [st, &ring](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+                (void)index;
+                size_t written = 0;
+                while (written < maxLen) {
+                    if (st->pendingPos >= st->pending.length()) {
+                        st->pending = "";
+                        st->pendingPos = 0;
+                        if (!nextEvent(*st, ring)) break;
+                        continue;
+                    }
+                    const size_t n = std::min(maxLen - written, st->pending.length() - st->pendingPos);
+                    memcpy(buffer + written, st->pending.c_str() + st->pendingPos, n);
+                    written += n;
+                    st->pendingPos += n;
+                }
+                if (written == 0) return RESPONSE_TRY_AGAIN;
+                st->lastSendMs = millis();
+                return written;
+            });
+        response->addHeader("Cache-Control", "no-cache");
+        request->send(response);
+    });
+
+    server.getServer()->on("/api/logs", HTTP_GET, [&server](AsyncWebServerRequest* request) {
+        if (!server.authenticate(request)) return request->requestAuthentication();
+
+        LoggingFeature* logging = LoggingFeature::getInstance();
+        if (!logging || !logging->getRing().isEnabled()) {
+            request->send(503, "application/json", "{\"error\":\"Log history disabled\"}");
+            return;
+        }
+        LogRing& ring = logging->getRing();
+
+        const uint32_t after = request->hasParam("after") ? parseSeq(request->getParam("after")->value()) : 0;
+        size_t limit = DEFAULT_LIMIT;
+        if (request->hasParam("limit")) {
+            const long l = request->getParam("limit")->value().toInt();
+            limit = l <= 0 ? DEFAULT_LIMIT : std::min<size_t>((size_t)l, MAX_LIMIT);
+        }
+
+        JsonDocument doc;
+        doc["first"] = ring.firstSeq();
+        doc["last"] = ring.lastSeq();
+        doc["level"] = LoggingFeature::levelLabel(logging->getRingLogLevel());
+        JsonArray entries = doc["entries"].to<JsonArray>();
+
+        LogRing::Entry e;
+        char text[LOG_MESSAGE_MAX];
+        LogRing::Cursor cursor(after);
+        while (entries.size() < limit && ring.next(cursor, e, text, sizeof(text))) {
+            fillEntry(entries.add<JsonObject>(), e, text);
+        }
+        // Resume with after=next; more=true means call again right away
+        doc["next"] = cursor.seq;
+        doc["more"] = (int32_t)(cursor.seq - ring.lastSeq()) < 0;
+
+        ApiEncoding::send(request, 200, doc);
+    });
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Arduino.h>
+
+class WebServerFeature;
+
+/**
+ * @brief Web access to the RAM log history
+ *
+ * - GET /api/logs?after=<seq>[&limit=<n>]: records newer than seq (JSON)
+ * - GET /api/logs/stream[?after=<seq>]: live tail as Server-Sent Events;
+ *   browsers resume after reconnects via Last-Event-ID
+ * - GET/POST /api/logs/levels: output and per category log levels
+ */
+class LogWeb {
+public:
+    static void setup(WebServerFeature& server);
+};
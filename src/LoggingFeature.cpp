@@ -1,11 +1,35 @@
 #include "LoggingFeature.h"
+#include "LoopScheduler.h"
 #include <stdarg.h>
 #include <time.h>
 #include <WiFi.h>
+#include <esp_timer.h>
+#include <Preferences.h>
+
+// Retry delay after the syslog hostname could not be resolved
+static constexpr uint32_t SYSLOG_RESOLVE_RETRY_MS = 30000;
+static constexpr uint32_t SYSLOG_TCP_MAX_BACKOFF_MS = 60000;
+
+// A formatted syslog line (message + header + frame prefix) always fits a batch
+static_assert(LOG_SYSLOG_BATCH_MAX >= LOG_MESSAGE_MAX + 96 + 8, "LOG_SYSLOG_BATCH_MAX too small");
 
 // Static instance pointer
 LoggingFeature* LoggingFeature::_instance = nullptr;
 
+// All zero (nothing logged) until the instance is constructed
+uint8_t LoggingFeature::categoryGate[(size_t)LogCategory::Count] = {};
+
+static const char* const CATEGORY_NAMES[(size_t)LogCategory::Count] = {
+    "General", "ModbusRTU", "ModbusDevice", "InfluxDB", "MQTT",
+    "Web", "WiFi", "Storage", "Time", "System"
+};
+
+static const char* const LEVEL_LABELS[] = { "off", "error", "warn", "info", "debug", "verbose" };
+
+// NVS namespace/key of the persisted category levels
+static const char* const PREFS_NAMESPACE = "logging";
+static const char* const PREFS_CATEGORY_LEVELS = "catLevels";
+
 LoggingFeature::LoggingFeature(uint32_t baudRate,
                                uint8_t serialBootLogLevel,
                                uint8_t serialRuntimeLogLevel,
@@ -29,8 +53,24 @@ LoggingFeature::LoggingFeature(uint32_t baudRate,
     , _syslogEnabled(strlen(syslogServer) > 0)
     , _inBootPhase(true)
     , _bootStartTime(0)
+    , _ringLogLevel(LOG_RING_LEVEL)
+    , _syslogResolved(false)
+    , _syslogResolvedMs(0)
+    , _tcpRetryMs(0)
+    , _tcpBackoffMs(1000)
+    , _syslogBatchLen(0)
+    , _enqueuePos(0)
+    , _dequeuePos(0)
+    , _dropped(0)
+    , _droppedTotal(0)
+    , _drainTask(nullptr)
 {
+    for (uint32_t i = 0; i < LOG_QUEUE_LENGTH; i++) {
+        _queue[i].seq.store(i, std::memory_order_relaxed);
+    }
+    memset(_categoryLevels, LOG_LEVEL_VERBOSE, sizeof(_categoryLevels));
     _instance = this;
+    updateGates();
 }
 
 void LoggingFeature::setup() {
@@ -52,12 +92,31 @@ void LoggingFeature::setup() {
     Serial.printf("  Serial runtime log level: %d\n", _serialRuntimeLogLevel);
     Serial.printf("  Boot phase duration: %lu ms\n", _bootDurationMs);
     if (_syslogEnabled) {
-        Serial.printf("  Syslog: %s:%d (level %d)\n", _syslogServer, _syslogPort, _syslogLogLevel);
+        static const char* const protocols[] = { "udp/3164", "udp/5424", "tcp/5424" };
+        Serial.printf("  Syslog: %s:%d %s (level %d)\n", _syslogServer, _syslogPort,
+                      protocols[LOG_SYSLOG_PROTOCOL], _syslogLogLevel);
     } else {
         Serial.println("  Syslog: disabled");
     }
     Serial.println("=================================");
     Serial.println();
+
+    if (LOG_RING_SIZE > 0 && !_ring.begin(LOG_RING_SIZE)) {
+        Serial.println("Log history buffer allocation failed");
+    }
+    loadCategoryLevels();
+    updateGates();
+
+    // Below the loop task priority: output only happens when nothing else is runnable
+    if (xTaskCreatePinnedToCore(drainTask, "logDrain", 4096, this, 0, &_drainTask, tskNO_AFFINITY) != pdPASS) {
+        _drainTask = nullptr;
+        Serial.println("Log drain task failed, logging synchronously");
+    }
+}
+
+uint32_t LoggingFeature::dueInMs() {
+    // Only the end of the boot phase is timed, the drain task does the rest
+    return _inBootPhase ? LoopScheduler::remainingMs(millis() - _bootStartTime, _bootDurationMs) : NOT_DUE;
 }
 
 void LoggingFeature::loop() {
@@ -65,6 +124,7 @@ void LoggingFeature::loop() {
     if (_inBootPhase && (millis() - _bootStartTime >= _bootDurationMs)) {
         _inBootPhase = false;
         _serialLogLevel = _serialRuntimeLogLevel;
+        updateGates();
         info("Boot phase ended, serial log level changed to %d", _serialRuntimeLogLevel);
     }
 }
@@ -73,24 +133,29 @@ LoggingFeature* LoggingFeature::getInstance() {
     return _instance;
 }
 
-String LoggingFeature::getTimestamp() {
+void LoggingFeature::printTimestamp(int64_t us, time_t epoch) {
+    if (!_enableTimestamp) return;
+
+    // Same validity rule as getLocalTime(): time is synced once the year is past 2016
     struct tm timeinfo;
-    if (getLocalTime(&timeinfo, 0)) {
-        // We have valid time from NTP
+    localtime_r(&epoch, &timeinfo);
+    if (timeinfo.tm_year > (2016 - 1900)) {
         char buffer[20];
         strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
-        return String(buffer);
+        Serial.printf("[%s] ", buffer);
     } else {
-        // Use millis() as fallback
-        return String(millis()) + "ms";
+        Serial.printf("[%lums] ", (unsigned long)(us / 1000));
     }
 }
 
-void LoggingFeature::printTimestamp() {
-    if (!_enableTimestamp) return;
-    Serial.print("[");
-    Serial.print(getTimestamp());
-    Serial.print("] ");
+const char* LoggingFeature::levelName(uint8_t level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR:   return "ERROR";
+        case LOG_LEVEL_WARN:    return "WARN ";
+        case LOG_LEVEL_INFO:    return "INFO ";
+        case LOG_LEVEL_DEBUG:   return "DEBUG";
+        default:                return "VERB ";
+    }
 }
 
 uint8_t LoggingFeature::logLevelToSyslogSeverity(uint8_t level) {
@@ -104,16 +169,16 @@ uint8_t LoggingFeature::logLevelToSyslogSeverity(uint8_t level) {
     }
 }
 
-void LoggingFeature::logToSerial(uint8_t level, const char* levelStr, const char* message) {
+void LoggingFeature::logToSerial(uint8_t level, const char* message, int64_t us, time_t epoch) {
     if (level > _serialLogLevel || _serialLogLevel == LOG_LEVEL_OFF) return;
     
-    printTimestamp();
-    Serial.print(levelStr);
+    printTimestamp(us, epoch);
+    Serial.print(levelName(level));
     Serial.print(": ");
     Serial.println(message);
 }
 
-void LoggingFeature::logToSyslog(uint8_t level, const char* message) {
+void LoggingFeature::logToSyslog(uint8_t level, const char* message, time_t epoch) {
     if (!_syslogEnabled) return;
     if (level > _syslogLogLevel || _syslogLogLevel == LOG_LEVEL_OFF) return;
     if (WiFi.status() != WL_CONNECTED) return;
@@ -122,73 +187,373 @@ void LoggingFeature::logToSyslog(uint8_t level, const char* message) {
     uint8_t severity = logLevelToSyslogSeverity(level);
     uint8_t pri = SYSLOG_FACILITY_USER + severity;
     
-    // Build syslog message (RFC 3164 BSD format)
-    // <PRI>TIMESTAMP HOSTNAME TAG: MESSAGE
-    char syslogMsg[512];
-    
+    char line[LOG_MESSAGE_MAX + 96];
     struct tm timeinfo;
-    char timestamp[20];
-    if (getLocalTime(&timeinfo, 0)) {
+    char timestamp[24];
+    const bool synced = localtime_r(&epoch, &timeinfo) && timeinfo.tm_year > (2016 - 1900);
+
+#if LOG_SYSLOG_PROTOCOL == SYSLOG_PROTOCOL_UDP_3164
+    // RFC 3164 BSD format: <PRI>TIMESTAMP HOSTNAME TAG: MESSAGE
+    if (synced) {
         // RFC 3164 timestamp format: "Mmm dd hh:mm:ss"
         strftime(timestamp, sizeof(timestamp), "%b %d %H:%M:%S", &timeinfo);
     } else {
         strcpy(timestamp, "-");
     }
-    
-    snprintf(syslogMsg, sizeof(syslogMsg), "<%d>%s %s %s: %s",
-             pri, timestamp, _hostname, FIRMWARE_NAME, message);
-    
-    // Send via UDP
-    _udp.beginPacket(_syslogServer, _syslogPort);
-    _udp.write((const uint8_t*)syslogMsg, strlen(syslogMsg));
+    int len = snprintf(line, sizeof(line), "<%d>%s %s %s: %s",
+                       pri, timestamp, _hostname, FIRMWARE_NAME, message);
+#else
+    // RFC 5424: <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID SD MSG
+    if (synced) {
+        gmtime_r(&epoch, &timeinfo);
+        strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
+    } else {
+        strcpy(timestamp, "-");
+    }
+    int len = snprintf(line, sizeof(line), "<%d>1 %s %s %s - - - %s",
+                       pri, timestamp, (_hostname && *_hostname) ? _hostname : "-", FIRMWARE_NAME, message);
+#endif
+    if (len <= 0) return;
+    appendSyslog(line, std::min((size_t)len, sizeof(line) - 1));
+}
+
+void LoggingFeature::appendSyslog(const char* line, size_t len) {
+#if LOG_SYSLOG_PROTOCOL == SYSLOG_PROTOCOL_TCP_5424
+    // RFC 6587 octet counting: "<len> <message>"
+    char prefix[8];
+    const size_t prefixLen = snprintf(prefix, sizeof(prefix), "%u ", (unsigned)len);
+#elif LOG_SYSLOG_UDP_BATCH
+    const char* prefix = "\n";
+    const size_t prefixLen = _syslogBatchLen > 0 ? 1 : 0;
+#else
+    const char* prefix = "";
+    const size_t prefixLen = 0;
+#endif
+    if (_syslogBatchLen + prefixLen + len > sizeof(_syslogBatch)) {
+        flushSyslog();
+#if LOG_SYSLOG_UDP_BATCH && LOG_SYSLOG_PROTOCOL != SYSLOG_PROTOCOL_TCP_5424
+        // First message of the datagram needs no separator
+        appendSyslog(line, len);
+        return;
+#endif
+    }
+    memcpy(_syslogBatch + _syslogBatchLen, prefix, prefixLen);
+    memcpy(_syslogBatch + _syslogBatchLen + prefixLen, line, len);
+    _syslogBatchLen += prefixLen + len;
+
+#if LOG_SYSLOG_PROTOCOL != SYSLOG_PROTOCOL_TCP_5424 && !LOG_SYSLOG_UDP_BATCH
+    flushSyslog();  // one message per datagram
+#endif
+}
+
+bool LoggingFeature::resolveSyslog() {
+    const uint32_t nowMs = millis();
+    if (_syslogResolvedMs != 0) {
+        const uint32_t ageMs = nowMs - _syslogResolvedMs;
+        if (_syslogResolved && ageMs < LOG_SYSLOG_DNS_REFRESH_MS) return true;
+        if (!_syslogResolved && ageMs < SYSLOG_RESOLVE_RETRY_MS) return false;
+    }
+    _syslogResolvedMs = nowMs ? nowMs : 1;
+
+    // A failed refresh keeps the previous address
+    IPAddress ip;
+    if (ip.fromString(_syslogServer) || WiFi.hostByName(_syslogServer, ip) == 1) {
+        if (_syslogResolved && ip != _syslogIp) _tcp.stop();
+        _syslogIp = ip;
+        _syslogResolved = true;
+    }
+    return _syslogResolved;
+}
+
+bool LoggingFeature::connectSyslog() {
+    if (_tcp.connected()) return true;
+
+    const uint32_t nowMs = millis();
+    if ((int32_t)(nowMs - _tcpRetryMs) < 0) return false;
+
+    if (_tcp.connect(_syslogIp, _syslogPort, 2000)) {
+        _tcpBackoffMs = 1000;
+        return true;
+    }
+    _tcpRetryMs = nowMs + _tcpBackoffMs;
+    _tcpBackoffMs = std::min(_tcpBackoffMs * 2, SYSLOG_TCP_MAX_BACKOFF_MS);
+    return false;
+}
+
+void LoggingFeature::flushSyslog() {
+    if (_syslogBatchLen == 0) return;
+    const size_t len = _syslogBatchLen;
+    _syslogBatchLen = 0;  // on failure the batch is lost, like a lost datagram
+
+    if (WiFi.status() != WL_CONNECTED || !resolveSyslog()) return;
+
+#if LOG_SYSLOG_PROTOCOL == SYSLOG_PROTOCOL_TCP_5424
+    // Blocks while the send window is full; the log queue absorbs (and counts) the overflow
+    if (!connectSyslog()) return;
+    if (_tcp.write((const uint8_t*)_syslogBatch, len) != len) {
+        _tcp.stop();
+        _tcpRetryMs = millis() + _tcpBackoffMs;
+    }
+#else
+    _udp.beginPacket(_syslogIp, _syslogPort);
+    _udp.write((const uint8_t*)_syslogBatch, len);
     _udp.endPacket();
+#endif
+}
+
+void LoggingFeature::stamp(LogRecord& record, uint8_t level, LogCategory category) {
+    record.us = esp_timer_get_time();
+    record.epoch = time(nullptr);
+    record.level = level;
+    record.category = (uint8_t)category;
+}
+
+void LoggingFeature::output(const LogRecord& record) {
+    char rendered[LOG_MESSAGE_MAX];
+    const char* message = record.data;
+    if (record.format) {
+        LogFormat::render(record.format, (const uint8_t*)record.data, record.argBytes, rendered, sizeof(rendered));
+        message = rendered;
+    }
+
+    logToSerial(record.level, message, record.us, record.epoch);
+    logToSyslog(record.level, message, record.epoch);
+    if (record.level <= _ringLogLevel) _ring.append(record.level, record.category, record.us, message);
+}
+
+LoggingFeature::Slot* LoggingFeature::claim(uint32_t& pos) {
+    // A cell is free while its seq equals the position
+    pos = _enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot* slot = &_queue[pos & (LOG_QUEUE_LENGTH - 1)];
+        const uint32_t seq = slot->seq.load(std::memory_order_acquire);
+        const int32_t diff = (int32_t)(seq - pos);
+        if (diff == 0) {
+            if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) return slot;
+        } else if (diff < 0) {
+            return nullptr;  // full
+        } else {
+            pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void LoggingFeature::publish(Slot* slot, uint32_t pos) {
+    slot->seq.store(pos + 1, std::memory_order_release);
+    xTaskNotifyGive(_drainTask);
+}
+
+void LoggingFeature::countDrop() {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    _droppedTotal.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool LoggingFeature::dequeue(LogRecord& record) {
+    const uint32_t pos = _dequeuePos.load(std::memory_order_relaxed);
+    Slot& slot = _queue[pos & (LOG_QUEUE_LENGTH - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != pos + 1) return false;  // empty or still being written
+
+    record = slot.record;
+    slot.seq.store(pos + LOG_QUEUE_LENGTH, std::memory_order_release);
+    _dequeuePos.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
+
+void LoggingFeature::drain() {
+    LogRecord record;
+    while (dequeue(record)) {
+        output(record);
+    }
+
+    const uint32_t dropped = _dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        stamp(record, LOG_LEVEL_WARN);
+        record.format = nullptr;
+        snprintf(record.data, sizeof(record.data), "%u log messages dropped (queue full)", (unsigned)dropped);
+        output(record);
+    }
+
+    // Queue is empty: send what the burst collected
+    flushSyslog();
+}
+
+void LoggingFeature::drainTask(void* arg) {
+    LoggingFeature* self = static_cast<LoggingFeature*>(arg);
+    for (;;) {
+        // Woken per message; the timeout catches records published after the last wakeup
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        self->drain();
+    }
+}
+
+bool LoggingFeature::flush(uint32_t timeoutMs) {
+    if (!_drainTask) return true;
+
+    const uint32_t startMs = millis();
+    while (_dequeuePos.load(std::memory_order_relaxed) != _enqueuePos.load(std::memory_order_relaxed)) {
+        if (millis() - startMs >= timeoutMs) return false;
+        xTaskNotifyGive(_drainTask);
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    return true;
 }
 
-void LoggingFeature::log(uint8_t level, const char* levelStr, const char* format, va_list args) {
+void LoggingFeature::log(uint8_t level, const char* format, va_list args) {
     if (!_ready) return;
-    
-    // Format the message once
-    char buffer[256];
-    vsnprintf(buffer, sizeof(buffer), format, args);
-    
-    // Output to serial (respects serial log level)
-    logToSerial(level, levelStr, buffer);
-    
-    // Output to syslog (respects syslog log level)
-    logToSyslog(level, buffer);
+
+    // Nothing to do if no output wants this level
+    if (!wants(level)) return;
+
+    uint32_t pos = 0;
+    Slot* slot = nullptr;
+    LogRecord local;
+    if (_drainTask) {
+        slot = claim(pos);
+        if (!slot) {
+            countDrop();
+            return;
+        }
+    }
+
+    LogRecord& r = slot ? slot->record : local;
+    stamp(r, level);
+    r.format = nullptr;
+    vsnprintf(r.data, sizeof(r.data), format, args);
+
+    if (slot) {
+        publish(slot, pos);
+    } else {
+        output(local);  // synchronous fallback (drain task not running)
+        flushSyslog();
+    }
 }
 
 void LoggingFeature::error(const char* format, ...) {
     va_list args;
     va_start(args, format);
-    log(LOG_LEVEL_ERROR, "ERROR", format, args);
+    log(LOG_LEVEL_ERROR, format, args);
     va_end(args);
 }
 
 void LoggingFeature::warn(const char* format, ...) {
     va_list args;
     va_start(args, format);
-    log(LOG_LEVEL_WARN, "WARN ", format, args);
+    log(LOG_LEVEL_WARN, format, args);
     va_end(args);
 }
 
 void LoggingFeature::info(const char* format, ...) {
     va_list args;
     va_start(args, format);
-    log(LOG_LEVEL_INFO, "INFO ", format, args);
+    log(LOG_LEVEL_INFO, format, args);
     va_end(args);
 }
 
 void LoggingFeature::debug(const char* format, ...) {
     va_list args;
     va_start(args, format);
-    log(LOG_LEVEL_DEBUG, "DEBUG", format, args);
+    log(LOG_LEVEL_DEBUG, format, args);
     va_end(args);
 }
 
 void LoggingFeature::verbose(const char* format, ...) {
     va_list args;
     va_start(args, format);
-    log(LOG_LEVEL_VERBOSE, "VERB ", format, args);
+    log(LOG_LEVEL_VERBOSE, format, args);
     va_end(args);
 }
+
+void LoggingFeature::updateGates() {
+    uint8_t outputs = _serialLogLevel;
+    if (_syslogEnabled && _syslogLogLevel > outputs) outputs = _syslogLogLevel;
+    if (_ring.isEnabled() && _ringLogLevel > outputs) outputs = _ringLogLevel;
+    for (size_t i = 0; i < (size_t)LogCategory::Count; i++) {
+        categoryGate[i] = std::min(_categoryLevels[i], outputs);
+    }
+}
+
+void LoggingFeature::loadCategoryLevels() {
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, true)) return;  // nothing stored yet
+    uint8_t stored[(size_t)LogCategory::Count];
+    const size_t n = prefs.getBytes(PREFS_CATEGORY_LEVELS, stored, sizeof(stored));
+    prefs.end();
+
+    // Categories added by a newer firmware keep their default
+    for (size_t i = 0; i < n; i++) {
+        if (stored[i] <= LOG_LEVEL_VERBOSE) _categoryLevels[i] = stored[i];
+    }
+}
+
+bool LoggingFeature::setCategoryLevel(LogCategory category, uint8_t level, bool persist) {
+    if (level > LOG_LEVEL_VERBOSE) level = LOG_LEVEL_VERBOSE;
+    if (category == LogCategory::Count) {
+        memset(_categoryLevels, level, sizeof(_categoryLevels));
+    } else {
+        _categoryLevels[(uint8_t)category] = level;
+    }
+    updateGates();
+
+    if (!persist) return true;
+
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, false)) return false;
+    const bool stored = prefs.putBytes(PREFS_CATEGORY_LEVELS, _categoryLevels, sizeof(_categoryLevels))
+                        == sizeof(_categoryLevels);
+    prefs.end();
+    return stored;
+}
+
+bool LoggingFeature::applyCategoryLevel(const char* category, const char* level, bool persist,
+                                        bool* persisted) {
+    LogCategory c;
+    uint8_t l;
+    if (!parseCategory(category, c) || !parseLevel(level, l)) return false;
+    const bool stored = setCategoryLevel(c, l, persist);
+    if (persisted) *persisted = persist && stored;
+    if (stored) {
+        info("Log level of %s set to %s", categoryName(c), levelLabel(l));
+    } else {
+        warn("Log level of %s set to %s, storing it failed", categoryName(c), levelLabel(l));
+    }
+    return true;
+}
+
+const char* LoggingFeature::categoryName(LogCategory category) {
+    if (category == LogCategory::Count) return "all";
+    return CATEGORY_NAMES[(uint8_t)category];
+}
+
+bool LoggingFeature::parseCategory(const char* name, LogCategory& category) {
+    if (!name) return false;
+    if (strcasecmp(name, "all") == 0) {
+        category = LogCategory::Count;
+        return true;
+    }
+    for (size_t i = 0; i < (size_t)LogCategory::Count; i++) {
+        if (strcasecmp(name, CATEGORY_NAMES[i]) == 0) {
+            category = (LogCategory)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* LoggingFeature::levelLabel(uint8_t level) {
+    return level <= LOG_LEVEL_VERBOSE ? LEVEL_LABELS[level] : "verbose";
+}
+
+bool LoggingFeature::parseLevel(const char* text, uint8_t& level) {
+    if (!text || !*text) return false;
+    if (isdigit((unsigned char)text[0]) && text[1] == 0 && text[0] - '0' <= LOG_LEVEL_VERBOSE) {
+        level = text[0] - '0';
+        return true;
+    }
+    for (uint8_t i = 0; i <= LOG_LEVEL_VERBOSE; i++) {
+        if (strcasecmp(text, LEVEL_LABELS[i]) == 0) {
+            level = i;
+            return true;
+        }
+    }
+    return false;
+}
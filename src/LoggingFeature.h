@@ -3,7 +3,21 @@
 
 #include <Arduino.h>
 #include <WiFiUdp.h>
+#include <WiFiClient.h>
+#include <atomic>
 #include "Feature.h"
+#include "LogFormat.h"
+#include "LogRing.h"
+
+// Records buffered between the logging call and serial/syslog output (power of 2)
+#ifndef LOG_QUEUE_LENGTH
+#define LOG_QUEUE_LENGTH 32
+#endif
+
+// Longest formatted message; longer ones are truncated
+#ifndef LOG_MESSAGE_MAX
+#define LOG_MESSAGE_MAX 200
+#endif
 
 // Log levels
 #define LOG_LEVEL_OFF     0
@@ -13,9 +27,70 @@
 #define LOG_LEVEL_DEBUG   4
 #define LOG_LEVEL_VERBOSE 5
 
+// Log categories: a source file selects its category by defining LOG_CATEGORY
+// before its first include, e.g. #define LOG_CATEGORY LogCategory::MQTT.
+// Headers compiled into other files name it per call: LOG_CAT_I(LogCategory::MQTT, ...)
+enum class LogCategory : uint8_t {
+    General,
+    ModbusRTU,
+    ModbusDevice,
+    InfluxDB,
+    MQTT,
+    Web,
+    WiFi,
+    Storage,
+    Time,
+    System,
+    Count
+};
+
+#ifndef LOG_CATEGORY
+#define LOG_CATEGORY LogCategory::General
+#endif
+
+// Highest level compiled in: LOG_x macros above it (and their arguments) are removed
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_VERBOSE
+#endif
+
 // Syslog facility codes
 #define SYSLOG_FACILITY_USER   (1 << 3)   // User-level messages
 
+// Syslog transports
+#define SYSLOG_PROTOCOL_UDP_3164  0   // BSD format, one message per datagram
+#define SYSLOG_PROTOCOL_UDP_5424  1   // RFC 5424 format over UDP
+#define SYSLOG_PROTOCOL_TCP_5424  2   // RFC 5424 format, octet-counted framing (RFC 6587)
+
+#ifndef LOG_SYSLOG_PROTOCOL
+#define LOG_SYSLOG_PROTOCOL SYSLOG_PROTOCOL_UDP_3164
+#endif
+
+// UDP only: pack several newline separated messages into one datagram
+// (collector must split datagrams at newlines, e.g. syslog-ng)
+#ifndef LOG_SYSLOG_UDP_BATCH
+#define LOG_SYSLOG_UDP_BATCH 0
+#endif
+
+// Bytes collected before a datagram/TCP write (TCP and batched UDP)
+#ifndef LOG_SYSLOG_BATCH_MAX
+#define LOG_SYSLOG_BATCH_MAX 1400
+#endif
+
+// RAM history of recent messages for /api/logs (bytes, 0 = disabled)
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 8192
+#endif
+
+// Capture level of the RAM history, independent of serial/syslog
+#ifndef LOG_RING_LEVEL
+#define LOG_RING_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Re-resolve the syslog server hostname after this time
+#ifndef LOG_SYSLOG_DNS_REFRESH_MS
+#define LOG_SYSLOG_DNS_REFRESH_MS 600000
+#endif
+
 // Syslog severity codes (RFC 5424)
 #define SYSLOG_SEVERITY_EMERGENCY  0
 #define SYSLOG_SEVERITY_ALERT      1
@@ -32,7 +107,22 @@
  * Supports:
  * - Separate log levels for serial and syslog
  * - Boot log level that transitions to runtime level after specified time
- * - Parallel output to syslog server via UDP
+ * - Parallel output to syslog server via UDP (RFC 3164 or 5424) or TCP
+ *   (RFC 5424 with RFC 6587 octet counting); the server address is resolved
+ *   once and refreshed periodically, messages of a burst are sent together
+ *
+ * Callers only format the message into a lock-free multi-producer queue;
+ * a low priority task drains it to serial and syslog. This keeps slow UART
+ * and network output off time critical paths (e.g. Modbus RTU timing).
+ * If the queue is full the message is dropped and counted.
+ *
+ * The LOG_x macros don't even format: they store the format string pointer
+ * and the raw arguments (strings copied) and the drain task renders them.
+ * Formats must therefore be string literals, which all LOG_x calls use.
+ *
+ * Each category has its own runtime level (persisted in NVS). The macros
+ * check a precomputed per-category gate byte - the lower of the category
+ * level and the highest output level - before evaluating any argument.
  */
 class LoggingFeature : public Feature {
 public:
@@ -60,6 +150,7 @@ public:
     
     void setup() override;
     void loop() override;
+    uint32_t dueInMs() override;
     const char* getName() const override { return "Logging"; }
     bool isReady() const override { return _ready; }
     
@@ -75,10 +166,45 @@ public:
     static LoggingFeature* getInstance();
     
     uint8_t getSerialLogLevel() const { return _serialLogLevel; }
-    void setSerialLogLevel(uint8_t level) { _serialLogLevel = level; }
+    void setSerialLogLevel(uint8_t level) { _serialLogLevel = level; updateGates(); }
     
     uint8_t getSyslogLogLevel() const { return _syslogLogLevel; }
-    void setSyslogLogLevel(uint8_t level) { _syslogLogLevel = level; }
+    void setSyslogLogLevel(uint8_t level) { _syslogLogLevel = level; updateGates(); }
+
+    uint8_t getRingLogLevel() const { return _ringLogLevel; }
+    void setRingLogLevel(uint8_t level) { _ringLogLevel = level; updateGates(); }
+
+    uint8_t getCategoryLevel(LogCategory category) const { return _categoryLevels[(uint8_t)category]; }
+
+    /**
+     * @brief Set the level of one category (LogCategory::Count = all)
+     * @param persist Store all category levels in NVS
+     * @return false if persist was requested and storing failed
+     */
+    bool setCategoryLevel(LogCategory category, uint8_t level, bool persist = true);
+
+    /**
+     * @brief Apply "<category>=<level>" (names or numbers, category "all")
+     * @param persisted If given, receives the result of storing the levels
+     * @return false if category or level is unknown
+     */
+    bool applyCategoryLevel(const char* category, const char* level, bool persist = true,
+                            bool* persisted = nullptr);
+
+    static const char* categoryName(LogCategory category);
+    static bool parseCategory(const char* name, LogCategory& category);
+    static const char* levelLabel(uint8_t level);
+    static bool parseLevel(const char* text, uint8_t& level);
+
+    /**
+     * @brief Per category: highest level that reaches any output (read by the LOG_x macros)
+     */
+    static uint8_t categoryGate[(size_t)LogCategory::Count];
+
+    /**
+     * @brief RAM history of recent messages (filled by the drain task)
+     */
+    LogRing& getRing() { return _ring; }
     
     bool isSyslogEnabled() const { return _syslogEnabled; }
     bool isBootPhase() const { return _inBootPhase; }
@@ -86,12 +212,72 @@ public:
     // Setter for dynamic configuration
     void setHostname(const char* hostname) { _hostname = hostname; }
 
+    /**
+     * @brief Messages dropped because the queue was full (since boot)
+     */
+    uint32_t getDroppedCount() const { return _droppedTotal.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Wait until all queued messages are written (e.g. before restart)
+     * @return true if the queue is empty
+     */
+    bool flush(uint32_t timeoutMs);
+
+    /**
+     * @brief True if serial or syslog output accepts this level
+     */
+    bool wants(uint8_t level) const {
+        return level <= _serialLogLevel || (_syslogEnabled && level <= _syslogLogLevel) ||
+               (level <= _ringLogLevel && _ring.isEnabled());
+    }
+
+    /**
+     * @brief Queue a message for deferred formatting (used by the LOG_x macros)
+     * @param format String literal; only the pointer is stored
+     */
+    template<typename... Args>
+    void logDeferred(uint8_t level, LogCategory category, const char* format, Args... args);
+
 private:
-    void log(uint8_t level, const char* levelStr, const char* format, va_list args);
-    void logToSerial(uint8_t level, const char* levelStr, const char* message);
-    void logToSyslog(uint8_t level, const char* message);
-    void printTimestamp();
-    String getTimestamp();
+    struct LogRecord {
+        int64_t us;             // esp_timer_get_time() at log time
+        time_t epoch;           // wall clock at log time (0 or small if not synced)
+        const char* format;     // deferred: format literal, data holds the arguments
+                                // nullptr: data holds the formatted text
+        uint8_t level;
+        uint8_t category;
+        uint8_t argBytes;
+        char data[LOG_MESSAGE_MAX];
+    };
+
+    // Bounded MPMC queue cell (Vyukov): seq tells whether the cell is free or filled
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        LogRecord record;
+    };
+
+    static_assert((LOG_QUEUE_LENGTH & (LOG_QUEUE_LENGTH - 1)) == 0, "LOG_QUEUE_LENGTH must be a power of 2");
+    static_assert(LOG_MESSAGE_MAX <= 255, "LOG_MESSAGE_MAX must fit LogRecord::argBytes");
+
+    void log(uint8_t level, const char* format, va_list args);
+    Slot* claim(uint32_t& pos);
+    void publish(Slot* slot, uint32_t pos);
+    void countDrop();
+    static void stamp(LogRecord& record, uint8_t level, LogCategory category = LogCategory::General);
+    void updateGates();
+    void loadCategoryLevels();
+    bool dequeue(LogRecord& record);
+    void drain();
+    static void drainTask(void* arg);
+    void output(const LogRecord& record);
+    void logToSerial(uint8_t level, const char* message, int64_t us, time_t epoch);
+    void logToSyslog(uint8_t level, const char* message, time_t epoch);
+    void appendSyslog(const char* line, size_t len);
+    void flushSyslog();
+    bool resolveSyslog();
+    bool connectSyslog();
+    void printTimestamp(int64_t us, time_t epoch);
+    static const char* levelName(uint8_t level);
     uint8_t logLevelToSyslogSeverity(uint8_t level);
     
     uint32_t _baudRate;
@@ -109,16 +295,107 @@ private:
     bool _inBootPhase;
     unsigned long _bootStartTime;
     
+    uint8_t _ringLogLevel;
+    LogRing _ring;
+    uint8_t _categoryLevels[(size_t)LogCategory::Count];
+
     WiFiUDP _udp;
+    WiFiClient _tcp;
+    IPAddress _syslogIp;
+    bool _syslogResolved;
+    uint32_t _syslogResolvedMs;     // last resolve attempt
+    uint32_t _tcpRetryMs;           // no connect attempt before this time
+    uint32_t _tcpBackoffMs;
+    char _syslogBatch[LOG_SYSLOG_BATCH_MAX];
+    size_t _syslogBatchLen;
+
+    Slot _queue[LOG_QUEUE_LENGTH];
+    std::atomic<uint32_t> _enqueuePos;
+    std::atomic<uint32_t> _dequeuePos;      // written by the drain task only
+    std::atomic<uint32_t> _dropped;         // not yet reported
+    std::atomic<uint32_t> _droppedTotal;
+    TaskHandle_t _drainTask;
     
     static LoggingFeature* _instance;
 };
 
+template<typename... Args>
+void LoggingFeature::logDeferred(uint8_t level, LogCategory category, const char* format, Args... args) {
+    if (!_ready) return;
+
+    uint32_t pos = 0;
+    Slot* slot = nullptr;
+    LogRecord local;
+    if (_drainTask) {
+        slot = claim(pos);
+        if (!slot) {
+            countDrop();
+            return;
+        }
+    }
+
+    LogRecord& r = slot ? slot->record : local;
+    stamp(r, level, category);
+    r.format = format;
+    LogFormat::ArgWriter writer{(uint8_t*)r.data, (uint8_t*)r.data + sizeof(r.data)};
+    (writer.put(args), ...);
+    r.argBytes = (uint8_t)(writer.p - (uint8_t*)r.data);
+
+    if (slot) {
+        publish(slot, pos);
+    } else {
+        output(local);  // synchronous fallback (drain task not running)
+        flushSyslog();
+    }
+}
+
 // Global convenience macros
-#define LOG_E(...) do { if (LoggingFeature::getInstance()) LoggingFeature::getInstance()->error(__VA_ARGS__); } while(0)
-#define LOG_W(...) do { if (LoggingFeature::getInstance()) LoggingFeature::getInstance()->warn(__VA_ARGS__); } while(0)
-#define LOG_I(...) do { if (LoggingFeature::getInstance()) LoggingFeature::getInstance()->info(__VA_ARGS__); } while(0)
-#define LOG_D(...) do { if (LoggingFeature::getInstance()) LoggingFeature::getInstance()->debug(__VA_ARGS__); } while(0)
-#define LOG_V(...) do { if (LoggingFeature::getInstance()) LoggingFeature::getInstance()->verbose(__VA_ARGS__); } while(0)
+#define LOG_AT_CAT(level, category, ...) do { \
+    if ((level) <= LoggingFeature::categoryGate[(uint8_t)(category)]) { \
+        LoggingFeature* _lf = LoggingFeature::getInstance(); \
+        if (_lf) _lf->logDeferred(level, category, __VA_ARGS__); \
+    } \
+} while(0)
+#define LOG_AT(level, ...) LOG_AT_CAT(level, LOG_CATEGORY, __VA_ARGS__)
+
+// Compiled out levels keep their arguments type checked but never evaluated
+#define LOG_OFF(...) do { if (0) LOG_AT(LOG_LEVEL_OFF, __VA_ARGS__); } while(0)
+#define LOG_CAT_OFF(category, ...) do { if (0) LOG_AT_CAT(LOG_LEVEL_OFF, category, __VA_ARGS__); } while(0)
+
+#if LOG_MIN_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_CAT_E(category, ...) LOG_AT_CAT(LOG_LEVEL_ERROR, category, __VA_ARGS__)
+#else
+#define LOG_E(...) LOG_OFF(__VA_ARGS__)
+#define LOG_CAT_E(category, ...) LOG_CAT_OFF(category, __VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_CAT_W(category, ...) LOG_AT_CAT(LOG_LEVEL_WARN, category, __VA_ARGS__)
+#else
+#define LOG_W(...) LOG_OFF(__VA_ARGS__)
+#define LOG_CAT_W(category, ...) LOG_CAT_OFF(category, __VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_CAT_I(category, ...) LOG_AT_CAT(LOG_LEVEL_INFO, category, __VA_ARGS__)
+#else
+#define LOG_I(...) LOG_OFF(__VA_ARGS__)
+#define LOG_CAT_I(category, ...) LOG_CAT_OFF(category, __VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_CAT_D(category, ...) LOG_AT_CAT(LOG_LEVEL_DEBUG, category, __VA_ARGS__)
+#else
+#define LOG_D(...) LOG_OFF(__VA_ARGS__)
+#define LOG_CAT_D(category, ...) LOG_CAT_OFF(category, __VA_ARGS__)
+#endif
+#if LOG_MIN_LEVEL >= LOG_LEVEL_VERBOSE
+#define LOG_V(...) LOG_AT(LOG_LEVEL_VERBOSE, __VA_ARGS__)
+#define LOG_CAT_V(category, ...) LOG_AT_CAT(LOG_LEVEL_VERBOSE, category, __VA_ARGS__)
+#else
+#define LOG_V(...) LOG_OFF(__VA_ARGS__)
+#define LOG_CAT_V(category, ...) LOG_CAT_OFF(category, __VA_ARGS__)
+#endif
 
 #endif // LOGGING_FEATURE_H
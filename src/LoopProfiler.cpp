@@ -0,0 +1,207 @@
+#define LOG_CATEGORY LogCategory::System
+
+#include "LoopProfiler.h"
+#include "LatencyHistogram.h"
+#include "CpuMonitor.h"
+#include "LoopScheduler.h"
+#include "InfluxLineProtocol.h"
+#include "LoggingFeature.h"
+#include "WebServerFeature.h"
+#include "ApiEncoding.h"
+#include <freertos/FreeRTOS.h>
+#include <atomic>
+
+namespace {
+    struct Slot {
+        const char* name;
+        uint32_t calls;                         // since boot/reset
+        LatencyHistogram current;
+        LatencyHistogram::Snapshot last;        // last complete window
+    };
+
+    Slot s_slots[LOOP_PROFILER_MAX_SLOTS];
+    std::atomic<size_t> s_slotCount{0};     // published after the slot is set up
+    bool s_overflowLogged = false;
+
+    // Guards s_slotCount growth, the call counts and the last-window snapshots
+    portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+
+    uint32_t s_loopStartUs = 0;
+    uint32_t s_windowStartMs = 0;
+    uint32_t s_lastWindowMs = 0;                // length of the last complete window
+    volatile uint32_t s_windowCount = 0;
+
+    Slot* lookup(const char* name, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if (s_slots[i].name == name) return &s_slots[i];
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (strcmp(s_slots[i].name, name) == 0) return &s_slots[i];
+        }
+        return nullptr;
+    }
+
+    Slot* findSlot(const char* name) {
+        Slot* slot = lookup(name, s_slotCount.load(std::memory_order_acquire));
+        if (slot) return slot;
+
+        // Feature tasks record too: add under the lock, unless one just did
+        portENTER_CRITICAL(&s_mux);
+        const size_t count = s_slotCount.load(std::memory_order_relaxed);
+        slot = lookup(name, count);
+        if (!slot && count < LOOP_PROFILER_MAX_SLOTS) {
+            slot = &s_slots[count];
+            slot->name = name;
+            slot->calls = 0;
+            memset(&slot->last, 0, sizeof(slot->last));
+            s_slotCount.store(count + 1, std::memory_order_release);
+        }
+        portEXIT_CRITICAL(&s_mux);
+
+        if (!slot && !s_overflowLogged) {
+            s_overflowLogged = true;
+            LOG_W("Loop profiler full, not recording %s", name);
+        }
+        return slot;
+    }
+
+    void rollWindow(uint32_t nowMs) {
+        const size_t count = s_slotCount;
+        for (size_t i = 0; i < count; i++) {
+            const LatencyHistogram::Snapshot snap = s_slots[i].current.snapshot();
+            s_slots[i].current.reset();
+            portENTER_CRITICAL(&s_mux);
+            s_slots[i].last = snap;
+            portEXIT_CRITICAL(&s_mux);
+        }
+        s_lastWindowMs = nowMs - s_windowStartMs;
+        s_windowStartMs = nowMs;
+        s_windowCount++;
+    }
+
+    LatencyHistogram::Snapshot lastWindow(size_t i) {
+        portENTER_CRITICAL(&s_mux);
+        const LatencyHistogram::Snapshot snap = s_slots[i].last;
+        portEXIT_CRITICAL(&s_mux);
+        return snap;
+    }
+
+    float busyPercent(const LatencyHistogram::Snapshot& snap) {
+        if (s_lastWindowMs == 0) return 0.0f;
+        return (float)snap.sumUs / (s_lastWindowMs * 10.0f);
+    }
+}
+
+namespace LoopProfiler {
+    void record(const char* name, uint32_t durationUs) {
+        if (!name) return;
+        Slot* slot = findSlot(name);
+        if (!slot) return;
+        portENTER_CRITICAL(&s_mux);
+        slot->calls++;
+        portEXIT_CRITICAL(&s_mux);
+        slot->current.record(durationUs);
+    }
+
+    void markLoopStart() {
+        s_loopStartUs = (uint32_t)micros();
+        if (s_windowStartMs == 0) s_windowStartMs = (uint32_t)millis();
+    }
+
+    void markLoopEnd() {
+        record("loop", (uint32_t)micros() - s_loopStartUs);
+
+        const uint32_t nowMs = (uint32_t)millis();
+        if ((uint32_t)(nowMs - s_windowStartMs) >= LOOP_PROFILER_WINDOW_MS) {
+            rollWindow(nowMs);
+        }
+    }
+
+    uint32_t windowCount() {
+        return s_windowCount;
+    }
+
+    void reset() {
+        const size_t count = s_slotCount;
+        for (size_t i = 0; i < count; i++) {
+            s_slots[i].current.reset();
+            portENTER_CRITICAL(&s_mux);
+            s_slots[i].calls = 0;
+            memset(&s_slots[i].last, 0, sizeof(s_slots[i].last));
+            portEXIT_CRITICAL(&s_mux);
+        }
+        s_windowStartMs = (uint32_t)millis();
+        s_lastWindowMs = 0;
+    }
+
+    void toJson(JsonObject obj) {
+        obj["windowMs"] = (uint32_t)LOOP_PROFILER_WINDOW_MS;
+        obj["lastWindowMs"] = s_lastWindowMs;
+        obj["windows"] = s_windowCount;
+        obj["currentWindowAgeMs"] = (uint32_t)((uint32_t)millis() - s_windowStartMs);
+
+        JsonObject cpu = obj["cpu"].to<JsonObject>();
+        cpu["usagePercent"] = CpuMonitor::usagePercent();
+        cpu["avgLoopUs"] = CpuMonitor::avgLoopDurationUs();
+        LoopScheduler::toJson(obj["scheduler"].to<JsonObject>());
+
+        JsonArray entries = obj["entries"].to<JsonArray>();
+        const size_t count = s_slotCount;
+        for (size_t i = 0; i < count; i++) {
+            const LatencyHistogram::Snapshot snap = lastWindow(i);
+            JsonObject e = entries.add<JsonObject>();
+            e["name"] = s_slots[i].name;
+            e["calls"] = s_slots[i].calls;
+            e["busyPercent"] = busyPercent(snap);
+            snap.toJson(e["window"].to<JsonObject>());
+        }
+    }
+
+    String toLineProtocol(const char* deviceId) {
+        String lines;
+        const size_t count = s_slotCount;
+        for (size_t i = 0; i < count; i++) {
+            const LatencyHistogram::Snapshot snap = lastWindow(i);
+            if (snap.count == 0) continue;
+
+            // Format: loop_perf,device=id,name=X calls=Ni,p50_us=Ni,...,busy_pct=F
+            String line = "loop_perf,device=";
+            line += InfluxLineProtocol::escapeTag(deviceId);
+            line += ",name=";
+            line += InfluxLineProtocol::escapeTag(s_slots[i].name);
+            line += " calls=";
+            line += snap.count;
+            line += "i,p50_us=";
+            line += snap.percentileUs(50);
+            line += "i,p95_us=";
+            line += snap.percentileUs(95);
+            line += "i,p99_us=";
+            line += snap.percentileUs(99);
+            line += "i,max_us=";
+            line += snap.maxUs;
+            line += "i,avg_us=";
+            line += snap.avgUs();
+            line += "i,busy_pct=";
+            line += String(busyPercent(snap), 2);
+            line += "\n";
+            lines += line;
+        }
+        return lines;
+    }
+
+    void setup(WebServerFeature& server) {
+        // Sub-path first: a handler for /api/perf also matches /api/perf/...
+        server.getServer()->on("/api/perf/reset", HTTP_POST, [&server](AsyncWebServerRequest* request) {
+            if (!server.authenticate(request)) return request->requestAuthentication();
+            reset();
+            request->send(200, "application/json", "{\"reset\":true}");
+        });
+
+        server.getServer()->on("/api/perf", HTTP_GET, [&server](AsyncWebServerRequest* request) {
+            if (!server.authenticate(request)) return request->requestAuthentication();
+            JsonDocument doc;
+            toJson(doc.to<JsonObject>());
+            ApiEncoding::send(request, 200, doc);
+        });
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+class WebServerFeature;
+
+// Length of a statistics window; percentiles are reported for the last complete one
+#ifndef LOOP_PROFILER_WINDOW_MS
+#define LOOP_PROFILER_WINDOW_MS 60000
+#endif
+
+// Distinct names that can be profiled (features, jobs and the loop itself)
+#ifndef LOOP_PROFILER_MAX_SLOTS
+#define LOOP_PROFILER_MAX_SLOTS 24
+#endif
+
+/**
+ * Per-feature/per-job duration histograms for the main loop.
+ *
+ * Every name gets a LatencyHistogram that is rotated each window, so
+ * /api/perf shows calls, p50/p95/p99/max and the share of the window spent
+ * in it for the last complete window, plus the call count since boot.
+ * "loop" is the whole iteration (markLoopStart() to markLoopEnd()).
+ *
+ * record() is safe from any task (feature tasks record their passes);
+ * the window is rolled by markLoopEnd() in the loop task.
+ *
+ * Usage:
+ *   LoopProfiler::markLoopStart();
+ *   LoopProfiler::record(feature->getName(), durUs);
+ *   { LoopProfiler::Scope perf("haDiscovery"); ... }
+ *   LoopProfiler::markLoopEnd();
+ */
+namespace LoopProfiler {
+    // name must stay valid (string literal, Feature::getName())
+    void record(const char* name, uint32_t durationUs);
+
+    // Records the time until it goes out of scope
+    class Scope {
+    public:
+        explicit Scope(const char* name) : _name(name), _startUs((uint32_t)micros()) {}
+        ~Scope() { record(_name, (uint32_t)micros() - _startUs); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* _name;
+        uint32_t _startUs;
+    };
+
+    void markLoopStart();
+
+    // Records "loop" and starts a new window when the current one is complete
+    void markLoopEnd();
+
+    // Number of completed windows, changes when new percentiles are available
+    uint32_t windowCount();
+
+    void reset();
+
+    void toJson(JsonObject obj);
+
+    // One line per name for the last complete window (measurement loop_perf)
+    String toLineProtocol(const char* deviceId);
+
+    // GET /api/perf, POST /api/perf/reset
+    void setup(WebServerFeature& server);
+}
@@ -0,0 +1,98 @@
+#define LOG_CATEGORY LogCategory::System
+
+#include "LoopScheduler.h"
+#include "LatencyHistogram.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+#include <atomic>
+
+namespace {
+    static constexpr size_t MAX_TASKS = 8;
+
+    TaskHandle_t s_loopTask = nullptr;
+    TaskHandle_t s_tasks[MAX_TASKS] = {};   // feature tasks, also woken by wake()
+    std::atomic<size_t> s_taskCount{0};
+    std::atomic<int64_t> s_wakeUs{0};       // first wake() since the last pass, 0 if none
+    LatencyHistogram s_wakeLatency;         // wake() until the loop runs again
+
+    uint32_t s_passes = 0;
+    uint32_t s_eventWakeups = 0;            // sleep ended by wake()
+    uint32_t s_timerWakeups = 0;            // sleep ran into its deadline
+    uint32_t s_busyPasses = 0;              // no sleep, another feature was due
+    uint32_t s_forcedYields = 0;
+    uint64_t s_sleptUs = 0;
+    uint8_t s_busyInRow = 0;
+    int64_t s_sinceUs = 0;
+}
+
+namespace LoopScheduler {
+    void setup() {
+        s_loopTask = xTaskGetCurrentTaskHandle();
+        s_sinceUs = esp_timer_get_time();
+    }
+
+    void wake() {
+        int64_t none = 0;
+        s_wakeUs.compare_exchange_strong(none, esp_timer_get_time());
+        if (s_loopTask) xTaskNotifyGive(s_loopTask);
+        const size_t n = s_taskCount.load();
+        for (size_t i = 0; i < n; i++) xTaskNotifyGive(s_tasks[i]);
+    }
+
+    bool addTask(TaskHandle_t task) {
+        const size_t n = s_taskCount.load();
+        if (n >= MAX_TASKS) return false;
+        s_tasks[n] = task;
+        s_taskCount.store(n + 1);
+        return true;
+    }
+
+    bool inLoopTask() {
+        return !s_loopTask || xTaskGetCurrentTaskHandle() == s_loopTask;
+    }
+
+    void sleep(uint32_t ms) {
+        s_passes++;
+        if (ms > LOOP_SCHEDULER_MAX_SLEEP_MS) ms = LOOP_SCHEDULER_MAX_SLEEP_MS;
+
+        if (ms == 0) {
+            s_busyPasses++;
+            if (++s_busyInRow < LOOP_SCHEDULER_MAX_BUSY_PASSES) {
+                ulTaskNotifyTake(pdTRUE, 0);    // events are handled by this pass anyway
+                s_wakeUs.store(0);
+                taskYIELD();
+                return;
+            }
+            s_forcedYields++;
+            ms = 1;
+        }
+        s_busyInRow = 0;
+
+        const int64_t startUs = esp_timer_get_time();
+        const TickType_t ticks = pdMS_TO_TICKS(ms) ? pdMS_TO_TICKS(ms) : 1;
+        const bool woken = ulTaskNotifyTake(pdTRUE, ticks) > 0;
+        const int64_t nowUs = esp_timer_get_time();
+        s_sleptUs += (uint64_t)(nowUs - startUs);
+
+        const int64_t wakeUs = s_wakeUs.exchange(0);
+        if (woken) {
+            s_eventWakeups++;
+            if (wakeUs != 0) s_wakeLatency.record((uint32_t)(nowUs - wakeUs));
+        } else {
+            s_timerWakeups++;
+        }
+    }
+
+    void toJson(JsonObject obj) {
+        const int64_t elapsedUs = esp_timer_get_time() - s_sinceUs;
+        obj["maxSleepMs"] = (uint32_t)LOOP_SCHEDULER_MAX_SLEEP_MS;
+        obj["passes"] = s_passes;
+        obj["eventWakeups"] = s_eventWakeups;
+        obj["timerWakeups"] = s_timerWakeups;
+        obj["busyPasses"] = s_busyPasses;
+        obj["forcedYields"] = s_forcedYields;
+        obj["sleepPercent"] = elapsedUs > 0 ? (float)((double)s_sleptUs * 100.0 / (double)elapsedUs) : 0.0f;
+        s_wakeLatency.snapshot().toJson(obj["wakeLatency"].to<JsonObject>());
+    }
+}
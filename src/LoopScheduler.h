@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Longest sleep between passes. Bounds the latency of main loop jobs that
+// don't declare a deadline (periodic publishing, collections, ...).
+#ifndef LOOP_SCHEDULER_MAX_SLEEP_MS
+#define LOOP_SCHEDULER_MAX_SLEEP_MS 10
+#endif
+
+// Passes in a row without sleeping before the loop gives lower priority
+// tasks one tick anyway (what delay(2) used to guarantee)
+#ifndef LOOP_SCHEDULER_MAX_BUSY_PASSES
+#define LOOP_SCHEDULER_MAX_BUSY_PASSES 8
+#endif
+
+/**
+ * Sleep/wake control of the main loop.
+ *
+ * Instead of a fixed delay(2) per pass, the loop runs only features whose
+ * Feature::dueInMs() is 0 and then sleeps until the earliest deadline.
+ * Event sources (UART receive callback, WiFi events, web handlers that
+ * queue loop work) call wake() to end the sleep early, so their work no
+ * longer waits for a fixed delay.
+ *
+ * Usage:
+ *   In setup(): LoopScheduler::setup();
+ *   In loop():  if (feature->dueInMs() == 0) feature->loop();
+ *               ...
+ *               LoopScheduler::sleep(min of all dueInMs());
+ *   Anywhere:   LoopScheduler::wake();
+ */
+namespace LoopScheduler {
+    // Remembers the calling task as the loop task
+    void setup();
+
+    // Ends the current (or next) sleep of the loop task and of all feature
+    // tasks (they re-check their deadlines); callable from any task
+    void wake();
+
+    // Have wake() notify this task too; called from the setup() task only
+    bool addTask(TaskHandle_t task);
+
+    // True when called from the loop task (or before setup())
+    bool inLoopTask();
+
+    // Sleeps up to ms (capped at LOOP_SCHEDULER_MAX_SLEEP_MS) or until wake()
+    void sleep(uint32_t ms);
+
+    // Time left of a period that started elapsedMs ago (0 if due)
+    inline uint32_t remainingMs(uint32_t elapsedMs, uint32_t periodMs) {
+        return elapsedMs >= periodMs ? 0 : periodMs - elapsedMs;
+    }
+
+    // Wakeup counts, sleep share and wake() to loop latency
+    void toJson(JsonObject obj);
+}
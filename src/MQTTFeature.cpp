@@ -1,4 +1,9 @@
+#define LOG_CATEGORY LogCategory::MQTT
+
 #include "MQTTFeature.h"
+#include "Hal.h"
+#include "LoopScheduler.h"
+#include "Trace.h"
 
 MQTTFeature* MQTTFeature::_instance = nullptr;
 
@@ -16,6 +21,7 @@ MQTTFeature::MQTTFeature(const char* server, uint16_t port,
     , _connected(false)
     , _lastReconnectAttempt(0)
     , _messageCallback(nullptr)
+    , _stats{0, 0, 0, 0, 0}
 {
     _instance = this;
     _mqttClient.setClient(_wifiClient);
@@ -34,13 +40,22 @@ void MQTTFeature::setup() {
     LOG_I("MQTT configured for %s:%d", _server, _port);
 }
 
+uint32_t MQTTFeature::dueInMs() {
+    if (strlen(_server) == 0 || !Hal::networkConnected()) return NOT_DUE;
+    if (!_mqttClient.connected()) {
+        return LoopScheduler::remainingMs(Hal::millis() - _lastReconnectAttempt, _reconnectIntervalMs);
+    }
+    // PubSubClient has no receive callback to wake the loop, so poll the socket
+    return MQTT_POLL_INTERVAL_MS;
+}
+
 void MQTTFeature::loop() {
     if (strlen(_server) == 0) return;
-    if (!WiFi.isConnected()) return;
+    if (!Hal::networkConnected()) return;
     
     if (!_mqttClient.connected()) {
         _connected = false;
-        unsigned long now = millis();
+        unsigned long now = Hal::millis();
         if (now - _lastReconnectAttempt >= _reconnectIntervalMs) {
             _lastReconnectAttempt = now;
             reconnect();
@@ -51,6 +66,7 @@ void MQTTFeature::loop() {
 }
 
 void MQTTFeature::reconnect() {
+    TRACE_SCOPE("mqtt.connect", 0);
     LOG_D("Attempting MQTT connection to %s...", _server);
     
     bool connected;
@@ -62,19 +78,28 @@ void MQTTFeature::reconnect() {
     
     if (connected) {
         _connected = true;
+        _stats.connectCount++;
         LOG_I("MQTT connected as %s", _clientId);
         
         // Publish online status
         String statusTopic = String(_baseTopic) + "/status";
         _mqttClient.publish(statusTopic.c_str(), "online", true);
     } else {
+        _stats.connectFailCount++;
         LOG_W("MQTT connection failed, rc=%d", _mqttClient.state());
     }
 }
 
 bool MQTTFeature::publish(const char* topic, const char* payload, bool retain) {
     if (!_connected) return false;
-    return _mqttClient.publish(topic, payload, retain);
+    TRACE_SCOPE("mqtt.publish", strlen(payload));
+    const bool ok = _mqttClient.publish(topic, payload, retain);
+    if (ok) {
+        _stats.publishCount++;
+    } else {
+        _stats.publishFailCount++;
+    }
+    return ok;
 }
 
 bool MQTTFeature::publishToBase(const char* subtopic, const char* payload, bool retain) {
@@ -99,6 +124,7 @@ void MQTTFeature::onMessage(MessageCallback callback) {
 }
 
 void MQTTFeature::mqttCallback(char* topic, byte* payload, unsigned int length) {
+    if (_instance) _instance->_stats.messagesReceived++;
     if (_instance && _instance->_messageCallback) {
         // Null-terminate the payload
         char* msg = new char[length + 1];
@@ -7,6 +7,11 @@
 #include <PubSubClient.h>
 #include <functional>
 
+// How often the client socket is polled for incoming messages while connected
+#ifndef MQTT_POLL_INTERVAL_MS
+#define MQTT_POLL_INTERVAL_MS 10
+#endif
+
 /**
  * @brief MQTT client feature with auto-reconnect
  */
@@ -21,6 +26,8 @@ public:
     
     void setup() override;
     void loop() override;
+    uint8_t dependencies() const override { return NEEDS_NETWORK; }
+    uint32_t dueInMs() override;
     const char* getName() const override { return "MQTT"; }
     bool isReady() const override { return _connected; }
     
@@ -38,6 +45,16 @@ public:
     const char* getBaseTopic() const { return _baseTopic; }
     const char* getClientId() const { return _clientId; }
     
+    // Statistics (cumulative since boot)
+    struct Stats {
+        uint32_t publishCount;
+        uint32_t publishFailCount;
+        uint32_t messagesReceived;
+        uint32_t connectCount;
+        uint32_t connectFailCount;
+    };
+    const Stats& getStats() const { return _stats; }
+    
     // Setter for dynamic configuration
     void setClientId(const char* clientId) { _clientId = clientId; }
     void setBaseTopic(const char* baseTopic) { _baseTopic = baseTopic; }
@@ -63,6 +80,7 @@ private:
     unsigned long _lastReconnectAttempt;
     
     MessageCallback _messageCallback;
+    Stats _stats;
     
     // Static buffer for topic building (avoids heap allocation per publish)
     static constexpr size_t MAX_TOPIC_LEN = 128;
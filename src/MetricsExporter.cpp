@@ -0,0 +1,287 @@
+#define LOG_CATEGORY LogCategory::Web
+
+#include "MetricsExporter.h"
+#include "WebServerFeature.h"
+#include "ModbusRTUFeature.h"
+#include "ModbusDevice.h"
+#include "InfluxDBFeature.h"
+#include "MQTTFeature.h"
+#include "CpuMonitor.h"
+#include "LoggingFeature.h"
+#include <math.h>
+#include <memory>
+
+namespace {
+    // Register value lines generated per piece (keeps each piece well below a TCP segment).
+    static constexpr size_t VALUES_PER_PIECE = 8;
+
+    ModbusRTUFeature* s_modbus = nullptr;
+    ModbusDeviceManager* s_devices = nullptr;
+    InfluxDBFeature* s_influx = nullptr;
+    MQTTFeature* s_mqtt = nullptr;
+
+    enum class Stage : uint8_t { System, Modbus, Influx, Mqtt, Devices, Values, Done };
+
+    struct Cursor {
+        Stage stage{Stage::System};
+        uint16_t nextUnit{0};       // first unit id not fully emitted yet
+        String lastKey;             // last register emitted for nextUnit ("" = none)
+        String pending;             // current piece
+        size_t pendingPos{0};
+    };
+
+    void appendEscaped(String& out, const char* s) {
+        for (; *s; s++) {
+            if (*s == '\\' || *s == '"') {
+                out += '\\';
+                out += *s;
+            } else if (*s == '\n') {
+                out += "\\n";
+            } else {
+                out += *s;
+            }
+        }
+    }
+
+    void appendNumber(String& out, double v) {
+        if (isnan(v)) {
+            out += "NaN";
+        } else if (isinf(v)) {
+            out += v > 0 ? "+Inf" : "-Inf";
+        } else {
+            char buf[24];
+            snprintf(buf, sizeof(buf), "%.7g", v);
+            out += buf;
+        }
+    }
+
+    void header(String& out, const char* name, const char* type, const char* help) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    void sample(String& out, const char* name, double v) {
+        out += name;
+        out += ' ';
+        appendNumber(out, v);
+        out += '\n';
+    }
+
+    void counter(String& out, const char* name, const char* help, double v) {
+        header(out, name, "counter", help);
+        sample(out, name, v);
+    }
+
+    void gauge(String& out, const char* name, const char* help, double v) {
+        header(out, name, "gauge", help);
+        sample(out, name, v);
+    }
+
+    void deviceLabels(String& out, const ModbusDeviceInstance& dev) {
+        out += "{unit_id=\"";
+        out += dev.unitId;
+        out += "\",device=\"";
+        appendEscaped(out, dev.deviceName.length() > 0 ? dev.deviceName.c_str() : dev.deviceTypeName.c_str());
+        out += '"';
+    }
+
+    void systemPiece(String& out) {
+        gauge(out, "esp_uptime_seconds", "Time since boot", millis() / 1000.0);
+        gauge(out, "esp_heap_free_bytes", "Free heap", ESP.getFreeHeap());
+        gauge(out, "esp_heap_min_free_bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+        gauge(out, "esp_heap_max_alloc_bytes", "Largest allocatable heap block", ESP.getMaxAllocHeap());
+        gauge(out, "esp_cpu_usage_percent", "Main loop busy time over the last second", CpuMonitor::usagePercent());
+        gauge(out, "esp_loop_count", "Main loop iterations in the last second", CpuMonitor::loopCount());
+        gauge(out, "esp_loop_avg_duration_seconds", "Average main loop duration",
+              CpuMonitor::avgLoopDurationUs() / 1e6);
+        if (LoggingFeature::getInstance()) {
+            counter(out, "esp_log_dropped_total", "Log messages dropped because the log queue was full",
+                    LoggingFeature::getInstance()->getDroppedCount());
+        }
+    }
+
+    void modbusPiece(String& out) {
+        using S = ModbusRTUFeature::Stats;
+        struct Counter {
+            const char* name;
+            const char* help;
+            uint32_t S::* field;
+        };
+        static const Counter counters[] = {
+            { "modbus_own_requests_sent_total", "Requests sent by the gateway", &S::ownRequestsSent },
+            { "modbus_own_requests_success_total", "Own requests answered", &S::ownRequestsSuccess },
+            { "modbus_own_requests_failed_total", "Own requests failed (timeout or exception)", &S::ownRequestsFailed },
+            { "modbus_own_requests_discarded_total", "Own requests not queued", &S::ownRequestsDiscarded },
+            { "modbus_other_requests_seen_total", "Requests of other masters seen on the bus", &S::otherRequestsSeen },
+            { "modbus_other_responses_seen_total", "Responses to other masters seen on the bus", &S::otherResponsesSeen },
+            { "modbus_other_exceptions_seen_total", "Exceptions to other masters seen on the bus", &S::otherExceptionsSeen },
+            { "modbus_frames_received_total", "Frames received", &S::framesReceived },
+            { "modbus_frames_sent_total", "Frames sent", &S::framesSent },
+            { "modbus_crc_errors_total", "Frames with CRC errors", &S::crcErrors },
+            { "modbus_timeouts_total", "Response timeouts", &S::timeouts },
+            { "modbus_queue_overflows_total", "Requests rejected by a full queue or low heap", &S::queueOverflows },
+        };
+
+        const S& st = s_modbus->getStats();
+        for (const auto& c : counters) counter(out, c.name, c.help, st.*c.field);
+        counter(out, "modbus_own_active_seconds_total", "Bus time used by own traffic", st.ownActiveTimeUs / 1e6);
+        counter(out, "modbus_other_active_seconds_total", "Bus time used by other traffic", st.otherActiveTimeUs / 1e6);
+        gauge(out, "modbus_pending_requests", "Queued plus in-flight requests", s_modbus->getPendingRequestCount());
+        gauge(out, "modbus_consecutive_timeouts", "Consecutive timeouts of the current unit", s_modbus->getConsecutiveTimeouts());
+    }
+
+    void influxPiece(String& out) {
+        const auto& st = s_influx->getStats();
+        counter(out, "influxdb_uploads_success_total", "Successful batch uploads", st.successCount);
+        counter(out, "influxdb_uploads_failed_total", "Failed batch uploads", st.failCount);
+        counter(out, "influxdb_points_written_total", "Lines written", st.totalPointsWritten);
+        gauge(out, "influxdb_pending_lines", "Lines waiting for upload", s_influx->pendingCount());
+        gauge(out, "influxdb_connected", "Last upload succeeded", s_influx->isConnected() ? 1 : 0);
+    }
+
+    void mqttPiece(String& out) {
+        const auto& st = s_mqtt->getStats();
+        counter(out, "mqtt_publish_total", "Messages published", st.publishCount);
+        counter(out, "mqtt_publish_failed_total", "Publish calls that failed", st.publishFailCount);
+        counter(out, "mqtt_messages_received_total", "Messages received on subscribed topics", st.messagesReceived);
+        counter(out, "mqtt_connects_total", "Successful broker connects", st.connectCount);
+        counter(out, "mqtt_connect_failures_total", "Failed broker connects", st.connectFailCount);
+        gauge(out, "mqtt_connected", "Connected to the broker", s_mqtt->isConnected() ? 1 : 0);
+    }
+
+    void devicesPiece(String& out) {
+        auto _guard = s_devices->scopedLock();
+        const auto& devices = s_devices->getDevices();
+
+        header(out, "modbus_device_success_total", "counter", "Successful polls per device");
+        for (const auto& kv : devices) {
+            out += "modbus_device_success_total";
+            deviceLabels(out, kv.second);
+            out += "} ";
+            out += kv.second.successCount;
+            out += '\n';
+        }
+        header(out, "modbus_device_errors_total", "counter", "Failed polls per device");
+        for (const auto& kv : devices) {
+            out += "modbus_device_errors_total";
+            deviceLabels(out, kv.second);
+            out += "} ";
+            out += kv.second.errorCount;
+            out += '\n';
+        }
+        header(out, "modbus_register_value", "gauge", "Last valid register value");
+    }
+
+    // Emit the next few register values; returns false when all devices are done.
+    bool valuesPiece(Cursor& c) {
+        auto _guard = s_devices->scopedLock();
+        const auto& devices = s_devices->getDevices();
+
+        // Devices may come and go between pieces; the cursor is key based, not iterator based.
+        auto dit = devices.lower_bound((uint8_t)std::min<uint16_t>(c.nextUnit, 255));
+        if (c.nextUnit > 255 || dit == devices.end()) return false;
+        if (dit->first != c.nextUnit) c.lastKey = "";
+
+        const auto& dev = dit->second;
+        auto vit = c.lastKey.length() == 0 ? dev.currentValues.begin()
+                                           : dev.currentValues.upper_bound(c.lastKey);
+        for (size_t n = 0; vit != dev.currentValues.end() && n < VALUES_PER_PIECE; ++vit) {
+            const ModbusRegisterValue& v = vit->second;
+            c.lastKey = vit->first;
+            if (!v.valid) continue;
+            c.pending += "modbus_register_value";
+            deviceLabels(c.pending, dev);
+            c.pending += ",register=\"";
+            appendEscaped(c.pending, v.name);
+            c.pending += "\",unit=\"";
+            appendEscaped(c.pending, v.unit);
+            c.pending += "\"} ";
+            appendNumber(c.pending, v.value);
+            c.pending += '\n';
+            n++;
+        }
+
+        if (vit == dev.currentValues.end()) {
+            c.nextUnit = (uint16_t)dit->first + 1;
+            c.lastKey = "";
+        } else {
+            c.nextUnit = dit->first;
+        }
+        return true;
+    }
+
+    // Produce the next piece of output into c.pending; false when done.
+    bool nextPiece(Cursor& c) {
+        switch (c.stage) {
+            case Stage::System:
+                systemPiece(c.pending);
+                c.stage = Stage::Modbus;
+                return true;
+            case Stage::Modbus:
+                modbusPiece(c.pending);
+                c.stage = Stage::Influx;
+                return true;
+            case Stage::Influx:
+                influxPiece(c.pending);
+                c.stage = Stage::Mqtt;
+                return true;
+            case Stage::Mqtt:
+                mqttPiece(c.pending);
+                c.stage = s_devices ? Stage::Devices : Stage::Done;
+                return true;
+            case Stage::Devices:
+                devicesPiece(c.pending);
+                c.stage = Stage::Values;
+                return true;
+            case Stage::Values:
+                if (valuesPiece(c)) return true;
+                c.stage = Stage::Done;
+                return false;
+            default:
+                return false;
+        }
+    }
+}
+
+void MetricsExporter::setup(WebServerFeature& server, ModbusRTUFeature& modbus,
+                            ModbusDeviceManager* devices, InfluxDBFeature& influx,
+                            MQTTFeature& mqtt) {
+    s_modbus = &modbus;
+    s_devices = devices;
+    s_influx = &influx;
+    s_mqtt = &mqtt;
+
+    server.getServer()->on("/metrics", HTTP_GET, [&server](AsyncWebServerRequest* request) {
+        if (!server.authenticate(request)) return request->requestAuthentication();
+
+        auto cursor = std::make_shared<Cursor>();
+        AsyncWebServerResponse* response = request->beginChunkedResponse(
+            "text/plain; version=0.0.4; charset=utf-8",
+            [cursor](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+                (void)index;
+                Cursor& c = *cursor;
+                size_t written = 0;
+                while (written < maxLen) {
+                    if (c.pendingPos >= c.pending.length()) {
+                        c.pending = "";
+                        c.pendingPos = 0;
+                        if (!nextPiece(c)) break;
+                        continue;
+                    }
+                    const size_t n = std::min(maxLen - written, c.pending.length() - c.pendingPos);
+                    memcpy(buffer + written, c.pending.c_str() + c.pendingPos, n);
+                    written += n;
+                    c.pendingPos += n;
+                }
+                return written;
+            });
+        request->send(response);
+    });
+}
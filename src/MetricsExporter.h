@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+
+class WebServerFeature;
+class ModbusRTUFeature;
+class ModbusDeviceManager;
+class InfluxDBFeature;
+class MQTTFeature;
+
+/**
+ * @brief Prometheus scrape endpoint (GET /metrics)
+ *
+ * Exposes all valid Modbus register values as gauges labelled with
+ * unit_id/device/register/unit, plus gateway internals: Modbus RTU stats,
+ * InfluxDB and MQTT counters, CpuMonitor and heap.
+ *
+ * The text exposition format is generated piece by piece into a chunked
+ * response, so RAM use does not grow with the number of registers.
+ */
+class MetricsExporter {
+public:
+    /**
+     * @brief Register the /metrics endpoint
+     * @param devices Device manager (may be nullptr: no register gauges)
+     */
+    static void setup(WebServerFeature& server, ModbusRTUFeature& modbus,
+                      ModbusDeviceManager* devices, InfluxDBFeature& influx,
+                      MQTTFeature& mqtt);
+};
@@ -0,0 +1,300 @@
+#define LOG_CATEGORY LogCategory::ModbusDevice
+
+#include "ModbusBatch.h"
+#include "ModbusRTUFeature.h"
+#include "LoggingFeature.h"
+#include "LoopScheduler.h"
+#include "ApiEncoding.h"
+#include <ArduinoJson.h>
+#include <algorithm>
+#include <memory>
+
+namespace {
+    enum class WindowState : uint8_t { Pending, Queued, Done, Failed, Rejected };
+
+    struct Window {
+        uint8_t unitId{0};
+        uint8_t functionCode{0};
+        uint16_t start{0};
+        uint16_t quantity{0};
+        WindowState state{WindowState::Pending};
+        uint8_t exceptionCode{0};
+        std::vector<uint16_t> words;
+    };
+
+    struct Batch {
+        AsyncWebServerRequestPtr request;
+        ApiEncoding::Format format{ApiEncoding::Format::Json};
+        std::vector<ModbusBatch::Item> items;
+        std::vector<uint16_t> itemWindow;  // window index per item
+        std::vector<Window> windows;
+        uint32_t startMs{0};
+        uint32_t deadlineMs{0};
+        size_t nextWindow{0};              // next window to queue
+        size_t openWindows{0};             // windows not yet Done/Failed/Rejected
+    };
+
+    ModbusRTUFeature* s_modbus = nullptr;
+
+    // Handed over from the AsyncTCP task, guarded by s_mux.
+    portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+    std::vector<std::shared_ptr<Batch>> s_incoming;
+    size_t s_inProgress = 0;
+
+    // Owned by the loop task.
+    std::vector<std::shared_ptr<Batch>> s_active;
+
+    // Coalesce items per unit/FC into windows of at most MAX_WINDOW_REGISTERS.
+    void plan(Batch& b, uint16_t maxGap) {
+        std::vector<uint16_t> order(b.items.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = (uint16_t)i;
+        std::sort(order.begin(), order.end(), [&b](uint16_t x, uint16_t y) {
+            const auto& a = b.items[x];
+            const auto& c = b.items[y];
+            if (a.unitId != c.unitId) return a.unitId < c.unitId;
+            if (a.functionCode != c.functionCode) return a.functionCode < c.functionCode;
+            return a.address < c.address;
+        });
+
+        b.itemWindow.assign(b.items.size(), 0);
+        for (uint16_t idx : order) {
+            const auto& it = b.items[idx];
+            const uint32_t itEnd = (uint32_t)it.address + it.count;  // exclusive
+            if (!b.windows.empty()) {
+                Window& w = b.windows.back();
+                const uint32_t wEnd = (uint32_t)w.start + w.quantity;
+                if (w.unitId == it.unitId && w.functionCode == it.functionCode &&
+                    it.address <= wEnd + maxGap &&
+                    std::max(wEnd, itEnd) - w.start <= ModbusBatch::MAX_WINDOW_REGISTERS) {
+                    if (itEnd > wEnd) w.quantity = (uint16_t)(itEnd - w.start);
+                    b.itemWindow[idx] = (uint16_t)(b.windows.size() - 1);
+                    continue;
+                }
+            }
+            Window w;
+            w.unitId = it.unitId;
+            w.functionCode = it.functionCode;
+            w.start = it.address;
+            w.quantity = it.count;
+            b.windows.push_back(w);
+            b.itemWindow[idx] = (uint16_t)(b.windows.size() - 1);
+        }
+        b.openWindows = b.windows.size();
+    }
+
+    // Queue windows while leaving half of the Modbus queue to the poll scheduler.
+    void dispatch(const std::shared_ptr<Batch>& batch) {
+        Batch& b = *batch;
+        const size_t limit = std::max<size_t>(1, s_modbus->getMaxQueueSize() / 2);
+        while (b.nextWindow < b.windows.size() && s_modbus->getQueuedRequestCount() < limit) {
+            const size_t wi = b.nextWindow++;
+            Window& w = b.windows[wi];
+            std::weak_ptr<Batch> weak = batch;
+            const bool queued = s_modbus->queueReadRegisters(
+                w.unitId, w.functionCode, w.start, w.quantity,
+                [weak, wi](bool success, const ModbusFrame& response) {
+                    auto bp = weak.lock();
+                    if (!bp || wi >= bp->windows.size()) return;
+                    Window& cw = bp->windows[wi];
+                    if (cw.state != WindowState::Queued) return;
+                    if (success && !response.isException) {
+                        const uint8_t* regData = response.getRegisterData();
+                        const size_t wordCount = response.getByteCount() / 2;
+                        cw.words.reserve(wordCount);
+                        for (size_t i = 0; regData && i < wordCount; i++) {
+                            cw.words.push_back(((uint16_t)regData[i * 2] << 8) | regData[i * 2 + 1]);
+                        }
+                        cw.state = WindowState::Done;
+                    } else {
+                        cw.exceptionCode = response.exceptionCode;
+                        cw.state = WindowState::Failed;
+                    }
+                    if (bp->openWindows > 0) bp->openWindows--;
+                });
+            if (queued) {
+                w.state = WindowState::Queued;
+            } else {
+                w.state = WindowState::Rejected;
+                if (b.openWindows > 0) b.openWindows--;
+            }
+        }
+    }
+
+    const char* windowError(const Window& w) {
+        switch (w.state) {
+            case WindowState::Failed:   return "exception";
+            case WindowState::Rejected: return "not_queued";
+            default:                    return "timeout";
+        }
+    }
+
+    // CBOR/MessagePack: item words go out as one big-endian byte string each.
+    void writeBinaryItems(Batch& b, Print& out) {
+        using namespace ApiEncoding;
+        const Format f = b.format;
+        writeArrayHeader(out, f, b.items.size());
+        for (size_t i = 0; i < b.items.size(); i++) {
+            const auto& it = b.items[i];
+            const Window& w = b.windows[b.itemWindow[i]];
+            const size_t offset = it.address - w.start;
+            const bool ok = w.state == WindowState::Done && w.words.size() >= offset + it.count;
+            const bool hasException = !ok && w.state == WindowState::Failed;
+
+            writeMapHeader(out, f, 6 + (hasException ? 1 : 0));
+            writeString(out, f, "unit");    writeUint(out, f, it.unitId);
+            writeString(out, f, "fc");      writeUint(out, f, it.functionCode);
+            writeString(out, f, "address"); writeUint(out, f, it.address);
+            writeString(out, f, "count");   writeUint(out, f, it.count);
+            writeString(out, f, "success"); writeBool(out, f, ok);
+            if (ok) {
+                uint8_t bytes[ModbusBatch::MAX_WINDOW_REGISTERS * 2];
+                for (size_t k = 0; k < it.count; k++) {
+                    const uint16_t word = w.words[offset + k];
+                    bytes[k * 2] = (uint8_t)(word >> 8);
+                    bytes[k * 2 + 1] = (uint8_t)word;
+                }
+                writeString(out, f, "words");
+                writeBytes(out, f, bytes, it.count * 2);
+            } else {
+                writeString(out, f, "error");
+                writeString(out, f, w.state == WindowState::Done ? "short_response" : windowError(w));
+                if (hasException) {
+                    writeString(out, f, "exceptionCode");
+                    writeUint(out, f, w.exceptionCode);
+                }
+            }
+        }
+    }
+
+    void writeJsonItems(Batch& b, Print& out) {
+        out.print('[');
+        // One small document per item keeps peak RAM independent of the batch size.
+        for (size_t i = 0; i < b.items.size(); i++) {
+            const auto& it = b.items[i];
+            const Window& w = b.windows[b.itemWindow[i]];
+
+            JsonDocument doc;
+            doc["unit"] = it.unitId;
+            doc["fc"] = it.functionCode;
+            doc["address"] = it.address;
+            doc["count"] = it.count;
+            const size_t offset = it.address - w.start;
+            const bool ok = w.state == WindowState::Done && w.words.size() >= offset + it.count;
+            doc["success"] = ok;
+            if (ok) {
+                JsonArray words = doc["words"].to<JsonArray>();
+                for (size_t k = 0; k < it.count; k++) words.add(w.words[offset + k]);
+            } else {
+                doc["error"] = w.state == WindowState::Done ? "short_response" : windowError(w);
+                if (w.state == WindowState::Failed) doc["exceptionCode"] = w.exceptionCode;
+            }
+
+            if (i > 0) out.print(',');
+            serializeJson(doc, out);
+        }
+        out.print(']');
+    }
+
+    void respond(Batch& b) {
+        auto request = b.request.lock();
+        if (!request) return;  // client went away
+
+        const uint32_t elapsedMs = (uint32_t)millis() - b.startMs;
+        const bool complete = b.openWindows == 0;
+        AsyncResponseStream* response = request->beginResponseStream(ApiEncoding::contentType(b.format));
+        response->addHeader("Vary", "Accept");
+
+        if (b.format == ApiEncoding::Format::Json) {
+            response->printf("{\"complete\":%s,\"transactions\":%u,\"elapsedMs\":%u,\"items\":",
+                             complete ? "true" : "false", (unsigned)b.windows.size(), (unsigned)elapsedMs);
+            writeJsonItems(b, *response);
+            response->print('}');
+        } else {
+            using namespace ApiEncoding;
+            writeMapHeader(*response, b.format, 4);
+            writeString(*response, b.format, "complete");     writeBool(*response, b.format, complete);
+            writeString(*response, b.format, "transactions"); writeUint(*response, b.format, b.windows.size());
+            writeString(*response, b.format, "elapsedMs");    writeUint(*response, b.format, elapsedMs);
+            writeString(*response, b.format, "items");
+            writeBinaryItems(b, *response);
+        }
+        request->send(response);
+    }
+}
+
+namespace ModbusBatch {
+    void init(ModbusRTUFeature& modbus) {
+        s_modbus = &modbus;
+    }
+
+    bool submit(AsyncWebServerRequest* request, std::vector<Item>&& items,
+                uint32_t timeoutMs, uint16_t maxGap) {
+        if (!s_modbus) return false;
+
+        auto batch = std::make_shared<Batch>();
+        batch->items = std::move(items);
+        batch->startMs = (uint32_t)millis();
+        batch->deadlineMs = batch->startMs + timeoutMs;
+        plan(*batch, maxGap);
+
+        portENTER_CRITICAL(&s_mux);
+        const bool accepted = s_inProgress < MAX_ACTIVE_BATCHES;
+        if (accepted) s_inProgress++;
+        portEXIT_CRITICAL(&s_mux);
+        if (!accepted) return false;
+
+        batch->format = ApiEncoding::negotiate(request);
+        batch->request = request->getThis();
+        request->pause();
+
+        portENTER_CRITICAL(&s_mux);
+        s_incoming.push_back(batch);
+        portEXIT_CRITICAL(&s_mux);
+        LoopScheduler::wake();
+
+        LOG_D("Modbus batch: %u items in %u transactions",
+              (unsigned)batch->items.size(), (unsigned)batch->windows.size());
+        return true;
+    }
+
+    void loop() {
+        if (!s_modbus) return;
+
+        portENTER_CRITICAL(&s_mux);
+        const bool hasIncoming = !s_incoming.empty();
+        portEXIT_CRITICAL(&s_mux);
+        if (hasIncoming) {
+            std::vector<std::shared_ptr<Batch>> incoming;
+            portENTER_CRITICAL(&s_mux);
+            incoming.swap(s_incoming);
+            portEXIT_CRITICAL(&s_mux);
+            for (auto& b : incoming) s_active.push_back(std::move(b));
+        }
+        if (s_active.empty()) return;
+
+        const uint32_t nowMs = (uint32_t)millis();
+        for (auto it = s_active.begin(); it != s_active.end();) {
+            Batch& b = **it;
+            const bool abandoned = b.request.expired();
+            const bool expired = (int32_t)(nowMs - b.deadlineMs) >= 0;
+            if (!abandoned && !expired) dispatch(*it);
+
+            if (abandoned || expired || b.openWindows == 0) {
+                if (!abandoned) respond(b);
+                it = s_active.erase(it);
+                portENTER_CRITICAL(&s_mux);
+                if (s_inProgress > 0) s_inProgress--;
+                portEXIT_CRITICAL(&s_mux);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    size_t activeCount() {
+        portENTER_CRITICAL(&s_mux);
+        const size_t n = s_inProgress;
+        portEXIT_CRITICAL(&s_mux);
+        return n;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <vector>
+
+class ModbusRTUFeature;
+
+/**
+ * Batched register reads for POST /api/modbus/batch.
+ *
+ * A batch is a list of unit/FC/address/count items. Items of the same unit and
+ * function code are coalesced into as few read windows (max 125 registers) as
+ * possible, the windows are queued to the Modbus RTU feature as the request
+ * queue has room, and the answer is sent once every window completed or the
+ * batch deadline expired.
+ *
+ * The HTTP request stays paused while the batch is in progress; all Modbus
+ * interaction and the response rendering happen in the loop task.
+ *
+ * Usage:
+ *   setup():  ModbusBatch::init(modbus);
+ *   loop():   ModbusBatch::loop();
+ */
+namespace ModbusBatch {
+    struct Item {
+        uint8_t unitId;
+        uint8_t functionCode;
+        uint16_t address;
+        uint16_t count;
+    };
+
+    // Limits enforced by submit() and the web handler.
+    static constexpr size_t MAX_ITEMS = 64;
+    static constexpr size_t MAX_ACTIVE_BATCHES = 4;
+    static constexpr uint16_t MAX_WINDOW_REGISTERS = 125;
+    static constexpr uint32_t DEFAULT_TIMEOUT_MS = 3000;
+    static constexpr uint32_t MAX_TIMEOUT_MS = 10000;
+    static constexpr uint16_t DEFAULT_MAX_GAP = 8;
+
+    // Bind the Modbus RTU feature used to execute batches.
+    void init(ModbusRTUFeature& modbus);
+
+    // Pause the request and hand the batch over to the loop task.
+    // Registers between two items (up to maxGap) are read along to save transactions.
+    // Returns false (request untouched) if too many batches are in progress.
+    bool submit(AsyncWebServerRequest* request, std::vector<Item>&& items,
+                uint32_t timeoutMs, uint16_t maxGap);
+
+    // Queue pending windows, finish completed or expired batches.
+    void loop();
+
+    // Number of batches waiting for their response.
+    size_t activeCount();
+}
@@ -0,0 +1,276 @@
+#include "ModbusCodec.h"
+#include <algorithm>
+#include <string.h>
+#include <strings.h>
+
+namespace ModbusCodec {
+    uint16_t crc16(const uint8_t* data, size_t length) {
+        uint16_t crc = 0xFFFF;
+
+        for (size_t i = 0; i < length; i++) {
+            crc ^= data[i];
+            for (int j = 0; j < 8; j++) {
+                if (crc & 0x0001) {
+                    crc = (crc >> 1) ^ 0xA001;
+                } else {
+                    crc >>= 1;
+                }
+            }
+        }
+
+        return crc;
+    }
+
+    bool parseFrame(const uint8_t* data, size_t length, ModbusFrame& frame) {
+        if (length < 4) return false;
+
+        frame.unitId = data[0];
+        frame.functionCode = data[1];
+
+        // Verify CRC (Modbus: LSB first)
+        uint16_t receivedCrc = (uint16_t)data[length - 2] | ((uint16_t)data[length - 1] << 8);
+        uint16_t calculatedCrc = crc16(data, length - 2);
+
+        const size_t payloadLenRaw = length - 4; // exclude unit, fc, crc(2)
+        const size_t payloadLen = (payloadLenRaw <= ModbusFrame::MAX_DATA_LEN) ? payloadLenRaw : ModbusFrame::MAX_DATA_LEN;
+
+        if (receivedCrc != calculatedCrc) {
+            frame.isValid = false;
+            frame.crc = receivedCrc;
+            frame.dataLen = (uint16_t)payloadLen;
+            if (payloadLen > 0) memcpy(frame.data.data(), data + 2, payloadLen);
+            frame.isException = false;
+            frame.exceptionCode = 0;
+            return true;  // Return true so caller can count CRC error and log
+        }
+
+        frame.crc = receivedCrc;
+        frame.isValid = true;
+
+        // Check for exception
+        if (frame.functionCode & 0x80) {
+            frame.isException = true;
+            frame.exceptionCode = (length > 2) ? data[2] : 0;
+            frame.dataLen = 0;
+        } else {
+            frame.isException = false;
+            frame.exceptionCode = 0;
+            frame.dataLen = (uint16_t)payloadLen;
+            if (payloadLen > 0) memcpy(frame.data.data(), data + 2, payloadLen);
+        }
+
+        return true;
+    }
+
+    ModbusDataType parseDataType(const char* str) {
+        if (strcasecmp(str, "int16") == 0) return ModbusDataType::INT16;
+        if (strcasecmp(str, "uint32_be") == 0) return ModbusDataType::UINT32_BE;
+        if (strcasecmp(str, "uint32_le") == 0) return ModbusDataType::UINT32_LE;
+        if (strcasecmp(str, "int32_be") == 0) return ModbusDataType::INT32_BE;
+        if (strcasecmp(str, "int32_le") == 0) return ModbusDataType::INT32_LE;
+        if (strcasecmp(str, "float32_be") == 0) return ModbusDataType::FLOAT32_BE;
+        if (strcasecmp(str, "float32_le") == 0) return ModbusDataType::FLOAT32_LE;
+        if (strcasecmp(str, "bool") == 0) return ModbusDataType::BOOL;
+        if (strcasecmp(str, "string") == 0) return ModbusDataType::STRING;
+        return ModbusDataType::UINT16;  // Default
+    }
+
+    float toValue(const ModbusRegisterDef& def, const uint16_t* rawData) {
+        float rawValue = 0;
+
+        switch (def.dataType) {
+            case ModbusDataType::UINT16:
+                rawValue = rawData[0];
+                break;
+
+            case ModbusDataType::INT16:
+                rawValue = (int16_t)rawData[0];
+                break;
+
+            case ModbusDataType::UINT32_BE:
+                rawValue = ((uint32_t)rawData[0] << 16) | rawData[1];
+                break;
+
+            case ModbusDataType::UINT32_LE:
+                rawValue = ((uint32_t)rawData[1] << 16) | rawData[0];
+                break;
+
+            case ModbusDataType::INT32_BE: {
+                int32_t val = ((uint32_t)rawData[0] << 16) | rawData[1];
+                rawValue = val;
+                break;
+            }
+
+            case ModbusDataType::INT32_LE: {
+                int32_t val = ((uint32_t)rawData[1] << 16) | rawData[0];
+                rawValue = val;
+                break;
+            }
+
+            case ModbusDataType::FLOAT32_BE: {
+                uint32_t bits = ((uint32_t)rawData[0] << 16) | rawData[1];
+                memcpy(&rawValue, &bits, sizeof(float));
+                break;
+            }
+
+            case ModbusDataType::FLOAT32_LE: {
+                uint32_t bits = ((uint32_t)rawData[1] << 16) | rawData[0];
+                memcpy(&rawValue, &bits, sizeof(float));
+                break;
+            }
+
+            case ModbusDataType::BOOL:
+                rawValue = rawData[0] ? 1.0f : 0.0f;
+                break;
+
+            default:
+                rawValue = rawData[0];
+                break;
+        }
+
+        return (rawValue * def.conversionFactor) + def.offset;
+    }
+
+    std::vector<uint16_t> toRaw(const ModbusRegisterDef& def, float value) {
+        std::vector<uint16_t> result;
+        result.reserve(2);  // one allocation, also for the two-register types
+
+        // Reverse the conversion factor and offset
+        float rawValue = (value - def.offset) / def.conversionFactor;
+
+        switch (def.dataType) {
+            case ModbusDataType::UINT16:
+                result.push_back((uint16_t)rawValue);
+                break;
+
+            case ModbusDataType::INT16:
+                result.push_back((uint16_t)(int16_t)rawValue);
+                break;
+
+            case ModbusDataType::UINT32_BE: {
+                uint32_t val = (uint32_t)rawValue;
+                result.push_back(val >> 16);
+                result.push_back(val & 0xFFFF);
+                break;
+            }
+
+            case ModbusDataType::UINT32_LE: {
+                uint32_t val = (uint32_t)rawValue;
+                result.push_back(val & 0xFFFF);
+                result.push_back(val >> 16);
+                break;
+            }
+
+            case ModbusDataType::INT32_BE: {
+                int32_t val = (int32_t)rawValue;
+                result.push_back((uint16_t)(val >> 16));
+                result.push_back((uint16_t)(val & 0xFFFF));
+                break;
+            }
+
+            case ModbusDataType::INT32_LE: {
+                int32_t val = (int32_t)rawValue;
+                result.push_back((uint16_t)(val & 0xFFFF));
+                result.push_back((uint16_t)(val >> 16));
+                break;
+            }
+
+            case ModbusDataType::FLOAT32_BE: {
+                uint32_t bits;
+                memcpy(&bits, &rawValue, sizeof(float));
+                result.push_back(bits >> 16);
+                result.push_back(bits & 0xFFFF);
+                break;
+            }
+
+            case ModbusDataType::FLOAT32_LE: {
+                uint32_t bits;
+                memcpy(&bits, &rawValue, sizeof(float));
+                result.push_back(bits & 0xFFFF);
+                result.push_back(bits >> 16);
+                break;
+            }
+
+            case ModbusDataType::BOOL:
+                result.push_back(rawValue >= 0.5f ? 1 : 0);
+                break;
+
+            default:
+                result.push_back((uint16_t)rawValue);
+                break;
+        }
+
+        return result;
+    }
+    void planPollWindows(const std::vector<ModbusRegisterDef>& registers,
+                         std::vector<PollWindow>& windows) {
+        windows.clear();
+
+        // Only merge strictly contiguous ranges by default (no holes), to avoid reading
+        // undocumented registers. This can be relaxed later if desired.
+        static constexpr uint16_t GAP_ALLOW_REGS = 0;
+
+        struct Seg {
+            uint16_t start;
+            uint16_t end;
+            uint8_t fc;
+            uint32_t interval;
+        };
+
+        std::vector<Seg> segs;
+        segs.reserve(registers.size());
+
+        for (const auto& reg : registers) {
+            if (reg.pollIntervalMs == 0) continue;
+            uint16_t start = reg.address;
+            uint16_t end = (uint16_t)(reg.address + reg.length - 1);
+            segs.push_back({start, end, reg.functionCode, reg.pollIntervalMs});
+        }
+
+        if (segs.empty()) return;
+
+        // Sort by (fc, interval, start)
+        std::sort(segs.begin(), segs.end(), [](const Seg& a, const Seg& b) {
+            if (a.fc != b.fc) return a.fc < b.fc;
+            if (a.interval != b.interval) return a.interval < b.interval;
+            return a.start < b.start;
+        });
+
+        // Merge into windows
+        uint8_t curFc = segs[0].fc;
+        uint32_t curInterval = segs[0].interval;
+        uint16_t ws = segs[0].start;
+        uint16_t we = segs[0].end;
+
+        auto flushWindow = [&]() {
+            uint16_t qty = (uint16_t)(we - ws + 1);
+            if (qty == 0) return;
+            windows.push_back({curFc, ws, qty, curInterval});
+        };
+
+        for (size_t i = 1; i < segs.size(); i++) {
+            const Seg& s = segs[i];
+            if (s.fc != curFc || s.interval != curInterval) {
+                flushWindow();
+                curFc = s.fc;
+                curInterval = s.interval;
+                ws = s.start;
+                we = s.end;
+                continue;
+            }
+
+            uint16_t mergedEnd = (s.end > we) ? s.end : we;
+            uint16_t mergedLen = (uint16_t)(mergedEnd - ws + 1);
+            bool canMerge = (s.start <= (uint16_t)(we + 1 + GAP_ALLOW_REGS)) && (mergedLen <= MAX_REGS_PER_READ);
+
+            if (canMerge) {
+                we = mergedEnd;
+            } else {
+                flushWindow();
+                ws = s.start;
+                we = s.end;
+            }
+        }
+        flushWindow();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "ModbusTypes.h"
+
+/**
+ * Pure Modbus RTU encoding and decoding.
+ *
+ * The hot paths of the bus monitor and the device manager without any
+ * hardware, clock or logging, so the native env can unit test and
+ * benchmark them (test/). ModbusRTUFeature and ModbusDeviceManager call
+ * these and add timestamps, statistics and logging around them.
+ */
+namespace ModbusCodec {
+    // Modbus RTU limit of registers per FC3/FC4 read
+    constexpr uint16_t MAX_REGS_PER_READ = 125;
+
+    /**
+     * @brief A contiguous register window polled with one read request
+     */
+    struct PollWindow {
+        uint8_t functionCode;
+        uint16_t startAddress;
+        uint16_t quantity;
+        uint32_t pollIntervalMs;
+    };
+
+    // CRC-16/MODBUS (poly 0xA001 reflected, init 0xFFFF); sent LSB first
+    uint16_t crc16(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Decode an RTU frame (unit, FC, payload, CRC)
+     * Leaves timestamp, unixTimestamp and isRequest to the caller.
+     * @return false if too short to be a frame; a CRC mismatch still
+     *         returns true with isValid false, so it can be counted
+     */
+    bool parseFrame(const uint8_t* data, size_t length, ModbusFrame& frame);
+
+    // "int16", "float32_be", ... (case-insensitive), UINT16 if unknown
+    ModbusDataType parseDataType(const char* str);
+
+    /**
+     * @brief Raw registers to the scaled value of a register definition
+     * @param rawData def.length registers as received
+     */
+    float toValue(const ModbusRegisterDef& def, const uint16_t* rawData);
+
+    // Scaled value back to the registers to write
+    std::vector<uint16_t> toRaw(const ModbusRegisterDef& def, float value);
+
+    /**
+     * @brief Merge the polled registers into read windows
+     * Strictly contiguous registers of the same function code and poll
+     * interval share a window of up to MAX_REGS_PER_READ registers.
+     * Registers with pollIntervalMs 0 (on demand) are skipped.
+     * @param windows Cleared, then filled sorted by (FC, interval, start)
+     */
+    void planPollWindows(const std::vector<ModbusRegisterDef>& registers,
+                         std::vector<PollWindow>& windows);
+}
@@ -1,7 +1,13 @@
+#define LOG_CATEGORY LogCategory::ModbusDevice
+
 #include "ModbusDevice.h"
+#include "ModbusCodec.h"
 #include <LittleFS.h>
 #include "TimeUtils.h"
+#include "Hal.h"
 #include "InfluxLineProtocol.h"
+#include "HeapMonitor.h"
+#include "Trace.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 
@@ -12,6 +18,34 @@ static bool valuesDiffer(float a, float b) {
     return diff > 0.0001f;
 }
 
+static void skipJsonWhitespace(Stream& in) {
+    int c;
+    while ((c = in.peek()) == ' ' || c == '\t' || c == '\r' || c == '\n') in.read();
+}
+
+// Position the stream just after the '[' of the array value of "key"
+static bool seekJsonArray(Stream& in, const char* key) {
+    String quoted = String('"') + key + '"';
+    while (in.find(quoted.c_str())) {
+        skipJsonWhitespace(in);
+        if (in.peek() != ':') continue;  // a string value, not a key
+        in.read();
+        skipJsonWhitespace(in);
+        if (in.peek() == '[') {
+            in.read();
+            return true;
+        }
+    }
+    return false;
+}
+
+// Skip separators before the next array element; false at the end of the array
+static bool nextJsonArrayElement(Stream& in) {
+    int c;
+    while ((c = in.peek()) == ',' || c == ' ' || c == '\t' || c == '\r' || c == '\n') in.read();
+    return c >= 0 && c != ']';
+}
+
 ModbusDeviceManager::ModbusDeviceManager(ModbusRTUFeature& modbus, StorageFeature& storage)
     : _modbus(modbus)
     , _storage(storage)
@@ -139,16 +173,17 @@ void ModbusDeviceManager::tryUpdateFromPassiveResponse(ModbusDeviceInstance& dev
             rawData.push_back(word);
         }
 
-        float value = convertRawToValue(reg, rawData.data());
+        float value = ModbusCodec::toValue(reg, rawData.data());
 
         auto& cached = device.currentValues[reg.name];
         bool shouldNotify = (!cached.valid) || valuesDiffer(cached.value, value);
 
-        cached.updatedAtMs = millis();
+        cached.updatedAtMs = Hal::millis();
         cached.unixTimestamp = TimeUtils::nowUnixSecondsOrZero();
         cached.timestamp = (cached.unixTimestamp != 0) ? cached.unixTimestamp : (cached.updatedAtMs / 1000);
         cached.value = value;
         cached.valid = true;
+        cached.restored = false;
 
         matchedAny = true;
 
@@ -175,7 +210,7 @@ void ModbusDeviceManager::tryUpdateFromPassiveResponse(ModbusDeviceInstance& dev
             uint16_t word = ((uint16_t)regData[byteIndex] << 8) | (uint16_t)regData[byteIndex + 1];
 
             ModbusRegisterValue& v = device.unknownU16[address];
-            v.updatedAtMs = millis();
+            v.updatedAtMs = Hal::millis();
             v.unixTimestamp = TimeUtils::nowUnixSecondsOrZero();
             v.timestamp = (v.unixTimestamp != 0) ? v.unixTimestamp : (v.updatedAtMs / 1000);
             snprintf(v.name, sizeof(v.name), "U16_%u", (unsigned)address);
@@ -187,15 +222,18 @@ void ModbusDeviceManager::tryUpdateFromPassiveResponse(ModbusDeviceInstance& dev
 }
 
 bool ModbusDeviceManager::loadDeviceType(const char* path) {
-    File file = LittleFS.open(path, "r");
-    if (!file) {
+    StorageFeature::Reader reader = _storage.openReader(path);
+    if (!reader) {
         LOG_E("Failed to open device type: %s", path);
         return false;
     }
     
+    // Definitions can be large: parse them as a stream instead of one document.
+    // First pass takes only the name, the filter skips the registers.
+    JsonDocument filter;
+    filter["name"] = true;
     JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
+    DeserializationError error = deserializeJson(doc, reader, DeserializationOption::Filter(filter));
     
     if (error) {
         LOG_E("JSON parse error: %s", error.c_str());
@@ -205,14 +243,24 @@ bool ModbusDeviceManager::loadDeviceType(const char* path) {
     ModbusDeviceType deviceType;
     strlcpy(deviceType.name, doc["name"] | "unknown", sizeof(deviceType.name));
     
-    JsonArray registers = doc["registers"].as<JsonArray>();
-    for (JsonObject reg : registers) {
+    // Second pass: one register definition at a time
+    reader.seek(0);
+    if (!seekJsonArray(reader, "registers")) {
+        LOG_W("Device type '%s' has no registers", deviceType.name);
+    }
+    while (nextJsonArrayElement(reader)) {
+        error = deserializeJson(doc, reader);
+        if (error) {
+            LOG_E("JSON parse error in registers of %s: %s", path, error.c_str());
+            return false;
+        }
+        JsonObject reg = doc.as<JsonObject>();
         ModbusRegisterDef def;
         strlcpy(def.name, reg["name"] | "", sizeof(def.name));
         def.address = reg["address"] | 0;
         def.length = reg["length"] | 1;
         def.functionCode = reg["functionCode"] | 3;
-        def.dataType = parseDataType(reg["dataType"] | "uint16");
+        def.dataType = ModbusCodec::parseDataType(reg["dataType"] | "uint16");
         def.conversionFactor = reg["factor"] | 1.0f;
         def.offset = reg["offset"] | 0.0f;
         strlcpy(def.unit, reg["unit"] | "", sizeof(def.unit));
@@ -231,15 +279,14 @@ bool ModbusDeviceManager::loadDeviceType(const char* path) {
 }
 
 bool ModbusDeviceManager::loadDeviceMappings(const char* path) {
-    File file = LittleFS.open(path, "r");
-    if (!file) {
+    StorageFeature::Reader reader = _storage.openReader(path);
+    if (!reader) {
         LOG_E("Failed to open mappings: %s", path);
         return false;
     }
     
     JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
+    DeserializationError error = deserializeJson(doc, reader);
     
     if (error) {
         LOG_E("JSON parse error: %s", error.c_str());
@@ -277,6 +324,7 @@ bool ModbusDeviceManager::loadDeviceMappings(const char* path) {
             val.value = 0;
             strlcpy(val.unit, reg.unit, sizeof(val.unit));
             val.valid = false;
+            val.restored = false;
             instance.currentValues[reg.name] = val;
         }
 
@@ -296,73 +344,12 @@ void ModbusDeviceManager::rebuildPollBatches(ModbusDeviceInstance& device) {
     device.pollBatches.clear();
     if (!device.deviceType) return;
 
-    // Only merge strictly contiguous ranges by default (no holes), to avoid reading
-    // undocumented registers. This can be relaxed later if desired.
-    static constexpr uint16_t GAP_ALLOW_REGS = 0;
-    static constexpr uint16_t MAX_REGS_PER_READ = 125;  // Modbus RTU limit for FC3/FC4
-
-    struct Seg {
-        uint16_t start;
-        uint16_t end;
-        uint8_t fc;
-        uint32_t interval;
-    };
-
-    std::vector<Seg> segs;
-    segs.reserve(device.deviceType->registers.size());
-
-    for (const auto& reg : device.deviceType->registers) {
-        if (reg.pollIntervalMs == 0) continue;
-        uint16_t start = reg.address;
-        uint16_t end = (uint16_t)(reg.address + reg.length - 1);
-        segs.push_back({start, end, reg.functionCode, reg.pollIntervalMs});
-    }
-
-    if (segs.empty()) return;
-
-    // Sort by (fc, interval, start)
-    std::sort(segs.begin(), segs.end(), [](const Seg& a, const Seg& b) {
-        if (a.fc != b.fc) return a.fc < b.fc;
-        if (a.interval != b.interval) return a.interval < b.interval;
-        return a.start < b.start;
-    });
-
-    // Merge into windows
-    uint8_t curFc = segs[0].fc;
-    uint32_t curInterval = segs[0].interval;
-    uint16_t ws = segs[0].start;
-    uint16_t we = segs[0].end;
-
-    auto flushWindow = [&]() {
-        uint16_t qty = (uint16_t)(we - ws + 1);
-        if (qty == 0) return;
-        device.pollBatches.push_back({curFc, ws, qty, curInterval, 0, 0});
-    };
-
-    for (size_t i = 1; i < segs.size(); i++) {
-        const Seg& s = segs[i];
-        if (s.fc != curFc || s.interval != curInterval) {
-            flushWindow();
-            curFc = s.fc;
-            curInterval = s.interval;
-            ws = s.start;
-            we = s.end;
-            continue;
-        }
-
-        uint16_t mergedEnd = (s.end > we) ? s.end : we;
-        uint16_t mergedLen = (uint16_t)(mergedEnd - ws + 1);
-        bool canMerge = (s.start <= (uint16_t)(we + 1 + GAP_ALLOW_REGS)) && (mergedLen <= MAX_REGS_PER_READ);
-
-        if (canMerge) {
-            we = mergedEnd;
-        } else {
-            flushWindow();
-            ws = s.start;
-            we = s.end;
-        }
+    std::vector<ModbusCodec::PollWindow> windows;
+    ModbusCodec::planPollWindows(device.deviceType->registers, windows);
+    device.pollBatches.reserve(windows.size());
+    for (const auto& w : windows) {
+        device.pollBatches.push_back({w.functionCode, w.startAddress, w.quantity, w.pollIntervalMs, 0, 0});
     }
-    flushWindow();
 
     LOG_I("Modbus poll plan for unit %u: %u batched windows", device.unitId, (unsigned)device.pollBatches.size());
 }
@@ -390,7 +377,7 @@ void ModbusDeviceManager::applyReadResponseToDevice(ModbusDeviceInstance& device
         words.push_back(w);
     }
 
-    const uint32_t nowMs = millis();
+    const uint32_t nowMs = Hal::millis();
     const uint32_t nowUnix = TimeUtils::nowUnixSecondsOrZero();
 
     // Update every register definition that is covered by this read window.
@@ -403,7 +390,7 @@ void ModbusDeviceManager::applyReadResponseToDevice(ModbusDeviceInstance& device
         uint32_t offset = (uint32_t)(reg.address - startAddress);
         if (offset + reg.length > wordCount) continue;
 
-        float value = convertRawToValue(reg, &words[offset]);
+        float value = ModbusCodec::toValue(reg, &words[offset]);
 
         auto& cached = device.currentValues[reg.name];
         cached.updatedAtMs = nowMs;
@@ -411,6 +398,7 @@ void ModbusDeviceManager::applyReadResponseToDevice(ModbusDeviceInstance& device
         cached.timestamp = (nowUnix != 0) ? nowUnix : (nowMs / 1000);
         cached.value = value;
         cached.valid = true;
+        cached.restored = false;
 
         notifyValueChange(device.unitId, reg.name, value, reg.unit);
     }
@@ -533,15 +521,16 @@ bool ModbusDeviceManager::readRegister(uint8_t unitId, const char* registerName,
                     for (size_t i = 0; i < reg->length; i++) {
                         rawData.push_back((data[i*2] << 8) | data[i*2 + 1]);
                     }
-                    value = convertRawToValue(*reg, rawData.data());
+                    value = ModbusCodec::toValue(*reg, rawData.data());
                     
                     // Update cached value
                     auto& cached = device->currentValues[reg->name];
-                    cached.updatedAtMs = millis();
+                    cached.updatedAtMs = Hal::millis();
                     cached.unixTimestamp = TimeUtils::nowUnixSecondsOrZero();
                     cached.timestamp = (cached.unixTimestamp != 0) ? cached.unixTimestamp : (cached.updatedAtMs / 1000);
                     cached.value = value;
                     cached.valid = true;
+                    cached.restored = false;
                     
                     // Notify value change callback
                     notifyValueChange(device->unitId, reg->name, value, reg->unit);
@@ -595,7 +584,7 @@ bool ModbusDeviceManager::writeRegister(uint8_t unitId, const char* registerName
         return false;
     }
     
-    auto rawValues = convertValueToRaw(*reg, value);
+    auto rawValues = ModbusCodec::toRaw(*reg, value);
     
     if (rawValues.size() == 1) {
         return _modbus.queueWriteSingleRegister(unitId, reg->address, rawValues[0],
@@ -708,7 +697,7 @@ String ModbusDeviceManager::getDeviceValuesJson(uint8_t unitId) const {
     const bool timeValid = TimeUtils::isTimeValidNow();
     const uint32_t nowUnix = TimeUtils::nowUnixSecondsOrZero();
 
-    JsonDocument doc;
+    JsonDocument doc(HeapMonitor::jsonAllocator());
     doc["unitId"] = unitId;
     doc["deviceType"] = deviceTypeName;
     doc["successCount"] = successCount;
@@ -716,7 +705,7 @@ String ModbusDeviceManager::getDeviceValuesJson(uint8_t unitId) const {
 
     {
         JsonObject updated = doc["updated"].to<JsonObject>();
-        updated["uptimeMs"] = (uint32_t)millis();
+        updated["uptimeMs"] = (uint32_t)Hal::millis();
         if (nowUnix != 0) {
             updated["epoch"] = nowUnix;
             String iso = TimeUtils::isoUtcFromUnixSeconds(nowUnix);
@@ -732,9 +721,15 @@ String ModbusDeviceManager::getDeviceValuesJson(uint8_t unitId) const {
         val["value"] = v.value;
         val["unit"] = v.unit;
         val["valid"] = v.valid;
+        if (v.restored) val["restored"] = true;
 
         JsonObject updated = val["updated"].to<JsonObject>();
         updated["uptimeMs"] = v.updatedAtMs;
+        if (!v.restored && v.updatedAtMs != 0) {
+            updated["ageMs"] = (uint32_t)(Hal::millis() - v.updatedAtMs);
+        } else if (v.restored && nowUnix != 0 && v.unixTimestamp != 0 && nowUnix >= v.unixTimestamp) {
+            updated["ageMs"] = (uint64_t)(nowUnix - v.unixTimestamp) * 1000;
+        }
         if (v.unixTimestamp != 0) {
             updated["epoch"] = v.unixTimestamp;
         } else if (timeValid && nowUnix != 0 && v.updatedAtMs != 0) {
@@ -775,7 +770,8 @@ String ModbusDeviceManager::getDeviceValuesJson(uint8_t unitId) const {
     return output;
 }
 
-void ModbusDeviceManager::writeDeviceValuesJson(uint8_t unitId, Print& out) const {
+void ModbusDeviceManager::writeDeviceValuesJson(uint8_t unitId, Print& out,
+                                                ApiEncoding::Format format) const {
     // Snapshot under lock (avoid holding mutex while doing JSON allocations/serialization).
     // Keep this small: unknown registers can get large quickly and this JSON is served from heap-backed buffers.
     static constexpr size_t MAX_UNKNOWN_U16_JSON = 32;
@@ -791,7 +787,7 @@ void ModbusDeviceManager::writeDeviceValuesJson(uint8_t unitId, Print& out) cons
         if (it == _devices.end()) {
             JsonDocument err;
             err["error"] = "Device not found";
-            serializeJson(err, out);
+            ApiEncoding::serialize(err, out, format);
             return;
         }
 
@@ -819,7 +815,7 @@ void ModbusDeviceManager::writeDeviceValuesJson(uint8_t unitId, Print& out) cons
         if (it == _devices.end()) {
             JsonDocument err;
             err["error"] = "Device not found";
-            serializeJson(err, out);
+            ApiEncoding::serialize(err, out, format);
             return;
         }
 
@@ -840,7 +836,7 @@ void ModbusDeviceManager::writeDeviceValuesJson(uint8_t unitId, Print& out) cons
     const uint32_t nowUnix = TimeUtils::nowUnixSecondsOrZero();
 
     // Keep the JSON shape identical to getDeviceValuesJson(), but avoid building a large String.
-    JsonDocument doc;
+    JsonDocument doc(HeapMonitor::jsonAllocator());
     doc["unitId"] = unitId;
     doc["deviceType"] = deviceTypeName;
     doc["successCount"] = successCount;
@@ -848,7 +844,7 @@ void ModbusDeviceManager::writeDeviceValuesJson(uint8_t unitId, Print& out) cons
 
     {
         JsonObject updated = doc["updated"].to<JsonObject>();
-        updated["uptimeMs"] = (uint32_t)millis();
+        updated["uptimeMs"] = (uint32_t)Hal::millis();
         if (nowUnix != 0) {
             updated["epoch"] = nowUnix;
             String iso = TimeUtils::isoUtcFromUnixSeconds(nowUnix);
@@ -864,9 +860,15 @@ void ModbusDeviceManager::writeDeviceValuesJson(uint8_t unitId, Print& out) cons
         val["value"] = v.value;
         val["unit"] = v.unit;
         val["valid"] = v.valid;
+        if (v.restored) val["restored"] = true;
 
         JsonObject updated = val["updated"].to<JsonObject>();
         updated["uptimeMs"] = v.updatedAtMs;
+        if (!v.restored && v.updatedAtMs != 0) {
+            updated["ageMs"] = (uint32_t)(Hal::millis() - v.updatedAtMs);
+        } else if (v.restored && nowUnix != 0 && v.unixTimestamp != 0 && nowUnix >= v.unixTimestamp) {
+            updated["ageMs"] = (uint64_t)(nowUnix - v.unixTimestamp) * 1000;
+        }
         if (v.unixTimestamp != 0) {
             updated["epoch"] = v.unixTimestamp;
         } else if (timeValid && nowUnix != 0 && v.updatedAtMs != 0) {
@@ -902,10 +904,11 @@ void ModbusDeviceManager::writeDeviceValuesJson(uint8_t unitId, Print& out) cons
     }
 
     doc["unknownU16Truncated"] = (bool)(unknownTotal > unknown.size());
-    serializeJson(doc, out);
+    ApiEncoding::serialize(doc, out, format);
 }
 
-void ModbusDeviceManager::writeDeviceMetaJson(uint8_t unitId, Print& out) const {
+void ModbusDeviceManager::writeDeviceMetaJson(uint8_t unitId, Print& out,
+                                              ApiEncoding::Format format) const {
     char deviceTypeName[64] = {0};
     uint32_t successCount = 0;
     uint32_t errorCount = 0;
@@ -918,7 +921,7 @@ void ModbusDeviceManager::writeDeviceMetaJson(uint8_t unitId, Print& out) const
         if (it == _devices.end()) {
             JsonDocument err;
             err["error"] = "Device not found";
-            serializeJson(err, out);
+            ApiEncoding::serialize(err, out, format);
             return;
         }
 
@@ -939,11 +942,11 @@ void ModbusDeviceManager::writeDeviceMetaJson(uint8_t unitId, Print& out) const
     doc["unknownU16Count"] = unknownCount;
 
     JsonObject updated = doc["updated"].to<JsonObject>();
-    updated["uptimeMs"] = (uint32_t)millis();
+    updated["uptimeMs"] = (uint32_t)Hal::millis();
     const uint32_t nowUnix = TimeUtils::nowUnixSecondsOrZero();
     if (nowUnix != 0) updated["epoch"] = nowUnix;
 
-    serializeJson(doc, out);
+    ApiEncoding::serialize(doc, out, format);
 }
 
 void ModbusDeviceManager::loop() {
@@ -953,7 +956,7 @@ void ModbusDeviceManager::loop() {
     auto _guard = scopedLock();
     if (_devices.empty()) return;
 
-    const uint32_t now = (uint32_t)millis();
+    const uint32_t now = (uint32_t)Hal::millis();
 
     // Avoid queue floods: only schedule a new poll when the Modbus queue is empty.
     // This also naturally adapts to a busy bus.
@@ -1016,7 +1019,7 @@ void ModbusDeviceManager::loop() {
                 device.errorCount++;
                 // Mark registers in this interval/functionCode as invalid if they are covered.
                 // (Best-effort; avoids stale data being presented as fresh.)
-                const uint32_t nowMs = millis();
+                const uint32_t nowMs = Hal::millis();
                 const uint32_t nowUnix = TimeUtils::nowUnixSecondsOrZero();
                 for (const auto& reg : device.deviceType->registers) {
                     if (reg.pollIntervalMs != interval) continue;
@@ -1029,6 +1032,7 @@ void ModbusDeviceManager::loop() {
                     cached.unixTimestamp = nowUnix;
                     cached.timestamp = (nowUnix != 0) ? nowUnix : (nowMs / 1000);
                     cached.valid = false;
+                    cached.restored = false;
                 }
             }
         });
@@ -1037,6 +1041,7 @@ void ModbusDeviceManager::loop() {
     bestBatch->lastAttemptMs = now;
 
     if (queued) {
+        TRACE_INSTANT("poll.schedule", unitId);
         bestBatch->lastPollMs = now;
         bestDevice->lastPollTime = now;
     }
@@ -1050,148 +1055,6 @@ std::vector<String> ModbusDeviceManager::getDeviceTypeNames() const {
     return names;
 }
 
-ModbusDataType ModbusDeviceManager::parseDataType(const char* str) const {
-    if (strcasecmp(str, "int16") == 0) return ModbusDataType::INT16;
-    if (strcasecmp(str, "uint32_be") == 0) return ModbusDataType::UINT32_BE;
-    if (strcasecmp(str, "uint32_le") == 0) return ModbusDataType::UINT32_LE;
-    if (strcasecmp(str, "int32_be") == 0) return ModbusDataType::INT32_BE;
-    if (strcasecmp(str, "int32_le") == 0) return ModbusDataType::INT32_LE;
-    if (strcasecmp(str, "float32_be") == 0) return ModbusDataType::FLOAT32_BE;
-    if (strcasecmp(str, "float32_le") == 0) return ModbusDataType::FLOAT32_LE;
-    if (strcasecmp(str, "bool") == 0) return ModbusDataType::BOOL;
-    if (strcasecmp(str, "string") == 0) return ModbusDataType::STRING;
-    return ModbusDataType::UINT16;  // Default
-}
-
-float ModbusDeviceManager::convertRawToValue(const ModbusRegisterDef& def,
-                                             const uint16_t* rawData) const {
-    float rawValue = 0;
-    
-    switch (def.dataType) {
-        case ModbusDataType::UINT16:
-            rawValue = rawData[0];
-            break;
-            
-        case ModbusDataType::INT16:
-            rawValue = (int16_t)rawData[0];
-            break;
-            
-        case ModbusDataType::UINT32_BE:
-            rawValue = ((uint32_t)rawData[0] << 16) | rawData[1];
-            break;
-            
-        case ModbusDataType::UINT32_LE:
-            rawValue = ((uint32_t)rawData[1] << 16) | rawData[0];
-            break;
-            
-        case ModbusDataType::INT32_BE: {
-            int32_t val = ((uint32_t)rawData[0] << 16) | rawData[1];
-            rawValue = val;
-            break;
-        }
-            
-        case ModbusDataType::INT32_LE: {
-            int32_t val = ((uint32_t)rawData[1] << 16) | rawData[0];
-            rawValue = val;
-            break;
-        }
-            
-        case ModbusDataType::FLOAT32_BE: {
-            uint32_t bits = ((uint32_t)rawData[0] << 16) | rawData[1];
-            memcpy(&rawValue, &bits, sizeof(float));
-            break;
-        }
-            
-        case ModbusDataType::FLOAT32_LE: {
-            uint32_t bits = ((uint32_t)rawData[1] << 16) | rawData[0];
-            memcpy(&rawValue, &bits, sizeof(float));
-            break;
-        }
-            
-        case ModbusDataType::BOOL:
-            rawValue = rawData[0] ? 1.0f : 0.0f;
-            break;
-            
-        default:
-            rawValue = rawData[0];
-            break;
-    }
-    
-    return (rawValue * def.conversionFactor) + def.offset;
-}
-
-std::vector<uint16_t> ModbusDeviceManager::convertValueToRaw(const ModbusRegisterDef& def,
-                                                              float value) const {
-    std::vector<uint16_t> result;
-    
-    // Reverse the conversion factor and offset
-    float rawValue = (value - def.offset) / def.conversionFactor;
-    
-    switch (def.dataType) {
-        case ModbusDataType::UINT16:
-            result.push_back((uint16_t)rawValue);
-            break;
-            
-        case ModbusDataType::INT16:
-            result.push_back((uint16_t)(int16_t)rawValue);
-            break;
-            
-        case ModbusDataType::UINT32_BE: {
-            uint32_t val = (uint32_t)rawValue;
-            result.push_back(val >> 16);
-            result.push_back(val & 0xFFFF);
-            break;
-        }
-            
-        case ModbusDataType::UINT32_LE: {
-            uint32_t val = (uint32_t)rawValue;
-            result.push_back(val & 0xFFFF);
-            result.push_back(val >> 16);
-            break;
-        }
-            
-        case ModbusDataType::INT32_BE: {
-            int32_t val = (int32_t)rawValue;
-            result.push_back((uint16_t)(val >> 16));
-            result.push_back((uint16_t)(val & 0xFFFF));
-            break;
-        }
-            
-        case ModbusDataType::INT32_LE: {
-            int32_t val = (int32_t)rawValue;
-            result.push_back((uint16_t)(val & 0xFFFF));
-            result.push_back((uint16_t)(val >> 16));
-            break;
-        }
-            
-        case ModbusDataType::FLOAT32_BE: {
-            uint32_t bits;
-            memcpy(&bits, &rawValue, sizeof(float));
-            result.push_back(bits >> 16);
-            result.push_back(bits & 0xFFFF);
-            break;
-        }
-            
-        case ModbusDataType::FLOAT32_LE: {
-            uint32_t bits;
-            memcpy(&bits, &rawValue, sizeof(float));
-            result.push_back(bits & 0xFFFF);
-            result.push_back(bits >> 16);
-            break;
-        }
-            
-        case ModbusDataType::BOOL:
-            result.push_back(rawValue >= 0.5f ? 1 : 0);
-            break;
-            
-        default:
-            result.push_back((uint16_t)rawValue);
-            break;
-    }
-    
-    return result;
-}
-
 void ModbusDeviceManager::notifyValueChange(uint8_t unitId, const char* registerName,
                                              float value, const char* unit) {
     if (_valueChangeCallback) {
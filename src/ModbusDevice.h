@@ -11,37 +11,7 @@
 #include "StorageFeature.h"
 #include "DataCollection.h"
 #include "LoggingFeature.h"
-
-/**
- * @brief Data types for Modbus register interpretation
- */
-enum class ModbusDataType : uint8_t {
-    UINT16 = 0,     // Unsigned 16-bit
-    INT16,          // Signed 16-bit
-    UINT32_BE,      // Unsigned 32-bit big-endian (AB CD)
-    UINT32_LE,      // Unsigned 32-bit little-endian (CD AB)
-    INT32_BE,       // Signed 32-bit big-endian
-    INT32_LE,       // Signed 32-bit little-endian
-    FLOAT32_BE,     // IEEE 754 float big-endian
-    FLOAT32_LE,     // IEEE 754 float little-endian
-    BOOL,           // Boolean (0/1)
-    STRING          // ASCII string
-};
-
-/**
- * @brief Single register definition
- */
-struct ModbusRegisterDef {
-    char name[32];              // Register name
-    uint16_t address;           // Start register address
-    uint16_t length;            // Number of registers
-    uint8_t functionCode;       // Function code (3 or 4 typically)
-    ModbusDataType dataType;    // Data type
-    float conversionFactor;     // Multiply raw value by this
-    float offset;               // Add this after multiplication
-    char unit[16];              // Unit string (°C, kW, etc.)
-    uint32_t pollIntervalMs;    // How often to poll (0 = on-demand)
-};
+#include "ApiEncoding.h"
 
 /**
  * @brief Device type definition (loaded from file)
@@ -59,7 +29,7 @@ struct ModbusRegisterValue {
     // - Unix epoch seconds when available, otherwise uptime seconds.
     uint32_t timestamp;
 
-    // Monotonic timestamp for scheduling/polling (millis()).
+    // Monotonic timestamp for scheduling/polling (Hal::millis()).
     uint32_t updatedAtMs;
 
     // Unix epoch seconds at capture time (0 if time not synced/available).
@@ -68,6 +38,10 @@ struct ModbusRegisterValue {
     float value;
     char unit[16];
     bool valid;
+
+    // Carried over from before the last restart (boot snapshot), not polled yet.
+    // updatedAtMs is 0, unixTimestamp is the capture time (0 if unknown).
+    bool restored;
 };
 
 /**
@@ -100,8 +74,8 @@ struct ModbusDeviceInstance {
         uint16_t startAddress;
         uint16_t quantity;          // number of registers
         uint32_t pollIntervalMs;
-        uint32_t lastPollMs;        // millis() when last queued successfully
-        uint32_t lastAttemptMs;     // millis() when we last attempted to queue
+        uint32_t lastPollMs;        // Hal::millis() when last queued successfully
+        uint32_t lastAttemptMs;     // Hal::millis() when we last attempted to queue
     };
 
     // Precomputed poll plan: contiguous register windows per (functionCode, pollIntervalMs)
@@ -260,18 +234,20 @@ public:
     String getDeviceValuesJson(uint8_t unitId) const;
 
     /**
-     * @brief Stream all current values for a device as JSON
+     * @brief Stream all current values for a device as JSON (or CBOR/MessagePack)
      *
      * Avoids building a potentially large intermediate String.
      */
-    void writeDeviceValuesJson(uint8_t unitId, Print& out) const;
+    void writeDeviceValuesJson(uint8_t unitId, Print& out,
+                               ApiEncoding::Format format = ApiEncoding::Format::Json) const;
 
     /**
-     * @brief Stream a lightweight device summary as JSON
+     * @brief Stream a lightweight device summary as JSON (or CBOR/MessagePack)
      *
      * Intended for debugging/health checks; avoids iterating all values.
      */
-    void writeDeviceMetaJson(uint8_t unitId, Print& out) const;
+    void writeDeviceMetaJson(uint8_t unitId, Print& out,
+                             ApiEncoding::Format format = ApiEncoding::Format::Json) const;
     
     /**
      * @brief Process automatic polling (call from loop)
@@ -317,10 +293,7 @@ private:
                                    uint16_t startAddress,
                                    const ModbusFrame& response);
 
-    float convertRawToValue(const ModbusRegisterDef& def, const uint16_t* rawData) const;
-    std::vector<uint16_t> convertValueToRaw(const ModbusRegisterDef& def, float value) const;
     const ModbusRegisterDef* findRegister(const ModbusDeviceType* type, const char* name) const;
-    ModbusDataType parseDataType(const char* str) const;
     void notifyValueChange(uint8_t unitId, const char* registerName, float value, const char* unit);
     
     ModbusRTUFeature& _modbus;
@@ -56,9 +56,9 @@ public:
                                          deviceId.c_str(), manufacturer, model, swVersion);
             }
             
-            LOG_I("Published HA discovery for %s (unit %d): %d sensors",
-                  device.deviceName.c_str(), device.unitId,
-                  device.deviceType->registers.size());
+            LOG_CAT_I(LogCategory::ModbusDevice, "Published HA discovery for %s (unit %d): %d sensors",
+                      device.deviceName.c_str(), device.unitId,
+                      device.deviceType->registers.size());
         }
     }
     
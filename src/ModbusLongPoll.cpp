@@ -0,0 +1,192 @@
+#define LOG_CATEGORY LogCategory::ModbusDevice
+
+#include "ModbusLongPoll.h"
+#include "ModbusRTUFeature.h"
+#include "ApiEncoding.h"
+#include "LoggingFeature.h"
+#include "LoopScheduler.h"
+#include <ArduinoJson.h>
+#include <map>
+#include <vector>
+
+namespace {
+    struct Waiting {
+        AsyncWebServerRequestPtr request;
+        uint8_t unitId{0};
+        uint8_t functionCode{0};
+        uint16_t address{0};
+        uint16_t count{0};
+        uint32_t createdMs{0};
+        uint32_t deadlineMs{0};
+    };
+
+    ModbusRTUFeature* s_modbus = nullptr;
+
+    // Handed over from the AsyncTCP task, guarded by s_mux.
+    portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+    std::vector<Waiting> s_incoming;
+    size_t s_inProgress = 0;
+
+    // Owned by the loop task; key is passed to the Modbus callback.
+    std::map<uint32_t, Waiting> s_waiting;
+    uint32_t s_nextId = 1;
+
+    void release() {
+        portENTER_CRITICAL(&s_mux);
+        if (s_inProgress > 0) s_inProgress--;
+        portEXIT_CRITICAL(&s_mux);
+    }
+
+    // Same fields as /api/modbus/raw/result, minus the request id.
+    void fillRequest(JsonDocument& doc, const Waiting& w, bool queued) {
+        doc["queued"] = queued;
+        doc["unitId"] = w.unitId;
+        doc["address"] = w.address;
+        doc["count"] = w.count;
+        doc["functionCode"] = w.functionCode;
+        doc["createdMs"] = w.createdMs;
+    }
+
+    void fillResponse(JsonDocument& doc, bool success, const ModbusFrame& response) {
+        doc["completed"] = true;
+        doc["success"] = success;
+        doc["isException"] = response.isException;
+        if (response.isException) doc["exceptionCode"] = response.exceptionCode;
+        doc["completedMs"] = (uint32_t)millis();
+        doc["crc"] = response.crc;
+        {
+            char crcHex[7];
+            snprintf(crcHex, sizeof(crcHex), "0x%04X", (unsigned)response.crc);
+            doc["crcHex"] = crcHex;
+        }
+        if (response.dataLen > 0) doc["dataHex"] = s_modbus->formatHex(response.data.data(), response.dataLen);
+
+        const uint8_t fcBase = response.functionCode & 0x7F;
+        if (!response.isException && (fcBase == ModbusFC::READ_HOLDING_REGISTERS || fcBase == ModbusFC::READ_INPUT_REGISTERS)) {
+            const size_t byteCount = response.getByteCount();
+            const uint8_t* regData = response.getRegisterData();
+            if (regData && byteCount >= 2) {
+                doc["registerDataHex"] = s_modbus->formatHex(regData, byteCount);
+                JsonArray words = doc["registerWords"].to<JsonArray>();
+                for (size_t i = 0; i + 1 < byteCount; i += 2) {
+                    words.add(((uint16_t)regData[i] << 8) | regData[i + 1]);
+                }
+            }
+        }
+    }
+
+    void answer(const Waiting& w, int code, JsonDocument& doc) {
+        auto request = w.request.lock();
+        if (!request) return;  // client went away
+        ApiEncoding::send(request.get(), code, doc);
+    }
+
+    void start(Waiting&& w) {
+        const uint32_t id = s_nextId++;
+        if (s_nextId == 0) s_nextId = 1;
+
+        // Install state before queueing so the callback can always find it.
+        auto& entry = s_waiting[id];
+        entry = std::move(w);
+
+        const bool queued = s_modbus->queueReadRegisters(
+            entry.unitId, entry.functionCode, entry.address, entry.count,
+            [id](bool success, const ModbusFrame& response) {
+                auto it = s_waiting.find(id);
+                if (it == s_waiting.end()) return;  // already answered as expired
+                JsonDocument doc;
+                fillRequest(doc, it->second, true);
+                fillResponse(doc, success, response);
+                answer(it->second, 200, doc);
+                s_waiting.erase(it);
+                release();
+            });
+
+        if (!queued) {
+            auto it = s_waiting.find(id);
+            if (it == s_waiting.end()) return;
+            JsonDocument doc;
+            fillRequest(doc, it->second, false);
+            doc["completed"] = false;
+            answer(it->second, 503, doc);
+            s_waiting.erase(it);
+            release();
+        }
+    }
+}
+
+namespace ModbusLongPoll {
+    void init(ModbusRTUFeature& modbus) {
+        s_modbus = &modbus;
+    }
+
+    bool submit(AsyncWebServerRequest* request, uint8_t unitId, uint8_t functionCode,
+                uint16_t address, uint16_t count, uint32_t waitMs) {
+        if (!s_modbus) return false;
+
+        portENTER_CRITICAL(&s_mux);
+        const bool accepted = s_inProgress < MAX_WAITING;
+        if (accepted) s_inProgress++;
+        portEXIT_CRITICAL(&s_mux);
+        if (!accepted) return false;
+
+        Waiting w;
+        w.request = request->getThis();
+        w.unitId = unitId;
+        w.functionCode = functionCode;
+        w.address = address;
+        w.count = count;
+        w.createdMs = (uint32_t)millis();
+        w.deadlineMs = w.createdMs + waitMs;
+        request->pause();
+
+        portENTER_CRITICAL(&s_mux);
+        s_incoming.push_back(std::move(w));
+        portEXIT_CRITICAL(&s_mux);
+        LoopScheduler::wake();
+        return true;
+    }
+
+    void loop() {
+        if (!s_modbus) return;
+
+        portENTER_CRITICAL(&s_mux);
+        const bool hasIncoming = !s_incoming.empty();
+        portEXIT_CRITICAL(&s_mux);
+        if (hasIncoming) {
+            std::vector<Waiting> incoming;
+            portENTER_CRITICAL(&s_mux);
+            incoming.swap(s_incoming);
+            portEXIT_CRITICAL(&s_mux);
+            for (auto& w : incoming) start(std::move(w));
+        }
+
+        // Modbus timeouts do not invoke the callback, so the deadline is checked here.
+        const uint32_t nowMs = (uint32_t)millis();
+        for (auto it = s_waiting.begin(); it != s_waiting.end();) {
+            const Waiting& w = it->second;
+            const bool abandoned = w.request.expired();
+            if (!abandoned && (int32_t)(nowMs - w.deadlineMs) < 0) {
+                ++it;
+                continue;
+            }
+            if (!abandoned) {
+                JsonDocument doc;
+                fillRequest(doc, w, true);
+                doc["completed"] = false;
+                doc["success"] = false;
+                answer(w, 200, doc);
+                LOG_D("Modbus long-poll: no response from unit %u within wait time", w.unitId);
+            }
+            it = s_waiting.erase(it);
+            release();
+        }
+    }
+
+    size_t activeCount() {
+        portENTER_CRITICAL(&s_mux);
+        const size_t n = s_inProgress;
+        portEXIT_CRITICAL(&s_mux);
+        return n;
+    }
+}
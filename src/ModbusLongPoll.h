@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+class ModbusRTUFeature;
+
+/**
+ * Long-poll raw register reads (GET /api/modbus/raw/readTracked?...&wait=<ms>).
+ *
+ * The HTTP request is paused and answered from the Modbus response callback,
+ * so the client gets the result in one round trip instead of polling
+ * /api/modbus/raw/result. If no response arrives before the deadline the
+ * request is answered with completed=false.
+ *
+ * Requests are handed over from the AsyncTCP task; queueing, completion and
+ * deadline handling happen in the loop task.
+ *
+ * Usage:
+ *   setup():  ModbusLongPoll::init(modbus);
+ *   loop():   ModbusLongPoll::loop();
+ */
+namespace ModbusLongPoll {
+    static constexpr size_t MAX_WAITING = 8;
+    static constexpr uint32_t MAX_WAIT_MS = 10000;
+
+    // Bind the Modbus RTU feature used to execute reads.
+    void init(ModbusRTUFeature& modbus);
+
+    // Pause the request and hand the read over to the loop task.
+    // Returns false (request untouched) if too many requests are waiting.
+    bool submit(AsyncWebServerRequest* request, uint8_t unitId, uint8_t functionCode,
+                uint16_t address, uint16_t count, uint32_t waitMs);
+
+    // Queue submitted reads, answer expired ones.
+    void loop();
+
+    // Number of requests waiting for their response.
+    size_t activeCount();
+}
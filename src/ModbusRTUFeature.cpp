@@ -1,8 +1,13 @@
+#define LOG_CATEGORY LogCategory::ModbusRTU
+
 #include "ModbusRTUFeature.h"
+#include "ModbusCodec.h"
 #include <esp_heap_caps.h>
 #include <algorithm>
 #include <cstring>
 #include "TimeUtils.h"
+#include "Trace.h"
+#include "LoopScheduler.h"
 
 static inline bool timeBefore32(uint32_t a, uint32_t b) {
     return (int32_t)(a - b) < 0;
@@ -73,53 +78,148 @@ bool ModbusRTUFeature::isUnitQueueingPaused(uint8_t unitId) const {
     if (it == _backoffByUnit.end()) return false;
     const TimeoutBackoffState& st = it->second;
     if (st.consecutiveTimeouts <= 2) return false;
-    const uint32_t now = (uint32_t)millis();
+    const uint32_t now = (uint32_t)Hal::millis();
     return timeBefore32(now, st.pausedUntilMs);
 }
 
 void ModbusRTUFeature::suspend() {
-    if (_suspended) return;
-    _suspended = true;
-    
-    // Clear pending requests - they would timeout anyway during OTA
-    _requestQueue.clear();
-    _waitingForResponse = false;
-    _hasPendingRequest = false;
-    
-    // Drain and discard any buffered RX data
-    _rxBuffer.clear();
-    while (_serial.available()) {
-        _serial.read();
-    }
-    
-    LOG_I("ModbusRTU suspended");
+    if (_suspended.exchange(true)) return;
+    _controlRequests.fetch_or(CONTROL_SUSPEND);
+    LoopScheduler::wake();
 }
 
 void ModbusRTUFeature::resume() {
-    if (!_suspended) return;
-    _suspended = false;
-    
+    if (!_suspended.exchange(false)) return;
+    _controlRequests.fetch_or(CONTROL_RESUME);
+    LoopScheduler::wake();
+}
+
+void ModbusRTUFeature::clearQueue() {
+    _controlRequests.fetch_or(CONTROL_CLEAR);
+    LoopScheduler::wake();
+}
+
+// suspend(), resume() and clearQueue() may come from any task; the queues,
+// the UART and the timing state belong to the task running loop()
+void ModbusRTUFeature::applyControlRequests() {
+    const uint8_t requests = _controlRequests.exchange(0);
+    if (requests == 0) return;
+
+    if (requests & (CONTROL_SUSPEND | CONTROL_CLEAR)) {
+        // Clear pending requests - they would timeout anyway during OTA
+        ModbusPendingRequest dropped;
+        while (_incoming.pop(dropped)) {}
+        _requestQueue.clear();
+        _queuedCount = 0;
+    }
+
+    if (requests & CONTROL_SUSPEND) {
+        _waitingForResponse = false;
+        _hasPendingRequest = false;
+
+        // Drain and discard any buffered RX data
+        _rxBuffer.clear();
+        while (_serial.available()) {
+            _serial.read();
+        }
+
+        LOG_I("ModbusRTU suspended");
+    }
+
+    if ((requests & CONTROL_RESUME) && !_suspended) {
+        resynchronize();
+        LOG_I("ModbusRTU resumed");
+    }
+}
+
+void ModbusRTUFeature::resynchronize() {
     // Re-synchronize timing
-    _lastByteTime = micros();
-    _lastActivityTime = millis();
+    _lastByteTime = Hal::micros();
+    _lastActivityTime = Hal::millis();
     _busSilent = true;
     _serialWasEmpty = true;
-    _serialEmptySinceUs = micros();
+    _serialEmptySinceUs = Hal::micros();
     
     // Drain any garbage that accumulated
     _rxBuffer.clear();
     while (_serial.available()) {
         _serial.read();
     }
-    
-    LOG_I("ModbusRTU resumed");
+}
+
+void ModbusRTUFeature::drainIncoming() {
+    ModbusPendingRequest req;
+    while (_incoming.pop(req)) {
+        _requestQueue.push_back(std::move(req));
+    }
+    _queuedCount = _requestQueue.size();
+}
+
+bool ModbusRTUFeature::enqueue(ModbusPendingRequest&& req) {
+    const uint8_t unitId = req.unitId;
+    if (!_incoming.push(std::move(req))) {
+        _stats.queueOverflows++;
+        _stats.ownRequestsDiscarded++;
+        LOG_E("Modbus request DISCARDED: queue full (%u/%u) - unit %d",
+              getQueuedRequestCount(), _maxQueueSize, unitId);
+        return false;
+    }
+    TRACE_INSTANT("rtu.enqueue", unitId);
+    LoopScheduler::wake();
+    return true;
+}
+
+void ModbusRTUFeature::deliverRequestCallback(const std::function<void(bool, const ModbusFrame&)>& callback,
+                                              bool success, const ModbusFrame& frame) {
+    if (!_deliveries || LoopScheduler::inLoopTask()) {
+        try {
+            callback(success, frame);
+        } catch (...) {
+            LOG_E("Exception in Modbus response callback");
+        }
+        return;
+    }
+    if (!_deliveries->push(CallbackDelivery{callback, frame, success, false})) {
+        _droppedCallbacks++;
+        return;
+    }
+    LoopScheduler::wake();
+}
+
+void ModbusRTUFeature::deliverFrameCallback(const ModbusFrame& frame, bool isRequest) {
+    if (!_frameCallback) return;
+    if (!_deliveries || LoopScheduler::inLoopTask()) {
+        _frameCallback(frame, isRequest);
+        return;
+    }
+    if (!_deliveries->push(CallbackDelivery{nullptr, frame, false, isRequest})) {
+        _droppedCallbacks++;
+        return;
+    }
+    LoopScheduler::wake();
+}
+
+void ModbusRTUFeature::deliverCallbacks() {
+    if (!_deliveries) return;
+    CallbackDelivery delivery;
+    while (_deliveries->pop(delivery)) {
+        if (delivery.requestCallback) {
+            try {
+                delivery.requestCallback(delivery.success, delivery.frame);
+            } catch (...) {
+                LOG_E("Exception in Modbus response callback");
+            }
+        } else if (_frameCallback) {
+            _frameCallback(delivery.frame, delivery.isRequest);
+        }
+    }
 }
 
 uint32_t ModbusRTUFeature::getUnitQueueingPauseRemainingMs(uint8_t unitId) const {
     if (!isUnitQueueingPaused(unitId)) return 0;
     auto it = _backoffByUnit.find(unitId);
     if (it == _backoffByUnit.end()) return 0;
-    const uint32_t now = (uint32_t)millis();
+    const uint32_t now = (uint32_t)Hal::millis();
     return (uint32_t)(it->second.pausedUntilMs - now);
 }
 
@@ -138,7 +238,7 @@ uint32_t ModbusRTUFeature::getUnitConsecutiveTimeouts(uint8_t unitId) const {
 std::vector<ModbusRTUFeature::UnitBackoffInfo> ModbusRTUFeature::getUnitBackoffInfo() const {
     std::vector<UnitBackoffInfo> out;
     out.reserve(_backoffByUnit.size());
-    const uint32_t now = (uint32_t)millis();
+    const uint32_t now = (uint32_t)Hal::millis();
 
     for (const auto& kv : _backoffByUnit) {
         const uint8_t unitId = kv.first;
@@ -150,7 +250,7 @@ std::vector<ModbusRTUFeature::UnitBackoffInfo> ModbusRTUFeature::getUnitBackoffI
     return out;
 }
 
-ModbusRTUFeature::ModbusRTUFeature(HardwareSerial& serial,
+ModbusRTUFeature::ModbusRTUFeature(Hal::Uart& serial,
                                    uint32_t baudRate,
                                    uint32_t config,
                                    int8_t rxPin,
@@ -172,6 +272,7 @@ ModbusRTUFeature::ModbusRTUFeature(HardwareSerial& serial,
     , _ready(false)
     , _waitingForResponse(false)
     , _requestSentTime(0)
+    , _incoming(maxQueueSize)
     , _hasPendingRequest(false)
     , _lastSuccessTime(0)
     , _lastTimeoutWarningMs(0)
@@ -202,7 +303,7 @@ ModbusRTUFeature::ModbusRTUFeature(HardwareSerial& serial,
     }
     
     // Initialize interval stats start time
-    _intervalStats.intervalStartMs = millis();
+    _intervalStats.intervalStartMs = Hal::millis();
     
     _rxBuffer.reserve(256);
 
@@ -310,7 +411,7 @@ uint16_t ModbusRTUFeature::calculateFrameCrc(const ModbusFrame& frame) const {
             len += copyLen;
         }
     }
-    return calculateCRC(bytes, len);
+    return ModbusCodec::crc16(bytes, len);
 }
 
 void ModbusRTUFeature::setup() {
@@ -326,15 +427,24 @@ void ModbusRTUFeature::setup() {
     if (_rxPin >= 0 && _txPin >= 0) {
         _serial.begin(_baudRate, _config, _rxPin, _txPin);
     } else {
-        _serial.begin(_baudRate, _config);
+        _serial.begin(_baudRate, _config, -1, -1);
     }
     
-    _lastActivityTime = millis();
-    _lastByteTime = micros();
+    // Received bytes wake the main loop, so they are timestamped and parsed
+    // without waiting for the next scheduled pass
+    _serial.onReceive([]() { LoopScheduler::wake(); });
+
+    // With a task of its own, callbacks are handed over to the loop task
+    if (taskConfig().stackBytes > 0) {
+        _deliveries.reset(new MpscQueue<CallbackDelivery>(MODBUS_RTU_CALLBACK_QUEUE_DEPTH));
+    }
+
+    _lastActivityTime = Hal::millis();
+    _lastByteTime = Hal::micros();
     _serialWasEmpty = (_serial.available() == 0);
-    _serialEmptySinceUs = micros();
-    _lastWarningCheckMs = millis();
-    _stats.lastStatsReset = millis();
+    _serialEmptySinceUs = Hal::micros();
+    _lastWarningCheckMs = Hal::millis();
+    _stats.lastStatsReset = Hal::millis();
     
     LOG_I("ModbusRTU initialized: %lu baud, silence=%lu us", _baudRate, _silenceTimeUs);
     if (_dePin >= 0) {
@@ -344,16 +454,49 @@ void ModbusRTUFeature::setup() {
     _ready = true;
 }
 
+uint32_t ModbusRTUFeature::dueInMs() {
+    if (!_ready) return NOT_DUE;
+    if (_controlRequests.load() != 0) return 0;
+    if (_suspended) return NOT_DUE;
+    if (_serial.available() || !_incoming.empty()) return 0;
+
+    const uint32_t nowUs = (uint32_t)Hal::micros();
+    const uint32_t nowMs = (uint32_t)Hal::millis();
+    uint32_t due = LoopScheduler::remainingMs(nowMs - _lastWarningCheckMs, MODBUS_STATS_INTERVAL_MS);
+
+    // Frame end and bus silence are detected after 3.5 quiet characters
+    if (!_rxBuffer.empty() || !_busSilent) {
+        const uint32_t leftUs = LoopScheduler::remainingMs(nowUs - (uint32_t)_lastByteTime, _silenceTimeUs + 1);
+        due = std::min(due, (leftUs + 999) / 1000);
+    }
+
+    if (_waitingForResponse) {
+        due = std::min(due, LoopScheduler::remainingMs(nowMs - _requestSentTime, _responseTimeoutMs + 1));
+    } else {
+        // Next request to send: once the line is quiet, or when its unit's backoff ends
+        for (const auto& req : _requestQueue) {
+            if (!isUnitQueueingPaused(req.unitId)) {
+                const uint32_t idleUs = _serialWasEmpty ? nowUs - (uint32_t)_serialEmptySinceUs : 0;
+                return std::min(due, (LoopScheduler::remainingMs(idleUs, _silenceTimeUs + 1) + 999) / 1000);
+            }
+            due = std::min(due, (uint32_t)(_backoffByUnit.at(req.unitId).pausedUntilMs - nowMs));
+        }
+    }
+    return due;
+}
+
 void ModbusRTUFeature::loop() {
     if (!_ready) return;
+    applyControlRequests();
     
     // When suspended, skip all processing (OTA in progress)
     if (_suspended) return;
+    drainIncoming();
 
     _loopCounter++;
     
-    unsigned long nowUs = micros();
-    unsigned long nowMs = millis();
+    unsigned long nowUs = Hal::micros();
+    unsigned long nowMs = Hal::millis();
     
     // Track total time for statistics
     _stats.totalTimeUs += (nowUs - _activeStartTimeUs);
@@ -370,7 +513,7 @@ void ModbusRTUFeature::loop() {
     const size_t maxRxBytesThisLoop = wantsToTransmitSoon ? 1024 : 256;
     size_t rxBytesThisLoop = 0;
     while (_serial.available() && rxBytesThisLoop < maxRxBytesThisLoop) {
-        unsigned long byteTimeUs = micros();
+        unsigned long byteTimeUs = Hal::micros();
         uint8_t byte = _serial.read();
         rxBytesThisLoop++;
 
@@ -382,12 +525,12 @@ void ModbusRTUFeature::loop() {
 
         if (_rxBuffer.empty()) {
             _rxBufferStartUs = (uint32_t)byteTimeUs;
-            _rxBufferStartMs = (uint32_t)millis();
+            _rxBufferStartMs = (uint32_t)Hal::millis();
         }
 
         _rxBuffer.push_back(byte);
         _lastByteTime = byteTimeUs;
-        _lastActivityTime = millis();
+        _lastActivityTime = Hal::millis();
         _busSilent = false;
 
         // We observed RX data; the serial buffer is not empty.
@@ -402,7 +545,7 @@ void ModbusRTUFeature::loop() {
     _dbgRxBytesDrainedInLoop = (uint16_t)rxBytesThisLoop;
 
     // Re-evaluate current time before checking for frame-complete silence
-    nowUs = micros();
+    nowUs = Hal::micros();
 
     // Track when the UART RX buffer is observed empty. This is more reliable for deciding
     // when it's safe to transmit than using _lastByteTime alone, because bytes can sit
@@ -423,8 +566,8 @@ void ModbusRTUFeature::loop() {
     
     // Update bus silence state and end active time tracking
     // IMPORTANT: Use microsecond timing for the RTU silence window.
-    // Using millis() rounding can prevent ever reaching the 3.5 char silence threshold
-    // (e.g. 9600 baud => ~3.64ms required, but millis() jumps in 1ms steps).
+    // Using Hal::millis() rounding can prevent ever reaching the 3.5 char silence threshold
+    // (e.g. 9600 baud => ~3.64ms required, but Hal::millis() jumps in 1ms steps).
     if (!_busSilent && (nowUs - _lastByteTime) > _silenceTimeUs) {
         _busSilent = true;
         if (_inActiveTime && !_waitingForResponse) {
@@ -434,6 +577,7 @@ void ModbusRTUFeature::loop() {
     
     // Check for response timeout
     if (_waitingForResponse && (nowMs - _requestSentTime) > _responseTimeoutMs) {
+        TRACE_INSTANT("rtu.timeout", _lastRequest.unitId);
         _stats.timeouts++;
         _stats.ownRequestsFailed++;
         _intervalStats.ownFailed++;
@@ -480,6 +624,7 @@ void ModbusRTUFeature::loop() {
                                [unitId](const ModbusPendingRequest& r) { return r.unitId == unitId; }),
                 _requestQueue.end());
             const size_t after = _requestQueue.size();
+            _queuedCount = after;
             if (after != before) {
                 LOG_W("Modbus queue building up (%u items). Dropped %u requests for unit %u",
                       before, (unsigned)(before - after), unitId);
@@ -504,26 +649,26 @@ void ModbusRTUFeature::loop() {
 
         _dbgGapUsInLoop = idleUs;
         _dbgGapEnoughForTxInLoop = gapEnoughForTx;
-        _dbgLastLoopSnapshotMs = millis();
+        _dbgLastLoopSnapshotMs = Hal::millis();
 
         if (gapEnoughForTx) {
             processQueue();
         } else if (!_requestQueue.empty()) {
             // Try to find a quiet window, bounded to keep the firmware responsive.
             static constexpr uint32_t TX_ARBITRATION_WINDOW_US = 8000;
-            uint32_t startUs = micros();
-            uint32_t lastRxUs = micros();
+            uint32_t startUs = Hal::micros();
+            uint32_t lastRxUs = Hal::micros();
 
             // Prime lastRxUs with the most recent byte timestamp we have.
             if (!_serialWasEmpty) {
                 lastRxUs = (uint32_t)_lastByteTime;
             }
 
-            while ((uint32_t)(micros() - startUs) < TX_ARBITRATION_WINDOW_US) {
+            while ((uint32_t)(Hal::micros() - startUs) < TX_ARBITRATION_WINDOW_US) {
                 if (_serial.available()) {
                     // Drain a bit more and keep our timestamps fresh.
                     uint8_t byte = _serial.read();
-                    unsigned long byteTimeUs = micros();
+                    unsigned long byteTimeUs = Hal::micros();
                     lastRxUs = (uint32_t)byteTimeUs;
                     _serialWasEmpty = false;
 
@@ -533,13 +678,13 @@ void ModbusRTUFeature::loop() {
                     }
                     _rxBuffer.push_back(byte);
                     _lastByteTime = byteTimeUs;
-                    _lastActivityTime = millis();
+                    _lastActivityTime = Hal::millis();
                     _busSilent = false;
                     continue;
                 }
 
                 // No buffered bytes right now. If we've been quiet long enough, transmit.
-                uint32_t nowArbUs = micros();
+                uint32_t nowArbUs = Hal::micros();
                 if ((uint32_t)(nowArbUs - lastRxUs) >= requiredIdleUs) {
                     _serialWasEmpty = true;
                     _serialEmptySinceUs = nowArbUs;
@@ -561,6 +706,7 @@ void ModbusRTUFeature::loop() {
 }
 
 void ModbusRTUFeature::processReceivedData() {
+    TRACE_SCOPE("rtu.rx", _rxBuffer.size());
     if (_rxBuffer.size() < 4) {
         // Incomplete frames are common on noisy buses; don't spam logs
         _rxBuffer.clear();
@@ -709,19 +855,19 @@ void ModbusRTUFeature::processReceivedData() {
           frame.isRequest = isRequest;
 
           if (!frame.isValid) {
+            TRACE_INSTANT("rtu.crc_error", frame.unitId);
             _stats.crcErrors++;
             LOG_W("RX Frame (CRC ERROR): Unit=%d, FC=0x%02X, Raw=%s",
                 frame.unitId, frame.functionCode,
                 formatFrameHex(frame).c_str());
             recordFrameToHistory(frame);
-            if (_frameCallback) {
-                _frameCallback(frame, isRequest);
-            }
+            deliverFrameCallback(frame, isRequest);
             i += frameLen;
             continue;
           }
 
           // CRC-valid frame
+          TRACE_INSTANT("rtu.frame", frame.unitId);
           _stats.framesReceived++;
 
           // Frame details available via /api/modbus/monitor; don't spam logs
@@ -754,7 +900,7 @@ void ModbusRTUFeature::processReceivedData() {
 
             // Reset backoff for this unit only
             _backoffByUnit.erase(frame.unitId);
-            _lastSuccessTime = millis();
+            _lastSuccessTime = Hal::millis();
 
             if (!frame.isException) {
                 _stats.ownRequestsSuccess++;
@@ -775,11 +921,7 @@ void ModbusRTUFeature::processReceivedData() {
             _hasPendingRequest = false;
 
             if (callbackCopy) {
-                try {
-                    callbackCopy(!frame.isException, frame);
-                } catch (...) {
-                    LOG_E("Exception in Modbus response callback");
-                }
+                deliverRequestCallback(callbackCopy, !frame.isException, frame);
             }
 
             endActiveTime();
@@ -805,7 +947,7 @@ void ModbusRTUFeature::processReceivedData() {
                 if (reqFc == FC3 || reqFc == FC4) {
                     ModbusRegisterMap& map = ensureRegisterMap(frame.unitId, reqFc);
                     map.requestCount++;
-                    map.lastUpdate = millis();
+                    map.lastUpdate = Hal::millis();
                 }
 
                 _lastRequestPerUnit[frame.unitId] = frame;
@@ -847,7 +989,7 @@ void ModbusRTUFeature::processReceivedData() {
                         ModbusRegisterMap& map = ensureRegisterMap(frame.unitId, exFc);
                         map.responseCount++;
                         map.errorCount++;
-                        map.lastUpdate = millis();
+                        map.lastUpdate = Hal::millis();
                     }
                 } else {
                     _stats.otherResponsesSeen++;
@@ -872,7 +1014,7 @@ void ModbusRTUFeature::processReceivedData() {
                     if (!updated && (respFc == FC3 || respFc == FC4)) {
                         ModbusRegisterMap& map = ensureRegisterMap(frame.unitId, respFc);
                         map.responseCount++;
-                        map.lastUpdate = millis();
+                        map.lastUpdate = Hal::millis();
                     }
 
                     // Pairing quality counters for FC3/FC4 responses
@@ -890,9 +1032,7 @@ void ModbusRTUFeature::processReceivedData() {
             }
         }
 
-        if (_frameCallback) {
-            _frameCallback(frame, isRequest);
-        }
+        deliverFrameCallback(frame, isRequest);
 
         i += frameLen;
     }
@@ -927,46 +1067,10 @@ ModbusRegisterMap& ModbusRTUFeature::ensureRegisterMap(uint8_t unitId, uint8_t f
 }
 
 bool ModbusRTUFeature::parseFrame(const uint8_t* data, size_t length, ModbusFrame& frame) {
-    if (length < 4) return false;
-    
-    frame.unitId = data[0];
-    frame.functionCode = data[1];
-    frame.timestamp = millis();
+    if (!ModbusCodec::parseFrame(data, length, frame)) return false;
+    frame.timestamp = Hal::millis();
     frame.unixTimestamp = TimeUtils::nowUnixSecondsOrZero();
     frame.isRequest = false;
-    
-    // Verify CRC (Modbus: LSB first)
-    uint16_t receivedCrc = (uint16_t)data[length - 2] | ((uint16_t)data[length - 1] << 8);
-    uint16_t calculatedCrc = calculateCRC(data, length - 2);
-
-    const size_t payloadLenRaw = length - 4; // exclude unit, fc, crc(2)
-    const size_t payloadLen = (payloadLenRaw <= ModbusFrame::MAX_DATA_LEN) ? payloadLenRaw : ModbusFrame::MAX_DATA_LEN;
-    
-    if (receivedCrc != calculatedCrc) {
-        frame.isValid = false;
-        frame.crc = receivedCrc;
-        frame.dataLen = (uint16_t)payloadLen;
-        if (payloadLen > 0) memcpy(frame.data.data(), data + 2, payloadLen);
-        frame.isException = false;
-        frame.exceptionCode = 0;
-        return true;  // Return true so caller can count CRC error and log
-    }
-    
-    frame.crc = receivedCrc;
-    frame.isValid = true;
-    
-    // Check for exception
-    if (frame.functionCode & 0x80) {
-        frame.isException = true;
-        frame.exceptionCode = (length > 2) ? data[2] : 0;
-        frame.dataLen = 0;
-    } else {
-        frame.isException = false;
-        frame.exceptionCode = 0;
-        frame.dataLen = (uint16_t)payloadLen;
-        if (payloadLen > 0) memcpy(frame.data.data(), data + 2, payloadLen);
-    }
-    
     return true;
 }
 
@@ -983,7 +1087,7 @@ void ModbusRTUFeature::updateRegisterMap(const ModbusFrame& request, const Modbu
     
     ModbusRegisterMap& regMap = ensureRegisterMap(response.unitId, fc);
     regMap.responseCount++;
-    regMap.lastUpdate = millis();
+    regMap.lastUpdate = Hal::millis();
     
     // Extract register values from response
     uint16_t startReg = request.getStartRegister();
@@ -1022,7 +1126,7 @@ void ModbusRTUFeature::processQueue() {
     if (sendIndex == (size_t)-1) return;
 
     _processQueueCounter++;
-    _lastProcessQueueMs = millis();
+    _lastProcessQueueMs = Hal::millis();
     
     // Copy the selected request (not reference/pointer - prevents vector reallocation issues)
     ModbusPendingRequest req = _requestQueue[sendIndex];
@@ -1032,13 +1136,14 @@ void ModbusRTUFeature::processQueue() {
     if (sendRequest(req)) {
         LOG_V("Request sent successfully");
         _stats.ownRequestsSent++;
+        if (_firstRequestMs == 0) _firstRequestMs = std::max<uint32_t>(1, Hal::millis());
 
         // Track our own FC3/FC4 requests in the register map
         uint8_t fc = req.functionCode & 0x7F;
         if (fc == ModbusFC::READ_HOLDING_REGISTERS || fc == ModbusFC::READ_INPUT_REGISTERS) {
             ModbusRegisterMap& map = ensureRegisterMap(req.unitId, fc);
             map.requestCount++;
-            map.lastUpdate = millis();
+            map.lastUpdate = Hal::millis();
         }
         
         // Store a COPY of the request, not a pointer into the vector
@@ -1046,7 +1151,7 @@ void ModbusRTUFeature::processQueue() {
         _currentRequest = req;
         _hasPendingRequest = true;
         _waitingForResponse = true;
-        _requestSentTime = millis();
+        _requestSentTime = Hal::millis();
         
         // Start tracking our active communication time
         startActiveTime(true);
@@ -1061,7 +1166,7 @@ void ModbusRTUFeature::processQueue() {
         _lastRequest.data[3] = (uint8_t)(req.quantity & 0xFF);
 
         // Also store under per-unit so FC3/FC4 response parsing can validate against our own requests.
-        _lastRequest.timestamp = millis();
+        _lastRequest.timestamp = Hal::millis();
         _lastRequest.unixTimestamp = TimeUtils::nowUnixSecondsOrZero();
         _lastRequest.isRequest = true;
         _lastRequest.isValid = true;
@@ -1070,6 +1175,8 @@ void ModbusRTUFeature::processQueue() {
         _lastRequestPerUnit[req.unitId] = _lastRequest;
 
         _requestQueue.erase(_requestQueue.begin() + (ptrdiff_t)sendIndex);
+        _queuedCount = _requestQueue.size();
+        TRACE_INSTANT("rtu.dequeue", req.unitId);
     } else {
         LOG_W("Failed to send request - bus not silent");
     }
@@ -1125,8 +1232,9 @@ bool ModbusRTUFeature::sendRequest(const ModbusPendingRequest& request) {
 }
 
 void ModbusRTUFeature::sendFrameFromBuffer() {
+    TRACE_SCOPE("rtu.tx", _txFrameBuffer[0]);
     // Calculate and append CRC
-    uint16_t crc = calculateCRC(_txFrameBuffer, _txFrameLen);
+    uint16_t crc = ModbusCodec::crc16(_txFrameBuffer, _txFrameLen);
     
     setDE(true);  // Enable transmitter
     delayMicroseconds(100);  // Small delay for transceiver
@@ -1143,7 +1251,7 @@ void ModbusRTUFeature::sendFrameFromBuffer() {
     setDE(false);  // Back to receive mode
 
     // Mark end-of-TX as last bus activity for accurate silence detection.
-    _lastByteTime = micros();
+    _lastByteTime = Hal::micros();
 
     // Refresh empty-buffer tracking after TX and echo discard.
     if (_serial.available() == 0) {
@@ -1154,7 +1262,7 @@ void ModbusRTUFeature::sendFrameFromBuffer() {
     }
     
     _stats.framesSent++;
-    _lastActivityTime = millis();
+    _lastActivityTime = Hal::millis();
     _busSilent = false;
     
     LOG_V("Modbus TX: unit=%u, FC=0x%02X, len=%u", _txFrameBuffer[0], _txFrameBuffer[1], _txFrameLen);
@@ -1221,11 +1329,11 @@ bool ModbusRTUFeature::queueReadRegisters(uint8_t unitId, uint8_t functionCode,
     // and allows callers (web API, poll scheduler) to enqueue a probe request.
     
     // Check queue size
-    if (_requestQueue.size() >= _maxQueueSize) {
+    if (getQueuedRequestCount() >= _maxQueueSize) {
         _stats.queueOverflows++;
         _stats.ownRequestsDiscarded++;
         LOG_E("Modbus request DISCARDED: queue full (%u/%u) - unit %d FC 0x%02X reg %d qty %d",
-              _requestQueue.size(), _maxQueueSize, unitId, functionCode, startRegister, quantity);
+              getQueuedRequestCount(), _maxQueueSize, unitId, functionCode, startRegister, quantity);
         return false;
     }
     
@@ -1251,11 +1359,10 @@ bool ModbusRTUFeature::queueReadRegisters(uint8_t unitId, uint8_t functionCode,
     req.startRegister = startRegister;
     req.quantity = quantity;
     req.callback = callback;
-    req.queuedAt = millis();
+    req.queuedAt = Hal::millis();
     req.retries = 0;
     
-    _requestQueue.push_back(req);
-    return true;
+    return enqueue(std::move(req));
 }
 
 bool ModbusRTUFeature::queueWriteSingleRegister(uint8_t unitId, uint16_t address, uint16_t value,
@@ -1277,11 +1384,11 @@ bool ModbusRTUFeature::queueWriteSingleRegister(uint8_t unitId, uint16_t address
     // NOTE: Do not reject queueing during timeout backoff; backoff is enforced on sending.
     
     // Check queue size
-    if (_requestQueue.size() >= _maxQueueSize) {
+    if (getQueuedRequestCount() >= _maxQueueSize) {
         _stats.queueOverflows++;
         _stats.ownRequestsDiscarded++;
         LOG_E("Modbus write request DISCARDED: queue full (%u/%u) - unit %d reg %d value %d",
-              _requestQueue.size(), _maxQueueSize, unitId, address, value);
+              getQueuedRequestCount(), _maxQueueSize, unitId, address, value);
         return false;
     }
     
@@ -1308,11 +1415,10 @@ bool ModbusRTUFeature::queueWriteSingleRegister(uint8_t unitId, uint16_t address
     req.quantity = 1;
     req.writeData.push_back(value);
     req.callback = callback;
-    req.queuedAt = millis();
+    req.queuedAt = Hal::millis();
     req.retries = 0;
     
-    _requestQueue.push_back(req);
-    return true;
+    return enqueue(std::move(req));
 }
 
 bool ModbusRTUFeature::queueWriteMultipleRegisters(uint8_t unitId, uint16_t startAddress,
@@ -1335,11 +1441,11 @@ bool ModbusRTUFeature::queueWriteMultipleRegisters(uint8_t unitId, uint16_t star
     // NOTE: Do not reject queueing during timeout backoff; backoff is enforced on sending.
     
     // Check queue size
-    if (_requestQueue.size() >= _maxQueueSize) {
+    if (getQueuedRequestCount() >= _maxQueueSize) {
         _stats.queueOverflows++;
         _stats.ownRequestsDiscarded++;
         LOG_E("Modbus write-multi request DISCARDED: queue full (%u/%u) - unit %d reg %d count %u",
-              _requestQueue.size(), _maxQueueSize, unitId, startAddress, values.size());
+              getQueuedRequestCount(), _maxQueueSize, unitId, startAddress, values.size());
         return false;
     }
     
@@ -1366,11 +1472,10 @@ bool ModbusRTUFeature::queueWriteMultipleRegisters(uint8_t unitId, uint16_t star
     req.quantity = values.size();
     req.writeData = values;
     req.callback = callback;
-    req.queuedAt = millis();
+    req.queuedAt = Hal::millis();
     req.retries = 0;
     
-    _requestQueue.push_back(req);
-    return true;
+    return enqueue(std::move(req));
 }
 
 void ModbusRTUFeature::setDE(bool transmit) {
@@ -1379,34 +1484,17 @@ void ModbusRTUFeature::setDE(bool transmit) {
     }
 }
 
-uint16_t ModbusRTUFeature::calculateCRC(const uint8_t* data, size_t length) const {
-    uint16_t crc = 0xFFFF;
-    
-    for (size_t i = 0; i < length; i++) {
-        crc ^= data[i];
-        for (int j = 0; j < 8; j++) {
-            if (crc & 0x0001) {
-                crc = (crc >> 1) ^ 0xA001;
-            } else {
-                crc >>= 1;
-            }
-        }
-    }
-    
-    return crc;
-}
-
 void ModbusRTUFeature::startActiveTime(bool isOwn) {
     if (!_inActiveTime) {
         _inActiveTime = true;
         _activeTimeIsOwn = isOwn;
-        _activeStartTimeUs = micros();
+        _activeStartTimeUs = Hal::micros();
     }
 }
 
 void ModbusRTUFeature::endActiveTime() {
     if (_inActiveTime) {
-        unsigned long duration = micros() - _activeStartTimeUs;
+        unsigned long duration = Hal::micros() - _activeStartTimeUs;
         if (_activeTimeIsOwn) {
             _stats.ownActiveTimeUs += duration;
             _intervalStats.ownActiveTimeUs += duration;
@@ -1434,12 +1522,17 @@ float ModbusRTUFeature::getBusIdlePercent() const {
 
 void ModbusRTUFeature::resetStats() {
     memset(&_stats, 0, sizeof(_stats));
-    _stats.lastStatsReset = millis();
+    _stats.lastStatsReset = Hal::millis();
+}
+
+void ModbusRTUFeature::restoreStats(const Stats& stats) {
+    _stats = stats;
+    _stats.lastStatsReset = Hal::millis();
 }
 
 void ModbusRTUFeature::resetIntervalStats() {
     memset(&_intervalStats, 0, sizeof(_intervalStats));
-    _intervalStats.intervalStartMs = millis();
+    _intervalStats.intervalStartMs = Hal::millis();
 }
 
 float ModbusRTUFeature::getOtherFailureRate() const {
@@ -1450,7 +1543,7 @@ float ModbusRTUFeature::getOtherFailureRate() const {
 
 void ModbusRTUFeature::checkAndLogWarnings() {
     // Calculate interval time in microseconds
-    unsigned long intervalMs = millis() - _intervalStats.intervalStartMs;
+    unsigned long intervalMs = Hal::millis() - _intervalStats.intervalStartMs;
     uint64_t intervalUs = (uint64_t)intervalMs * 1000ULL;
     
     // Track interval stats
@@ -1495,7 +1588,7 @@ void ModbusRTUFeature::checkAndLogWarnings() {
     }
     
     // Log summary at INFO level (using cumulative stats)
-    unsigned long uptimeSec = (millis() - _stats.lastStatsReset) / 1000;
+    unsigned long uptimeSec = (Hal::millis() - _stats.lastStatsReset) / 1000;
     uint32_t totalOwn = _stats.ownRequestsSuccess + _stats.ownRequestsFailed;
     if (uptimeSec > 0 && totalOwn > 0) {
           const uint32_t free8 = heap_caps_get_free_size(MALLOC_CAP_8BIT);
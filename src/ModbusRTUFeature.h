@@ -2,68 +2,39 @@
 #define MODBUS_RTU_FEATURE_H
 
 #include <Arduino.h>
-#include <HardwareSerial.h>
 #include <array>
+#include <atomic>
 #include <vector>
 #include <map>
+#include <memory>
 #include <functional>
 #include "Feature.h"
 #include "LoggingFeature.h"
+#include "MpscQueue.h"
+#include "HalUart.h"
+#include "ModbusTypes.h"
 
-/**
- * @brief Modbus function codes
- */
-namespace ModbusFC {
-    constexpr uint8_t READ_COILS = 0x01;
-    constexpr uint8_t READ_DISCRETE_INPUTS = 0x02;
-    constexpr uint8_t READ_HOLDING_REGISTERS = 0x03;
-    constexpr uint8_t READ_INPUT_REGISTERS = 0x04;
-    constexpr uint8_t WRITE_SINGLE_COIL = 0x05;
-    constexpr uint8_t WRITE_SINGLE_REGISTER = 0x06;
-    constexpr uint8_t WRITE_MULTIPLE_COILS = 0x0F;
-    constexpr uint8_t WRITE_MULTIPLE_REGISTERS = 0x10;
-}
+// Stack of a ModbusRTU task of its own; 0 (default) keeps it in the loop task.
+// In its own task, bus timing no longer waits for uploads or web work, and
+// request/frame callbacks are handed to the loop task (deliverCallbacks()).
+#ifndef MODBUS_RTU_TASK_STACK
+#define MODBUS_RTU_TASK_STACK 0
+#endif
 
-/**
- * @brief A single Modbus RTU frame (request or response)
- */
-struct ModbusFrame {
-    static constexpr size_t MAX_DATA_LEN = 252;  // up to FC3/FC4 response payload (byteCount+data)
+// Core 1 keeps the bus away from WiFi/lwIP interrupts on core 0
+#ifndef MODBUS_RTU_TASK_CORE
+#define MODBUS_RTU_TASK_CORE 1
+#endif
 
-    uint8_t unitId;
-    uint8_t functionCode;
-    std::array<uint8_t, MAX_DATA_LEN> data{};  // Payload without unit ID, FC, and CRC
-    uint16_t dataLen{0};
-    uint16_t crc;
-    unsigned long timestamp;         // millis() at capture time (monotonic)
-    uint32_t unixTimestamp;          // epoch seconds at capture time (0 if time invalid)
-    bool isRequest;                  // request vs response (best-effort)
-    bool isValid;                   // CRC check passed
-    bool isException;               // Exception response (FC | 0x80)
-    uint8_t exceptionCode;
-    
-    // For read requests: extract start register and quantity
-    uint16_t getStartRegister() const {
-        if (dataLen >= 2) return (data[0] << 8) | data[1];
-        return 0;
-    }
-    
-    uint16_t getQuantity() const {
-        if (dataLen >= 4) return (data[2] << 8) | data[3];
-        return 0;
-    }
-    
-    // For read responses: get register data
-    size_t getByteCount() const {
-        if (dataLen >= 1) return data[0];
-        return 0;
-    }
-    
-    const uint8_t* getRegisterData() const {
-        if (dataLen > 1) return &data[1];
-        return nullptr;
-    }
-};
+// Above the loop task (1), so frame gaps are seen when they happen
+#ifndef MODBUS_RTU_TASK_PRIORITY
+#define MODBUS_RTU_TASK_PRIORITY 3
+#endif
+
+// Callbacks waiting for the loop task before they are dropped
+#ifndef MODBUS_RTU_CALLBACK_QUEUE_DEPTH
+#define MODBUS_RTU_CALLBACK_QUEUE_DEPTH 16
+#endif
 
 /**
  * @brief Raw register data storage for a unit/function code combination
@@ -101,7 +72,7 @@ public:
     
     /**
      * @brief Construct Modbus RTU feature
-     * @param serial HardwareSerial instance (Serial1, Serial2)
+     * @param serial Serial port (Hal::HardwareUart on Serial1/Serial2)
      * @param baudRate Baud rate (9600, 19200, etc.)
      * @param config Serial config (SERIAL_8N1, SERIAL_8E1, etc.)
      * @param rxPin RX pin (-1 for default)
@@ -110,7 +81,7 @@ public:
      * @param maxQueueSize Maximum pending requests
      * @param responseTimeoutMs Response timeout in ms
      */
-    ModbusRTUFeature(HardwareSerial& serial,
+    ModbusRTUFeature(Hal::Uart& serial,
                      uint32_t baudRate = 9600,
                      uint32_t config = SERIAL_8N1,
                      int8_t rxPin = -1,
@@ -121,6 +92,10 @@ public:
     
     void setup() override;
     void loop() override;
+    uint32_t dueInMs() override;
+    TaskConfig taskConfig() const override {
+        return TaskConfig{MODBUS_RTU_TASK_STACK, MODBUS_RTU_TASK_PRIORITY, MODBUS_RTU_TASK_CORE};
+    }
     const char* getName() const override { return "ModbusRTU"; }
     bool isReady() const override { return _ready; }
     
@@ -137,18 +112,19 @@ public:
      * @brief Get time since last bus activity in ms
      */
     unsigned long getTimeSinceLastActivity() const {
-        return millis() - _lastActivityTime;
+        return Hal::millis() - _lastActivityTime;
     }
 
     // ========================================
     // Debug (for /api/modbus/status)
     // ========================================
-    uint32_t getTimeSinceLastByteUs() const { return (uint32_t)(micros() - _lastByteTime); }
+    uint32_t getTimeSinceLastByteUs() const { return (uint32_t)(Hal::micros() - _lastByteTime); }
     uint32_t getCharTimeUs() const { return _charTimeUs; }
     uint32_t getSilenceTimeUs() const { return _silenceTimeUs; }
     uint32_t getLoopCounter() const { return _loopCounter; }
     uint32_t getProcessQueueCounter() const { return _processQueueCounter; }
     unsigned long getLastProcessQueueMs() const { return _lastProcessQueueMs; }
+    uint32_t getFirstRequestMs() const { return _firstRequestMs; }  // own request since boot, 0 if none
     uint16_t getDbgQueueSizeInLoop() const { return _dbgQueueSizeInLoop; }
     bool getDbgWaitingForResponseInLoop() const { return _dbgWaitingForResponseInLoop; }
     uint16_t getDbgSerialAvailableInLoop() const { return _dbgSerialAvailableInLoop; }
@@ -168,6 +144,7 @@ public:
     
     /**
      * @brief Register callback for all frames seen on bus
+     * Callbacks always run in the loop task, also if ModbusRTU has a task of its own.
      */
     void onFrame(FrameCallback callback) { _frameCallback = callback; }
     
@@ -212,6 +189,17 @@ public:
                                       const std::vector<uint16_t>& values,
                                       std::function<void(bool, const ModbusFrame&)> callback = nullptr);
     
+    /**
+     * @brief Run request and frame callbacks queued by the ModbusRTU task
+     * Call from the loop task on every pass; does nothing without a task of its own.
+     */
+    void deliverCallbacks();
+
+    /**
+     * @brief Callbacks dropped because the loop task fell behind
+     */
+    uint32_t getDroppedCallbacks() const { return _droppedCallbacks.load(); }
+
     /**
      * @brief Send a raw frame (waits for bus silence)
      */
@@ -220,13 +208,18 @@ public:
     /**
      * @brief Get queued request count (not including in-flight)
      */
-    size_t getQueuedRequestCount() const { return _requestQueue.size(); }
+    size_t getQueuedRequestCount() const { return _queuedCount.load() + _incoming.size(); }
+
+    /**
+     * @brief Get maximum number of queued requests
+     */
+    size_t getMaxQueueSize() const { return _maxQueueSize; }
 
     /**
      * @brief Get pending request count (queued + in-flight)
      */
     size_t getPendingRequestCount() const {
-        return _requestQueue.size() + ((_waitingForResponse && _hasPendingRequest) ? 1 : 0);
+        return getQueuedRequestCount() + ((_waitingForResponse && _hasPendingRequest) ? 1 : 0);
     }
 
     /**
@@ -259,13 +252,14 @@ public:
     std::vector<UnitBackoffInfo> getUnitBackoffInfo() const;
     
     /**
-     * @brief Clear all pending requests
+     * @brief Clear all pending requests (done by the next loop())
      */
-    void clearQueue() { _requestQueue.clear(); }
+    void clearQueue();
     
     /**
      * @brief Suspend all Modbus communication (for OTA, etc.)
-     * Clears queue, stops polling, ignores incoming data
+     * Clears queue, stops polling, ignores incoming data.
+     * isSuspended() changes at once, the bus is quiesced by the next loop().
      */
     void suspend();
     
@@ -351,6 +345,11 @@ public:
      */
     void resetStats();
     
+    /**
+     * @brief Continue cumulative statistics from a boot snapshot
+     */
+    void restoreStats(const Stats& stats);
+    
     /**
      * @brief Reset interval statistics (called after each warning check)
      */
@@ -392,10 +391,16 @@ private:
     ModbusRegisterMap& ensureRegisterMap(uint8_t unitId, uint8_t functionCode);
     void updateRegisterMap(const ModbusFrame& request, const ModbusFrame& response);
     void processQueue();
+    void applyControlRequests();
+    void resynchronize();
+    void drainIncoming();
+    void deliverRequestCallback(const std::function<void(bool, const ModbusFrame&)>& callback,
+                                bool success, const ModbusFrame& frame);
+    void deliverFrameCallback(const ModbusFrame& frame, bool isRequest);
+    bool enqueue(ModbusPendingRequest&& req);
     bool sendRequest(const ModbusPendingRequest& request);
     void sendFrameFromBuffer();  // Uses static _txFrameBuffer
     void sendFrame(const std::vector<uint8_t>& frame);  // Legacy wrapper for sendRawFrame
-    uint16_t calculateCRC(const uint8_t* data, size_t length) const;
     void setDE(bool transmit);
     void checkAndLogWarnings();
     void startActiveTime(bool isOwn);
@@ -405,7 +410,7 @@ private:
         return (unitId << 8) | functionCode;
     }
     
-    HardwareSerial& _serial;
+    Hal::Uart& _serial;
     uint32_t _baudRate;
     uint32_t _config;
     int8_t _rxPin;
@@ -417,7 +422,13 @@ private:
     uint32_t _silenceTimeUs;          // 3.5 character times in microseconds
     uint32_t _charTimeUs;             // Time for one character
     
-    bool _suspended{false};           // When true, skip all processing (for OTA)
+    std::atomic<bool> _suspended{false};  // When true, skip all processing (for OTA)
+
+    // suspend()/resume()/clearQueue() from other tasks, applied by loop()
+    static constexpr uint8_t CONTROL_SUSPEND = 0x01;
+    static constexpr uint8_t CONTROL_RESUME = 0x02;
+    static constexpr uint8_t CONTROL_CLEAR = 0x04;
+    std::atomic<uint8_t> _controlRequests{0};
     
     std::vector<uint8_t> _rxBuffer;
     unsigned long _lastByteTime;
@@ -438,8 +449,11 @@ private:
     // Register storage
     std::map<uint16_t, ModbusRegisterMap> _registerMaps;
     
-    // Request queue
+    // Request queue: queue*() push to _incoming from any task, loop() moves
+    // the requests to _requestQueue, which only the task running loop() touches
+    MpscQueue<ModbusPendingRequest> _incoming;
     std::vector<ModbusPendingRequest> _requestQueue;
+    std::atomic<size_t> _queuedCount{0};  // _requestQueue.size() for other tasks
     ModbusPendingRequest _currentRequest;  // Copy, not pointer - prevents invalid references
     bool _hasPendingRequest;
 
@@ -455,6 +469,16 @@ private:
     std::map<uint16_t, unsigned long> _lastTimeoutPerUnit;  // Track last timeout per unit (throttle spam)
     
     FrameCallback _frameCallback;
+
+    // Callbacks handed from the ModbusRTU task to the loop task (own task only)
+    struct CallbackDelivery {
+        std::function<void(bool, const ModbusFrame&)> requestCallback;  // empty: frame callback
+        ModbusFrame frame;
+        bool success;
+        bool isRequest;
+    };
+    std::unique_ptr<MpscQueue<CallbackDelivery>> _deliveries;
+    std::atomic<uint32_t> _droppedCallbacks{0};
     Stats _stats;
     IntervalStats _intervalStats;
     
@@ -468,6 +492,7 @@ private:
     uint32_t _loopCounter{0};
     uint32_t _processQueueCounter{0};
     unsigned long _lastProcessQueueMs{0};
+    uint32_t _firstRequestMs{0};
 
     // Static TX frame buffer (avoids heap allocation per send)
     // Max Modbus RTU frame: 256 bytes payload + 3 header + 2 CRC = 261
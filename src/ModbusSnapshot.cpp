@@ -0,0 +1,321 @@
+#define LOG_CATEGORY LogCategory::ModbusDevice
+
+#include "ModbusSnapshot.h"
+#include "ModbusDevice.h"
+#include "ModbusRTUFeature.h"
+#include "StorageFeature.h"
+#include "ResetManager.h"
+#include "LoggingFeature.h"
+#include "TimeUtils.h"
+#include "MutexLock.h"
+
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stddef.h>
+#include <vector>
+
+namespace {
+    static constexpr uint32_t SNAPSHOT_MAGIC = 0x504E534D;  // 'MSNP'
+    static constexpr uint16_t SNAPSHOT_VERSION = 1;
+    static constexpr size_t SNAPSHOT_MAX_FILE = 16384;
+
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t statsSize;         // layout check for ModbusRTUFeature::Stats
+        uint16_t valueCount;
+        uint16_t batchCount;
+        uint32_t size;              // whole snapshot incl. header
+        uint32_t crc;               // over the snapshot with crc = 0
+        uint32_t savedUnix;         // 0 if time wasn't synced
+        ModbusRTUFeature::Stats stats;
+    };
+
+    struct ValueEntry {
+        uint32_t nameHash;          // FNV-1a of the register name
+        uint32_t unixTimestamp;
+        float value;
+        uint8_t unitId;
+        uint8_t reserved[3];
+    };
+
+    struct BatchEntry {
+        uint8_t unitId;
+        uint8_t functionCode;
+        uint16_t startAddress;
+        uint32_t sinceLastPollMs;
+    };
+
+    // RTC memory persists across soft resets (not power loss)
+    RTC_NOINIT_ATTR uint32_t s_rtc[MODBUS_SNAPSHOT_RTC_BYTES / sizeof(uint32_t)];
+
+    ModbusDeviceManager* s_devices = nullptr;
+    ModbusRTUFeature* s_modbus = nullptr;
+    StorageFeature* s_storage = nullptr;
+    SemaphoreHandle_t s_mutex = nullptr;
+
+    const char* s_source = "none";
+    uint16_t s_restoredValues = 0;
+    uint16_t s_restoredBatches = 0;
+    uint32_t s_restoredSavedUnix = 0;
+    uint32_t s_rtcSaves = 0;
+    uint32_t s_flashSaves = 0;
+    uint32_t s_failures = 0;
+    uint32_t s_lastBytes = 0;
+    uint32_t s_lastRtcSaveMs = 0;
+    uint32_t s_lastFlashSaveMs = 0;
+    bool s_tooBigLogged = false;
+
+    uint32_t nameHash(const char* name) {
+        uint32_t h = 2166136261u;
+        while (*name) {
+            h ^= (uint8_t)*name++;
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    template <typename T>
+    void append(std::vector<uint8_t>& buf, const T& item) {
+        const uint8_t* p = (const uint8_t*)&item;
+        buf.insert(buf.end(), p, p + sizeof(T));
+    }
+
+    std::vector<uint8_t> capture() {
+        std::vector<uint8_t> buf(sizeof(Header));
+        Header h{};
+        h.magic = SNAPSHOT_MAGIC;
+        h.version = SNAPSHOT_VERSION;
+        h.statsSize = sizeof(ModbusRTUFeature::Stats);
+        h.stats = s_modbus->getStats();
+
+        const uint32_t nowMs = millis();
+        const uint32_t nowUnix = TimeUtils::nowUnixSecondsOrZero();
+        h.savedUnix = nowUnix;
+
+        std::vector<BatchEntry> batches;
+        {
+            auto _guard = s_devices->scopedLock();
+            for (const auto& kv : s_devices->getDevices()) {
+                const auto& device = kv.second;
+                if (!device.deviceType) continue;
+
+                for (const auto& v : device.currentValues) {
+                    if (!v.second.valid) continue;
+                    ValueEntry e{};
+                    e.nameHash = nameHash(v.first.c_str());
+                    e.unitId = device.unitId;
+                    e.value = v.second.value;
+                    e.unixTimestamp = v.second.unixTimestamp;
+                    if (e.unixTimestamp == 0 && nowUnix != 0 && v.second.updatedAtMs != 0) {
+                        // Polled before the time was synced: date it now, uptime is lost on restart
+                        e.unixTimestamp = nowUnix - (nowMs - v.second.updatedAtMs) / 1000;
+                    }
+                    append(buf, e);
+                    h.valueCount++;
+                }
+
+                for (const auto& batch : device.pollBatches) {
+                    if (batch.lastPollMs == 0) continue;  // not polled yet, due at once anyway
+                    BatchEntry b{};
+                    b.unitId = device.unitId;
+                    b.functionCode = batch.functionCode;
+                    b.startAddress = batch.startAddress;
+                    b.sinceLastPollMs = nowMs - batch.lastPollMs;
+                    batches.push_back(b);
+                }
+            }
+        }
+        for (const auto& b : batches) append(buf, b);
+        h.batchCount = (uint16_t)batches.size();
+
+        h.size = buf.size();
+        h.crc = 0;
+        memcpy(buf.data(), &h, sizeof(h));
+        h.crc = esp_rom_crc32_le(0, buf.data(), buf.size());
+        memcpy(buf.data(), &h, sizeof(h));
+        return buf;
+    }
+
+    bool validate(const uint8_t* data, size_t len, Header& h) {
+        if (len < sizeof(Header)) return false;
+        memcpy(&h, data, sizeof(h));
+        if (h.magic != SNAPSHOT_MAGIC || h.version != SNAPSHOT_VERSION) return false;
+        if (h.statsSize != sizeof(ModbusRTUFeature::Stats)) return false;
+        if (h.size > len) return false;
+        if (h.size != sizeof(Header) + h.valueCount * sizeof(ValueEntry) + h.batchCount * sizeof(BatchEntry)) {
+            return false;
+        }
+
+        // Same bytes as in capture(): header as stored, crc field zeroed
+        uint8_t header[sizeof(Header)];
+        memcpy(header, data, sizeof(header));
+        memset(header + offsetof(Header, crc), 0, sizeof(h.crc));
+        uint32_t calc = esp_rom_crc32_le(0, header, sizeof(header));
+        calc = esp_rom_crc32_le(calc, data + sizeof(Header), h.size - sizeof(Header));
+        return calc == h.crc;
+    }
+
+    void apply(const uint8_t* data, const Header& h, bool restorePhase) {
+        const ValueEntry* values = (const ValueEntry*)(data + sizeof(Header));
+        const BatchEntry* batches = (const BatchEntry*)(values + h.valueCount);
+        const uint32_t nowMs = millis();
+
+        auto _guard = s_devices->scopedLock();
+
+        for (size_t i = 0; i < h.valueCount; i++) {
+            ValueEntry e;
+            memcpy(&e, &values[i], sizeof(e));
+            ModbusDeviceInstance* device = s_devices->getDevice(e.unitId);
+            if (!device || !device->deviceType) continue;
+
+            // Register definitions may have changed: restore by name only
+            for (const auto& reg : device->deviceType->registers) {
+                if (nameHash(reg.name) != e.nameHash) continue;
+                auto it = device->currentValues.find(reg.name);
+                if (it == device->currentValues.end() || it->second.valid) break;
+                auto& v = it->second;
+                v.value = e.value;
+                v.unixTimestamp = e.unixTimestamp;
+                v.timestamp = e.unixTimestamp;
+                v.updatedAtMs = 0;
+                v.valid = true;
+                v.restored = true;
+                s_restoredValues++;
+                break;
+            }
+        }
+
+        if (!restorePhase) return;
+
+        for (size_t i = 0; i < h.batchCount; i++) {
+            BatchEntry b;
+            memcpy(&b, &batches[i], sizeof(b));
+            ModbusDeviceInstance* device = s_devices->getDevice(b.unitId);
+            if (!device) continue;
+
+            for (auto& batch : device->pollBatches) {
+                if (batch.functionCode != b.functionCode || batch.startAddress != b.startAddress) continue;
+                // Time since the last poll now includes the boot. Keep the interval
+                // grid even if the boot took longer than the interval, so batches
+                // stay spread instead of all coming due at once.
+                if (batch.pollIntervalMs == 0) break;
+                const uint64_t elapsed = (uint64_t)b.sinceLastPollMs + nowMs;
+                const uint32_t phase = (uint32_t)(elapsed % batch.pollIntervalMs);
+                batch.lastPollMs = nowMs - phase;  // may wrap, next due = lastPollMs + interval
+                if (batch.lastPollMs == 0) batch.lastPollMs = 1;
+                s_restoredBatches++;
+                break;
+            }
+        }
+    }
+
+    bool restoreFromRtc() {
+        Header h;
+        if (!validate((const uint8_t*)s_rtc, sizeof(s_rtc), h)) return false;
+        s_modbus->restoreStats(h.stats);
+        apply((const uint8_t*)s_rtc, h, true);
+        s_restoredSavedUnix = h.savedUnix;
+        s_source = "rtc";
+        return true;
+    }
+
+    bool restoreFromFlash() {
+        if (!s_storage->isReady()) return false;
+        StorageFeature::Reader reader = s_storage->openReader(MODBUS_SNAPSHOT_PATH);
+        if (!reader) return false;
+        const size_t size = reader.size();
+        if (size < sizeof(Header) || size > SNAPSHOT_MAX_FILE) return false;
+
+        std::vector<uint8_t> buf(size);
+        if (reader.read(buf.data(), size) != size) return false;
+        reader.close();
+
+        Header h;
+        if (!validate(buf.data(), buf.size(), h)) {
+            LOG_W("Ignoring invalid Modbus snapshot %s", MODBUS_SNAPSHOT_PATH);
+            return false;
+        }
+        s_modbus->restoreStats(h.stats);
+        apply(buf.data(), h, false);
+        s_restoredSavedUnix = h.savedUnix;
+        s_source = "flash";
+        return true;
+    }
+}
+
+namespace ModbusSnapshot {
+    void setup(ModbusDeviceManager& devices, ModbusRTUFeature& modbus, StorageFeature& storage) {
+        s_devices = &devices;
+        s_modbus = &modbus;
+        s_storage = &storage;
+        if (!s_mutex) s_mutex = xSemaphoreCreateMutex();
+
+        if (restoreFromRtc() || restoreFromFlash()) {
+            LOG_I("Modbus snapshot restored from %s: %u values, %u poll phases",
+                  s_source, s_restoredValues, s_restoredBatches);
+        }
+
+        s_lastRtcSaveMs = millis();
+        s_lastFlashSaveMs = millis();
+        ResetManager::onRestart([]() { save(true); });
+    }
+
+    void loop() {
+        if (!s_devices) return;
+        const uint32_t now = millis();
+        const bool flash = (uint32_t)(now - s_lastFlashSaveMs) >= MODBUS_SNAPSHOT_FLASH_INTERVAL_MS;
+        if (!flash && (uint32_t)(now - s_lastRtcSaveMs) < MODBUS_SNAPSHOT_RTC_INTERVAL_MS) return;
+        save(flash);
+    }
+
+    bool save(bool toFlash) {
+        if (!s_devices) return false;
+        MutexLock lock(s_mutex);
+
+        const std::vector<uint8_t> buf = capture();
+        s_lastBytes = buf.size();
+        s_lastRtcSaveMs = millis();
+
+        if (buf.size() <= sizeof(s_rtc)) {
+            memcpy(s_rtc, buf.data(), buf.size());
+            s_rtcSaves++;
+        } else {
+            s_rtc[0] = 0;  // invalidate an older snapshot
+            if (!s_tooBigLogged) {
+                s_tooBigLogged = true;
+                LOG_W("Modbus snapshot (%u bytes) exceeds RTC memory (%u bytes), flash only",
+                      buf.size(), sizeof(s_rtc));
+            }
+        }
+
+        if (!toFlash) return true;
+        s_lastFlashSaveMs = millis();
+        if (!s_storage || !s_storage->isReady()) return false;
+
+        StorageFeature::Writer writer = s_storage->openWriter(MODBUS_SNAPSHOT_PATH,
+            StorageFeature::WRITE_ATOMIC | StorageFeature::WRITE_CHECKSUM);
+        if (writer) writer.write(buf.data(), buf.size());
+        if (!writer || !writer.close()) {
+            s_failures++;
+            LOG_E("Failed to write Modbus snapshot %s", MODBUS_SNAPSHOT_PATH);
+            return false;
+        }
+        s_flashSaves++;
+        return true;
+    }
+
+    void toJson(JsonObject obj) {
+        obj["restoredFrom"] = s_source;
+        obj["restoredValues"] = s_restoredValues;
+        obj["restoredPollPhases"] = s_restoredBatches;
+        if (s_restoredSavedUnix != 0) obj["restoredSavedEpoch"] = s_restoredSavedUnix;
+        obj["bytes"] = s_lastBytes;
+        obj["rtcCapacity"] = (uint32_t)sizeof(s_rtc);
+        obj["rtcSaves"] = s_rtcSaves;
+        obj["flashSaves"] = s_flashSaves;
+        obj["flashFailures"] = s_failures;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+class ModbusDeviceManager;
+class ModbusRTUFeature;
+class StorageFeature;
+
+// RTC memory reserved for the snapshot; it's only kept there if it fits
+#ifndef MODBUS_SNAPSHOT_RTC_BYTES
+#define MODBUS_SNAPSHOT_RTC_BYTES 2048
+#endif
+
+#ifndef MODBUS_SNAPSHOT_RTC_INTERVAL_MS
+#define MODBUS_SNAPSHOT_RTC_INTERVAL_MS 10000
+#endif
+
+#ifndef MODBUS_SNAPSHOT_FLASH_INTERVAL_MS
+#define MODBUS_SNAPSHOT_FLASH_INTERVAL_MS 900000
+#endif
+
+#ifndef MODBUS_SNAPSHOT_PATH
+#define MODBUS_SNAPSHOT_PATH "/modbus/snapshot.bin"
+#endif
+
+/**
+ * @brief Fast-boot snapshot of the Modbus device state
+ *
+ * Captures the cached register values, the poll phase of every poll batch
+ * and the cumulative RTU statistics. The snapshot is kept in RTC memory
+ * (survives soft resets, crashes and watchdog resets) and in a flash file
+ * (survives power loss), written periodically and on planned restarts.
+ *
+ * At boot the RTC copy is preferred. Restored values are marked as
+ * restored until polled again. Poll phases are only taken from RTC memory:
+ * after a power loss the downtime is unknown, so everything is polled at once.
+ */
+namespace ModbusSnapshot {
+    // Call after the device mappings are loaded and before the first poll.
+    // Restores the newest snapshot and hooks saving into planned restarts.
+    void setup(ModbusDeviceManager& devices, ModbusRTUFeature& modbus, StorageFeature& storage);
+
+    // Periodic saves; call from loop()
+    void loop();
+
+    // Capture now (RTC memory always, flash file if toFlash)
+    bool save(bool toFlash);
+
+    // Restore source, counts and save statistics
+    void toJson(JsonObject obj);
+}
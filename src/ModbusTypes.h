@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+// Modbus types shared by the bus feature, the device manager and ModbusCodec.
+// Plain C++ without Arduino, so they also build in the native test env.
+
+/**
+ * @brief Modbus function codes
+ */
+namespace ModbusFC {
+    constexpr uint8_t READ_COILS = 0x01;
+    constexpr uint8_t READ_DISCRETE_INPUTS = 0x02;
+    constexpr uint8_t READ_HOLDING_REGISTERS = 0x03;
+    constexpr uint8_t READ_INPUT_REGISTERS = 0x04;
+    constexpr uint8_t WRITE_SINGLE_COIL = 0x05;
+    constexpr uint8_t WRITE_SINGLE_REGISTER = 0x06;
+    constexpr uint8_t WRITE_MULTIPLE_COILS = 0x0F;
+    constexpr uint8_t WRITE_MULTIPLE_REGISTERS = 0x10;
+}
+
+/**
+ * @brief A single Modbus RTU frame (request or response)
+ */
+struct ModbusFrame {
+    static constexpr size_t MAX_DATA_LEN = 252;  // up to FC3/FC4 response payload (byteCount+data)
+
+    uint8_t unitId;
+    uint8_t functionCode;
+    std::array<uint8_t, MAX_DATA_LEN> data{};  // Payload without unit ID, FC, and CRC
+    uint16_t dataLen{0};
+    uint16_t crc;
+    unsigned long timestamp;         // Hal::millis() at capture time (monotonic)
+    uint32_t unixTimestamp;          // epoch seconds at capture time (0 if time invalid)
+    bool isRequest;                  // request vs response (best-effort)
+    bool isValid;                   // CRC check passed
+    bool isException;               // Exception response (FC | 0x80)
+    uint8_t exceptionCode;
+    
+    // For read requests: extract start register and quantity
+    uint16_t getStartRegister() const {
+        if (dataLen >= 2) return (data[0] << 8) | data[1];
+        return 0;
+    }
+    
+    uint16_t getQuantity() const {
+        if (dataLen >= 4) return (data[2] << 8) | data[3];
+        return 0;
+    }
+    
+    // For read responses: get register data
+    size_t getByteCount() const {
+        if (dataLen >= 1) return data[0];
+        return 0;
+    }
+    
+    const uint8_t* getRegisterData() const {
+        if (dataLen > 1) return &data[1];
+        return nullptr;
+    }
+};
+
+/**
+ * @brief Data types for Modbus register interpretation
+ */
+enum class ModbusDataType : uint8_t {
+    UINT16 = 0,     // Unsigned 16-bit
+    INT16,          // Signed 16-bit
+    UINT32_BE,      // Unsigned 32-bit big-endian (AB CD)
+    UINT32_LE,      // Unsigned 32-bit little-endian (CD AB)
+    INT32_BE,       // Signed 32-bit big-endian
+    INT32_LE,       // Signed 32-bit little-endian
+    FLOAT32_BE,     // IEEE 754 float big-endian
+    FLOAT32_LE,     // IEEE 754 float little-endian
+    BOOL,           // Boolean (0/1)
+    STRING          // ASCII string
+};
+
+/**
+ * @brief Single register definition
+ */
+struct ModbusRegisterDef {
+    char name[32];              // Register name
+    uint16_t address;           // Start register address
+    uint16_t length;            // Number of registers
+    uint8_t functionCode;       // Function code (3 or 4 typically)
+    ModbusDataType dataType;    // Data type
+    float conversionFactor;     // Multiply raw value by this
+    float offset;               // Add this after multiplication
+    char unit[16];              // Unit string (°C, kW, etc.)
+    uint32_t pollIntervalMs;    // How often to poll (0 = on-demand)
+};
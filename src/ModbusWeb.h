@@ -3,6 +3,10 @@
 
 #include "ModbusDevice.h"
 #include "ModbusRTUFeature.h"
+#include "ModbusBatch.h"
+#include "ModbusLongPoll.h"
+#include "ModbusSnapshot.h"
+#include "ApiEncoding.h"
 #include "WebServerFeature.h"
 #include <ArduinoJson.h>
 #include <map>
@@ -96,9 +100,7 @@ public:
                     dev["unknownCount"] = (uint32_t)kv.second.unknownU16.size();
                 }
                 
-                String output;
-                serializeJson(doc, output);
-                request->send(200, "application/json", output);
+                ApiEncoding::send(request, 200, doc);
             });
         
         // Get device values
@@ -112,11 +114,13 @@ public:
                 }
                 
                 uint8_t unitId = request->getParam("unit")->value().toInt();
-                auto* response = request->beginResponseStream("application/json");
+                const ApiEncoding::Format format = ApiEncoding::negotiate(request);
+                auto* response = request->beginResponseStream(ApiEncoding::contentType(format));
+                response->addHeader("Vary", "Accept");
                 if (request->hasParam("meta")) {
-                    devices.writeDeviceMetaJson(unitId, *response);
+                    devices.writeDeviceMetaJson(unitId, *response, format);
                 } else {
-                    devices.writeDeviceValuesJson(unitId, *response);
+                    devices.writeDeviceValuesJson(unitId, *response, format);
                 }
                 request->send(response);
             });
@@ -155,9 +159,7 @@ public:
                 doc["valid"] = valid;
                 doc["queued"] = queued;
                 
-                String output;
-                serializeJson(doc, output);
-                request->send(200, "application/json", output);
+                ApiEncoding::send(request, 200, doc);
             });
         
         // Write to a register
@@ -191,9 +193,7 @@ public:
                 doc["value"] = value;
                 doc["queued"] = queued;
                 
-                String output;
-                serializeJson(doc, output);
-                request->send(200, "application/json", output);
+                ApiEncoding::send(request, 200, doc);
             });
         
         // Raw read request
@@ -230,12 +230,12 @@ public:
                 doc["functionCode"] = fc;
                 doc["queued"] = queued;
                 
-                String output;
-                serializeJson(doc, output);
-                request->send(200, "application/json", output);
+                ApiEncoding::send(request, 200, doc);
             });
 
-        // Raw read request (tracked) - returns a requestId that can be polled via /api/modbus/raw/result
+        // Raw read request (tracked) - returns a requestId that can be polled via /api/modbus/raw/result,
+        // or with wait=<ms> holds the request until the response arrived (long-poll, no requestId)
+        ModbusLongPoll::init(modbus);
         webServer->on("/api/modbus/raw/readTracked", HTTP_GET,
             [&modbus, &server, purgeTracked](AsyncWebServerRequest* request) mutable {
                 if (!server.authenticate(request)) return request->requestAuthentication();
@@ -254,14 +254,26 @@ public:
                     return;
                 }
 
-                purgeTracked();
-
                 uint8_t unitId = request->getParam("unit")->value().toInt();
                 uint16_t address = request->getParam("address")->value().toInt();
                 uint16_t count = request->getParam("count")->value().toInt();
                 uint8_t fc = request->hasParam("fc") ?
                              request->getParam("fc")->value().toInt() : 3;
 
+                if (request->hasParam("wait")) {
+                    const long waitMs = request->getParam("wait")->value().toInt();
+                    if (waitMs <= 0 || waitMs > (long)ModbusLongPoll::MAX_WAIT_MS) {
+                        request->send(400, "application/json", "{\"error\":\"wait must be 1..10000 ms\"}");
+                        return;
+                    }
+                    if (!ModbusLongPoll::submit(request, unitId, fc, address, count, (uint32_t)waitMs)) {
+                        request->send(503, "application/json", "{\"error\":\"Too many waiting requests\"}");
+                    }
+                    return;
+                }
+
+                purgeTracked();
+
                 uint32_t requestId = s_nextTrackedId++;
                 if (requestId == 0) requestId = s_nextTrackedId++;
 
@@ -322,9 +334,7 @@ public:
                 doc["count"] = count;
                 doc["functionCode"] = fc;
 
-                String output;
-                serializeJson(doc, output);
-                request->send(queued ? 200 : 503, "application/json", output);
+                ApiEncoding::send(request, queued ? 200 : 503, doc);
             });
 
         // Fetch tracked raw read result
@@ -375,11 +385,77 @@ public:
                     }
                 }
 
-                String output;
-                serializeJson(doc, output);
-                request->send(200, "application/json", output);
+                ApiEncoding::send(request, 200, doc);
             });
-        
+
+        // Batch raw read: coalesces items into few bus transactions and answers once all completed
+        ModbusBatch::init(modbus);
+        webServer->on("/api/modbus/batch", HTTP_POST,
+            [&server](AsyncWebServerRequest* request) {
+                if (!server.authenticate(request)) return request->requestAuthentication();
+
+#if MODBUS_LISTEN_ONLY
+                request->send(409, "application/json",
+                              "{\"error\":\"Modbus is in listen-only mode (sending disabled)\"}");
+                return;
+#endif
+
+                if (!request->_tempObject) {
+                    request->send(400, "application/json", "{\"error\":\"Missing or too large JSON body\"}");
+                    return;
+                }
+
+                JsonDocument body;
+                if (deserializeJson(body, (const char*)request->_tempObject)) {
+                    request->send(400, "application/json", "{\"error\":\"Invalid JSON body\"}");
+                    return;
+                }
+
+                JsonArray arr = body["items"].as<JsonArray>();
+                if (arr.isNull() || arr.size() == 0 || arr.size() > ModbusBatch::MAX_ITEMS) {
+                    request->send(400, "application/json", "{\"error\":\"items must hold 1..64 entries\"}");
+                    return;
+                }
+
+                std::vector<ModbusBatch::Item> items;
+                items.reserve(arr.size());
+                for (JsonObject o : arr) {
+                    const int32_t unit = o["unit"] | 0;
+                    const int32_t fc = o["fc"] | 3;
+                    const int32_t address = o["address"] | -1;
+                    const int32_t count = o["count"] | 1;
+                    if (unit < 1 || unit > 247 ||
+                        (fc != ModbusFC::READ_HOLDING_REGISTERS && fc != ModbusFC::READ_INPUT_REGISTERS) ||
+                        address < 0 || count < 1 || count > ModbusBatch::MAX_WINDOW_REGISTERS ||
+                        address + count > 0x10000L) {
+                        request->send(400, "application/json",
+                                      "{\"error\":\"Invalid item (unit 1..247, fc 3/4, address, count 1..125)\"}");
+                        return;
+                    }
+                    items.push_back({(uint8_t)unit, (uint8_t)fc, (uint16_t)address, (uint16_t)count});
+                }
+
+                uint32_t timeoutMs = body["timeoutMs"] | ModbusBatch::DEFAULT_TIMEOUT_MS;
+                if (timeoutMs > ModbusBatch::MAX_TIMEOUT_MS) timeoutMs = ModbusBatch::MAX_TIMEOUT_MS;
+                uint16_t maxGap = body["maxGap"] | ModbusBatch::DEFAULT_MAX_GAP;
+
+                if (!ModbusBatch::submit(request, std::move(items), timeoutMs, maxGap)) {
+                    request->send(503, "application/json", "{\"error\":\"Too many batches in progress\"}");
+                }
+            },
+            nullptr,
+            [](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+                static constexpr size_t MAX_BODY = 4096;
+                if (total > MAX_BODY) return;
+                if (index == 0) {
+                    request->_tempObject = malloc(total + 1);
+                    if (!request->_tempObject) return;
+                }
+                if (!request->_tempObject || index + len > total) return;
+                memcpy((uint8_t*)request->_tempObject + index, data, len);
+                ((char*)request->_tempObject)[index + len] = '\0';
+            });
+
         // Get bus status
         webServer->on("/api/modbus/status", HTTP_GET,
             [&modbus, &server](AsyncWebServerRequest* request) {
@@ -426,6 +502,8 @@ public:
                     o["pauseRemainingMs"] = info.pauseRemainingMs;
                 }
 
+                ModbusSnapshot::toJson(doc["snapshot"].to<JsonObject>());
+
                 JsonObject debug = doc["debug"].to<JsonObject>();
                 debug["sinceLastByteUs"] = modbus.getTimeSinceLastByteUs();
                 debug["charTimeUs"] = modbus.getCharTimeUs();
@@ -450,9 +528,7 @@ public:
                     if (iso.length() > 0) updated["iso"] = iso;
                 }
                 
-                String output;
-                serializeJson(doc, output);
-                request->send(200, "application/json", output);
+                ApiEncoding::send(request, 200, doc);
             });
 
         // Recent CRC error contexts (before/bad/after) with full hex dumps
@@ -536,9 +612,7 @@ public:
                     }
                 }
 
-                String output;
-                serializeJson(doc, output);
-                request->send(200, "application/json", output);
+                ApiEncoding::send(request, 200, doc);
             };
 
         webServer->on("/api/modbus/crc", HTTP_GET, handleModbusCrc);
@@ -585,9 +659,7 @@ public:
                     }
                 }
                 
-                String output;
-                serializeJson(doc, output);
-                request->send(200, "application/json", output);
+                ApiEncoding::send(request, 200, doc);
             });
         
         // Device types list
@@ -602,9 +674,7 @@ public:
                     arr.add(name);
                 }
                 
-                String output;
-                serializeJson(doc, output);
-                request->send(200, "application/json", output);
+                ApiEncoding::send(request, 200, doc);
             });
         
         // HTML dashboard
@@ -699,7 +769,7 @@ public:
                     "<p><a href='/view/modbus'>&larr; Back to dashboard</a></p>"
                     "<div class='card'>"
                     "<h2>Tracked Raw Read</h2>"
-                    "<p><small>Sends via <code>/api/modbus/raw/readTracked</code> and polls <code>/api/modbus/raw/result</code>.</small></p>"
+                    "<p><small>Sends via <code>/api/modbus/raw/readTracked?wait=3000</code>; the response arrives with the result.</small></p>"
                     "<div>"
                     "<label>unit <input id='unit' type='number' value='1' min='1' max='247'></label>"
                     "<label>address <input id='address' type='number' value='0' min='0' max='65535'></label>"
@@ -711,7 +781,6 @@ public:
                     "<h3>Result</h3><pre id='out'>Ready.</pre>"
                     "</div>"
                     "<script>"
-                    "let lastRequestId = 0;"
                     "function qs(id){return document.getElementById(id);}"
                     "function toHexByte(b){return ('0'+(b&0xFF).toString(16)).slice(-2).toUpperCase();}"
                     "function toHex(bytes){return bytes.map(toHexByte).join(' ');}"
@@ -737,22 +806,12 @@ public:
                     "  const crc = crc16Modbus(req);"
                     "  req.push(crc & 0xFF, (crc>>8)&0xFF);" // Modbus CRC is little-endian on the wire
                     "  qs('req').textContent = toHex(req);"
-                    "  qs('out').textContent='Queueing...';"
-                    "  const url=`/api/modbus/raw/readTracked?unit=${encodeURIComponent(u)}&address=${encodeURIComponent(a)}&count=${encodeURIComponent(c)}&fc=${encodeURIComponent(fc)}`;"
+                    "  qs('out').textContent='Waiting for response...';"
+                    "  const url=`/api/modbus/raw/readTracked?unit=${encodeURIComponent(u)}&address=${encodeURIComponent(a)}&count=${encodeURIComponent(c)}&fc=${encodeURIComponent(fc)}&wait=3000`;"
                     "  const r=await fetch(url);"
                     "  const j=await r.json();"
-                    "  lastRequestId = j.requestId || 0;"
-                    "  qs('out').textContent = JSON.stringify(j,null,2);"
-                    "  if(!j.queued || !lastRequestId) return;"
-                    "  pollResult(lastRequestId, 0);"
-                    "}"
-                    "async function pollResult(id, n){"
-                    "  if(n>40){ qs('out').textContent += `\n\nNo response yet (timeout waiting in UI).` ; return; }"
-                    "  const r=await fetch(`/api/modbus/raw/result?id=${encodeURIComponent(id)}`);"
-                    "  const j=await r.json();"
                     "  qs('out').textContent = JSON.stringify(j,null,2);"
-                    "  if(j.completed) return;"
-                    "  setTimeout(()=>pollResult(id,n+1), 250);"
+                    "  if(j.queued && !j.completed) qs('out').textContent += `\n\nNo response within 3 s.`;"
                     "}"
                     "</script></body></html>");
 
@@ -846,9 +905,7 @@ public:
                     }
                 }
 
-                String output;
-                serializeJson(doc, output);
-                request->send(200, "application/json", output);
+                ApiEncoding::send(request, 200, doc);
             });
     }
 };
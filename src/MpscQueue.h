@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+
+/**
+ * Bounded lock-free queue, many producers and one consumer.
+ *
+ * For handing work between feature tasks and the loop task without a mutex:
+ * push() may be called from any task (never blocks, fails when full), pop()
+ * only from the task owning the queue. Every slot carries a sequence number
+ * (D. Vyukov's bounded queue), so a producer claims a slot with a single
+ * compare-and-swap and publishes it with a release store.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    /**
+     * @brief Allocate the slots
+     * @param capacity Rounded up to a power of two
+     */
+    explicit MpscQueue(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        _cells.reset(new Cell[n]);
+        _mask = n - 1;
+        for (size_t i = 0; i < n; i++) _cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /**
+     * @brief Add an element (any task)
+     * @return false if the queue is full
+     */
+    bool push(T value) {
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = _cells[pos & _mask];
+            const size_t seq = cell.seq.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Take the oldest element (consumer task only)
+     * @return false if the queue is empty
+     */
+    bool pop(T& out) {
+        const size_t pos = _head.load(std::memory_order_relaxed);
+        Cell& cell = _cells[pos & _mask];
+        const size_t seq = cell.seq.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) return false;
+
+        out = std::move(cell.value);
+        cell.value = T();
+        cell.seq.store(pos + _mask + 1, std::memory_order_release);
+        _head.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Elements claimed by producers and not yet popped (a snapshot from any task)
+    size_t size() const {
+        // head first: tail never falls behind a head read earlier
+        const size_t head = _head.load(std::memory_order_acquire);
+        const size_t tail = _tail.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const { return _mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> _cells;
+    size_t _mask;
+    std::atomic<size_t> _tail{0};
+    std::atomic<size_t> _head{0};
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+/**
+ * Holds a FreeRTOS mutex for the rest of the scope.
+ *
+ * A null handle locks nothing, so code may run before the mutex is created
+ * in setup(). Use RecursiveMutexLock for xSemaphoreCreateRecursiveMutex().
+ *
+ * Usage:
+ *   MutexLock lock(_mutex);
+ */
+class MutexLock {
+public:
+    explicit MutexLock(SemaphoreHandle_t mutex) : _mutex(mutex) { if (_mutex) xSemaphoreTake(_mutex, portMAX_DELAY); }
+    ~MutexLock() { if (_mutex) xSemaphoreGive(_mutex); }
+
+    MutexLock(const MutexLock&) = delete;
+    MutexLock& operator=(const MutexLock&) = delete;
+
+private:
+    SemaphoreHandle_t _mutex;
+};
+
+class RecursiveMutexLock {
+public:
+    explicit RecursiveMutexLock(SemaphoreHandle_t mutex) : _mutex(mutex) {
+        if (_mutex) xSemaphoreTakeRecursive(_mutex, portMAX_DELAY);
+    }
+    ~RecursiveMutexLock() { if (_mutex) xSemaphoreGiveRecursive(_mutex); }
+
+    RecursiveMutexLock(const RecursiveMutexLock&) = delete;
+    RecursiveMutexLock& operator=(const RecursiveMutexLock&) = delete;
+
+private:
+    SemaphoreHandle_t _mutex;
+};
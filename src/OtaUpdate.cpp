@@ -0,0 +1,282 @@
+#define LOG_CATEGORY LogCategory::Web
+
+#include "OtaUpdate.h"
+#include "LoggingFeature.h"
+#include <Update.h>
+#include <esp_task_wdt.h>
+#include "esp32/rom/miniz.h"
+#include <algorithm>
+
+namespace {
+    // Keep Modbus suspended this long after the last flash write.
+    static constexpr uint32_t FLASH_GRACE_MS = 2000;
+
+    // Enough for a gzip header with file name; FEXTRA payloads are not expected.
+    static constexpr size_t PREFIX_MAX = 256;
+
+    static constexpr uint8_t ESP_IMAGE_MAGIC = 0xE9;
+
+    enum GzipFlags : uint8_t {
+        GZ_FHCRC = 0x02,
+        GZ_FEXTRA = 0x04,
+        GZ_FNAME = 0x08,
+        GZ_FCOMMENT = 0x10,
+    };
+
+    bool s_active = false;
+    OtaUpdate::Format s_format = OtaUpdate::Format::Unknown;
+    bool s_headerDone = false;
+    uint8_t s_prefix[PREFIX_MAX];
+    size_t s_prefixLen = 0;
+
+    tinfl_decompressor* s_inflator = nullptr;
+    uint8_t* s_dict = nullptr;             // TINFL_LZ_DICT_SIZE ring, also the flash write buffer
+    size_t s_dictOfs = 0;
+    bool s_inflateDone = false;
+
+    size_t s_received = 0;
+    size_t s_written = 0;
+    volatile uint32_t s_lastWriteMs = 0;
+    String s_lastError;
+
+    void fail(const char* what) {
+        s_lastError = what;
+        if (Update.hasError()) {
+            s_lastError += ": ";
+            s_lastError += Update.errorString();
+        }
+        LOG_E("OTA: %s", s_lastError.c_str());
+    }
+
+    void freeInflator() {
+        free(s_inflator);
+        free(s_dict);
+        s_inflator = nullptr;
+        s_dict = nullptr;
+    }
+
+    bool allocInflator() {
+        s_inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+        s_dict = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+        if (!s_inflator || !s_dict) {
+            freeInflator();
+            fail("not enough heap for inflate");
+            return false;
+        }
+        tinfl_init(s_inflator);
+        s_dictOfs = 0;
+        s_inflateDone = false;
+        return true;
+    }
+
+    bool flashWrite(uint8_t* data, size_t len) {
+        if (len == 0) return true;
+        if (Update.write(data, len) != len) {
+            fail("flash write failed");
+            return false;
+        }
+        s_written += len;
+        s_lastWriteMs = millis();
+        esp_task_wdt_reset();
+        return true;
+    }
+
+    // Returns header length, 0 if more bytes are needed, -1 if invalid.
+    int parseGzipHeader(const uint8_t* p, size_t n) {
+        if (n < 10) return 0;
+        if (p[0] != 0x1F || p[1] != 0x8B || p[2] != 8) return -1;
+        const uint8_t flags = p[3];
+        size_t pos = 10;
+        if (flags & GZ_FEXTRA) {
+            if (n < pos + 2) return 0;
+            pos += 2 + (size_t)(p[pos] | (p[pos + 1] << 8));
+        }
+        for (uint8_t f : { (uint8_t)GZ_FNAME, (uint8_t)GZ_FCOMMENT }) {
+            if (!(flags & f)) continue;
+            while (pos < n && p[pos] != 0) pos++;
+            if (pos >= n) return 0;
+            pos++;
+        }
+        if (flags & GZ_FHCRC) pos += 2;
+        return pos <= n ? (int)pos : 0;
+    }
+
+    bool inflateWrite(const uint8_t* data, size_t len) {
+        const mz_uint32 flags = TINFL_FLAG_HAS_MORE_INPUT |
+            (s_format == OtaUpdate::Format::Zlib ? TINFL_FLAG_PARSE_ZLIB_HEADER : 0);
+
+        while (!s_inflateDone) {
+            size_t inBytes = len;
+            size_t outBytes = TINFL_LZ_DICT_SIZE - s_dictOfs;
+            tinfl_status status = tinfl_decompress(s_inflator, data, &inBytes,
+                                                   s_dict, s_dict + s_dictOfs, &outBytes, flags);
+            data += inBytes;
+            len -= inBytes;
+
+            if (!flashWrite(s_dict + s_dictOfs, outBytes)) return false;
+            s_dictOfs = (s_dictOfs + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+            if (status == TINFL_STATUS_DONE) {
+                // Trailing checksum/size bytes are ignored; Update.end() verifies the image itself.
+                s_inflateDone = true;
+            } else if (status < TINFL_STATUS_DONE) {
+                fail("corrupt compressed image");
+                return false;
+            } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && len == 0) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool writeBody(const uint8_t* data, size_t len) {
+        if (s_format == OtaUpdate::Format::Raw) return flashWrite(const_cast<uint8_t*>(data), len);
+        return inflateWrite(data, len);
+    }
+
+    // Detect the format and consume the gzip header from the buffered prefix.
+    // Returns false on error; s_headerDone tells whether body bytes follow.
+    bool processPrefix() {
+        if (s_prefixLen == 0) return true;
+
+        size_t headerLen = 0;
+        if (s_format == OtaUpdate::Format::Unknown) {
+            if (s_prefix[0] == ESP_IMAGE_MAGIC) {
+                s_format = OtaUpdate::Format::Raw;
+            } else if (s_prefixLen < 2) {
+                return true;
+            } else if (s_prefix[0] == 0x1F && s_prefix[1] == 0x8B) {
+                s_format = OtaUpdate::Format::Gzip;
+            } else if ((s_prefix[0] & 0x0F) == 8 && (((s_prefix[0] << 8) | s_prefix[1]) % 31) == 0) {
+                s_format = OtaUpdate::Format::Zlib;
+            } else {
+                fail("unknown image format");
+                return false;
+            }
+            if (s_format != OtaUpdate::Format::Raw && !allocInflator()) return false;
+            LOG_I("OTA: %s image", OtaUpdate::formatName());
+        }
+
+        if (s_format == OtaUpdate::Format::Gzip) {
+            const int n = parseGzipHeader(s_prefix, s_prefixLen);
+            if (n < 0) {
+                fail("invalid gzip header");
+                return false;
+            }
+            if (n == 0) {
+                if (s_prefixLen == PREFIX_MAX) {
+                    fail("gzip header too large");
+                    return false;
+                }
+                return true;
+            }
+            headerLen = (size_t)n;
+        }
+
+        s_headerDone = true;
+        return writeBody(s_prefix + headerLen, s_prefixLen - headerLen);
+    }
+}
+
+namespace OtaUpdate {
+    bool begin(const char* source) {
+        if (s_active) abort();
+
+        s_format = Format::Unknown;
+        s_headerDone = false;
+        s_prefixLen = 0;
+        s_received = 0;
+        s_written = 0;
+        s_lastError = "";
+
+        if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
+            fail("begin failed");
+            return false;
+        }
+        s_active = true;
+        s_lastWriteMs = millis();
+        LOG_I("OTA: session started (%s), free heap %u", source ? source : "-", ESP.getFreeHeap());
+        return true;
+    }
+
+    bool write(const uint8_t* data, size_t len) {
+        if (!s_active) return false;
+        if (len == 0) return true;
+
+        if (!s_headerDone) {
+            const size_t take = std::min(len, PREFIX_MAX - s_prefixLen);
+            memcpy(s_prefix + s_prefixLen, data, take);
+            s_prefixLen += take;
+            s_received += take;
+            data += take;
+            len -= take;
+            if (!processPrefix()) {
+                abort();
+                return false;
+            }
+            if (!s_headerDone) return true;
+        }
+
+        if (!writeBody(data, len)) {
+            abort();
+            return false;
+        }
+        s_received += len;
+        return true;
+    }
+
+    bool end() {
+        if (!s_active) return false;
+
+        bool ok = s_headerDone;
+        if (!ok) fail("image too short");
+        if (ok && s_format != Format::Raw && !s_inflateDone) {
+            fail("truncated compressed image");
+            ok = false;
+        }
+        if (ok && !Update.end(true)) {
+            fail("end failed");
+            ok = false;
+        }
+        if (!ok) Update.abort();
+
+        freeInflator();
+        s_active = false;
+        s_lastWriteMs = millis();
+        if (ok) {
+            LOG_I("OTA: complete, %u bytes received, %u bytes written (%s)",
+                  (unsigned)s_received, (unsigned)s_written, formatName());
+        }
+        return ok;
+    }
+
+    void abort() {
+        if (!s_active) return;
+        Update.abort();
+        freeInflator();
+        s_active = false;
+        LOG_W("OTA: session aborted at %u bytes", (unsigned)s_received);
+    }
+
+    bool isActive() { return s_active; }
+
+    bool isFlashing() {
+        const uint32_t last = s_lastWriteMs;
+        return last != 0 && (uint32_t)(millis() - last) < FLASH_GRACE_MS;
+    }
+
+    size_t receivedBytes() { return s_received; }
+    size_t writtenBytes() { return s_written; }
+    Format format() { return s_format; }
+
+    const char* formatName() {
+        switch (s_format) {
+            case Format::Raw:  return "raw";
+            case Format::Gzip: return "gzip";
+            case Format::Zlib: return "zlib";
+            default:           return "unknown";
+        }
+    }
+
+    const char* lastError() { return s_lastError.c_str(); }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * Streaming firmware writer behind the HTTP OTA endpoints.
+ *
+ * Wraps the Arduino Update library and accepts raw ESP images as well as
+ * gzip or zlib (HTTP "deflate") compressed ones. The format is detected from
+ * the first bytes of the stream; compressed data is inflated on the fly into
+ * the OTA partition, so nothing but the inflate window is buffered.
+ *
+ * A session may be fed in pieces over several HTTP requests. receivedBytes()
+ * is the offset a client has to continue at after a dropped connection.
+ *
+ * Usage:
+ *   OtaUpdate::begin("upload.bin.gz");
+ *   OtaUpdate::write(data, len);   // repeatedly
+ *   OtaUpdate::end();              // validates and activates the image
+ */
+namespace OtaUpdate {
+    enum class Format : uint8_t { Unknown, Raw, Gzip, Zlib };
+
+    // Start a new session. Aborts a session that is still open.
+    bool begin(const char* source);
+
+    // Feed the next bytes of the (possibly compressed) stream.
+    bool write(const uint8_t* data, size_t len);
+
+    // Finish the session. Returns true if the new image was accepted.
+    bool end();
+
+    // Drop the session and discard everything written so far.
+    void abort();
+
+    // True between begin() and end()/abort().
+    bool isActive();
+
+    // True while flash is being written (last write within a short grace period).
+    // Used to keep the RS485 bus quiet only while it matters.
+    bool isFlashing();
+
+    // Stream bytes accepted so far (= resume offset).
+    size_t receivedBytes();
+
+    // Image bytes written to the OTA partition so far.
+    size_t writtenBytes();
+
+    Format format();
+    const char* formatName();
+
+    // Description of the last failure (empty if none).
+    const char* lastError();
+}
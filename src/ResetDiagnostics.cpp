@@ -1,6 +1,9 @@
+#define LOG_CATEGORY LogCategory::System
+
 #include "ResetDiagnostics.h"
 
 #include <esp_system.h>
+#include <freertos/FreeRTOS.h>
 
 #include <string.h>
 
@@ -35,6 +38,9 @@ namespace {
     uint32_t s_rtc0 = 0;
     uint32_t s_rtc1 = 0;
 
+    // Loop durations are recorded by the loop task and the feature tasks
+    portMUX_TYPE s_loopMux = portMUX_INITIALIZER_UNLOCKED;
+
     const char* resetReasonToString(esp_reset_reason_t reason) {
         switch (reason) {
             case ESP_RST_UNKNOWN:   return "unknown";
@@ -108,6 +114,7 @@ namespace ResetDiagnostics {
         init();
         if (!name) name = "";
 
+        portENTER_CRITICAL(&s_loopMux);
         s_rtcState.lastLoopDurationUs = durationUs;
         strncpy(s_rtcState.lastLoopName, name, sizeof(s_rtcState.lastLoopName) - 1);
         s_rtcState.lastLoopName[sizeof(s_rtcState.lastLoopName) - 1] = '\0';
@@ -117,6 +124,7 @@ namespace ResetDiagnostics {
             strncpy(s_rtcState.maxLoopName, name, sizeof(s_rtcState.maxLoopName) - 1);
             s_rtcState.maxLoopName[sizeof(s_rtcState.maxLoopName) - 1] = '\0';
         }
+        portEXIT_CRITICAL(&s_loopMux);
     }
 
     uint32_t bootCount() {
@@ -131,6 +139,10 @@ namespace ResetDiagnostics {
         return resetReasonToString(s_reason);
     }
 
+    const char* resetReasonString(esp_reset_reason_t reason) {
+        return resetReasonToString(reason);
+    }
+
     uint32_t rtcResetReasonCore0() {
         return s_rtc0;
     }
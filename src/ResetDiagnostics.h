@@ -23,6 +23,7 @@ namespace ResetDiagnostics {
 
     esp_reset_reason_t resetReason();
     const char* resetReasonString();
+    const char* resetReasonString(esp_reset_reason_t reason);
 
     // Per-core RTC reset reason codes (ROM). 0 when unavailable.
     uint32_t rtcResetReasonCore0();
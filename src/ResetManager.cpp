@@ -1,11 +1,16 @@
+#define LOG_CATEGORY LogCategory::System
+
 #include "ResetManager.h"
 #include "LoggingFeature.h"
+#include "StorageFeature.h"
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <vector>
 
 namespace {
     volatile bool g_restartScheduled = false;
+    std::vector<std::function<void()>> g_restartCallbacks;
 
     struct RestartTaskArgs {
         uint32_t delayMs;
@@ -20,6 +25,12 @@ namespace {
             vTaskDelay(pdMS_TO_TICKS(delayMs));
         }
 
+        for (auto& callback : g_restartCallbacks) callback();
+
+        // Don't lose cached file writes and the last messages still queued for serial/syslog
+        if (StorageFeature::getInstance()) StorageFeature::getInstance()->flush();
+        if (LoggingFeature::getInstance()) LoggingFeature::getInstance()->flush(200);
+
         ESP.restart();
         vTaskDelete(nullptr);
     }
@@ -52,7 +63,7 @@ bool ResetManager::scheduleRestart(uint32_t delayMs, const char* reason) {
     BaseType_t ok = xTaskCreatePinnedToCore(
         restartTask,
         "restart",
-        2048,
+        4096,
         args,
         1,
         nullptr,
@@ -72,3 +83,7 @@ bool ResetManager::scheduleRestart(uint32_t delayMs, const char* reason) {
 bool ResetManager::isRestartScheduled() {
     return g_restartScheduled;
 }
+
+void ResetManager::onRestart(std::function<void()> callback) {
+    if (callback) g_restartCallbacks.push_back(std::move(callback));
+}
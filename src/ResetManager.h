@@ -2,6 +2,7 @@
 #define RESET_MANAGER_H
 
 #include <Arduino.h>
+#include <functional>
 
 class ResetManager {
 public:
@@ -10,6 +11,10 @@ public:
 
     // Returns true if a restart has been scheduled but not executed yet.
     static bool isRestartScheduled();
+
+    // Runs callback in the restart task right before the restart, before cached
+    // file writes are flushed. Register during setup().
+    static void onRestart(std::function<void()> callback);
 };
 
 #endif // RESET_MANAGER_H
@@ -0,0 +1,349 @@
+#define LOG_CATEGORY LogCategory::System
+
+#include "StallMonitor.h"
+#include "ResetDiagnostics.h"
+#include "StorageFeature.h"
+#include "Trace.h"
+#include "TimeUtils.h"
+#include "LoggingFeature.h"
+#include "WebServerFeature.h"
+#include "ApiEncoding.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <vector>
+
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+#include <esp_debug_helpers.h>
+#include <esp_private/freertos_debug.h>
+#include <xtensa_context.h>
+#define STALL_MONITOR_HAS_BACKTRACE 1
+#else
+#define STALL_MONITOR_HAS_BACKTRACE 0
+#endif
+
+namespace {
+    static constexpr uint32_t RTC_MAGIC = 0x53544C4C; // 'STLL'
+    static constexpr size_t MAX_QUEUES = 4;
+
+    struct QueueDepth {
+        char name[12];
+        uint32_t depth;
+    };
+
+    struct TraceEntry {
+        int32_t relUs;          // relative to the start of the stall
+        uint32_t arg;
+        char name[15];
+        uint8_t phase;          // Trace::Phase
+    };
+
+    // One report; kept in RTC memory so a reset during the stall doesn't lose it
+    struct Report {
+        uint32_t magic;
+        uint32_t bootCount;
+        uint32_t startUptimeMs;     // last check-in before the stall
+        uint32_t startUnix;         // 0 if time was not set
+        uint32_t durationMs;        // updated while the stall lasts
+        uint8_t ended;              // 0: still stalled, or reset during the stall
+        uint8_t persisted;          // written to flash
+        uint8_t backtraceDepth;
+        uint8_t queueCount;
+        uint8_t traceCount;
+        char phase[8];
+        char name[24];
+        uint32_t backtrace[STALL_MONITOR_BACKTRACE];
+        QueueDepth queues[MAX_QUEUES];
+        TraceEntry trace[STALL_MONITOR_TRACE_EVENTS];
+    };
+
+    RTC_NOINIT_ATTR Report s_rtc;
+
+    struct Queue {
+        const char* name;
+        std::function<size_t()> depth;
+    };
+
+    // Guards s_rtc and the stall state between loop and monitor task
+    portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+    std::vector<Queue> s_queues;
+    StorageFeature* s_storage = nullptr;
+    TaskHandle_t s_loopTask = nullptr;
+    TaskHandle_t s_monitorTask = nullptr;
+    volatile uint32_t s_lastCheckInMs = 0;
+    volatile bool s_armed = false;
+    volatile bool s_stalled = false;
+    volatile bool s_finished = false;   // a report waits for loop() to log and persist it
+    uint32_t s_stallCount = 0;
+    uint32_t s_flashWrites = 0;
+    uint32_t s_flashFailures = 0;
+
+    Report snapshot() {
+        Report r;
+        portENTER_CRITICAL(&s_mux);
+        memcpy(&r, &s_rtc, sizeof(r));
+        portEXIT_CRITICAL(&s_mux);
+        return r;
+    }
+
+#if STALL_MONITOR_HAS_BACKTRACE
+    uint32_t stackPc(uint32_t pc) {
+        // Return addresses carry the window increment in the top bits
+        if (pc & 0x80000000) pc = (pc & 0x3fffffff) | 0x40000000;
+        return pc - 3;
+    }
+
+    // Walks the saved stack of a suspended task
+    uint8_t backtrace(TaskHandle_t task, uint32_t* out, size_t max) {
+        TaskSnapshot_t snap;
+        if (!vTaskGetSnapshot(task, &snap) || !snap.pxTopOfStack) return 0;
+
+        esp_backtrace_frame_t frame;
+        const XtExcFrame* exc = (const XtExcFrame*)snap.pxTopOfStack;
+        if (exc->exit == 0) {
+            // Solicited frame: the task blocked or yielded itself
+            const XtSolFrame* sol = (const XtSolFrame*)snap.pxTopOfStack;
+            frame.pc = sol->pc;
+            frame.sp = sol->a1;
+            frame.next_pc = sol->a0;
+        } else {
+            frame.pc = exc->pc;
+            frame.sp = exc->a1;
+            frame.next_pc = exc->a0;
+        }
+        frame.exc_frame = nullptr;
+
+        uint8_t depth = 0;
+        out[depth++] = frame.pc;
+        while (depth < max && frame.next_pc != 0 && esp_backtrace_get_next_frame(&frame)) {
+            out[depth++] = stackPc(frame.pc);
+        }
+        return depth;
+    }
+#endif
+
+    // Runs in the monitor task while the loop task is stuck
+    void capture(uint32_t startMs, uint32_t nowMs) {
+        Report r;
+        memset(&r, 0, sizeof(r));
+        r.magic = RTC_MAGIC;
+        r.bootCount = ResetDiagnostics::bootCount();
+        r.startUptimeMs = startMs;
+        r.startUnix = TimeUtils::nowUnixSecondsOrZero();
+        if (r.startUnix != 0) r.startUnix -= (nowMs - startMs) / 1000;
+        r.durationMs = nowMs - startMs;
+        strlcpy(r.phase, ResetDiagnostics::breadcrumbPhase(), sizeof(r.phase));
+        strlcpy(r.name, ResetDiagnostics::breadcrumbName(), sizeof(r.name));
+
+        // Suspended, the loop task has a saved frame and can't change the queues
+        vTaskSuspend(s_loopTask);
+#if STALL_MONITOR_HAS_BACKTRACE
+        r.backtraceDepth = backtrace(s_loopTask, r.backtrace, STALL_MONITOR_BACKTRACE);
+#endif
+        for (const auto& q : s_queues) {
+            QueueDepth& d = r.queues[r.queueCount++];
+            strlcpy(d.name, q.name, sizeof(d.name));
+            d.depth = (uint32_t)q.depth();
+        }
+        vTaskResume(s_loopTask);
+
+        Trace::Event events[STALL_MONITOR_TRACE_EVENTS];
+        int64_t traceStartUs = 0;
+        const size_t n = Trace::recent(events, STALL_MONITOR_TRACE_EVENTS, traceStartUs);
+        const int64_t stallStartUs = esp_timer_get_time() - (int64_t)(nowMs - startMs) * 1000;
+        for (size_t i = 0; i < n; i++) {
+            TraceEntry& t = r.trace[r.traceCount++];
+            t.relUs = (int32_t)(traceStartUs + events[i].us - stallStartUs);
+            t.arg = events[i].arg;
+            strlcpy(t.name, events[i].name, sizeof(t.name));
+            t.phase = (uint8_t)events[i].phase;
+        }
+
+        portENTER_CRITICAL(&s_mux);
+        memcpy(&s_rtc, &r, sizeof(r));
+        portEXIT_CRITICAL(&s_mux);
+    }
+
+    void monitorTask(void*) {
+        for (;;) {
+            vTaskDelay(pdMS_TO_TICKS(STALL_MONITOR_CHECK_MS));
+            if (!s_armed) continue;
+
+            const uint32_t now = (uint32_t)millis();
+            const uint32_t last = s_lastCheckInMs;
+            if ((uint32_t)(now - last) < STALL_MONITOR_THRESHOLD_MS) continue;
+
+            if (!s_stalled) {
+                capture(last, now);
+                s_stallCount++;
+                s_stalled = true;
+                TRACE_INSTANT("loop.stall", now - last);
+            } else {
+                portENTER_CRITICAL(&s_mux);
+                s_rtc.durationMs = now - s_rtc.startUptimeMs;
+                portEXIT_CRITICAL(&s_mux);
+            }
+        }
+    }
+
+    void reportToJson(const Report& r, JsonObject obj) {
+        obj["bootCount"] = r.bootCount;
+        obj["uptimeMs"] = r.startUptimeMs;
+        if (r.startUnix != 0) obj["epoch"] = r.startUnix;
+        obj["durationMs"] = r.durationMs;
+        obj["ended"] = r.ended != 0;
+        obj["phase"] = r.phase;
+        obj["name"] = r.name;
+
+        JsonArray bt = obj["backtrace"].to<JsonArray>();
+        char pc[12];
+        for (uint8_t i = 0; i < r.backtraceDepth && i < STALL_MONITOR_BACKTRACE; i++) {
+            snprintf(pc, sizeof(pc), "0x%08lx", (unsigned long)r.backtrace[i]);
+            bt.add(pc);
+        }
+
+        JsonObject queues = obj["queues"].to<JsonObject>();
+        for (uint8_t i = 0; i < r.queueCount && i < MAX_QUEUES; i++) {
+            queues[r.queues[i].name] = r.queues[i].depth;
+        }
+
+        JsonArray trace = obj["trace"].to<JsonArray>();
+        static const char* const phases[] = {"B", "E", "i"};
+        for (uint8_t i = 0; i < r.traceCount && i < STALL_MONITOR_TRACE_EVENTS; i++) {
+            JsonObject t = trace.add<JsonObject>();
+            t["relUs"] = r.trace[i].relUs;
+            t["name"] = r.trace[i].name;
+            t["ph"] = phases[r.trace[i].phase % 3];
+            t["arg"] = r.trace[i].arg;
+        }
+    }
+
+    // Appends the RTC report to the flash history (newest last)
+    bool persist(const Report& r) {
+        if (!s_storage || !s_storage->isReady()) return false;
+
+        JsonDocument doc;
+        const String old = s_storage->readFile(STALL_MONITOR_PATH);
+        if (old.isEmpty() || deserializeJson(doc, old) || !doc.is<JsonArray>()) doc.to<JsonArray>();
+        JsonArray history = doc.as<JsonArray>();
+        while (history.size() >= STALL_MONITOR_HISTORY) history.remove(0);
+        reportToJson(r, history.add<JsonObject>());
+
+        String out;
+        serializeJson(doc, out);
+        if (!s_storage->writeFile(STALL_MONITOR_PATH, out)) {
+            s_flashFailures++;
+            LOG_E("Failed to write stall report %s", STALL_MONITOR_PATH);
+            return false;
+        }
+        s_flashWrites++;
+        return true;
+    }
+
+    void logReport(const Report& r) {
+        String bt;
+        for (uint8_t i = 0; i < r.backtraceDepth && i < STALL_MONITOR_BACKTRACE; i++) {
+            char pc[12];
+            snprintf(pc, sizeof(pc), " 0x%08lx", (unsigned long)r.backtrace[i]);
+            bt += pc;
+        }
+        LOG_W("Loop %s for %lu ms in %s/%s, backtrace:%s",
+              r.ended ? "stalled" : "was stalled at reset",
+              (unsigned long)r.durationMs, r.phase, r.name, bt.length() ? bt.c_str() : " n/a");
+    }
+}
+
+namespace StallMonitor {
+    void addQueue(const char* name, std::function<size_t()> depth) {
+        if (s_queues.size() >= MAX_QUEUES) {
+            LOG_W("Stall monitor: too many queues, %s ignored", name);
+            return;
+        }
+        s_queues.push_back({name, std::move(depth)});
+    }
+
+    void checkIn() {
+        const uint32_t now = (uint32_t)millis();
+        s_lastCheckInMs = now;
+        if (!s_armed) {
+            s_loopTask = xTaskGetCurrentTaskHandle();
+            s_armed = true;
+            return;
+        }
+        if (!s_stalled) return;
+
+        portENTER_CRITICAL(&s_mux);
+        s_rtc.durationMs = now - s_rtc.startUptimeMs;
+        s_rtc.ended = 1;
+        portEXIT_CRITICAL(&s_mux);
+        s_stalled = false;
+        s_finished = true;
+    }
+
+    void loop() {
+        if (!s_finished) return;
+        s_finished = false;
+
+        const Report r = snapshot();
+        logReport(r);
+        if (persist(r)) {
+            portENTER_CRITICAL(&s_mux);
+            s_rtc.persisted = 1;
+            portEXIT_CRITICAL(&s_mux);
+        }
+    }
+
+    uint32_t stallCount() {
+        return s_stallCount;
+    }
+
+    void toJson(JsonObject obj) {
+        obj["thresholdMs"] = (uint32_t)STALL_MONITOR_THRESHOLD_MS;
+        obj["armed"] = (bool)s_armed;
+        obj["stalled"] = (bool)s_stalled;
+        obj["stalls"] = s_stallCount;
+        obj["bootCount"] = ResetDiagnostics::bootCount();
+        obj["sinceCheckInMs"] = (uint32_t)((uint32_t)millis() - s_lastCheckInMs);
+        obj["flashWrites"] = s_flashWrites;
+        obj["flashFailures"] = s_flashFailures;
+
+        const Report r = snapshot();
+        if (r.magic == RTC_MAGIC) reportToJson(r, obj["last"].to<JsonObject>());
+
+        if (s_storage && s_storage->isReady()) {
+            JsonDocument history;
+            const String saved = s_storage->readFile(STALL_MONITOR_PATH);
+            if (!saved.isEmpty() && !deserializeJson(history, saved) && history.is<JsonArray>()) {
+                obj["history"] = history.as<JsonArray>();
+            }
+        }
+    }
+
+    void setup(WebServerFeature& server, StorageFeature& storage) {
+        s_storage = &storage;
+
+        if (s_rtc.magic != RTC_MAGIC) {
+            memset(&s_rtc, 0, sizeof(s_rtc));
+        } else {
+            s_rtc.phase[sizeof(s_rtc.phase) - 1] = '\0';
+            s_rtc.name[sizeof(s_rtc.name) - 1] = '\0';
+            for (auto& q : s_rtc.queues) q.name[sizeof(q.name) - 1] = '\0';
+            for (auto& t : s_rtc.trace) t.name[sizeof(t.name) - 1] = '\0';
+            // A report from before the last reset that did not make it to flash
+            if (!s_rtc.persisted) s_finished = true;
+        }
+
+        if (!s_monitorTask &&
+            xTaskCreatePinnedToCore(monitorTask, "stallMon", 3072, nullptr, 2, &s_monitorTask, tskNO_AFFINITY) != pdPASS) {
+            LOG_E("Stall monitor: task creation failed");
+        }
+
+        server.getServer()->on("/api/stalls", HTTP_GET, [&server](AsyncWebServerRequest* request) {
+            if (!server.authenticate(request)) return request->requestAuthentication();
+            JsonDocument doc;
+            toJson(doc.to<JsonObject>());
+            ApiEncoding::send(request, 200, doc);
+        });
+    }
+}
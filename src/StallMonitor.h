@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+
+class WebServerFeature;
+class StorageFeature;
+
+// The main loop is considered stalled if it did not check in for this long
+#ifndef STALL_MONITOR_THRESHOLD_MS
+#define STALL_MONITOR_THRESHOLD_MS 3000
+#endif
+
+#ifndef STALL_MONITOR_CHECK_MS
+#define STALL_MONITOR_CHECK_MS 250
+#endif
+
+// Captured per stall: backtrace depth and newest trace events
+#ifndef STALL_MONITOR_BACKTRACE
+#define STALL_MONITOR_BACKTRACE 16
+#endif
+
+#ifndef STALL_MONITOR_TRACE_EVENTS
+#define STALL_MONITOR_TRACE_EVENTS 16
+#endif
+
+// Stall reports kept in flash
+#ifndef STALL_MONITOR_HISTORY
+#define STALL_MONITOR_HISTORY 8
+#endif
+
+#ifndef STALL_MONITOR_PATH
+#define STALL_MONITOR_PATH "/diag/stalls.json"
+#endif
+
+/**
+ * Main loop stall watchdog.
+ *
+ * A separate task checks that loop() called checkIn() within
+ * STALL_MONITOR_THRESHOLD_MS. If not, it briefly suspends the loop task and
+ * records a report into RTC memory: the ResetDiagnostics breadcrumb, the
+ * loop task's backtrace, registered queue depths and the newest events of a
+ * running Trace capture. The duration is updated until the loop checks in
+ * again, so a report also survives a watchdog reset during the stall.
+ *
+ * Finished reports (and one left in RTC memory by a reset) are logged and
+ * appended to STALL_MONITOR_PATH from loop(), never from the monitor task.
+ *
+ * Usage:
+ *   In setup(): StallMonitor::addQueue("modbus", [] { return modbus.getQueuedRequestCount(); });
+ *               StallMonitor::setup(webServer, storage);
+ *   At the start of loop(): StallMonitor::checkIn();
+ *   In loop(): StallMonitor::loop();
+ */
+namespace StallMonitor {
+    // Queue depth to include in reports; call before setup()
+    void addQueue(const char* name, std::function<size_t()> depth);
+
+    // Tell the monitor that the loop is alive; arms it on the first call
+    void checkIn();
+
+    // Logs and persists finished reports; call from loop()
+    void loop();
+
+    // Number of stalls detected since boot
+    uint32_t stallCount();
+
+    void toJson(JsonObject obj);
+
+    // Starts the monitor task; GET /api/stalls
+    void setup(WebServerFeature& server, StorageFeature& storage);
+}
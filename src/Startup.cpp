@@ -0,0 +1,278 @@
+#define LOG_CATEGORY LogCategory::System
+
+#include "Startup.h"
+#include "LoopScheduler.h"
+#include "ResetDiagnostics.h"
+#include "InfluxLineProtocol.h"
+#include "LoggingFeature.h"
+#include "WebServerFeature.h"
+#include "ApiEncoding.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+
+namespace {
+    static constexpr size_t MAX_CONDITIONS = 8;
+
+    enum class State : uint8_t {
+        Pending,        // waiting for its conditions (or retried)
+        Running,        // setup() in a helper task
+        Finished,       // helper task done, not yet reported
+        Done
+    };
+
+    struct StepSlot {
+        const char* name;
+        uint8_t needs;
+        Startup::Step step;
+        Feature* feature;
+        bool background;
+        std::atomic<State> state;
+        uint32_t startMs;
+        uint32_t doneMs;
+    };
+
+    struct Milestone {
+        const char* name;
+        Startup::Condition reached;
+        uint32_t ms;            // 0: not reached yet
+    };
+
+    Startup::Condition s_conditions[MAX_CONDITIONS] = {};
+    StepSlot s_steps[STARTUP_MAX_STEPS];
+    size_t s_stepCount = 0;
+    Milestone s_milestones[STARTUP_MAX_MILESTONES];
+    size_t s_milestoneCount = 0;
+    void (*s_featureHook)(Feature*) = nullptr;
+    bool s_done = false;
+    uint32_t s_doneMs = 0;
+
+    bool needsMet(uint8_t needs) {
+        for (size_t bit = 0; bit < MAX_CONDITIONS; bit++) {
+            if (!(needs & (1u << bit))) continue;
+            if (!s_conditions[bit] || !s_conditions[bit]()) return false;
+        }
+        return true;
+    }
+
+    StepSlot* addSlot(const char* name, uint8_t needs) {
+        if (s_stepCount >= STARTUP_MAX_STEPS) {
+            LOG_E("Startup: no slot left for %s", name);
+            return nullptr;
+        }
+        StepSlot& slot = s_steps[s_stepCount++];
+        slot.name = name;
+        slot.needs = needs;
+        slot.step = nullptr;
+        slot.feature = nullptr;
+        slot.background = false;
+        slot.state = State::Pending;
+        slot.startMs = 0;
+        slot.doneMs = 0;
+        s_done = false;
+        return &slot;
+    }
+
+    void setupTask(void* arg) {
+        StepSlot& slot = *static_cast<StepSlot*>(arg);
+        slot.feature->setup();
+        slot.doneMs = (uint32_t)millis();
+        slot.state = State::Finished;
+        LoopScheduler::wake();
+        vTaskDelete(nullptr);
+    }
+
+    void complete(StepSlot& slot) {
+        slot.state = State::Done;
+        LOG_I("Startup: %s ready after %lu ms (%lu ms in setup)", slot.name,
+              (unsigned long)slot.doneMs, (unsigned long)(slot.doneMs - slot.startMs));
+        if (slot.feature && s_featureHook) s_featureHook(slot.feature);
+    }
+
+    // Runs a step in the loop task; true if it is done
+    bool start(StepSlot& slot) {
+        ResetDiagnostics::setBreadcrumb("setup", slot.name);
+        if (!slot.startMs) slot.startMs = (uint32_t)millis();
+
+        if (slot.background) {
+            slot.state = State::Running;
+            if (xTaskCreatePinnedToCore(setupTask, slot.name, STARTUP_TASK_STACK, &slot, 1,
+                                        nullptr, tskNO_AFFINITY) == pdPASS) {
+                return false;
+            }
+            LOG_W("Startup: helper task for %s failed, setting up in the loop task", slot.name);
+            slot.background = false;
+        }
+
+        if (slot.feature) {
+            slot.feature->setup();
+        } else if (!slot.step()) {
+            slot.state = State::Pending;
+            return false;
+        }
+        slot.doneMs = (uint32_t)millis();
+        complete(slot);
+        return true;
+    }
+
+    const char* stateName(State state) {
+        switch (state) {
+            case State::Pending: return "pending";
+            case State::Running: return "running";
+            case State::Finished:
+            case State::Done: return "done";
+        }
+        return "?";
+    }
+}
+
+namespace Startup {
+    void setCondition(uint8_t need, Condition isMet) {
+        for (size_t bit = 0; bit < MAX_CONDITIONS; bit++) {
+            if (need & (1u << bit)) s_conditions[bit] = isMet;
+        }
+    }
+
+    void addFeature(Feature* feature) {
+        StepSlot* slot = addSlot(feature->getName(), feature->dependencies());
+        if (!slot) {
+            feature->setup();
+            return;
+        }
+        slot->feature = feature;
+        slot->background = feature->setupBlocks();
+    }
+
+    void add(const char* name, uint8_t needs, Step step) {
+        StepSlot* slot = addSlot(name, needs);
+        if (!slot) {
+            step();
+            return;
+        }
+        slot->step = step;
+    }
+
+    void onFeatureReady(void (*hook)(Feature* feature)) {
+        s_featureHook = hook;
+    }
+
+    void addMilestone(const char* name, Condition reached) {
+        if (s_milestoneCount >= STARTUP_MAX_MILESTONES) return;
+        s_milestones[s_milestoneCount++] = Milestone{name, reached, 0};
+    }
+
+    bool run() {
+        if (s_done) return true;
+
+        // A step that becomes done can satisfy a later one in the same pass
+        bool progress = true;
+        while (progress) {
+            progress = false;
+            for (size_t i = 0; i < s_stepCount; i++) {
+                StepSlot& slot = s_steps[i];
+                const State state = slot.state;
+                if (state == State::Finished) {
+                    complete(slot);
+                    progress = true;
+                } else if (state == State::Pending && needsMet(slot.needs)) {
+                    progress |= start(slot);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < s_stepCount; i++) {
+            if (s_steps[i].state != State::Done) return false;
+        }
+        s_done = true;
+        s_doneMs = (uint32_t)millis();
+        LOG_I("Startup: all %u steps done after %lu ms", (unsigned)s_stepCount, (unsigned long)s_doneMs);
+        return true;
+    }
+
+    void loop() {
+        run();
+
+        for (size_t i = 0; i < s_milestoneCount; i++) {
+            Milestone& m = s_milestones[i];
+            if (m.ms || !m.reached()) continue;
+            m.ms = (uint32_t)millis();
+            LOG_I("Startup: %s after %lu ms", m.name, (unsigned long)m.ms);
+        }
+    }
+
+    bool isDone() {
+        return s_done;
+    }
+
+    bool isSetUp(const Feature* feature) {
+        if (s_done) return true;
+        for (size_t i = 0; i < s_stepCount; i++) {
+            if (s_steps[i].feature == feature) return s_steps[i].state == State::Done;
+        }
+        return true;
+    }
+
+    bool milestonesReached() {
+        for (size_t i = 0; i < s_milestoneCount; i++) {
+            if (!s_milestones[i].ms) return false;
+        }
+        return true;
+    }
+
+    void setup(WebServerFeature& server) {
+        server.getServer()->on("/api/startup", HTTP_GET, [&server](AsyncWebServerRequest* request) {
+            if (!server.authenticate(request)) return request->requestAuthentication();
+            JsonDocument doc;
+            toJson(doc.to<JsonObject>());
+            ApiEncoding::send(request, 200, doc);
+        });
+    }
+
+    void toJson(JsonObject obj) {
+        obj["done"] = s_done;
+        if (s_done) obj["doneMs"] = s_doneMs;
+
+        JsonArray steps = obj["steps"].to<JsonArray>();
+        for (size_t i = 0; i < s_stepCount; i++) {
+            const StepSlot& slot = s_steps[i];
+            const State state = slot.state;
+            JsonObject o = steps.add<JsonObject>();
+            o["name"] = slot.name;
+            o["needs"] = slot.needs;
+            o["background"] = slot.background;
+            o["state"] = stateName(state);
+            if (slot.startMs) o["startMs"] = slot.startMs;
+            if (state == State::Done || state == State::Finished) o["doneMs"] = slot.doneMs;
+        }
+
+        JsonObject milestones = obj["milestones"].to<JsonObject>();
+        for (size_t i = 0; i < s_milestoneCount; i++) {
+            const Milestone& m = s_milestones[i];
+            if (m.ms) {
+                milestones[m.name] = m.ms;
+            } else {
+                milestones[m.name] = nullptr;
+            }
+        }
+    }
+
+    String toLineProtocol(const char* deviceId) {
+        // Format: startup,device=id setup_ms=Ni,<milestone>_ms=Ni,...
+        String line = "startup,device=";
+        line += InfluxLineProtocol::escapeTag(deviceId);
+        line += " setup_ms=";
+        line += s_doneMs;
+        line += "i";
+        for (size_t i = 0; i < s_milestoneCount; i++) {
+            const Milestone& m = s_milestones[i];
+            if (!m.ms) continue;
+            line += ",";
+            line += m.name;
+            line += "_ms=";
+            line += m.ms;
+            line += "i";
+        }
+        line += "\n";
+        return line;
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "Feature.h"
+
+class WebServerFeature;
+
+#ifndef STARTUP_MAX_STEPS
+#define STARTUP_MAX_STEPS 32
+#endif
+
+#ifndef STARTUP_MAX_MILESTONES
+#define STARTUP_MAX_MILESTONES 8
+#endif
+
+// Stack of the helper task running a Feature::setupBlocks() setup
+#ifndef STARTUP_TASK_STACK
+#define STARTUP_TASK_STACK 8192
+#endif
+
+/**
+ * Dependency-aware startup.
+ *
+ * Feature setups and the other init steps of main.cpp are registered with
+ * the readiness conditions they need (Feature::Needs). run() starts every
+ * step whose conditions hold, in registration order, and keeps the others
+ * for a later pass, so e.g. Modbus polls as soon as storage and the UART
+ * are up instead of after the WiFi connection. A feature whose setup()
+ * blocks (Feature::setupBlocks()) is set up in a helper task meanwhile.
+ *
+ * Milestones (first Modbus poll, first upload, ...) are timed once per boot
+ * from power-on and logged; /api/startup shows steps and milestones.
+ *
+ * Usage:
+ *   In setup(): Startup::setCondition(Feature::NEEDS_STORAGE, [] { return storage.isReady(); });
+ *               Startup::addFeature(&storage);
+ *               Startup::add("modbusDevices", Feature::NEEDS_STORAGE, [] { ...; return true; });
+ *               Startup::addMilestone("firstPoll", [] { return ...; });
+ *               Startup::run();
+ *   In loop():  Startup::loop(); and skip features with !Startup::isSetUp(feature)
+ */
+namespace Startup {
+    // Returns true when the condition is met
+    using Condition = bool (*)();
+
+    // Returns false to be retried on the next pass
+    using Step = bool (*)();
+
+    // Predicate of a single Feature::Needs bit
+    void setCondition(uint8_t need, Condition isMet);
+
+    // Runs feature->setup() once its dependencies() are met
+    void addFeature(Feature* feature);
+
+    void add(const char* name, uint8_t needs, Step step);
+
+    // Called in the loop task after a feature's setup() completed
+    void onFeatureReady(void (*hook)(Feature* feature));
+
+    // Timed the first time reached() returns true
+    void addMilestone(const char* name, Condition reached);
+
+    // Starts what is ready; true once all steps are done
+    bool run();
+
+    // run() while steps are pending, then checks the milestones
+    void loop();
+
+    bool isDone();
+    bool isSetUp(const Feature* feature);
+    bool milestonesReached();
+
+    // Registers GET /api/startup
+    void setup(WebServerFeature& server);
+
+    void toJson(JsonObject obj);
+
+    // startup,device=id setup_ms=Ni,<milestone>_ms=Ni,... (reached milestones only)
+    String toLineProtocol(const char* deviceId);
+}
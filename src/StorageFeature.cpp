@@ -1,22 +1,54 @@
+#define LOG_CATEGORY LogCategory::Storage
+
 #include "StorageFeature.h"
 #include "LoggingFeature.h"
+#include "LoopScheduler.h"
+#include "MutexLock.h"
 #include <ArduinoJson.h>
+#include <esp_rom_crc.h>
+#include <vector>
+
+StorageFeature* StorageFeature::_instance = nullptr;
+LatencyHistogram StorageFeature::_latency[(size_t)FsOp::Count];
+uint64_t StorageFeature::_bytesRead = 0;
+uint64_t StorageFeature::_bytesWritten = 0;
+
+void StorageFeature::recordOp(FsOp op, uint32_t startUs, size_t bytes) {
+    _latency[(size_t)op].record((uint32_t)micros() - startUs);
+    if (bytes == 0) return;
+    // 64 bit counters are not atomic on this CPU; a rare lost update is acceptable
+    if (op == FsOp::Read) _bytesRead += bytes;
+    else if (op == FsOp::Write) _bytesWritten += bytes;
+}
+
+const char* StorageFeature::opName(FsOp op) {
+    static const char* const NAMES[] = {"open", "read", "write", "sync", "rename", "remove"};
+    return (size_t)op < (size_t)FsOp::Count ? NAMES[(size_t)op] : "unknown";
+}
 
 StorageFeature::StorageFeature(bool formatOnFail)
     : _formatOnFail(formatOnFail)
     , _mounted(false)
+    , _writeBackMs(STORAGE_WRITE_BACK_MS)
+    , _benchRunning(false)
+    , _benchSize(0)
+    , _mutex(nullptr)
 {
+    _instance = this;
 }
 
 void StorageFeature::setup() {
     if (_mounted) return;
     
+    if (!_mutex) _mutex = xSemaphoreCreateRecursiveMutex();
+
     LOG_I("Mounting LittleFS filesystem...");
     
     if (LittleFS.begin(false)) {
         _mounted = true;
         LOG_I("LittleFS mounted. Total: %u bytes, Used: %u bytes", 
               totalBytes(), usedBytes());
+        recoverInterruptedWrites("/");
     } else if (_formatOnFail) {
         LOG_W("LittleFS mount failed, formatting...");
         if (LittleFS.format()) {
@@ -34,13 +66,299 @@ void StorageFeature::setup() {
     }
 }
 
-bool StorageFeature::writeFile(const char* path, const String& content) {
-    if (!_mounted) {
-        LOG_E("Storage not mounted");
+void StorageFeature::recoverInterruptedWrites(const char* dir) {
+    File root = LittleFS.open(dir);
+    if (!root || !root.isDirectory()) return;
+
+    std::vector<String> subdirs;
+    std::vector<String> leftovers;
+    for (File file = root.openNextFile(); file; file = root.openNextFile()) {
+        const String path = file.path();
+        if (file.isDirectory()) {
+            subdirs.push_back(path);
+        } else if (path.endsWith(TMP_SUFFIX) || path.endsWith(BACKUP_SUFFIX)) {
+            leftovers.push_back(path);
+        }
+    }
+    root.close();
+
+    for (const String& path : leftovers) {
+        if (path.endsWith(TMP_SUFFIX)) {
+            // An atomic write that never completed; the target is untouched
+            LittleFS.remove(path.c_str());
+            LOG_W("Removed incomplete %s", path.c_str());
+            continue;
+        }
+        // Reset during replaceViaBackup(): restore the old file if the new one isn't there
+        const String target = path.substring(0, path.length() - strlen(BACKUP_SUFFIX));
+        if (!LittleFS.exists(target.c_str()) && LittleFS.rename(path.c_str(), target.c_str())) {
+            LOG_W("Restored %s from its backup", target.c_str());
+        } else {
+            LittleFS.remove(path.c_str());
+        }
+    }
+    for (const String& subdir : subdirs) recoverInterruptedWrites(subdir.c_str());
+}
+
+uint32_t StorageFeature::dueInMs() {
+    if (!_mounted) return NOT_DUE;
+
+    RecursiveMutexLock lock(_mutex);
+    const uint32_t now = millis();
+    uint32_t due = NOT_DUE;
+    for (const auto& entry : _pending) {
+        const int32_t left = (int32_t)(entry.second.dueMs - now);
+        if (left <= 0) return 0;
+        if ((uint32_t)left < due) due = (uint32_t)left;
+    }
+    return due;
+}
+
+void StorageFeature::loop() {
+    if (!_mounted) return;
+
+    // At most one file per call, so a burst of due writes doesn't stall the loop
+    RecursiveMutexLock lock(_mutex);
+    const uint32_t now = millis();
+    for (auto& entry : _pending) {
+        if ((int32_t)(now - entry.second.dueMs) >= 0) {
+            flushLocked(entry.first.c_str());
+            break;
+        }
+    }
+}
+
+StorageFeature::Reader::Reader()
+    : _pos(0)
+    , _len(0)
+    , _end(0)
+{
+    setTimeout(0);
+}
+
+StorageFeature::Reader::Reader(File file)
+    : _file(file)
+    , _pos(0)
+    , _len(0)
+    , _end(file ? file.size() : 0)
+{
+    setTimeout(0);
+}
+
+bool StorageFeature::Reader::fill() {
+    if (!_file) return false;
+    const size_t at = _file.position();
+    _pos = 0;
+    if (at >= _end) {
+        _len = 0;
         return false;
     }
+    const uint32_t t0 = micros();
+    _len = _file.read(_buf, std::min(sizeof(_buf), _end - at));
+    recordOp(FsOp::Read, t0, _len);
+    return _len > 0;
+}
+
+bool StorageFeature::Reader::verifyFooter() {
+    const size_t size = _file.size();
+    Footer footer;
+    if (size < sizeof(footer) || !_file.seek(size - sizeof(footer)) ||
+        _file.read((uint8_t*)&footer, sizeof(footer)) != sizeof(footer) ||
+        footer.magic != FOOTER_MAGIC) {
+        return seek(0);  // plain file
+    }
 
-    // Ensure parent directories exist
+    _end = size - sizeof(footer);
+    seek(0);
+    uint32_t crc = 0;
+    while (fill()) crc = esp_rom_crc32_le(crc, _buf, _len);
+    seek(0);
+    return crc == footer.crc;
+}
+
+size_t StorageFeature::Reader::read(uint8_t* buffer, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        if (_pos < _len) {
+            const size_t n = std::min(len - done, _len - _pos);
+            memcpy(buffer + done, _buf + _pos, n);
+            _pos += n;
+            done += n;
+        } else if (len - done >= sizeof(_buf)) {
+            // Large reads bypass the buffer
+            if (!_file) break;
+            const size_t at = _file.position();
+            if (at >= _end) break;
+            const uint32_t t0 = micros();
+            const size_t n = _file.read(buffer + done, std::min(len - done, _end - at));
+            recordOp(FsOp::Read, t0, n);
+            if (n == 0) break;
+            done += n;
+        } else if (!fill()) {
+            break;
+        }
+    }
+    return done;
+}
+
+int StorageFeature::Reader::available() {
+    if (!_file) return 0;
+    return (int)(_end - position());
+}
+
+int StorageFeature::Reader::read() {
+    if (_pos >= _len && !fill()) return -1;
+    return _buf[_pos++];
+}
+
+int StorageFeature::Reader::peek() {
+    if (_pos >= _len && !fill()) return -1;
+    return _buf[_pos];
+}
+
+size_t StorageFeature::Reader::position() const {
+    if (!_file) return 0;
+    return _file.position() - (_len - _pos);
+}
+
+bool StorageFeature::Reader::seek(size_t pos) {
+    _pos = _len = 0;
+    return _file && pos <= _end && _file.seek(pos);
+}
+
+void StorageFeature::Reader::close() {
+    _pos = _len = 0;
+    if (_file) _file.close();
+}
+
+StorageFeature::Writer::Writer()
+    : _len(0)
+    , _written(0)
+    , _crc(0)
+    , _checksum(false)
+    , _append(false)
+    , _failed(false)
+{
+}
+
+StorageFeature::Writer::Writer(File file, const char* path, const String& tmpPath, bool checksum, bool append)
+    : _file(file)
+    , _path(path)
+    , _tmpPath(tmpPath)
+    , _len(0)
+    , _written(0)
+    , _crc(0)
+    , _checksum(checksum)
+    , _append(append)
+    , _failed(false)
+{
+}
+
+bool StorageFeature::Writer::flushBuffer() {
+    if (_len == 0) return true;
+    const uint32_t t0 = micros();
+    const size_t n = _file.write(_buf, _len);
+    recordOp(FsOp::Write, t0, n);
+    if (n != _len) _failed = true;
+    _len = 0;
+    return !_failed;
+}
+
+size_t StorageFeature::Writer::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t StorageFeature::Writer::write(const uint8_t* buffer, size_t size) {
+    if (!_file || _failed) return 0;
+    if (_checksum) _crc = esp_rom_crc32_le(_crc, buffer, size);
+    if (_len + size > sizeof(_buf)) {
+        if (!flushBuffer()) return 0;
+        // Large writes bypass the buffer
+        if (size >= sizeof(_buf)) {
+            const uint32_t t0 = micros();
+            const size_t n = _file.write(buffer, size);
+            recordOp(FsOp::Write, t0, n);
+            _written += n;
+            if (n != size) _failed = true;
+            return n;
+        }
+    }
+    memcpy(_buf + _len, buffer, size);
+    _len += size;
+    _written += size;
+    return size;
+}
+
+bool StorageFeature::Writer::close() {
+    if (!_file) return !_failed;
+    flushBuffer();
+    if (_checksum && !_failed) {
+        const Footer footer{FOOTER_MAGIC, _crc};
+        if (_file.write((const uint8_t*)&footer, sizeof(footer)) != sizeof(footer)) _failed = true;
+    }
+    const uint32_t t0 = micros();
+    _file.flush();
+    _file.close();
+    recordOp(FsOp::Sync, t0);
+
+    if (_failed) {
+        LOG_E("Write incomplete: %s (%u bytes)", _path.c_str(), _written);
+        abort();
+        return false;
+    }
+
+    if (_tmpPath.length() > 0) {
+        // LittleFS renames atomically: readers see the old or the new file, never a mix
+        const uint32_t t0 = micros();
+        const bool renamed = LittleFS.rename(_tmpPath.c_str(), _path.c_str());
+        recordOp(FsOp::Rename, t0);
+        if (!renamed && !replaceViaBackup()) {
+            LOG_E("Failed to replace %s", _path.c_str());
+            _failed = true;
+            abort();
+            return false;
+        }
+        _tmpPath = "";
+    }
+    return true;
+}
+
+bool StorageFeature::Writer::replaceViaBackup() {
+    // The old file moves aside first and is only removed once the new one is
+    // in place; setup() finishes or undoes this after a reset in between
+    if (!LittleFS.exists(_path.c_str())) return LittleFS.rename(_tmpPath.c_str(), _path.c_str());
+    const String backup = _path + BACKUP_SUFFIX;
+    LittleFS.remove(backup.c_str());
+    if (!LittleFS.rename(_path.c_str(), backup.c_str())) return false;
+    if (!LittleFS.rename(_tmpPath.c_str(), _path.c_str())) {
+        LittleFS.rename(backup.c_str(), _path.c_str());
+        return false;
+    }
+    LittleFS.remove(backup.c_str());
+    return true;
+}
+
+void StorageFeature::Writer::abort() {
+    _len = 0;
+    if (_file) _file.close();
+    if (_append) {
+        // The existing content stays; only the bytes appended so far are kept with it
+        if (_path.length() > 0) LOG_W("Append to %s aborted after %u bytes", _path.c_str(), _written);
+        _path = "";
+        return;
+    }
+    // Written in place: the partial file is all there is. Atomic: the target is untouched.
+    const String& partial = _tmpPath.length() > 0 ? _tmpPath : _path;
+    if (partial.length() == 0) return;
+    const uint32_t t0 = micros();
+    LittleFS.remove(partial.c_str());
+    recordOp(FsOp::Remove, t0);
+    LOG_D("Removed partial file %s", partial.c_str());
+    _tmpPath = "";
+    _path = "";
+}
+
+bool StorageFeature::ensureParentDir(const char* path) {
     String p = String(path);
     int lastSlash = p.lastIndexOf('/');
     if (lastSlash > 0) {
@@ -53,24 +371,221 @@ bool StorageFeature::writeFile(const char* path, const String& content) {
             }
         }
     }
+    return true;
+}
 
-    File file = LittleFS.open(path, "w");
-    if (!file) {
-        LOG_E("Failed to open file for writing: %s", path);
+bool StorageFeature::writeFile(const char* path, const String& content) {
+    if (!_mounted) {
+        LOG_E("Storage not mounted");
         return false;
     }
 
-    size_t written = file.print(content);
-    file.close();
+    if (_writeBackMs == 0) {
+        RecursiveMutexLock lock(_mutex);
+        _pending.erase(path);
+        return commitFile(path, content);
+    }
 
-    if (written != content.length()) {
-        LOG_E("Write incomplete: %s (%u/%u bytes)", path, written, content.length());
+    // Keep the first due time: a path rewritten more often than the delay
+    // is still written once per window instead of never
+    RecursiveMutexLock lock(_mutex);
+    auto it = _pending.find(path);
+    if (it == _pending.end()) {
+        _pending[path] = PendingWrite{content, (uint32_t)millis() + _writeBackMs};
+    } else {
+        it->second.content = content;
+        _stats.coalesced++;
+    }
+    return true;
+}
+
+bool StorageFeature::commitFile(const char* path, const String& content) {
+    Writer writer = openWriter(path, WRITE_ATOMIC | WRITE_CHECKSUM);
+    if (!writer) {
+        _stats.failures++;
+        return false;
+    }
+    writer.write((const uint8_t*)content.c_str(), content.length());
+    if (!writer.close()) {
+        _stats.failures++;
         return false;
     }
 
-    LOG_D("Wrote %u bytes to %s", written, path);
+    _stats.commits++;
+    _stats.bytes += content.length() + sizeof(Footer);
+    LOG_D("Wrote %u bytes to %s", content.length(), path);
     return true;
-} 
+}
+
+bool StorageFeature::flushLocked(const char* path) {
+    auto it = _pending.find(path);
+    if (it == _pending.end()) return true;
+    // path may be the map key (loop()): copy it before the entry goes
+    const String target = it->first;
+    const String content = std::move(it->second.content);
+    _pending.erase(it);
+    return commitFile(target.c_str(), content);
+}
+
+bool StorageFeature::flush(const char* path) {
+    if (!_mounted) return false;
+
+    RecursiveMutexLock lock(_mutex);
+    if (path) return flushLocked(path);
+
+    bool ok = true;
+    while (!_pending.empty()) {
+        const String first = _pending.begin()->first;
+        ok = flushLocked(first.c_str()) && ok;
+    }
+    return ok;
+}
+
+StorageFeature::WriteBackStats StorageFeature::getWriteBackStats() {
+    RecursiveMutexLock lock(_mutex);
+    WriteBackStats stats = _stats;
+    stats.pending = _pending.size();
+    return stats;
+}
+
+bool StorageFeature::startBenchmark(size_t sizeBytes) {
+    if (!_mounted || _benchRunning) return false;
+
+    _benchRunning = true;
+    _benchSize = sizeBytes;
+    if (xTaskCreate(benchmarkTask, "fsBench", 4096, this, 1, nullptr) != pdPASS) {
+        LOG_E("Failed to start filesystem benchmark task");
+        _benchRunning = false;
+        return false;
+    }
+    return true;
+}
+
+StorageFeature::BenchmarkResult StorageFeature::getBenchmarkResult() {
+    RecursiveMutexLock lock(_mutex);
+    return _bench;
+}
+
+void StorageFeature::benchmarkTask(void* param) {
+    StorageFeature* self = static_cast<StorageFeature*>(param);
+    self->runBenchmark(self->_benchSize);
+    self->_benchRunning = false;
+    vTaskDelete(nullptr);
+}
+
+void StorageFeature::runBenchmark(size_t sizeBytes) {
+    static const char* DIR = "/.perf";
+    static const char* SEQ = "/.perf/seq.bin";
+    static const char* SMALL = "/.perf/small.bin";
+    static const char* SMALL_TMP = "/.perf/small.bin.tmp";
+
+    BenchmarkResult r;
+    r.sizeBytes = sizeBytes;
+    const uint32_t startMs = millis();
+    uint8_t buf[STORAGE_CHUNK_SIZE];
+    for (size_t i = 0; i < sizeof(buf); i++) buf[i] = (uint8_t)i;
+
+    LOG_I("Filesystem benchmark started (%u bytes)", sizeBytes);
+    auto finish = [&](const char* error) {
+        LittleFS.remove(SEQ);
+        LittleFS.remove(SMALL);
+        LittleFS.remove(SMALL_TMP);
+        LittleFS.rmdir(DIR);
+        if (error) strlcpy(r.error, error, sizeof(r.error));
+        r.valid = error == nullptr;
+        r.durationMs = millis() - startMs;
+        RecursiveMutexLock lock(_mutex);
+        _bench = r;
+    };
+
+    if (freeBytes() < sizeBytes * 2 + 16384) return finish("not enough free space");
+    if (!LittleFS.exists(DIR) && !LittleFS.mkdir(DIR)) return finish("mkdir failed");
+
+    // Sequential write, including the final sync
+    uint32_t t0 = micros();
+    File f = LittleFS.open(SEQ, "w");
+    if (!f) return finish("open failed");
+    for (size_t done = 0; done < sizeBytes; done += sizeof(buf)) {
+        const size_t n = std::min(sizeof(buf), sizeBytes - done);
+        if (f.write(buf, n) != n) {
+            f.close();
+            return finish("write failed");
+        }
+    }
+    f.flush();
+    f.close();
+    uint32_t us = micros() - t0;
+    r.seqWriteKBps = us ? (uint32_t)((uint64_t)sizeBytes * 1000000 / 1024 / us) : 0;
+
+    // Sequential read
+    t0 = micros();
+    f = LittleFS.open(SEQ, "r");
+    if (!f) return finish("open failed");
+    size_t total = 0;
+    size_t n;
+    while ((n = f.read(buf, sizeof(buf))) > 0) total += n;
+    us = micros() - t0;
+    if (total != sizeBytes) {
+        f.close();
+        return finish("read back size mismatch");
+    }
+    r.seqReadKBps = us ? (uint32_t)((uint64_t)sizeBytes * 1000000 / 1024 / us) : 0;
+
+    // Random reads
+    static constexpr int RANDOM_READS = 64;
+    uint64_t sumUs = 0;
+    for (int i = 0; i < RANDOM_READS; i++) {
+        const size_t offset = (esp_random() % (sizeBytes - 256)) & ~(size_t)3;
+        t0 = micros();
+        f.seek(offset);
+        f.read(buf, 256);
+        us = micros() - t0;
+        sumUs += us;
+        if (us > r.randomReadMaxUs) r.randomReadMaxUs = us;
+    }
+    f.close();
+    r.randomReadAvgUs = (uint32_t)(sumUs / RANDOM_READS);
+
+    // Small appends, each flushed to flash
+    static constexpr int APPENDS = 32;
+    f = LittleFS.open(SMALL, "a");
+    if (!f) return finish("open failed");
+    sumUs = 0;
+    for (int i = 0; i < APPENDS; i++) {
+        t0 = micros();
+        f.write(buf, 32);
+        f.flush();
+        us = micros() - t0;
+        sumUs += us;
+        if (us > r.appendMaxUs) r.appendMaxUs = us;
+    }
+    f.close();
+    r.appendAvgUs = (uint32_t)(sumUs / APPENDS);
+
+    // Small atomic replaces
+    static constexpr int REPLACES = 16;
+    sumUs = 0;
+    for (int i = 0; i < REPLACES; i++) {
+        t0 = micros();
+        f = LittleFS.open(SMALL_TMP, "w");
+        if (!f) return finish("open failed");
+        f.write(buf, 128);
+        f.flush();
+        f.close();
+        if (!LittleFS.rename(SMALL_TMP, SMALL) &&
+            !(LittleFS.remove(SMALL) && LittleFS.rename(SMALL_TMP, SMALL))) {
+            return finish("rename failed");
+        }
+        us = micros() - t0;
+        sumUs += us;
+        if (us > r.replaceMaxUs) r.replaceMaxUs = us;
+    }
+    r.replaceAvgUs = (uint32_t)(sumUs / REPLACES);
+
+    finish(nullptr);
+    LOG_I("Filesystem benchmark: write %u KB/s, read %u KB/s, append %u us, replace %u us",
+          r.seqWriteKBps, r.seqReadKBps, r.appendAvgUs, r.replaceAvgUs);
+}
 
 bool StorageFeature::appendFile(const char* path, const String& content) {
     if (!_mounted) {
@@ -78,27 +593,23 @@ bool StorageFeature::appendFile(const char* path, const String& content) {
         return false;
     }
 
-    // Ensure parent directories exist
-    String p = String(path);
-    int lastSlash = p.lastIndexOf('/');
-    if (lastSlash > 0) {
-        String parent = p.substring(0, lastSlash);
-        if (!LittleFS.exists(parent.c_str())) {
-            if (!mkdir(parent.c_str())) {
-                LOG_E("Failed to create parent directory: %s", parent.c_str());
-                return false;
-            }
-        }
-    }
+    flush(path);
+    if (!ensureParentDir(path)) return false;
 
+    uint32_t t0 = micros();
     File file = LittleFS.open(path, "a");
+    recordOp(FsOp::Open, t0);
     if (!file) {
         LOG_E("Failed to open file for appending: %s", path);
         return false;
     }
 
+    t0 = micros();
     size_t written = file.print(content);
+    recordOp(FsOp::Write, t0, written);
+    t0 = micros();
     file.close();
+    recordOp(FsOp::Sync, t0);
 
     if (written != content.length()) {
         LOG_E("Append incomplete: %s (%u/%u bytes)", path, written, content.length());
@@ -114,22 +625,88 @@ String StorageFeature::readFile(const char* path) {
         LOG_E("Storage not mounted");
         return "";
     }
+
+    {
+        RecursiveMutexLock lock(_mutex);
+        auto it = _pending.find(path);
+        if (it != _pending.end()) return it->second.content;
+    }
     
-    File file = LittleFS.open(path, "r");
-    if (!file) {
-        LOG_W("File not found: %s", path);
+    Reader reader = openReader(path);
+    if (!reader) return "";
+    
+    // Reserve once and read in chunks; readString() grows the String step by step
+    String content;
+    if (!content.reserve(reader.size())) {
+        LOG_E("Not enough memory to read %s (%u bytes)", path, reader.size());
         return "";
     }
-    
-    String content = file.readString();
-    file.close();
+    char buf[STORAGE_CHUNK_SIZE];
+    size_t n;
+    while ((n = reader.read((uint8_t*)buf, sizeof(buf))) > 0) {
+        content.concat(buf, n);
+    }
     
     LOG_D("Read %u bytes from %s", content.length(), path);
     return content;
 }
 
+StorageFeature::Reader StorageFeature::openReader(const char* path) {
+    if (!_mounted) {
+        LOG_E("Storage not mounted");
+        return Reader();
+    }
+
+    // Cached content must be on flash before it can be streamed
+    flush(path);
+
+    const uint32_t t0 = micros();
+    File file = LittleFS.open(path, "r");
+    recordOp(FsOp::Open, t0);
+    if (!file || file.isDirectory()) {
+        LOG_W("File not found: %s", path);
+        return Reader();
+    }
+    Reader reader(file);
+    if (!reader.verifyFooter()) {
+        LOG_E("Checksum mismatch: %s", path);
+        return Reader();
+    }
+    return reader;
+}
+
+StorageFeature::Writer StorageFeature::openWriter(const char* path, uint8_t flags) {
+    if (!_mounted) {
+        LOG_E("Storage not mounted");
+        return Writer();
+    }
+
+    // Cached writeFile() content is older than this write: put it on flash
+    // first (an append extends it), so loop() can't commit it over the new file
+    flush(path);
+
+    if (!ensureParentDir(path)) return Writer();
+
+    const bool append = (flags & WRITE_APPEND) != 0;
+    const String tmpPath = (!append && (flags & WRITE_ATOMIC)) ? String(path) + TMP_SUFFIX : String();
+    const char* openPath = tmpPath.length() > 0 ? tmpPath.c_str() : path;
+
+    const uint32_t t0 = micros();
+    File file = LittleFS.open(openPath, append ? "a" : "w");
+    recordOp(FsOp::Open, t0);
+    if (!file) {
+        LOG_E("Failed to open file for writing: %s", openPath);
+        return Writer();
+    }
+    return Writer(file, path, tmpPath, !append && (flags & WRITE_CHECKSUM), append);
+}
+
 bool StorageFeature::exists(const char* path) {
     if (!_mounted) return false;
+    {
+        RecursiveMutexLock lock(_mutex);
+        if (_pending.count(path)) return true;
+    }
     return LittleFS.exists(path);
 }
 
@@ -139,11 +716,19 @@ bool StorageFeature::remove(const char* path) {
         return false;
     }
     
+    {
+        RecursiveMutexLock lock(_mutex);
+        _pending.erase(path);
+    }
+
     if (!LittleFS.exists(path)) {
         return true;  // Already doesn't exist
     }
     
-    if (LittleFS.remove(path)) {
+    const uint32_t t0 = micros();
+    const bool removed = LittleFS.remove(path);
+    recordOp(FsOp::Remove, t0);
+    if (removed) {
         LOG_D("Removed file: %s", path);
         return true;
     }
@@ -3,13 +3,169 @@
 
 #include <Arduino.h>
 #include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <map>
 #include "Feature.h"
+#include "LatencyHistogram.h"
+
+// Buffer size of Reader and Writer; bounds the heap used by streamed file I/O
+#ifndef STORAGE_CHUNK_SIZE
+#define STORAGE_CHUNK_SIZE 512
+#endif
+
+// writeFile() keeps the content this long before writing it to flash;
+// further writes to the same path within the window replace it (0 = write through)
+#ifndef STORAGE_WRITE_BACK_MS
+#define STORAGE_WRITE_BACK_MS 2000
+#endif
 
 /**
  * @brief LittleFS filesystem wrapper feature
+ *
+ * readFile()/writeFile() handle a file as one String, fine for small files.
+ * Larger files are streamed with openReader()/openWriter(), which only ever
+ * hold STORAGE_CHUNK_SIZE bytes.
+ *
+ * Replacing writes go to "<path>.tmp" first and are renamed over the target
+ * when complete, so a reset never leaves a half written file. Files written
+ * by writeFile() also carry a CRC32 footer; readers verify and hide it.
+ * setup() removes temp files a reset left behind.
  */
 class StorageFeature : public Feature {
 public:
+    enum WriteFlags : uint8_t {
+        WRITE_APPEND = 0x01,    // append to the file (never atomic, no checksum)
+        WRITE_ATOMIC = 0x02,    // write a temp file, rename it over the target on close()
+        WRITE_CHECKSUM = 0x04,  // add a CRC32 footer
+    };
+
+    /**
+     * @brief Buffered sequential file reader
+     *
+     * A Stream, so it can be passed to deserializeJson() directly. Never
+     * waits: read() returns -1 at the end of the file. A checksum footer is
+     * not part of the data.
+     */
+    class Reader : public Stream {
+    public:
+        Reader();
+        explicit Reader(File file);
+        Reader(Reader&&) = default;
+        Reader& operator=(Reader&&) = default;
+
+        explicit operator bool() const { return (bool)_file; }
+
+        /**
+         * @brief Read up to len bytes
+         * @return Bytes read, 0 at end of file
+         */
+        size_t read(uint8_t* buffer, size_t len);
+
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t readBytes(char* buffer, size_t length) override { return read((uint8_t*)buffer, length); }
+        size_t write(uint8_t) override { return 0; }
+
+        size_t size() const { return _end; }
+        size_t position() const;
+        bool seek(size_t pos);
+        void close();
+
+    private:
+        friend class StorageFeature;
+
+        bool fill();
+        bool verifyFooter();    // false if a footer is present and the CRC does not match
+
+        File _file;
+        uint8_t _buf[STORAGE_CHUNK_SIZE];
+        size_t _pos;
+        size_t _len;
+        size_t _end;            // data size without footer
+    };
+
+    /**
+     * @brief Buffered file writer
+     *
+     * A Print, so serializeJson() can write to it directly. Write errors are
+     * sticky and reported by close().
+     */
+    class Writer : public Print {
+    public:
+        Writer();
+        Writer(File file, const char* path, const String& tmpPath, bool checksum, bool append);
+        Writer(Writer&&) = default;
+        Writer& operator=(Writer&&) = delete;
+
+        // A writer that was not closed is aborted, never committed half written
+        ~Writer() override { if (_file) abort(); }
+
+        explicit operator bool() const { return (bool)_file; }
+
+        using Print::write;
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t* buffer, size_t size) override;
+
+        /**
+         * @brief Flush, close and (if atomic) replace the target file
+         * @return true if every byte was written
+         */
+        bool close();
+
+        /**
+         * @brief Close and drop what was written
+         * Removes the temp file (atomic) or the partial file (rewritten in
+         * place); an append leaves the file with the bytes already written.
+         */
+        void abort();
+
+        size_t written() const { return _written; }
+        bool failed() const { return _failed; }
+
+    private:
+        bool flushBuffer();
+        bool replaceViaBackup();
+
+        File _file;
+        String _path;
+        String _tmpPath;        // empty if written in place
+        uint8_t _buf[STORAGE_CHUNK_SIZE];
+        size_t _len;
+        size_t _written;
+        uint32_t _crc;
+        bool _checksum;
+        bool _append;
+        bool _failed;
+    };
+
+    // Filesystem operations with a latency histogram
+    enum class FsOp : uint8_t { Open, Read, Write, Sync, Rename, Remove, Count };
+
+    struct BenchmarkResult {
+        bool valid{false};
+        uint32_t sizeBytes{0};
+        uint32_t durationMs{0};
+        uint32_t seqWriteKBps{0};
+        uint32_t seqReadKBps{0};
+        uint32_t randomReadAvgUs{0};    // 256 byte reads at random offsets
+        uint32_t randomReadMaxUs{0};
+        uint32_t appendAvgUs{0};        // 32 byte append + flush (KvStore pattern)
+        uint32_t appendMaxUs{0};
+        uint32_t replaceAvgUs{0};       // 128 byte temp file + rename (atomic writeFile pattern)
+        uint32_t replaceMaxUs{0};
+        char error[48]{};
+    };
+
+    struct WriteBackStats {
+        uint32_t commits{0};        // files written to flash by writeFile()
+        uint32_t coalesced{0};      // writeFile() calls replaced by a later one
+        uint32_t failures{0};
+        uint64_t bytes{0};          // bytes written to flash by writeFile()
+        size_t pending{0};
+    };
+
     /**
      * @brief Construct storage feature
      * @param formatOnFail Format filesystem if mount fails
@@ -17,19 +173,29 @@ public:
     StorageFeature(bool formatOnFail = true);
     
     void setup() override;
+    void loop() override;
+    uint32_t dueInMs() override;
     const char* getName() const override { return "Storage"; }
     bool isReady() const override { return _mounted; }
     
+    static StorageFeature* getInstance() { return _instance; }
+    
     /**
-     * @brief Write content to file (overwrites if exists)
+     * @brief Replace file content (atomic, with checksum footer)
+     *
+     * Goes through the write-back cache: the file is written after the
+     * write-back delay, with the latest content written in the meantime.
+     * Reads through this class already see the new content.
      * @param path File path (must start with /)
      * @param content Content to write
-     * @return true if successful
+     * @return true if successful (accepted, if cached)
      */
     bool writeFile(const char* path, const String& content);
     
     /**
      * @brief Append content to file
+     * @note Not for files written by writeFile(), their footer would end up
+     *       in the middle of the data
      * @param path File path
      * @param content Content to append
      * @return true if successful
@@ -39,10 +205,62 @@ public:
     /**
      * @brief Read entire file content
      * @param path File path
-     * @return File content, or empty string on error
+     * @return File content, or empty string on error or checksum mismatch
      */
     String readFile(const char* path);
     
+    /**
+     * @brief Open a file for streamed reading
+     * @return Reader, false if the file can't be opened or fails its checksum
+     */
+    Reader openReader(const char* path);
+    
+    /**
+     * @brief Open a file for streamed writing (parent directories are created)
+     * Content of the path still cached by writeFile() is written first, so
+     * it can't overwrite the streamed file later.
+     * @param flags WriteFlags
+     * @return Writer, false if the file can't be opened
+     */
+    Writer openWriter(const char* path, uint8_t flags = WRITE_ATOMIC);
+    
+    /**
+     * @brief Write cached writeFile() content now
+     * @param path Only this file (nullptr = all)
+     * @return false if a write failed
+     */
+    bool flush(const char* path = nullptr);
+    
+    void setWriteBackDelay(uint32_t ms) { _writeBackMs = ms; }
+    uint32_t getWriteBackDelay() const { return _writeBackMs; }
+    WriteBackStats getWriteBackStats();
+    
+    /**
+     * @brief Record the latency of a filesystem operation (and bytes moved)
+     *
+     * Called for all I/O done through this class; other code using LittleFS
+     * directly (KvStore) reports here too.
+     * @param startUs micros() when the operation started
+     */
+    static void recordOp(FsOp op, uint32_t startUs, size_t bytes = 0);
+    static const LatencyHistogram& latency(FsOp op) { return _latency[(size_t)op]; }
+    static void resetLatency() { for (auto& h : _latency) h.reset(); }
+    static const char* opName(FsOp op);
+    static uint64_t bytesRead() { return _bytesRead; }
+    static uint64_t bytesWritten() { return _bytesWritten; }
+    
+    /**
+     * @brief Start a filesystem benchmark in a background task
+     *
+     * Works in the scratch directory /.perf, which is removed afterwards.
+     * Benchmark I/O bypasses the latency histograms.
+     * @param sizeBytes Size of the sequential test file
+     * @return false if one is already running or storage isn't mounted
+     */
+    bool startBenchmark(size_t sizeBytes);
+    bool isBenchmarkRunning() const { return _benchRunning; }
+    BenchmarkResult getBenchmarkResult();
+    
     /**
      * @brief Check if file exists
      */
@@ -80,10 +298,42 @@ public:
      * @return JSON array of filenames
      */
     String listDir(const char* path);
-
+    
 private:
+    struct PendingWrite {
+        String content;
+        uint32_t dueMs;
+    };
+
+    static constexpr const char* TMP_SUFFIX = ".tmp";      // atomic write in progress
+    static constexpr const char* BACKUP_SUFFIX = ".bak";   // old file while replacing without rename
+    static constexpr uint32_t FOOTER_MAGIC = 0x31435243;   // "CRC1"
+    struct Footer {
+        uint32_t magic;
+        uint32_t crc;
+    };
+
+    void recoverInterruptedWrites(const char* dir);
+    bool ensureParentDir(const char* path);
+    bool commitFile(const char* path, const String& content);
+    bool flushLocked(const char* path);
+    void runBenchmark(size_t sizeBytes);
+    static void benchmarkTask(void* param);
+
+    static StorageFeature* _instance;
+    static LatencyHistogram _latency[(size_t)FsOp::Count];
+    static uint64_t _bytesRead;
+    static uint64_t _bytesWritten;
+
     bool _formatOnFail;
     bool _mounted;
+    uint32_t _writeBackMs;
+    std::map<String, PendingWrite> _pending;
+    WriteBackStats _stats;
+    volatile bool _benchRunning;
+    size_t _benchSize;
+    BenchmarkResult _bench;
+    SemaphoreHandle_t _mutex;   // guards _pending and _stats
 };
 
 #endif // STORAGE_FEATURE_H
@@ -0,0 +1,275 @@
+#define LOG_CATEGORY LogCategory::System
+
+#include "TaskMonitor.h"
+#include "InfluxLineProtocol.h"
+#include "LoggingFeature.h"
+#include "WebServerFeature.h"
+#include "ApiEncoding.h"
+#include "FeatureTasks.h"
+#include "MutexLock.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <vector>
+
+#if defined(configUSE_TRACE_FACILITY) && configUSE_TRACE_FACILITY
+#define TASK_MONITOR_HAS_TASK_LIST 1
+#else
+#define TASK_MONITOR_HAS_TASK_LIST 0
+#endif
+
+#if TASK_MONITOR_HAS_TASK_LIST && defined(configGENERATE_RUN_TIME_STATS) && configGENERATE_RUN_TIME_STATS
+#define TASK_MONITOR_HAS_RUN_TIME 1
+#else
+#define TASK_MONITOR_HAS_RUN_TIME 0
+#endif
+
+namespace {
+#if defined(configRUN_TIME_COUNTER_TYPE)
+    using RunTime = configRUN_TIME_COUNTER_TYPE;
+#else
+    using RunTime = uint32_t;
+#endif
+
+    struct TaskInfo {
+        TaskHandle_t handle;
+        char name[configMAX_TASK_NAME_LEN];
+        eTaskState state;
+        uint8_t priority;
+        int8_t core;                // -1 = not pinned
+        uint32_t stackFreeBytes;    // high-water mark: least free stack ever
+        RunTime runTime;
+        float cpuPercent;           // of one core, last interval; -1 if unknown
+        bool stackWarned;
+    };
+
+    SemaphoreHandle_t s_mutex = nullptr;
+    std::vector<TaskInfo> s_tasks;      // last sample
+    float s_coreUsage[portNUM_PROCESSORS];
+    RunTime s_prevTotal = 0;
+    RunTime s_prevIdle[portNUM_PROCESSORS] = {};
+    uint32_t s_intervalMs = TASK_MONITOR_INTERVAL_MS;
+    uint32_t s_lastSampleMs = 0;
+    volatile uint32_t s_sampleCount = 0;
+
+    void ensureInit() {
+        if (s_mutex) return;
+        s_mutex = xSemaphoreCreateMutex();
+        for (int i = 0; i < portNUM_PROCESSORS; i++) s_coreUsage[i] = -1.0f;
+    }
+
+    const char* stateName(eTaskState state) {
+        switch (state) {
+            case eRunning:   return "running";
+            case eReady:     return "ready";
+            case eBlocked:   return "blocked";
+            case eSuspended: return "suspended";
+            case eDeleted:   return "deleted";
+            default:         return "invalid";
+        }
+    }
+
+    const TaskInfo* findPrevious(const std::vector<TaskInfo>& tasks, TaskHandle_t handle) {
+        for (const auto& t : tasks) {
+            if (t.handle == handle) return &t;
+        }
+        return nullptr;
+    }
+}
+
+namespace TaskMonitor {
+    void loop() {
+        const uint32_t now = (uint32_t)millis();
+        if (s_sampleCount != 0 && (uint32_t)(now - s_lastSampleMs) < s_intervalMs) return;
+        sample();
+    }
+
+    void sample() {
+        ensureInit();
+        s_lastSampleMs = (uint32_t)millis();
+
+#if TASK_MONITOR_HAS_TASK_LIST
+        std::vector<TaskStatus_t> status(uxTaskGetNumberOfTasks() + 4);
+        RunTime total = 0;
+        const UBaseType_t n = uxTaskGetSystemState(status.data(), status.size(), &total);
+        status.resize(n);
+
+        std::vector<TaskInfo> tasks;
+        tasks.reserve(n);
+        {
+            MutexLock lock(s_mutex);
+            const RunTime elapsed = total - s_prevTotal;
+            const bool haveDelta = TASK_MONITOR_HAS_RUN_TIME && s_sampleCount != 0 && elapsed > 0;
+
+            for (const auto& s : status) {
+                TaskInfo t;
+                t.handle = s.xHandle;
+                strlcpy(t.name, s.pcTaskName, sizeof(t.name));
+                t.state = s.eCurrentState;
+                t.priority = (uint8_t)s.uxCurrentPriority;
+#if defined(configTASKLIST_INCLUDE_COREID) && configTASKLIST_INCLUDE_COREID
+                t.core = (s.xCoreID == tskNO_AFFINITY) ? -1 : (int8_t)s.xCoreID;
+#else
+                t.core = -1;
+#endif
+                t.stackFreeBytes = s.usStackHighWaterMark;  // bytes on ESP-IDF
+                t.runTime = s.ulRunTimeCounter;
+                t.cpuPercent = -1.0f;
+                t.stackWarned = false;
+
+                const TaskInfo* prev = findPrevious(s_tasks, t.handle);
+                if (prev) {
+                    t.stackWarned = prev->stackWarned;
+                    if (haveDelta) t.cpuPercent = (float)(RunTime)(t.runTime - prev->runTime) * 100.0f / elapsed;
+                }
+
+                if (t.stackFreeBytes < TASK_MONITOR_STACK_WARN_BYTES) {
+                    if (!t.stackWarned) {
+                        t.stackWarned = true;
+                        LOG_W("Task %s: only %u bytes of stack left", t.name, (unsigned)t.stackFreeBytes);
+                    }
+                } else {
+                    t.stackWarned = false;
+                }
+                tasks.push_back(t);
+            }
+
+#if TASK_MONITOR_HAS_RUN_TIME
+            for (int core = 0; core < portNUM_PROCESSORS; core++) {
+                TaskHandle_t idle = xTaskGetIdleTaskHandleForCore(core);
+                for (const auto& t : tasks) {
+                    if (t.handle != idle) continue;
+                    if (haveDelta) {
+                        const float idlePercent = (float)(RunTime)(t.runTime - s_prevIdle[core]) * 100.0f / elapsed;
+                        s_coreUsage[core] = std::max(0.0f, std::min(100.0f, 100.0f - idlePercent));
+                    }
+                    s_prevIdle[core] = t.runTime;
+                    break;
+                }
+            }
+#endif
+
+            std::sort(tasks.begin(), tasks.end(), [](const TaskInfo& a, const TaskInfo& b) {
+                return a.cpuPercent > b.cpuPercent;
+            });
+            s_tasks.swap(tasks);
+            s_prevTotal = total;
+        }
+#endif
+        s_sampleCount++;
+    }
+
+    void setIntervalMs(uint32_t intervalMs) {
+        s_intervalMs = intervalMs;
+    }
+
+    uint32_t intervalMs() {
+        return s_intervalMs;
+    }
+
+    uint32_t sampleCount() {
+        return s_sampleCount;
+    }
+
+    float coreUsagePercent(int core) {
+        if (core < 0 || core >= portNUM_PROCESSORS || !s_mutex) return -1.0f;
+        return s_coreUsage[core];
+    }
+
+    void toJson(JsonObject obj) {
+        ensureInit();
+        obj["intervalMs"] = s_intervalMs;
+        obj["samples"] = s_sampleCount;
+        obj["ageMs"] = (uint32_t)((uint32_t)millis() - s_lastSampleMs);
+        obj["runTimeStats"] = (bool)TASK_MONITOR_HAS_RUN_TIME;
+        obj["stackWarnBytes"] = (uint32_t)TASK_MONITOR_STACK_WARN_BYTES;
+
+        MutexLock lock(s_mutex);
+        JsonArray cores = obj["cores"].to<JsonArray>();
+        for (int i = 0; i < portNUM_PROCESSORS; i++) {
+            JsonObject c = cores.add<JsonObject>();
+            c["core"] = i;
+            if (s_coreUsage[i] >= 0.0f) c["usagePercent"] = s_coreUsage[i];
+        }
+
+        JsonArray tasks = obj["tasks"].to<JsonArray>();
+        for (const auto& t : s_tasks) {
+            JsonObject o = tasks.add<JsonObject>();
+            o["name"] = t.name;
+            o["state"] = stateName(t.state);
+            o["priority"] = t.priority;
+            o["core"] = t.core;
+            o["stackFreeBytes"] = t.stackFreeBytes;
+            if (t.cpuPercent >= 0.0f) o["cpuPercent"] = t.cpuPercent;
+        }
+
+        FeatureTasks::toJson(obj["features"].to<JsonArray>());
+    }
+
+    String toLineProtocol(const char* deviceId) {
+        ensureInit();
+        const String device = InfluxLineProtocol::escapeTag(deviceId);
+        String lines;
+
+        MutexLock lock(s_mutex);
+        for (int i = 0; i < portNUM_PROCESSORS; i++) {
+            if (s_coreUsage[i] < 0.0f) continue;
+            lines += "cpu_core,device=";
+            lines += device;
+            lines += ",core=";
+            lines += i;
+            lines += " usage_pct=";
+            lines += String(s_coreUsage[i], 2);
+            lines += "\n";
+        }
+
+        // Format: task_stats,device=id,task=name stack_free=Ni,priority=Ni[,cpu_pct=F]
+        for (const auto& t : s_tasks) {
+            lines += "task_stats,device=";
+            lines += device;
+            lines += ",task=";
+            lines += InfluxLineProtocol::escapeTag(t.name);
+            lines += " stack_free=";
+            lines += t.stackFreeBytes;
+            lines += "i,priority=";
+            lines += t.priority;
+            lines += "i";
+            if (t.cpuPercent >= 0.0f) {
+                lines += ",cpu_pct=";
+                lines += String(t.cpuPercent, 2);
+            }
+            lines += "\n";
+        }
+        return lines;
+    }
+
+    void setup(WebServerFeature& server) {
+        ensureInit();
+
+        server.getServer()->on("/api/tasks", HTTP_GET, [&server](AsyncWebServerRequest* request) {
+            if (!server.authenticate(request)) return request->requestAuthentication();
+            JsonDocument doc;
+            toJson(doc.to<JsonObject>());
+            ApiEncoding::send(request, 200, doc);
+        });
+
+        server.getServer()->on("/api/tasks", HTTP_POST, [&server](AsyncWebServerRequest* request) {
+            if (!server.authenticate(request)) return request->requestAuthentication();
+            if (!request->hasParam("intervalMs", true)) {
+                request->send(400, "application/json", "{\"error\":\"Missing intervalMs parameter\"}");
+                return;
+            }
+            const uint32_t interval = (uint32_t)request->getParam("intervalMs", true)->value().toInt();
+            if (interval < 1000 || interval > 600000) {
+                request->send(400, "application/json", "{\"error\":\"intervalMs must be 1000..600000\"}");
+                return;
+            }
+            setIntervalMs(interval);
+
+            JsonDocument doc;
+            doc["intervalMs"] = interval;
+            ApiEncoding::send(request, 200, doc);
+        });
+    }
+}
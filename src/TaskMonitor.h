@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+class WebServerFeature;
+
+// Sampling interval for task run time, core idle time and stack watermarks
+#ifndef TASK_MONITOR_INTERVAL_MS
+#define TASK_MONITOR_INTERVAL_MS 10000
+#endif
+
+// Warn when a task has less unused stack than this (bytes)
+#ifndef TASK_MONITOR_STACK_WARN_BYTES
+#define TASK_MONITOR_STACK_WARN_BYTES 512
+#endif
+
+/**
+ * FreeRTOS task diagnostics.
+ *
+ * CpuMonitor only sees the Arduino loop task. This samples all tasks
+ * (AsyncTCP, WiFi, lwIP, idle, ...) via uxTaskGetSystemState(): CPU share
+ * of each task and utilisation of each core over the last interval, stack
+ * high-water marks and task states. A warning is logged once per task when
+ * its free stack drops below TASK_MONITOR_STACK_WARN_BYTES.
+ *
+ * Run time shares need configGENERATE_RUN_TIME_STATS (enabled in the
+ * Arduino core); without it only states and stacks are reported.
+ *
+ * Usage:
+ *   In loop(): TaskMonitor::loop();
+ */
+namespace TaskMonitor {
+    // Samples when the interval has elapsed; call from loop()
+    void loop();
+
+    // Sample now
+    void sample();
+
+    void setIntervalMs(uint32_t intervalMs);
+    uint32_t intervalMs();
+
+    // Number of samples taken, changes when new data is available
+    uint32_t sampleCount();
+
+    // Utilisation of a core over the last interval (0.0 - 100.0, -1 if unknown)
+    float coreUsagePercent(int core);
+
+    void toJson(JsonObject obj);
+
+    // Measurements task_stats (per task) and cpu_core (per core)
+    String toLineProtocol(const char* deviceId);
+
+    // GET /api/tasks, POST /api/tasks (intervalMs)
+    void setup(WebServerFeature& server);
+}
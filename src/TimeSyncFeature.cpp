@@ -1,5 +1,8 @@
+#define LOG_CATEGORY LogCategory::Time
+
 #include "TimeSyncFeature.h"
 #include "LoggingFeature.h"
+#include "LoopScheduler.h"
 #include <WiFi.h>
 #include <time.h>
 
@@ -32,6 +35,19 @@ void TimeSyncFeature::setup() {
     LOG_I("TimeSync configured, waiting for WiFi...");
 }
 
+uint32_t TimeSyncFeature::dueInMs() {
+    switch (_state) {
+        case State::WAITING_FOR_WIFI:
+            return WiFi.status() == WL_CONNECTED ? 0 : NOT_DUE;   // WiFi events wake the loop
+        case State::SYNCING:
+            return SYNC_POLL_MS;
+        case State::SYNCED:
+            return LoopScheduler::remainingMs(millis() - _lastSyncTime, _syncIntervalMs);
+        default:
+            return 0;
+    }
+}
+
 void TimeSyncFeature::loop() {
     switch (_state) {
         case State::WAITING_FOR_WIFI:
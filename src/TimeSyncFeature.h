@@ -21,6 +21,8 @@ public:
     
     void setup() override;
     void loop() override;
+    uint8_t dependencies() const override { return NEEDS_NETWORK; }
+    uint32_t dueInMs() override;
     const char* getName() const override { return "TimeSync"; }
     bool isReady() const override { return _synced; }
     
@@ -47,6 +49,7 @@ private:
     unsigned long _lastSyncTime;
     unsigned long _syncStartTime;
     static const unsigned long SYNC_TIMEOUT = 10000; // 10 seconds timeout
+    static const uint32_t SYNC_POLL_MS = 100;
 };
 
 #endif // TIMESYNC_FEATURE_H
@@ -2,6 +2,7 @@
 
 #include <Arduino.h>
 #include <time.h>
+#include "Hal.h"
 
 namespace TimeUtils {
 
@@ -11,25 +12,25 @@ inline bool isUnixTimeValid(time_t t) {
 }
 
 inline bool isTimeValidNow() {
-    return isUnixTimeValid(time(nullptr));
+    return isUnixTimeValid(Hal::time());
 }
 
 inline uint32_t nowUnixSecondsOrZero() {
-    time_t t = time(nullptr);
+    time_t t = Hal::time();
     return isUnixTimeValid(t) ? (uint32_t)t : 0;
 }
 
 inline uint32_t nowSecondsPreferUnix() {
     uint32_t unixNow = nowUnixSecondsOrZero();
     if (unixNow != 0) return unixNow;
-    return millis() / 1000;
+    return Hal::millis() / 1000;
 }
 
 inline uint32_t unixFromUptimeSeconds(uint32_t uptimeSeconds) {
     uint32_t unixNow = nowUnixSecondsOrZero();
     if (unixNow == 0) return 0;
 
-    uint32_t upNow = millis() / 1000;
+    uint32_t upNow = Hal::millis() / 1000;
     if (upNow >= uptimeSeconds) {
         return unixNow - (upNow - uptimeSeconds);
     }
@@ -0,0 +1,348 @@
+#define LOG_CATEGORY LogCategory::System
+
+#include "Trace.h"
+#include "LoggingFeature.h"
+#include "WebServerFeature.h"
+#include "ApiEncoding.h"
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace {
+    struct Capture {
+        std::unique_ptr<Trace::Event[]> events;
+        size_t capacity{0};
+        uint32_t recorded{0};
+        int64_t startUs{0};
+        int64_t stopUs{0};          // 0 while running
+        int64_t durationUs{0};      // 0 = until stopped
+    };
+
+    // Guards s_capture and the ring writes. Held for a few instructions per
+    // event, so a spinlock is cheaper than a mutex and safe from any task.
+    portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+    std::shared_ptr<Capture> s_capture;
+
+    void finish(Capture& c, int64_t now) {
+        if (c.stopUs == 0) c.stopUs = now;
+        Trace::g_active = false;
+    }
+
+    std::shared_ptr<Capture> current() {
+        portENTER_CRITICAL(&s_mux);
+        std::shared_ptr<Capture> c = s_capture;
+        portEXIT_CRITICAL(&s_mux);
+        return c;
+    }
+
+    struct TaskName {
+        TaskHandle_t handle;
+        String name;
+    };
+
+    // Thread ids and names of the tasks that recorded events
+    std::vector<TaskName> taskNames(const Capture& c) {
+        std::vector<TaskName> names;
+        const size_t n = std::min((size_t)c.recorded, c.capacity);
+        for (size_t i = 0; i < n; i++) {
+            TaskHandle_t h = c.events[i].task;
+            bool known = false;
+            for (const auto& t : names) {
+                if (t.handle == h) { known = true; break; }
+            }
+            if (!known) names.push_back({h, String()});
+        }
+
+#if defined(configUSE_TRACE_FACILITY) && configUSE_TRACE_FACILITY
+        // Only ask live tasks for their name; a handle of a deleted task is stale
+        std::vector<TaskStatus_t> status(uxTaskGetNumberOfTasks() + 4);
+        status.resize(uxTaskGetSystemState(status.data(), status.size(), nullptr));
+        for (auto& t : names) {
+            for (const auto& s : status) {
+                if (s.xHandle == t.handle) { t.name = s.pcTaskName; break; }
+            }
+        }
+#endif
+        for (size_t i = 0; i < names.size(); i++) {
+            if (names[i].name.isEmpty()) names[i].name = "task " + String(i + 1);
+        }
+        return names;
+    }
+
+    struct Download {
+        std::shared_ptr<Capture> capture;
+        std::vector<TaskName> tasks;
+        size_t first{0};            // ring index of the oldest event
+        size_t count{0};
+        size_t next{0};             // events written
+        size_t nextTask{0};         // thread_name records written
+        bool started{false};
+        bool done{false};
+        String pending;
+        size_t pendingPos{0};
+    };
+
+    size_t tid(const Download& d, TaskHandle_t h) {
+        for (size_t i = 0; i < d.tasks.size(); i++) {
+            if (d.tasks[i].handle == h) return i + 1;
+        }
+        return 0;
+    }
+
+    // Next part of the Chrome trace JSON into d.pending; false when complete
+    bool nextChunk(Download& d) {
+        if (d.done) return false;
+        char line[160];
+
+        if (!d.started) {
+            d.started = true;
+            d.pending = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"esp32\"}}";
+            return true;
+        }
+        if (d.nextTask < d.tasks.size()) {
+            const TaskName& t = d.tasks[d.nextTask++];
+            snprintf(line, sizeof(line),
+                     ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                     (unsigned)d.nextTask, t.name.c_str());
+            d.pending = line;
+            return true;
+        }
+        if (d.next < d.count) {
+            // Several events per chunk; one snprintf each keeps the String growth small
+            d.pending = "";
+            for (int i = 0; i < 16 && d.next < d.count; i++, d.next++) {
+                const Trace::Event& e = d.capture->events[(d.first + d.next) % d.capture->capacity];
+                const char* ph = e.phase == Trace::Phase::Begin ? "B" : e.phase == Trace::Phase::End ? "E" : "i";
+                int n = snprintf(line, sizeof(line),
+                                 ",\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%lu,\"pid\":1,\"tid\":%u",
+                                 e.name, ph, (unsigned long)e.us, (unsigned)tid(d, e.task));
+                if (e.phase == Trace::Phase::Instant) {
+                    n += snprintf(line + n, sizeof(line) - n, ",\"s\":\"t\"");
+                }
+                if (e.phase != Trace::Phase::End) {
+                    n += snprintf(line + n, sizeof(line) - n, ",\"args\":{\"arg\":%lu}", (unsigned long)e.arg);
+                }
+                snprintf(line + n, sizeof(line) - n, "}");
+                d.pending += line;
+            }
+            return true;
+        }
+        d.done = true;
+        d.pending = "\n]}\n";
+        return true;
+    }
+
+    void statusJson(JsonObject obj) {
+        const Trace::Status st = Trace::status();
+        obj["enabled"] = (bool)TRACE_ENABLED;
+        obj["active"] = st.active;
+        obj["capacity"] = (uint32_t)st.capacity;
+        obj["recorded"] = st.recorded;
+        obj["overwritten"] = st.recorded > st.capacity ? (uint32_t)(st.recorded - st.capacity) : 0u;
+        obj["elapsedMs"] = st.elapsedMs;
+    }
+}
+
+namespace Trace {
+    volatile bool g_active = false;
+
+    void record(Phase phase, const char* name, uint32_t arg) {
+        const int64_t now = esp_timer_get_time();
+        TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+        portENTER_CRITICAL(&s_mux);
+        Capture* c = s_capture.get();
+        if (c && c->stopUs == 0) {
+            if (c->durationUs != 0 && now - c->startUs >= c->durationUs) {
+                finish(*c, c->startUs + c->durationUs);
+            } else {
+                Event& e = c->events[c->recorded % c->capacity];
+                e.us = (uint32_t)(now - c->startUs);
+                e.name = name;
+                e.task = task;
+                e.arg = arg;
+                e.phase = phase;
+                c->recorded++;
+            }
+        }
+        portEXIT_CRITICAL(&s_mux);
+    }
+
+    bool start(size_t events, uint32_t durationMs) {
+#if TRACE_ENABLED
+        if (events == 0) events = TRACE_DEFAULT_EVENTS;
+        events = std::min(events, (size_t)TRACE_MAX_EVENTS);
+
+        auto c = std::make_shared<Capture>();
+        c->events.reset(new (std::nothrow) Event[events]);
+        if (!c->events) {
+            LOG_W("No memory for a trace of %u events", (unsigned)events);
+            return false;
+        }
+        c->capacity = events;
+        c->durationUs = (int64_t)durationMs * 1000;
+        c->startUs = esp_timer_get_time();
+
+        portENTER_CRITICAL(&s_mux);
+        s_capture.swap(c);
+        g_active = true;
+        portEXIT_CRITICAL(&s_mux);
+        // previous capture (if any) is freed outside of the critical section
+
+        LOG_I("Trace started: %u events, %lu ms", (unsigned)events, (unsigned long)durationMs);
+        return true;
+#else
+        (void)events;
+        (void)durationMs;
+        return false;
+#endif
+    }
+
+    void stop() {
+        const int64_t now = esp_timer_get_time();
+        portENTER_CRITICAL(&s_mux);
+        if (s_capture) finish(*s_capture, now);
+        portEXIT_CRITICAL(&s_mux);
+    }
+
+    size_t recent(Event* out, size_t max, int64_t& startUs) {
+        size_t n = 0;
+        startUs = 0;
+        portENTER_CRITICAL(&s_mux);
+        if (Capture* c = s_capture.get()) {
+            n = std::min(max, std::min((size_t)c->recorded, c->capacity));
+            for (size_t i = 0; i < n; i++) {
+                out[i] = c->events[(c->recorded - n + i) % c->capacity];
+            }
+            startUs = c->startUs;
+        }
+        portEXIT_CRITICAL(&s_mux);
+        return n;
+    }
+
+    Status status() {
+        const int64_t now = esp_timer_get_time();
+        Status st{false, 0, 0, 0};
+        portENTER_CRITICAL(&s_mux);
+        if (Capture* c = s_capture.get()) {
+            // An expired capture only notices on the next event
+            if (c->stopUs == 0 && c->durationUs != 0 && now - c->startUs >= c->durationUs) {
+                finish(*c, c->startUs + c->durationUs);
+            }
+            st.active = c->stopUs == 0;
+            st.capacity = c->capacity;
+            st.recorded = c->recorded;
+            st.elapsedMs = (uint32_t)(((st.active ? now : c->stopUs) - c->startUs) / 1000);
+        }
+        portEXIT_CRITICAL(&s_mux);
+        return st;
+    }
+
+    void setup(WebServerFeature& server) {
+#if TRACE_ENABLED
+        // One span per request handler, including body and upload callbacks
+        server.getServer()->addMiddleware([](AsyncWebServerRequest* request, ArMiddlewareNext next) {
+            TRACE_SCOPE("http", (uint32_t)request->method());
+            next();
+        });
+#endif
+
+        // Sub-paths first: a handler for /api/trace also matches /api/trace/...
+        server.getServer()->on("/api/trace/start", HTTP_POST, [&server](AsyncWebServerRequest* request) {
+            if (!server.authenticate(request)) return request->requestAuthentication();
+            if (!TRACE_ENABLED) {
+                request->send(501, "application/json", "{\"error\":\"Tracing not compiled in\"}");
+                return;
+            }
+            if (status().active) {
+                request->send(409, "application/json", "{\"error\":\"Trace already running\"}");
+                return;
+            }
+            size_t events = TRACE_DEFAULT_EVENTS;
+            uint32_t durationMs = 10000;
+            if (request->hasParam("events", true)) {
+                events = (size_t)request->getParam("events", true)->value().toInt();
+                if (events < 16 || events > TRACE_MAX_EVENTS) {
+                    request->send(400, "application/json", "{\"error\":\"events out of range\"}");
+                    return;
+                }
+            }
+            if (request->hasParam("durationMs", true)) {
+                durationMs = (uint32_t)request->getParam("durationMs", true)->value().toInt();
+                if (durationMs > 600000) {
+                    request->send(400, "application/json", "{\"error\":\"durationMs must be 0..600000\"}");
+                    return;
+                }
+            }
+            if (!start(events, durationMs)) {
+                request->send(503, "application/json", "{\"error\":\"Not enough memory for trace\"}");
+                return;
+            }
+
+            JsonDocument doc;
+            statusJson(doc.to<JsonObject>());
+            ApiEncoding::send(request, 200, doc);
+        });
+
+        server.getServer()->on("/api/trace/stop", HTTP_POST, [&server](AsyncWebServerRequest* request) {
+            if (!server.authenticate(request)) return request->requestAuthentication();
+            stop();
+            JsonDocument doc;
+            statusJson(doc.to<JsonObject>());
+            ApiEncoding::send(request, 200, doc);
+        });
+
+        server.getServer()->on("/api/trace/download", HTTP_GET, [&server](AsyncWebServerRequest* request) {
+            if (!server.authenticate(request)) return request->requestAuthentication();
+            std::shared_ptr<Capture> capture = current();
+            if (!capture) {
+                request->send(404, "application/json", "{\"error\":\"No trace captured\"}");
+                return;
+            }
+            if (status().active) {
+                request->send(409, "application/json", "{\"error\":\"Trace still running\"}");
+                return;
+            }
+
+            auto d = std::make_shared<Download>();
+            d->capture = capture;
+            d->count = std::min((size_t)capture->recorded, capture->capacity);
+            d->first = capture->recorded > capture->capacity ? capture->recorded % capture->capacity : 0;
+            d->tasks = taskNames(*capture);
+
+            // The filler keeps the capture alive even if a new one is started meanwhile
+            AsyncWebServerResponse* response = request->beginChunkedResponse(
+                "application/json",
+                [d](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+                    (void)index;
+                    size_t written = 0;
+                    while (written < maxLen) {
+                        if (d->pendingPos >= d->pending.length()) {
+                            d->pending = "";
+                            d->pendingPos = 0;
+                            if (!nextChunk(*d)) break;
+                            continue;
+                        }
+                        const size_t n = std::min(maxLen - written, d->pending.length() - d->pendingPos);
+                        memcpy(buffer + written, d->pending.c_str() + d->pendingPos, n);
+                        written += n;
+                        d->pendingPos += n;
+                    }
+                    return written;
+                });
+            response->addHeader("Content-Disposition", "attachment; filename=\"trace.json\"");
+            request->send(response);
+        });
+
+        server.getServer()->on("/api/trace", HTTP_GET, [&server](AsyncWebServerRequest* request) {
+            if (!server.authenticate(request)) return request->requestAuthentication();
+            JsonDocument doc;
+            statusJson(doc.to<JsonObject>());
+            ApiEncoding::send(request, 200, doc);
+        });
+    }
+}
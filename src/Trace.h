@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+class WebServerFeature;
+
+// 0 removes all TRACE_* instrumentation from the build
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+// Ring size of a capture if not given (events, 20 bytes each)
+#ifndef TRACE_DEFAULT_EVENTS
+#define TRACE_DEFAULT_EVENTS 2048
+#endif
+
+#ifndef TRACE_MAX_EVENTS
+#define TRACE_MAX_EVENTS 8192
+#endif
+
+/**
+ * Span tracing into a RAM ring, exported as Chrome/Perfetto trace JSON.
+ *
+ * Instrumentation uses the TRACE_* macros with string literal names. While
+ * no capture is running an event costs one load and branch; during a
+ * capture it takes a timestamp and a slot in the ring (well under 1 us).
+ * The ring is only allocated while a capture exists and keeps the newest
+ * events when it wraps.
+ *
+ * Captures are started, stopped and downloaded via /api/trace; the
+ * download opens in ui.perfetto.dev or chrome://tracing.
+ */
+namespace Trace {
+    enum class Phase : uint8_t { Begin, End, Instant };
+
+    struct Event {
+        uint32_t us;            // since capture start
+        const char* name;
+        TaskHandle_t task;
+        uint32_t arg;
+        Phase phase;
+    };
+
+    struct Status {
+        bool active;
+        size_t capacity;
+        uint32_t recorded;      // events recorded, including overwritten ones
+        uint32_t elapsedMs;
+    };
+
+    extern volatile bool g_active;
+
+    void record(Phase phase, const char* name, uint32_t arg);
+
+    /**
+     * @brief Start a capture (discards the previous one)
+     * @param events Ring size (clamped to TRACE_MAX_EVENTS)
+     * @param durationMs Stop automatically after this time (0 = until stop())
+     * @return false if compiled out or the ring can't be allocated
+     */
+    bool start(size_t events, uint32_t durationMs);
+    void stop();
+    Status status();
+
+    /**
+     * @brief Copy the newest events of the current capture, oldest first
+     * @param startUs Set to the esp_timer time the event timestamps refer to
+     * @return Number of events copied (0 without a capture)
+     */
+    size_t recent(Event* out, size_t max, int64_t& startUs);
+
+    // Records a span for the lifetime of the object
+    class Span {
+    public:
+        explicit Span(const char* name, uint32_t arg = 0) : _name(name) {
+            if (g_active) record(Phase::Begin, name, arg);
+        }
+        ~Span() {
+            if (g_active) record(Phase::End, _name, 0);
+        }
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        const char* _name;
+    };
+
+    // GET /api/trace, POST /api/trace/start, POST /api/trace/stop,
+    // GET /api/trace/download; also traces web handlers
+    void setup(WebServerFeature& server);
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#if TRACE_ENABLED
+#define TRACE_BEGIN(name, arg) do { if (Trace::g_active) Trace::record(Trace::Phase::Begin, name, arg); } while (0)
+#define TRACE_END(name) do { if (Trace::g_active) Trace::record(Trace::Phase::End, name, 0); } while (0)
+#define TRACE_INSTANT(name, arg) do { if (Trace::g_active) Trace::record(Trace::Phase::Instant, name, arg); } while (0)
+#define TRACE_SCOPE(name, arg) Trace::Span TRACE_CONCAT(_traceSpan, __LINE__)(name, arg)
+#else
+#define TRACE_BEGIN(name, arg) do {} while (0)
+#define TRACE_END(name) do {} while (0)
+#define TRACE_INSTANT(name, arg) do {} while (0)
+#define TRACE_SCOPE(name, arg) do {} while (0)
+#endif
@@ -1,3 +1,5 @@
+#define LOG_CATEGORY LogCategory::Web
+
 #include "WebServerFeature.h"
 #include "DeviceInfo.h"
 #include "LoggingFeature.h"
@@ -7,12 +9,14 @@
 #include "ResetManager.h"
 #include <WiFi.h>
 #include <esp_task_wdt.h>
+#include <memory>
 
 #include <esp_ota_ops.h>
-#include <Update.h>
+#include <mbedtls/sha256.h>
 
 #include "ResetDiagnostics.h"
 #include "CpuMonitor.h"
+#include "OtaUpdate.h"
 
 #ifndef FIRMWARE_GIT_SHA
 #define FIRMWARE_GIT_SHA unknown
@@ -22,11 +26,23 @@
 #define FIRMWARE_BUILD_UNIX 0
 #endif
 
+// Largest body accepted by /api/update/chunk (buffered for the hash check)
+#ifndef OTA_MAX_CHUNK
+#define OTA_MAX_CHUNK 16384
+#endif
+
 #define _STR_HELPER(x) #x
 #define _STR(x) _STR_HELPER(x)
 // Access global storage instance defined in main.cpp
 extern StorageFeature storage;
 
+namespace {
+    // File upload in progress (one at a time), written chunk by chunk as it arrives
+    std::unique_ptr<StorageFeature::Writer> s_upload;
+    AsyncWebServerRequest* s_uploadRequest = nullptr;
+    bool s_uploadFailed = false;
+}
+
 WebServerFeature::WebServerFeature(uint16_t port, const char* username, const char* password)
     : _port(port)
     , _username(username)
@@ -96,7 +112,7 @@ void WebServerFeature::setupDefaultRoutes() {
             "</form>";
         html += "<form action='/api/update' method='post' enctype='multipart/form-data' onsubmit=\"return confirm('Upload firmware and reboot?')\">"
             "<strong>/api/update</strong> <small>(HTTP OTA)</small> "
-            "<input type='file' name='firmware' accept='.bin'> "
+            "<input type='file' name='firmware' accept='.bin,.gz'> "
             "<button type='submit'>Upload</button>"
             "</form>";
         html += "</div>";
@@ -355,8 +371,17 @@ void WebServerFeature::setupDefaultRoutes() {
             return request->send(404, "application/json", "{\"error\":\"not found\"}");
         }
 
-        String content = storage.readFile(path.c_str());
-        AsyncWebServerResponse* response = request->beginResponse(200, "application/octet-stream", content);
+        // Streamed from the file in TCP sized pieces, never held in RAM as a whole
+        auto reader = std::make_shared<StorageFeature::Reader>(storage.openReader(path.c_str()));
+        if (!*reader) {
+            return request->send(404, "application/json", "{\"error\":\"not found\"}");
+        }
+        AsyncWebServerResponse* response = request->beginResponse(
+            "application/octet-stream", reader->size(),
+            [reader](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+                (void)index;
+                return reader->read(buffer, maxLen);
+            });
         // Add Content-Disposition header for attachment with filename
         int slash = path.lastIndexOf('/');
         String fname = (slash >= 0) ? path.substring(slash + 1) : path;
@@ -364,6 +389,137 @@ void WebServerFeature::setupDefaultRoutes() {
         request->send(response);
     });
 
+    // File upload endpoint (multipart), replaces the file at 'path'
+    // Usage: curl -u admin:password -F "file=@device.json" 'http://device/api/storage/file?path=/modbus/devices/device.json'
+    _server->on("/api/storage/file", HTTP_POST,
+        [this](AsyncWebServerRequest* request) {
+            if (_authEnabled && !authenticate(request)) {
+                return request->requestAuthentication();
+            }
+            if (s_uploadRequest != request) {
+                return request->send(400, "application/json", "{\"error\":\"missing 'path' parameter or file\"}");
+            }
+
+            const bool ok = s_upload && !s_uploadFailed;
+            const size_t written = s_upload ? s_upload->written() : 0;
+            s_upload.reset();
+            s_uploadRequest = nullptr;
+            if (!ok) {
+                return request->send(500, "application/json", "{\"error\":\"upload failed\"}");
+            }
+
+            JsonDocument doc;
+            doc["path"] = request->getParam("path")->value();
+            doc["size"] = (uint32_t)written;
+            String out;
+            serializeJson(doc, out);
+            request->send(200, "application/json", out);
+        },
+        [this](AsyncWebServerRequest* request, String filename, size_t index, uint8_t* data, size_t len, bool final) {
+            if (_authEnabled && !authenticate(request)) return;
+            if (!request->hasParam("path") || !storage.isReady()) return;
+
+            if (index == 0) {
+                if (s_upload) {
+                    // Previous upload never completed (client went away)
+                    LOG_W("Discarding unfinished upload");
+                    s_upload->abort();
+                }
+                const String path = request->getParam("path")->value();
+                s_uploadRequest = request;
+                s_uploadFailed = false;
+                s_upload.reset(new StorageFeature::Writer(storage.openWriter(path.c_str())));
+                if (!*s_upload) {
+                    s_uploadFailed = true;
+                    return;
+                }
+                LOG_I("Upload started: %s -> %s", filename.c_str(), path.c_str());
+            }
+            if (s_uploadRequest != request || !s_upload || s_uploadFailed) return;
+
+            if (len > 0 && s_upload->write(data, len) != len) {
+                s_uploadFailed = true;
+                s_upload->abort();
+                return;
+            }
+            if (final) {
+                if (!s_upload->close()) {
+                    s_uploadFailed = true;
+                    s_upload->abort();
+                } else {
+                    LOG_I("Upload complete: %u bytes", s_upload->written());
+                }
+            }
+        }
+    );
+
+    // Filesystem latency histograms and the last benchmark result
+    _server->on("/api/storage/perf", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        if (_authEnabled && !authenticate(request)) {
+            return request->requestAuthentication();
+        }
+
+        JsonDocument doc;
+        JsonObject ops = doc["ops"].to<JsonObject>();
+        for (size_t i = 0; i < (size_t)StorageFeature::FsOp::Count; i++) {
+            const auto op = (StorageFeature::FsOp)i;
+            StorageFeature::latency(op).snapshot().toJson(ops[StorageFeature::opName(op)].to<JsonObject>());
+        }
+        doc["bytesRead"] = StorageFeature::bytesRead();
+        doc["bytesWritten"] = StorageFeature::bytesWritten();
+
+        JsonObject bench = doc["benchmark"].to<JsonObject>();
+        bench["running"] = storage.isBenchmarkRunning();
+        const StorageFeature::BenchmarkResult r = storage.getBenchmarkResult();
+        if (r.valid) {
+            bench["sizeBytes"] = r.sizeBytes;
+            bench["durationMs"] = r.durationMs;
+            bench["seqWriteKBps"] = r.seqWriteKBps;
+            bench["seqReadKBps"] = r.seqReadKBps;
+            bench["randomReadAvgUs"] = r.randomReadAvgUs;
+            bench["randomReadMaxUs"] = r.randomReadMaxUs;
+            bench["appendAvgUs"] = r.appendAvgUs;
+            bench["appendMaxUs"] = r.appendMaxUs;
+            bench["replaceAvgUs"] = r.replaceAvgUs;
+            bench["replaceMaxUs"] = r.replaceMaxUs;
+        } else if (r.error[0] != '\0') {
+            bench["error"] = r.error;
+        }
+
+        String out;
+        serializeJson(doc, out);
+        request->send(200, "application/json", out);
+    });
+
+    // Start the filesystem benchmark (runs in the background, poll GET /api/storage/perf)
+    _server->on("/api/storage/perf/bench", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        if (_authEnabled && !authenticate(request)) {
+            return request->requestAuthentication();
+        }
+
+        if (!storage.isReady()) {
+            return request->send(500, "application/json", "{\"error\":\"storage not mounted\"}");
+        }
+        long sizeKb = 64;
+        if (request->hasParam("sizeKb", true)) sizeKb = request->getParam("sizeKb", true)->value().toInt();
+        else if (request->hasParam("sizeKb")) sizeKb = request->getParam("sizeKb")->value().toInt();
+        if (sizeKb < 4 || sizeKb > 512) {
+            return request->send(400, "application/json", "{\"error\":\"sizeKb must be 4..512\"}");
+        }
+        if (!storage.startBenchmark((size_t)sizeKb * 1024)) {
+            return request->send(409, "application/json", "{\"error\":\"benchmark already running\"}");
+        }
+        request->send(202, "application/json", "{\"started\":true}");
+    });
+
+    _server->on("/api/storage/perf/reset", HTTP_POST, [this](AsyncWebServerRequest* request) {
+        if (_authEnabled && !authenticate(request)) {
+            return request->requestAuthentication();
+        }
+        StorageFeature::resetLatency();
+        request->send(200, "application/json", "{\"reset\":true}");
+    });
+
     // Storage diagnostics endpoint (requires auth) - REGISTERED LAST so specific routes match first
     _server->on("/api/storage", HTTP_GET, [this](AsyncWebServerRequest* request) {
         if (_authEnabled && !authenticate(request)) {
@@ -381,8 +537,16 @@ void WebServerFeature::setupDefaultRoutes() {
         json += "\"free\":" + String(storage.freeBytes()) + ",";
         json += "\"root\":" + storage.listDir("/") + ",";
         json += "\"modbus\":" + storage.listDir("/modbus") + ",";
-        json += "\"data\":" + storage.listDir("/data");
-        json += "}";
+        json += "\"data\":" + storage.listDir("/data") + ",";
+        const StorageFeature::WriteBackStats wb = storage.getWriteBackStats();
+        json += "\"writeBack\":{";
+        json += "\"delayMs\":" + String(storage.getWriteBackDelay()) + ",";
+        json += "\"pending\":" + String((uint32_t)wb.pending) + ",";
+        json += "\"commits\":" + String(wb.commits) + ",";
+        json += "\"coalesced\":" + String(wb.coalesced) + ",";
+        json += "\"failures\":" + String(wb.failures) + ",";
+        json += "\"bytes\":" + String((uint32_t)wb.bytes);
+        json += "}}";
 
         request->send(200, "application/json", json);
     });
@@ -541,8 +705,105 @@ void WebServerFeature::setupDefaultRoutes() {
         request->send(200, "text/plain", "OK");
     });
 
-    // HTTP OTA firmware update endpoint
-    // Usage: curl -u admin:password -F "firmware=@.pio/build/serial/firmware.bin" http://device/api/update
+    // Resumable OTA: the image (raw or compressed) is sent as raw request bodies
+    // at increasing offsets. After a dropped connection, GET /api/update/status
+    // tells the offset to continue at.
+    _server->on("/api/update/status", HTTP_GET, [this](AsyncWebServerRequest* request) {
+        if (_authEnabled && !authenticate(request)) return request->requestAuthentication();
+
+        JsonDocument doc;
+        doc["active"] = OtaUpdate::isActive();
+        doc["offset"] = (uint32_t)OtaUpdate::receivedBytes();
+        doc["written"] = (uint32_t)OtaUpdate::writtenBytes();
+        doc["format"] = OtaUpdate::formatName();
+        if (OtaUpdate::lastError()[0] != '\0') doc["error"] = OtaUpdate::lastError();
+
+        String out;
+        serializeJson(doc, out);
+        request->send(200, "application/json", out);
+    });
+
+    _server->on("/api/update/chunk", HTTP_POST,
+        [this](AsyncWebServerRequest* request) {
+            if (_authEnabled && !authenticate(request)) return request->requestAuthentication();
+
+            if (!request->hasParam("offset") || !request->hasParam("sha256")) {
+                request->send(400, "application/json", "{\"error\":\"Missing offset or sha256 parameter\"}");
+                return;
+            }
+            const size_t len = request->contentLength();
+            if (!request->_tempObject || len == 0) {
+                request->send(413, "application/json", "{\"error\":\"Missing or too large chunk\"}");
+                return;
+            }
+
+            const uint8_t* chunk = (const uint8_t*)request->_tempObject;
+            uint8_t digest[32];
+            mbedtls_sha256(chunk, len, digest, 0);
+            char digestHex[65];
+            for (size_t i = 0; i < sizeof(digest); i++) {
+                snprintf(digestHex + i * 2, 3, "%02x", digest[i]);
+            }
+            if (!request->getParam("sha256")->value().equalsIgnoreCase(digestHex)) {
+                request->send(422, "application/json", "{\"error\":\"Chunk hash mismatch, resend\"}");
+                return;
+            }
+
+            const size_t offset = (size_t)request->getParam("offset")->value().toInt();
+            if (offset == 0) {
+                if (!OtaUpdate::begin("chunked")) {
+                    request->send(500, "application/json", "{\"error\":\"Update begin failed\"}");
+                    return;
+                }
+            } else if (!OtaUpdate::isActive() || offset != OtaUpdate::receivedBytes()) {
+                JsonDocument doc;
+                doc["error"] = "Offset mismatch";
+                doc["expectedOffset"] = OtaUpdate::isActive() ? (uint32_t)OtaUpdate::receivedBytes() : 0;
+                String out;
+                serializeJson(doc, out);
+                request->send(409, "application/json", out);
+                return;
+            }
+
+            if (!OtaUpdate::write(chunk, len)) {
+                request->send(500, "application/json", "{\"error\":\"Update write failed\"}");
+                return;
+            }
+
+            const bool final = request->hasParam("final");
+            if (final && !OtaUpdate::end()) {
+                request->send(500, "application/json", "{\"error\":\"Update failed\"}");
+                return;
+            }
+
+            JsonDocument doc;
+            doc["offset"] = (uint32_t)OtaUpdate::receivedBytes();
+            doc["written"] = (uint32_t)OtaUpdate::writtenBytes();
+            doc["complete"] = final;
+            String out;
+            serializeJson(doc, out);
+            AsyncWebServerResponse* response = request->beginResponse(200, "application/json", out);
+            if (final) response->addHeader("Connection", "close");
+            request->send(response);
+
+            if (final) {
+                LOG_I("HTTP OTA update successful, scheduling restart");
+                ResetManager::scheduleRestart(1000, "http_ota");
+            }
+        },
+        nullptr,
+        // Chunk body: buffered so the hash can be checked before anything is flashed
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t len, size_t index, size_t total) {
+            if (_authEnabled && !authenticate(request)) return;
+            if (total > OTA_MAX_CHUNK) return;
+            if (index == 0) request->_tempObject = malloc(total);
+            if (!request->_tempObject || index + len > total) return;
+            memcpy((uint8_t*)request->_tempObject + index, data, len);
+        });
+
+    // HTTP OTA firmware update endpoint (after /api/update/..., which it would also match)
+    // Accepts raw, gzip or zlib compressed images (detected from the data).
+    // Usage: curl -u admin:password -F "firmware=@.pio/build/serial/firmware.bin.gz" http://device/api/update
     _server->on("/api/update", HTTP_POST, 
         // Request handler (called after upload completes)
         [this](AsyncWebServerRequest* request) {
@@ -552,7 +813,8 @@ void WebServerFeature::setupDefaultRoutes() {
                 return request->requestAuthentication();
             }
             
-            bool success = !Update.hasError();
+            bool success = !OtaUpdate::isActive() && OtaUpdate::lastError()[0] == '\0' &&
+                           OtaUpdate::writtenBytes() > 0;
             AsyncWebServerResponse* response = request->beginResponse(
                 success ? 200 : 500, 
                 "application/json",
@@ -575,37 +837,30 @@ void WebServerFeature::setupDefaultRoutes() {
             
             if (index == 0) {
                 Serial.printf("\n[OTA] Starting: %s, free heap: %u\n", filename.c_str(), ESP.getFreeHeap());
-                LOG_I("HTTP OTA update starting: %s", filename.c_str());
-                if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
-                    Serial.printf("[OTA] Begin FAILED: %s\n", Update.errorString());
-                    LOG_E("HTTP OTA begin failed: %s", Update.errorString());
+                if (!OtaUpdate::begin(filename.c_str())) {
+                    Serial.printf("[OTA] Begin FAILED: %s\n", OtaUpdate::lastError());
                     return;
                 }
                 Serial.println("[OTA] Begin OK");
             }
             
             if (len > 0) {
-                size_t written = Update.write(data, len);
-                if (written != len) {
-                    Serial.printf("[OTA] Write FAILED at %u: %s\n", index, Update.errorString());
-                    LOG_E("HTTP OTA write failed: %s", Update.errorString());
+                if (!OtaUpdate::write(data, len)) {
+                    Serial.printf("[OTA] Write FAILED at %u: %s\n", index, OtaUpdate::lastError());
                     return;
                 }
                 if ((index % 102400) < len) {
                     Serial.printf("[OTA] %uKB, heap: %u\n", (index + len) / 1024, ESP.getFreeHeap());
                 }
-                esp_task_wdt_reset();
                 yield();
             }
             
             if (final) {
                 Serial.printf("[OTA] Finalizing at %u bytes\n", index + len);
-                if (Update.end(true)) {
+                if (OtaUpdate::end()) {
                     Serial.println("[OTA] SUCCESS");
-                    LOG_I("HTTP OTA update complete: %u bytes", index + len);
                 } else {
-                    Serial.printf("[OTA] End FAILED: %s\n", Update.errorString());
-                    LOG_E("HTTP OTA end failed: %s", Update.errorString());
+                    Serial.printf("[OTA] End FAILED: %s\n", OtaUpdate::lastError());
                 }
             }
         }
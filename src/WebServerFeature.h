@@ -19,6 +19,8 @@ public:
     WebServerFeature(uint16_t port, const char* username, const char* password);
     
     void setup() override;
+    uint8_t dependencies() const override { return NEEDS_NETWORK; }  // begin() binds a socket
+    uint32_t dueInMs() override { return NOT_DUE; }  // requests are served by the AsyncTCP task
     const char* getName() const override { return "WebServer"; }
     bool isReady() const override { return _ready; }
     
@@ -1,5 +1,8 @@
+#define LOG_CATEGORY LogCategory::WiFi
+
 #include "WiFiManagerFeature.h"
 #include "LoggingFeature.h"
+#include "LoopScheduler.h"
 #include <WiFi.h>
 
 WiFiManagerFeature::WiFiManagerFeature(const char* apName, const char* apPassword, uint16_t configPortalTimeout)
@@ -35,12 +38,31 @@ void WiFiManagerFeature::setup() {
         _wifiManager.autoConnect(_apName);
     }
     
+    // Connection changes are handled by loop() right away instead of at its next poll
+    WiFi.onEvent([](WiFiEvent_t, WiFiEventInfo_t) { LoopScheduler::wake(); });
+
     _state = State::CONNECTING;
     _setupDone = true;
     
     LOG_I("WiFi connection initiated, AP name: %s", _apName);
 }
 
+uint32_t WiFiManagerFeature::dueInMs() {
+    // The config portal serves DNS and HTTP from process()
+    if (_wifiManager.getConfigPortalActive() || _wifiManager.getWebPortalActive()) return WIFI_PORTAL_POLL_MS;
+
+    switch (_state) {
+        case State::CONNECTING:
+            return WiFi.status() == WL_CONNECTED ? 0 : WIFI_CONNECT_POLL_MS;
+        case State::CONNECTED:
+            return WiFi.status() == WL_CONNECTED ? NOT_DUE : 0;
+        case State::DISCONNECTED:
+            return LoopScheduler::remainingMs(millis() - _lastReconnectAttempt, RECONNECT_INTERVAL);
+        default:
+            return NOT_DUE;
+    }
+}
+
 void WiFiManagerFeature::loop() {
     // Process WiFiManager (needed for non-blocking mode)
     _wifiManager.process();
@@ -20,6 +20,8 @@ public:
     
     void setup() override;
     void loop() override;
+    uint32_t dueInMs() override;
+    bool setupBlocks() const override { return true; }  // autoConnect() waits for the connection
     const char* getName() const override { return "WiFiManager"; }
     bool isReady() const override { return _connected; }
     
@@ -48,6 +50,8 @@ private:
     bool _setupDone;
     unsigned long _lastReconnectAttempt;
     static const unsigned long RECONNECT_INTERVAL = 30000; // 30 seconds
+    static const uint32_t WIFI_PORTAL_POLL_MS = 10;
+    static const uint32_t WIFI_CONNECT_POLL_MS = 500;      // WiFi events wake the loop earlier
 };
 
 #endif // WIFIMANAGER_FEATURE_H
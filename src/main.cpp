@@ -5,6 +5,8 @@
 #include "TimeSyncFeature.h"
 #include "WebServerFeature.h"
 #include "StorageFeature.h"
+#include "KvStore.h"
+#include "BootStats.h"
 #include "InfluxDBFeature.h"
 #include "MQTTFeature.h"
 #include "LEDFeature.h"
@@ -15,9 +17,21 @@
 #include "ModbusDevice.h"
 #include "ModbusWeb.h"
 #include "ModbusIntegration.h"
+#include "ModbusSnapshot.h"
 #include "ResetManager.h"
 #include "ResetDiagnostics.h"
 #include "CpuMonitor.h"
+#include "OtaUpdate.h"
+#include "MetricsExporter.h"
+#include "LogWeb.h"
+#include "LoopProfiler.h"
+#include "TaskMonitor.h"
+#include "HeapMonitor.h"
+#include "Trace.h"
+#include "StallMonitor.h"
+#include "LoopScheduler.h"
+#include "FeatureTasks.h"
+#include "Startup.h"
 #include <ArduinoJson.h>
 #include <esp_ota_ops.h>
 
@@ -94,6 +108,9 @@ LoggingFeature logging(
 WiFiManagerFeature wifiManager("", "", WIFI_CONFIG_PORTAL_TIMEOUT);  // AP name and password set in setup()
 TimeSyncFeature timeSync(NTP_SERVER1, NTP_SERVER2, TIMEZONE, NTP_SYNC_INTERVAL);
 StorageFeature storage(true);  // Format on fail
+
+// Small persistent state (counters, learned settings), appended to /kv.log
+KvStore kvStore(storage);
 WebServerFeature webServer(WEBSERVER_PORT, WEBSERVER_USERNAME, "");  // Password set in setup()
 
 // InfluxDB: supports V1.x (user/password) and V2.x (org/bucket/token)
@@ -131,8 +148,9 @@ MQTTFeature mqtt(
 );
 
 // Modbus RTU feature - monitors bus and handles requests
+Hal::HardwareUart modbusUart(Serial2);
 ModbusRTUFeature modbus(
-    Serial2,                    // Hardware serial port
+    modbusUart,                 // Hardware serial port
     MODBUS_BAUD_RATE,
     MODBUS_SERIAL_CONFIG,
     MODBUS_SERIAL_RX,
@@ -155,20 +173,31 @@ const HASensorConfig sensorHAConfig[] = {
 // Modbus device manager (declared here, initialized after storage is ready)
 ModbusDeviceManager* modbusDevices = nullptr;
 
-// Array of all features for easy iteration
+// Array of all features for easy iteration (and their setup order, see Startup)
 Feature* features[] = {
     &logging,      // Must be first for early logging
     &led,          // LED setup early to indicate boot
-    &wifiManager,  // Must be before network-dependent features
-    &timeSync,
     &storage,      // Filesystem before features that need it
+    &kvStore,
+    &modbus,       // Modbus RTU bus monitor, polls without network
+    &wifiManager,  // Connects in a helper task
+    &timeSync,
     &webServer,
     &influxDB,
-    &mqtt,         // MQTT after network is ready
-    &modbus        // Modbus RTU bus monitor
+    &mqtt
 };
 const size_t featureCount = sizeof(features) / sizeof(features[0]);
 
+// Heap attribution of each feature's loop()
+HeapTag heapTagFor(const Feature* feature) {
+    if (feature == &modbus) return HeapTag::Modbus;
+    if (feature == &influxDB) return HeapTag::Influx;
+    if (feature == &mqtt) return HeapTag::MQTT;
+    if (feature == &webServer) return HeapTag::Web;
+    if (feature == &storage || feature == &kvStore) return HeapTag::Storage;
+    return HeapTag::Other;
+}
+
 // ============================================
 // Data Collection Timer
 // ============================================
@@ -214,6 +243,7 @@ void setup() {
     // Capture reset reason + boot counter early for diagnostics.
     ResetDiagnostics::init();
     ResetDiagnostics::setBreadcrumb("setup", "start");
+    LoopScheduler::setup();
 
     // Ensure OTA updates stick even when rollback is enabled.
     // Must run early, before any long initialization.
@@ -254,8 +284,22 @@ void setup() {
         const String resetTopic = mqttBaseTopic + "/cmd/reset";
         const String restartTopic = mqttBaseTopic + "/cmd/restart";
         const String modbusRawReadTopic = mqttBaseTopic + "/modbus/cmd/raw/read";
+        const String logLevelTopic = mqttBaseTopic + "/cmd/loglevel";
         const String t(topic);
-        if (t != resetTopic && t != restartTopic && t != modbusRawReadTopic) return;
+        if (t != resetTopic && t != restartTopic && t != modbusRawReadTopic && t != logLevelTopic) return;
+
+        // Log level command
+        // Topic: <base>/cmd/loglevel, payload "<category>=<level>" (e.g. "ModbusRTU=verbose", "all=info")
+        if (t == logLevelTopic) {
+            String p(payload);
+            p.trim();
+            const int eq = p.indexOf('=');
+            const bool ok = eq > 0 &&
+                logging.applyCategoryLevel(p.substring(0, eq).c_str(), p.substring(eq + 1).c_str());
+            if (!ok) LOG_W("MQTT loglevel ignored (payload='%s')", payload);
+            mqtt.publishToBase("status/loglevel", ok ? p.c_str() : "invalid", false);
+            return;
+        }
 
         if (t == resetTopic || t == restartTopic) {
             String p(payload);
@@ -385,11 +429,20 @@ void setup() {
     LOG_I("RTC Reset Reason Core0/Core1: %u/%u", (unsigned)ResetDiagnostics::rtcResetReasonCore0(), (unsigned)ResetDiagnostics::rtcResetReasonCore1());
     LOG_I("======================================");
     
-    // Initialize all features
+    // Readiness conditions the startup steps below wait for
+    Startup::setCondition(Feature::NEEDS_STORAGE, [] { return Startup::isSetUp(&storage); });
+    Startup::setCondition(Feature::NEEDS_UART, [] { return modbus.isReady(); });
+    Startup::setCondition(Feature::NEEDS_WIFI, [] { return WiFi.status() == WL_CONNECTED; });
+    Startup::setCondition(Feature::NEEDS_TIME, [] { return timeSync.isSynced(); });
+    Startup::setCondition(Feature::NEEDS_WEB, [] { return webServer.isReady(); });
+    Startup::setCondition(Feature::NEEDS_NETWORK, [] { return Startup::isSetUp(&wifiManager); });
+
+    // Features with a TaskConfig stack size continue in tasks of their own
+    Startup::onFeatureReady([](Feature* feature) { FeatureTasks::start(&feature, 1, heapTagFor); });
+
+    // Initialize all features, each once its dependencies are met
     for (size_t i = 0; i < featureCount; i++) {
-        ResetDiagnostics::setBreadcrumb("setup", features[i]->getName());
-        features[i]->setup();
-        LOG_I("Feature '%s' setup complete", features[i]->getName());
+        Startup::addFeature(features[i]);
     }
     
     // Set device ID on data collections for InfluxDB tags
@@ -399,89 +452,193 @@ void setup() {
     // sensorData.enablePersistence(&storage, "/data/sensors.json", 5000);
     
     // Load any previously saved data
-    if (storage.isReady()) {
-        String json = storage.readFile("/data/sensors.json");
-        if (json.length() > 0) {
-            sensorData.fromJson(json);
+    Startup::add("sensorData", Feature::NEEDS_STORAGE, [] {
+        StorageFeature::Reader reader = storage.openReader("/data/sensors.json");
+        if (reader && reader.size() > 0) {
+            sensorData.fromJson(reader);
             LOG_I("Loaded %u sensor readings from storage", sensorData.count());
         }
-    }
+        return true;
+    });
     
+    // Boot and uptime counters that survive power loss (the RTC boot count doesn't)
+    Startup::add("bootStats", Feature::NEEDS_STORAGE, [] {
+        if (!Startup::isSetUp(&kvStore)) return false;
+        BootStats::setup(kvStore);  // no-op if the store failed to load
+        return true;
+    });
+
     // Register web endpoints for sensor data collection
     // Creates: /api/sensors (JSON all), /api/sensors/latest (JSON latest), /view/sensors (HTML table)
-    DataCollectionWeb::registerCollection(
-        webServer,
-        sensorData,
-        "sensors",
-        5000  // Refresh every 5 seconds
-    );
+    Startup::add("sensorWeb", Feature::NEEDS_WEB, [] {
+        DataCollectionWeb::registerCollection(
+            webServer,
+            sensorData,
+            "sensors",
+            5000  // Refresh every 5 seconds
+        );
+        return true;
+    });
     
-    // Initialize Modbus device manager with device definitions from filesystem
-    modbusDevices = new ModbusDeviceManager(modbus, storage);
-    if (storage.isReady()) {
-        LOG_I("Free heap before Modbus init: %d bytes", ESP.getFreeHeap());
-        
-        // Load device type definitions from /modbus/devices/*.json
-        modbusDevices->loadAllDeviceTypes(MODBUS_DEVICE_TYPES_PATH);
-        LOG_I("Free heap after loading device types: %d bytes", ESP.getFreeHeap());
-        
-        // Load unit ID to device type mapping
-        modbusDevices->loadDeviceMappings(MODBUS_DEVICE_MAP_PATH);
-        LOG_I("Free heap after loading device mappings: %d bytes", ESP.getFreeHeap());
-        
-        LOG_I("Modbus devices loaded: %d device types, %d mapped units",
-              modbusDevices->getDeviceTypeNames().size(),
-              modbusDevices->getDevices().size());
-        
-        // Register callback for Modbus value changes -> InfluxDB + MQTT
-        modbusDevices->onValueChange([](uint8_t unitId, const char* deviceName,
-                                        const char* registerName, float value,
-                                        const char* unit) {
-            // Queue to InfluxDB
-            ModbusIntegration::queueValueToInfluxDB(&influxDB, unitId, deviceName,
-                                                     registerName, value, unit, "modbus");
+    // Initialize Modbus device manager with device definitions from filesystem.
+    // Needs no network: polling starts while WiFi is still connecting.
+    Startup::add("modbusDevices", Feature::NEEDS_STORAGE | Feature::NEEDS_UART, [] {
+        modbusDevices = new ModbusDeviceManager(modbus, storage);
+        if (storage.isReady()) {
+            LOG_I("Free heap before Modbus init: %d bytes", ESP.getFreeHeap());
             
-            // Publish individual value to MQTT
-            String modbusTopic = mqttBaseTopic + "/modbus";
-            ModbusIntegration::publishRegisterValue(&mqtt, unitId, deviceName,
-                                                     registerName, value, modbusTopic.c_str(), true /* retain */);
+            // Load device type definitions from /modbus/devices/*.json
+            modbusDevices->loadAllDeviceTypes(MODBUS_DEVICE_TYPES_PATH);
+            LOG_I("Free heap after loading device types: %d bytes", ESP.getFreeHeap());
             
-            // Pulse LED to indicate Modbus data received
-            led.pulse();
+            // Load unit ID to device type mapping
+            modbusDevices->loadDeviceMappings(MODBUS_DEVICE_MAP_PATH);
+            LOG_I("Free heap after loading device mappings: %d bytes", ESP.getFreeHeap());
             
-            LOG_V("Modbus value: %s/%s = %.4f %s", deviceName, registerName, value, unit);
-        });
-    }
-    
-    // Register Modbus web endpoints
-    ModbusWeb::setup(webServer, modbus, *modbusDevices);
+            LOG_I("Modbus devices loaded: %d device types, %d mapped units",
+                  modbusDevices->getDeviceTypeNames().size(),
+                  modbusDevices->getDevices().size());
+            
+            // Register callback for Modbus value changes -> InfluxDB + MQTT
+            modbusDevices->onValueChange([](uint8_t unitId, const char* deviceName,
+                                            const char* registerName, float value,
+                                            const char* unit) {
+                // Queue to InfluxDB
+                ModbusIntegration::queueValueToInfluxDB(&influxDB, unitId, deviceName,
+                                                         registerName, value, unit, "modbus");
+                
+                // Publish individual value to MQTT
+                String modbusTopic = mqttBaseTopic + "/modbus";
+                ModbusIntegration::publishRegisterValue(&mqtt, unitId, deviceName,
+                                                         registerName, value, modbusTopic.c_str(), true /* retain */);
+                
+                // Pulse LED to indicate Modbus data received
+                led.pulse();
+                
+                LOG_V("Modbus value: %s/%s = %.4f %s", deviceName, registerName, value, unit);
+            });
+        }
+        
+        // Last known values, poll phases and bus counters from before the restart
+        ModbusSnapshot::setup(*modbusDevices, modbus, storage);
+        return true;
+    });
     
-    LOG_I("All features initialized");
+    // Register Modbus web endpoints and the Prometheus scrape endpoint
+    Startup::add("modbusWeb", Feature::NEEDS_WEB, [] {
+        if (!modbusDevices) return false;
+        ModbusWeb::setup(webServer, modbus, *modbusDevices);
+        MetricsExporter::setup(webServer, modbus, modbusDevices, influxDB, mqtt);
+        return true;
+    });
+
+    // Diagnostics endpoints
+    StallMonitor::addQueue("modbus", [] { return modbus.getQueuedRequestCount(); });
+    StallMonitor::addQueue("influx", [] { return influxDB.pendingCount(); });
+    Startup::add("diagWeb", Feature::NEEDS_WEB, [] {
+        // Log history (/api/logs, /api/logs/stream)
+        LogWeb::setup(webServer);
+
+        // Loop time histograms (/api/perf)
+        LoopProfiler::setup(webServer);
+
+        // FreeRTOS task and core statistics (/api/tasks)
+        TaskMonitor::setup(webServer);
+
+        // Heap usage per subsystem and heap history (/api/heap)
+        HeapMonitor::setup(webServer);
+
+        // Span tracing (/api/trace)
+        Trace::setup(webServer);
+
+        // Boots per reset reason and uptime (/api/boots)
+        BootStats::setup(webServer);
+
+        // Main loop stall reports (/api/stalls)
+        StallMonitor::setup(webServer, storage);
+
+        // Startup steps and milestones (/api/startup)
+        Startup::setup(webServer);
+        return true;
+    });
+
+    // Timed on every boot, see /api/startup
+    Startup::addMilestone("wifi_connected", [] { return WiFi.status() == WL_CONNECTED; });
+    Startup::addMilestone("time_synced", [] { return timeSync.isSynced(); });
+    Startup::addMilestone("first_poll", [] { return modbus.getFirstRequestMs() != 0; });
+    Startup::addMilestone("first_upload", [] { return influxDB.getStats().successCount != 0; });
+
+    // Everything that doesn't wait for the network; the rest follows from loop()
+    Startup::run();
     LOG_I("Free heap: %d bytes", ESP.getFreeHeap());
     
     // Enable periodic CPU stats logging (every 60 seconds)
     CpuMonitor::setLogInterval(60000);
 
-    // Setup complete - turn off LED (will pulse on activity)
-    led.setupComplete();
     ResetDiagnostics::setBreadcrumb("setup", "done");
 }
 
+// Runs in the loop task: not a feature task and setup() returned
+bool runsInLoop(const Feature* feature) {
+    return Startup::isSetUp(feature) && !FeatureTasks::isDetached(feature);
+}
+
 void loop() {
     CpuMonitor::markLoopStart();
+    LoopProfiler::markLoopStart();
+    StallMonitor::checkIn();
+
+    // Keep the RS485 bus quiet only while OTA data is actually being flashed
+    if (OtaUpdate::isFlashing() != modbus.isSuspended()) {
+        if (modbus.isSuspended()) {
+            modbus.resume();
+        } else {
+            modbus.suspend();
+        }
+    }
 
-    // Run all feature loop handlers
+    // Setups waiting for a condition or a helper task, boot milestones
+    static bool setupCompleteShown = false;
+    static bool startupReported = false;
+    if (!startupReported) {
+        ResetDiagnostics::setBreadcrumb("job", "startup");
+        Startup::loop();
+        if (!setupCompleteShown && Startup::isDone()) {
+            // Setup complete - turn off LED (will pulse on activity)
+            led.setupComplete();
+            setupCompleteShown = true;
+        }
+        if (setupCompleteShown && Startup::milestonesReached()) {
+            influxDB.queue(Startup::toLineProtocol(deviceId.c_str()));
+            startupReported = true;
+        }
+    }
+
+    // Run the feature loop handlers that have something to do
     for (size_t i = 0; i < featureCount; i++) {
+        if (!runsInLoop(features[i]) || features[i]->dueInMs() != 0) continue;
         ResetDiagnostics::setBreadcrumb("loop", features[i]->getName());
+        HeapMonitor::Scope heap(heapTagFor(features[i]));
         const uint32_t startUs = (uint32_t)micros();
         features[i]->loop();
         const uint32_t durUs = (uint32_t)((uint32_t)micros() - startUs);
         ResetDiagnostics::recordLoopDurationUs(features[i]->getName(), durUs);
+        LoopProfiler::record(features[i]->getName(), durUs);
     }
     
+    // Modbus callbacks (pollers, value change publishing) run here, also
+    // when the ModbusRTU feature has a task of its own
+    {
+        ResetDiagnostics::setBreadcrumb("job", "modbusCallbacks");
+        HeapMonitor::Scope heap(HeapTag::Modbus);
+        modbus.deliverCallbacks();
+    }
+
     // Publish Home Assistant autodiscovery once MQTT is connected
     if (mqtt.isConnected() && !haDiscoveryPublished) {
         ResetDiagnostics::setBreadcrumb("job", "haDiscovery");
+        LoopProfiler::Scope perf("haDiscovery");
+        HeapMonitor::Scope heap(HeapTag::MQTT);
         String deviceName = String(DeviceInfo::getFirmwareName()) + " " + deviceId;
         DataCollectionMQTT::publishDiscovery(
             &mqtt,
@@ -505,7 +662,8 @@ void loop() {
             bool ok1 = mqtt.subscribeToBase("cmd/reset");
             bool ok2 = mqtt.subscribeToBase("cmd/restart");
             bool ok3 = mqtt.subscribeToBase("modbus/cmd/raw/read");
-            mqttResetCmdSubscribed = (ok1 && ok2 && ok3);
+            bool ok4 = mqtt.subscribeToBase("cmd/loglevel");
+            mqttResetCmdSubscribed = (ok1 && ok2 && ok3 && ok4);
             LOG_I("MQTT reset cmd subscribed: %s", mqttResetCmdSubscribed ? "yes" : "no");
         }
     } else {
@@ -515,6 +673,8 @@ void loop() {
     // Publish Modbus Home Assistant autodiscovery once MQTT is connected
     if (mqtt.isConnected() && !modbusHADiscoveryPublished && modbusDevices) {
         ResetDiagnostics::setBreadcrumb("job", "modbusHADiscovery");
+        LoopProfiler::Scope perf("modbusHADiscovery");
+        HeapMonitor::Scope heap(HeapTag::MQTT);
         String modbusTopic = mqttBaseTopic + "/modbus";
         ModbusIntegration::publishDiscovery(
             &mqtt,
@@ -533,6 +693,8 @@ void loop() {
         millis() - lastModbusStatePublish >= MODBUS_STATE_PUBLISH_INTERVAL) {
         lastModbusStatePublish = millis();
         ResetDiagnostics::setBreadcrumb("job", "modbusStatePublish");
+        LoopProfiler::Scope perf("modbusStatePublish");
+        HeapMonitor::Scope heap(HeapTag::MQTT);
         String modbusTopic = mqttBaseTopic + "/modbus";
         ModbusIntegration::publishAllDeviceStates(&mqtt, *modbusDevices,
                                                    modbusTopic.c_str());
@@ -542,6 +704,7 @@ void loop() {
     if (millis() - lastDataCollection >= DATA_COLLECTION_INTERVAL) {
         lastDataCollection = millis();
         ResetDiagnostics::setBreadcrumb("job", "collectSensorData");
+        LoopProfiler::Scope perf("collectSensorData");
         collectSensorData();
     }
     
@@ -552,20 +715,83 @@ void loop() {
     sensorData.loop();
         const uint32_t durUs = (uint32_t)((uint32_t)micros() - startUs);
         ResetDiagnostics::recordLoopDurationUs("sensorData", durUs);
+        LoopProfiler::record("sensorData", durUs);
     }
     
     // Run Modbus device polling
     if (modbusDevices) {
         ResetDiagnostics::setBreadcrumb("loop", "modbusDevices");
+        HeapMonitor::Scope heap(HeapTag::Modbus);
         const uint32_t startUs = (uint32_t)micros();
         modbusDevices->loop();
         const uint32_t durUs = (uint32_t)((uint32_t)micros() - startUs);
         ResetDiagnostics::recordLoopDurationUs("modbusDevices", durUs);
+        LoopProfiler::record("modbusDevices", durUs);
     }
 
+    // Keep the boot snapshot current (RTC memory, flash now and then)
+    if (modbusDevices) {
+        ResetDiagnostics::setBreadcrumb("job", "modbusSnapshot");
+        LoopProfiler::Scope perf("modbusSnapshot");
+        HeapMonitor::Scope heap(HeapTag::Modbus);
+        ModbusSnapshot::loop();
+    }
+
+    // Complete batched Modbus reads requested via /api/modbus/batch
+    if (ModbusBatch::activeCount() > 0) {
+        ResetDiagnostics::setBreadcrumb("job", "modbusBatch");
+        LoopProfiler::Scope perf("modbusBatch");
+        HeapMonitor::Scope heap(HeapTag::Modbus);
+        ModbusBatch::loop();
+    }
+
+    // Answer long-poll raw reads (/api/modbus/raw/readTracked?wait=)
+    if (ModbusLongPoll::activeCount() > 0) {
+        ResetDiagnostics::setBreadcrumb("job", "modbusLongPoll");
+        LoopProfiler::Scope perf("modbusLongPoll");
+        HeapMonitor::Scope heap(HeapTag::Modbus);
+        ModbusLongPoll::loop();
+    }
+
+    // Uptime counters, saved every few minutes
+    BootStats::loop();
+
+    // Heap history and allocation rates
+    HeapMonitor::loop();
+    StallMonitor::loop();
+    FeatureTasks::loop();
+
+    // Task run time, core utilisation and stack watermarks
+    {
+        ResetDiagnostics::setBreadcrumb("job", "taskMonitor");
+        LoopProfiler::Scope perf("taskMonitor");
+        TaskMonitor::loop();
+    }
+
+    static uint32_t taskSamplesQueued = 0;
+    if (TaskMonitor::sampleCount() != taskSamplesQueued) {
+        taskSamplesQueued = TaskMonitor::sampleCount();
+        const String taskLines = TaskMonitor::toLineProtocol(deviceId.c_str());
+        if (taskLines.length() > 0) influxDB.queue(taskLines);
+    }
+
+    // Loop time histograms of the last complete window as Influx self-metrics
+    static uint32_t perfWindowsQueued = 0;
+    if (LoopProfiler::windowCount() != perfWindowsQueued) {
+        perfWindowsQueued = LoopProfiler::windowCount();
+        const String perfLines = LoopProfiler::toLineProtocol(deviceId.c_str());
+        if (perfLines.length() > 0) influxDB.queue(perfLines);
+    }
+
+    LoopProfiler::markLoopEnd();
     CpuMonitor::markLoopEnd();
 
-    // Small delay to allow WiFi/TCP stack and other background tasks to run.
-    // Without this, the tight loop can starve RTOS background tasks.
-    delay(2);
+    // Sleep until the next feature deadline or an event (UART data, WiFi,
+    // web request); gives the WiFi/TCP stack and other tasks their CPU time
+    uint32_t sleepMs = Feature::NOT_DUE;
+    for (size_t i = 0; i < featureCount && sleepMs > 0; i++) {
+        if (!runsInLoop(features[i])) continue;
+        sleepMs = std::min(sleepMs, features[i]->dueInMs());
+    }
+    LoopScheduler::sleep(sleepMs);
 }
@@ -0,0 +1,430 @@
+#pragma once
+
+// Arduino core stand-in for the native env: String, Print/Stream, IPAddress,
+// Serial (stdout) and the timing functions on the Hal virtual clock. Only
+// what the natively built modules use; behaviour follows the ESP32 core.
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include "Hal.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_system.h>
+
+using std::max;
+using std::min;
+
+// newlib has them, glibc only from 2.38
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+    const size_t len = strlen(src);
+    if (size) {
+        const size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = 0;
+    }
+    return len;
+}
+
+inline size_t strlcat(char* dst, const char* src, size_t size) {
+    const size_t used = strnlen(dst, size);
+    return used + strlcpy(dst + used, src, size - used);
+}
+#endif
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+#define SERIAL_8N1 0x800001c
+#define SERIAL_8E1 0x800001e
+#define SERIAL_8O1 0x800001f
+#define SERIAL_8N2 0x800003c
+#define SERIAL_8E2 0x800003e
+#define SERIAL_8O2 0x800003f
+
+class StringSumHelper;
+
+class String {
+public:
+    String() = default;
+    String(const char* s) : _s(s ? s : "") {}
+    String(const char* s, unsigned int len) : _s(s ? s : "", s ? len : 0) {}
+    explicit String(const std::string& s) : _s(s) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(unsigned char v, unsigned char base = 10) : _s(format((unsigned long long)v, base)) {}
+    explicit String(int v, unsigned char base = 10) : _s(formatSigned(v, base)) {}
+    explicit String(unsigned int v, unsigned char base = 10) : _s(format(v, base)) {}
+    explicit String(long v, unsigned char base = 10) : _s(formatSigned(v, base)) {}
+    explicit String(unsigned long v, unsigned char base = 10) : _s(format(v, base)) {}
+    explicit String(long long v, unsigned char base = 10) : _s(formatSigned(v, base)) {}
+    explicit String(unsigned long long v, unsigned char base = 10) : _s(format(v, base)) {}
+    explicit String(float v, unsigned int decimals = 2) : _s(formatFloat(v, decimals)) {}
+    explicit String(double v, unsigned int decimals = 2) : _s(formatFloat(v, decimals)) {}
+
+    String& operator=(const char* s) { _s = s ? s : ""; return *this; }
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+    char charAt(unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    void setCharAt(unsigned int i, char c) { if (i < _s.size()) _s[i] = c; }
+    char operator[](unsigned int i) const { return charAt(i); }
+    char& operator[](unsigned int i) { return _s[i]; }
+    const char* begin() const { return _s.c_str(); }
+    const char* end() const { return _s.c_str() + _s.size(); }
+
+    bool concat(const String& s) { _s += s._s; return true; }
+    bool concat(const char* s) { if (!s) return false; _s += s; return true; }
+    bool concat(const char* s, unsigned int len) { if (!s) return false; _s.append(s, len); return true; }
+    bool concat(char c) { _s += c; return true; }
+    bool concat(unsigned char v) { return concat(String(v)); }
+    bool concat(int v) { return concat(String(v)); }
+    bool concat(unsigned int v) { return concat(String(v)); }
+    bool concat(long v) { return concat(String(v)); }
+    bool concat(unsigned long v) { return concat(String(v)); }
+    bool concat(long long v) { return concat(String(v)); }
+    bool concat(unsigned long long v) { return concat(String(v)); }
+    bool concat(float v) { return concat(String(v)); }
+    bool concat(double v) { return concat(String(v)); }
+
+    template <typename T>
+    String& operator+=(const T& v) { concat(v); return *this; }
+
+    bool equals(const String& s) const { return _s == s._s; }
+    bool equals(const char* s) const { return s ? _s == s : _s.empty(); }
+    bool equalsIgnoreCase(const String& s) const { return strcasecmp(c_str(), s.c_str()) == 0; }
+    int compareTo(const String& s) const { return _s.compare(s._s); }
+    bool operator==(const String& s) const { return equals(s); }
+    bool operator==(const char* s) const { return equals(s); }
+    bool operator!=(const String& s) const { return !equals(s); }
+    bool operator!=(const char* s) const { return !equals(s); }
+    bool operator<(const String& s) const { return _s < s._s; }
+    bool operator>(const String& s) const { return _s > s._s; }
+    bool operator<=(const String& s) const { return _s <= s._s; }
+    bool operator>=(const String& s) const { return _s >= s._s; }
+
+    bool startsWith(const String& prefix) const { return _s.compare(0, prefix._s.size(), prefix._s) == 0; }
+    bool startsWith(const String& prefix, unsigned int offset) const {
+        return offset <= _s.size() && _s.compare(offset, prefix._s.size(), prefix._s) == 0;
+    }
+    bool endsWith(const String& suffix) const {
+        return suffix._s.size() <= _s.size() &&
+               _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+    }
+
+    int indexOf(char c, unsigned int from = 0) const { return toIndex(_s.find(c, from)); }
+    int indexOf(const String& s, unsigned int from = 0) const { return toIndex(_s.find(s._s, from)); }
+    int lastIndexOf(char c) const { return toIndex(_s.rfind(c)); }
+    int lastIndexOf(char c, unsigned int from) const { return toIndex(_s.rfind(c, from)); }
+    int lastIndexOf(const String& s) const { return toIndex(_s.rfind(s._s)); }
+
+    String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        if (from >= _s.size()) return String();
+        return String(_s.substr(from, std::min<size_t>(to, _s.size()) - from));
+    }
+
+    void remove(unsigned int index) { if (index < _s.size()) _s.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < _s.size()) _s.erase(index, count); }
+    void replace(char find, char replacement) { std::replace(_s.begin(), _s.end(), find, replacement); }
+    void replace(const String& find, const String& replacement) {
+        if (find._s.empty()) return;
+        for (size_t at = _s.find(find._s); at != std::string::npos; at = _s.find(find._s, at + replacement._s.size())) {
+            _s.replace(at, find._s.size(), replacement._s);
+        }
+    }
+    void toLowerCase() { for (char& c : _s) c = (char)tolower((unsigned char)c); }
+    void toUpperCase() { for (char& c : _s) c = (char)toupper((unsigned char)c); }
+    void trim() {
+        const size_t first = _s.find_first_not_of(" \t\r\n\f\v");
+        if (first == std::string::npos) { _s.clear(); return; }
+        _s = _s.substr(first, _s.find_last_not_of(" \t\r\n\f\v") - first + 1);
+    }
+
+    long toInt() const { return atol(c_str()); }
+    float toFloat() const { return (float)atof(c_str()); }
+    double toDouble() const { return atof(c_str()); }
+
+    void getBytes(unsigned char* buf, unsigned int size, unsigned int index = 0) const {
+        if (!size || !buf) return;
+        const size_t n = index < _s.size() ? std::min<size_t>(size - 1, _s.size() - index) : 0;
+        if (n) memcpy(buf, _s.data() + index, n);
+        buf[n] = 0;
+    }
+    void toCharArray(char* buf, unsigned int size, unsigned int index = 0) const {
+        getBytes((unsigned char*)buf, size, index);
+    }
+
+private:
+    static int toIndex(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+    static std::string format(unsigned long long v, unsigned char base) {
+        if (base < 2 || base > 36) base = 10;
+        char buf[65];
+        char* p = buf + sizeof(buf);
+        *--p = 0;
+        do {
+            const int digit = (int)(v % base);
+            *--p = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+            v /= base;
+        } while (v);
+        return p;
+    }
+
+    static std::string formatSigned(long long v, unsigned char base) {
+        if (base == 10 && v < 0) return "-" + format(0ULL - (unsigned long long)v, base);
+        return format((unsigned long long)v, base);
+    }
+
+    static std::string formatFloat(double v, unsigned int decimals) {
+        if (isnan(v)) return "nan";
+        if (isinf(v)) return v < 0 ? "-inf" : "inf";
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        return buf;
+    }
+
+    std::string _s;
+};
+
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& s) : String(s) {}
+    StringSumHelper(const char* s) : String(s) {}
+};
+
+template <typename T>
+inline StringSumHelper operator+(const StringSumHelper& lhs, const T& rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+inline StringSumHelper operator+(const String& lhs, const String& rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+inline StringSumHelper operator+(const String& lhs, const char* rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+inline StringSumHelper operator+(const char* lhs, const String& rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+inline StringSumHelper operator+(const String& lhs, char rhs) {
+    StringSumHelper sum(lhs);
+    sum.concat(rhs);
+    return sum;
+}
+
+// Numbers append their decimal text, like the core's StringSumHelper overloads.
+// Without them String + number has two equally good candidates.
+inline StringSumHelper operator+(const String& lhs, unsigned char rhs) { return StringSumHelper(lhs) + rhs; }
+inline StringSumHelper operator+(const String& lhs, int rhs) { return StringSumHelper(lhs) + rhs; }
+inline StringSumHelper operator+(const String& lhs, unsigned int rhs) { return StringSumHelper(lhs) + rhs; }
+inline StringSumHelper operator+(const String& lhs, long rhs) { return StringSumHelper(lhs) + rhs; }
+inline StringSumHelper operator+(const String& lhs, unsigned long rhs) { return StringSumHelper(lhs) + rhs; }
+inline StringSumHelper operator+(const String& lhs, long long rhs) { return StringSumHelper(lhs) + rhs; }
+inline StringSumHelper operator+(const String& lhs, unsigned long long rhs) { return StringSumHelper(lhs) + rhs; }
+inline StringSumHelper operator+(const String& lhs, float rhs) { return StringSumHelper(lhs) + rhs; }
+inline StringSumHelper operator+(const String& lhs, double rhs) { return StringSumHelper(lhs) + rhs; }
+
+class Print {
+public:
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) {
+            if (!write(*buffer++)) break;
+            n++;
+        }
+        return n;
+    }
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+    size_t print(int v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+    size_t print(unsigned int v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+    size_t print(long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+    size_t print(unsigned long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+    size_t print(long long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+    size_t print(unsigned long long v, int base = DEC) { return print(String(v, (unsigned char)base)); }
+    size_t print(double v, int decimals = 2) { return print(String(v, (unsigned int)decimals)); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T& v) { const size_t n = print(v); return n + println(); }
+    template <typename T>
+    size_t println(const T& v, int format) { const size_t n = print(v, format); return n + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[256];
+        va_list args;
+        va_start(args, format);
+        const int len = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        if (len < 0) return 0;
+        if ((size_t)len < sizeof(buf)) return write((const uint8_t*)buf, len);
+
+        std::string big((size_t)len + 1, '\0');
+        va_start(args, format);
+        vsnprintf(&big[0], big.size(), format, args);
+        va_end(args);
+        return write((const uint8_t*)big.data(), len);
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeoutMs) { _timeoutMs = timeoutMs; }
+    unsigned long getTimeout() const { return _timeoutMs; }
+
+    // No waiting on the host: reads until the data runs out
+    virtual size_t readBytes(char* buffer, size_t length) {
+        size_t n = 0;
+        while (n < length) {
+            const int c = read();
+            if (c < 0) break;
+            buffer[n++] = (char)c;
+        }
+        return n;
+    }
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+
+    String readString() {
+        String s;
+        for (int c = read(); c >= 0; c = read()) s += (char)c;
+        return s;
+    }
+
+    String readStringUntil(char terminator) {
+        String s;
+        for (int c = read(); c >= 0 && c != terminator; c = read()) s += (char)c;
+        return s;
+    }
+
+protected:
+    unsigned long _timeoutMs = 1000;
+};
+
+class IPAddress {
+public:
+    IPAddress() : _bytes{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _bytes{a, b, c, d} {}
+    // Network byte order, as lwIP stores it
+    IPAddress(uint32_t address) { memcpy(_bytes, &address, sizeof(_bytes)); }
+
+    bool fromString(const char* address) {
+        unsigned int v[4];
+        char tail;
+        if (!address || sscanf(address, "%u.%u.%u.%u%c", &v[0], &v[1], &v[2], &v[3], &tail) != 4) return false;
+        for (int i = 0; i < 4; i++) {
+            if (v[i] > 255) return false;
+            _bytes[i] = (uint8_t)v[i];
+        }
+        return true;
+    }
+    bool fromString(const String& address) { return fromString(address.c_str()); }
+
+    operator uint32_t() const { uint32_t v; memcpy(&v, _bytes, sizeof(v)); return v; }
+    bool operator==(const IPAddress& other) const { return memcmp(_bytes, other._bytes, sizeof(_bytes)) == 0; }
+    bool operator!=(const IPAddress& other) const { return !(*this == other); }
+    uint8_t operator[](int i) const { return _bytes[i]; }
+
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t _bytes[4];
+};
+
+// Serial monitor output goes to stdout; nothing is ever received
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1) {
+        (void)baud;
+        (void)config;
+        (void)rxPin;
+        (void)txPin;
+    }
+    void end() {}
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, stdout); }
+    using Print::write;
+    void flush() override { fflush(stdout); }
+    explicit operator bool() const { return true; }
+};
+
+inline HardwareSerial Serial;
+
+// The host has no fixed heap; report a comfortable constant
+class EspClass {
+public:
+    uint32_t getHeapSize() { return 320 * 1024; }
+    uint32_t getFreeHeap() { return 200 * 1024; }
+    uint32_t getMinFreeHeap() { return 180 * 1024; }
+    uint32_t getMaxAllocHeap() { return 110 * 1024; }
+    void restart() { exit(0); }
+};
+
+inline EspClass ESP;
+
+inline unsigned long millis() { return Hal::millis(); }
+inline unsigned long micros() { return Hal::micros(); }
+
+// delay() blocks like on the ESP32 (vTaskDelay); busy waits pass virtual time
+inline void delay(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+inline void delayMicroseconds(uint32_t us) { Hal::VirtualClock::advanceUs(us); }
+void yield();
+
+inline void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+inline void digitalWrite(uint8_t pin, uint8_t value) { (void)pin; (void)value; }
+inline int digitalRead(uint8_t pin) { (void)pin; return LOW; }
+
+inline long random(long howBig) { return howBig > 0 ? ::random() % howBig : 0; }
+inline long random(long howSmall, long howBig) { return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall); }
+inline void randomSeed(unsigned long seed) { srandom((unsigned int)seed); }
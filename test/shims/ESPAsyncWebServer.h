@@ -0,0 +1,254 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// ESPAsyncWebServer stand-in: handlers are registered as usual and a test
+// dispatches requests it built itself with AsyncWebServer::handle().
+
+typedef enum {
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServerRequest;
+
+typedef std::function<void(AsyncWebServerRequest* request)> ArRequestHandlerFunction;
+typedef std::function<size_t(uint8_t* buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+typedef std::function<void(void)> ArMiddlewareNext;
+typedef std::function<void(AsyncWebServerRequest* request, ArMiddlewareNext next)> ArMiddlewareCallback;
+
+class AsyncWebParameter {
+public:
+    AsyncWebParameter(const String& name, const String& value, bool form) : _name(name), _value(value), _form(form) {}
+    const String& name() const { return _name; }
+    const String& value() const { return _value; }
+    bool isPost() const { return _form; }
+
+private:
+    String _name;
+    String _value;
+    bool _form;
+};
+
+class AsyncWebHeader {
+public:
+    AsyncWebHeader(const String& name, const String& value) : _name(name), _value(value) {}
+    const String& name() const { return _name; }
+    const String& value() const { return _value; }
+
+private:
+    String _name;
+    String _value;
+};
+
+class AsyncWebServerResponse {
+public:
+    AsyncWebServerResponse(int code, const String& contentType) : _code(code), _contentType(contentType) {}
+    virtual ~AsyncWebServerResponse() = default;
+
+    void setCode(int code) { _code = code; }
+    bool addHeader(const char* name, const char* value) {
+        _headers.emplace_back(name, value);
+        return true;
+    }
+
+    // Host only: what would go on the wire
+    int code() const { return _code; }
+    const String& contentType() const { return _contentType; }
+    const String& body() const { return _body; }
+    String header(const char* name) const {
+        for (const auto& h : _headers) {
+            if (h.name().equalsIgnoreCase(name)) return h.value();
+        }
+        return String();
+    }
+    virtual void produce() {}
+
+protected:
+    int _code;
+    String _contentType;
+    String _body;
+    std::vector<AsyncWebHeader> _headers;
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print {
+public:
+    explicit AsyncResponseStream(const String& contentType) : AsyncWebServerResponse(200, contentType) {}
+    size_t write(uint8_t c) override { _body += (char)c; return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        _body.concat((const char*)buffer, (unsigned int)size);
+        return size;
+    }
+    using Print::write;
+};
+
+class AsyncChunkedResponse : public AsyncWebServerResponse {
+public:
+    AsyncChunkedResponse(const String& contentType, AwsResponseFiller filler)
+        : AsyncWebServerResponse(200, contentType), _filler(std::move(filler)) {}
+
+    void produce() override {
+        uint8_t buf[512];
+        for (size_t index = 0;;) {
+            const size_t n = _filler(buf, sizeof(buf), index);
+            if (n == 0) break;
+            _body.concat((const char*)buf, (unsigned int)n);
+            index += n;
+        }
+    }
+
+private:
+    AwsResponseFiller _filler;
+};
+
+class AsyncWebServerRequest {
+public:
+    AsyncWebServerRequest(WebRequestMethodComposite method, const String& url) : _method(method), _url(url) {}
+
+    WebRequestMethodComposite method() const { return _method; }
+    const String& url() const { return _url; }
+
+    // Host only: set up the request
+    void addParam(const String& name, const String& value, bool form = false) { _params.emplace_back(name, value, form); }
+    void addHeader(const String& name, const String& value) { _requestHeaders.emplace_back(name, value); }
+    void setAuthenticated(bool authenticated) { _authenticated = authenticated; }
+
+    bool hasParam(const char* name, bool post = false, bool file = false) const {
+        return getParam(name, post, file) != nullptr;
+    }
+    const AsyncWebParameter* getParam(const char* name, bool post = false, bool file = false) const {
+        (void)file;
+        for (const auto& p : _params) {
+            if (p.name() == name && p.isPost() == post) return &p;
+        }
+        return nullptr;
+    }
+    bool hasHeader(const char* name) const { return getHeader(name) != nullptr; }
+    const AsyncWebHeader* getHeader(const char* name) const {
+        for (const auto& h : _requestHeaders) {
+            if (h.name().equalsIgnoreCase(name)) return &h;
+        }
+        return nullptr;
+    }
+
+    bool authenticate(const char* username, const char* password) const {
+        (void)username;
+        (void)password;
+        return _authenticated;
+    }
+    void requestAuthentication() { send(401, "text/plain", "Unauthorized"); }
+
+    AsyncResponseStream* beginResponseStream(const char* contentType, size_t bufferSize = 1460) {
+        (void)bufferSize;
+        return new AsyncResponseStream(contentType);
+    }
+    AsyncWebServerResponse* beginChunkedResponse(const char* contentType, AwsResponseFiller filler) {
+        return new AsyncChunkedResponse(contentType, std::move(filler));
+    }
+
+    void send(AsyncWebServerResponse* response) {
+        response->produce();
+        _response.reset(response);
+    }
+    void send(int code, const char* contentType = "", const String& content = String()) {
+        AsyncResponseStream* response = beginResponseStream(contentType);
+        response->setCode(code);
+        response->print(content);
+        send(response);
+    }
+
+    // Host only: the response sent by the handler, nullptr if none
+    const AsyncWebServerResponse* response() const { return _response.get(); }
+
+private:
+    WebRequestMethodComposite _method;
+    String _url;
+    std::vector<AsyncWebParameter> _params;
+    std::vector<AsyncWebHeader> _requestHeaders;
+    bool _authenticated = true;
+    std::unique_ptr<AsyncWebServerResponse> _response;
+};
+
+class AsyncWebHandler {
+public:
+    virtual ~AsyncWebHandler() = default;
+    virtual bool canHandle(AsyncWebServerRequest* request) const { (void)request; return false; }
+    virtual void handleRequest(AsyncWebServerRequest* request) { (void)request; }
+};
+
+class AsyncCallbackWebHandler : public AsyncWebHandler {
+public:
+    AsyncCallbackWebHandler(const String& uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest)
+        : _uri(uri), _method(method), _onRequest(std::move(onRequest)) {}
+
+    // Like the library: the exact path or anything below it
+    bool canHandle(AsyncWebServerRequest* request) const override {
+        if (!(_method & request->method())) return false;
+        return request->url() == _uri || request->url().startsWith(_uri + "/");
+    }
+    void handleRequest(AsyncWebServerRequest* request) override { if (_onRequest) _onRequest(request); }
+
+private:
+    String _uri;
+    WebRequestMethodComposite _method;
+    ArRequestHandlerFunction _onRequest;
+};
+
+class AsyncWebServer {
+public:
+    explicit AsyncWebServer(uint16_t port) : _port(port) {}
+
+    void begin() {}
+    void end() {}
+
+    AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest) {
+        _callbacks.emplace_back(new AsyncCallbackWebHandler(uri, method, std::move(onRequest)));
+        _handlers.push_back(_callbacks.back().get());
+        return *_callbacks.back();
+    }
+    AsyncWebHandler& addHandler(AsyncWebHandler* handler) {
+        _handlers.push_back(handler);
+        return *handler;
+    }
+    void addMiddleware(ArMiddlewareCallback middleware) { _middlewares.push_back(std::move(middleware)); }
+    void onNotFound(ArRequestHandlerFunction fn) { _notFound = std::move(fn); }
+
+    // Host only: runs the middlewares and the first matching handler
+    void handle(AsyncWebServerRequest* request) {
+        runMiddleware(0, request);
+    }
+
+private:
+    void runMiddleware(size_t i, AsyncWebServerRequest* request) {
+        if (i < _middlewares.size()) {
+            _middlewares[i](request, [this, i, request] { runMiddleware(i + 1, request); });
+            return;
+        }
+        for (AsyncWebHandler* h : _handlers) {
+            if (h->canHandle(request)) {
+                h->handleRequest(request);
+                return;
+            }
+        }
+        if (_notFound) _notFound(request);
+        else request->send(404);
+    }
+
+    uint16_t _port;
+    std::vector<std::unique_ptr<AsyncCallbackWebHandler>> _callbacks;
+    std::vector<AsyncWebHandler*> _handlers;
+    std::vector<ArMiddlewareCallback> _middlewares;
+    ArRequestHandlerFunction _notFound;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Arduino.h>
+#include <utility>
+#include <vector>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+/**
+ * HTTP requests answered by the test instead of a server.
+ *
+ * Every request is recorded in HostHttp::requests (with the virtual time it
+ * was sent) and answered with HostHttp::responseCode; a negative code is a
+ * connection error like HTTPC_ERROR_CONNECTION_REFUSED.
+ */
+namespace HostHttp {
+    struct Request {
+        String method;
+        String url;
+        String body;
+        String authorization;           // "user:password" of setAuthorization()
+        std::vector<std::pair<String, String>> headers;
+        uint64_t atUs;
+    };
+
+    inline std::vector<Request> requests;
+    inline int responseCode = 204;
+    inline String responseBody;
+
+    inline void reset() {
+        requests.clear();
+        responseCode = 204;
+        responseBody = String();
+    }
+}
+
+class HTTPClient {
+public:
+    bool begin(const String& url) {
+        _request = HostHttp::Request{};
+        _request.url = url;
+        _code = 0;
+        return true;
+    }
+    void end() {}
+    void setTimeout(uint16_t timeoutMs) { (void)timeoutMs; }
+    void setReuse(bool reuse) { (void)reuse; }
+    void addHeader(const String& name, const String& value) { _request.headers.emplace_back(name, value); }
+    void setAuthorization(const char* user, const char* password) {
+        _request.authorization = String(user) + ":" + password;
+    }
+
+    int GET() { return send("GET", nullptr, 0); }
+    int POST(const String& payload) { return send("POST", (const uint8_t*)payload.c_str(), payload.length()); }
+    int POST(uint8_t* payload, size_t size) { return send("POST", payload, size); }
+
+    String getString() { return _code > 0 ? HostHttp::responseBody : String(); }
+
+    static String errorToString(int error) {
+        switch (error) {
+            case HTTPC_ERROR_CONNECTION_REFUSED:  return "connection refused";
+            case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+            case HTTPC_ERROR_NOT_CONNECTED:       return "not connected";
+            case HTTPC_ERROR_READ_TIMEOUT:        return "read Timeout";
+            default:                              return String();
+        }
+    }
+
+private:
+    int send(const char* method, const uint8_t* payload, size_t size) {
+        _request.method = method;
+        _request.body = String((const char*)payload, (unsigned int)size);
+        _request.atUs = Hal::VirtualClock::nowUs();
+        HostHttp::requests.push_back(_request);
+        _code = HostHttp::responseCode;
+        return _code;
+    }
+
+    HostHttp::Request _request;
+    int _code = 0;
+};
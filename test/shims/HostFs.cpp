@@ -0,0 +1,239 @@
+#include "LittleFS.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace stdfs = std::filesystem;
+
+namespace {
+    // Capacity reported by totalBytes(), the littlefs partition of min_spiffs.csv
+    static constexpr size_t TOTAL_BYTES = 128 * 1024;
+
+    std::string defaultRoot() {
+        std::error_code ec;
+        const stdfs::path tmp = stdfs::temp_directory_path(ec);
+        return ((ec ? stdfs::path("/tmp") : tmp) / ("littlefs-" + std::to_string(getpid()))).string();
+    }
+}
+
+namespace fs {
+    struct FileImpl {
+        std::string path;           // as opened, e.g. "/data/x.json"
+        std::string name;           // last path component
+        FILE* fp = nullptr;
+        bool directory = false;
+        std::string hostDir;
+        std::vector<std::string> entries;
+        size_t nextEntry = 0;
+
+        ~FileImpl() {
+            if (fp) fclose(fp);
+        }
+    };
+
+    File::operator bool() const {
+        return _impl && (_impl->fp || _impl->directory);
+    }
+
+    size_t File::write(uint8_t c) {
+        return write(&c, 1);
+    }
+
+    size_t File::write(const uint8_t* buffer, size_t size) {
+        if (!_impl || !_impl->fp) return 0;
+        return fwrite(buffer, 1, size, _impl->fp);
+    }
+
+    int File::available() {
+        if (!_impl || !_impl->fp) return 0;
+        return (int)(size() - position());
+    }
+
+    int File::read() {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+
+    int File::peek() {
+        if (!_impl || !_impl->fp) return -1;
+        const int c = fgetc(_impl->fp);
+        if (c != EOF) ungetc(c, _impl->fp);
+        return c == EOF ? -1 : c;
+    }
+
+    void File::flush() {
+        if (_impl && _impl->fp) fflush(_impl->fp);
+    }
+
+    size_t File::read(uint8_t* buffer, size_t size) {
+        if (!_impl || !_impl->fp) return 0;
+        return fread(buffer, 1, size, _impl->fp);
+    }
+
+    bool File::seek(uint32_t pos, SeekMode mode) {
+        if (!_impl || !_impl->fp) return false;
+        static const int whence[] = {SEEK_SET, SEEK_CUR, SEEK_END};
+        return fseek(_impl->fp, (long)pos, whence[mode]) == 0;
+    }
+
+    size_t File::position() const {
+        if (!_impl || !_impl->fp) return 0;
+        const long pos = ftell(_impl->fp);
+        return pos < 0 ? 0 : (size_t)pos;
+    }
+
+    size_t File::size() const {
+        if (!_impl || !_impl->fp) return 0;
+        fflush(_impl->fp);
+        const long at = ftell(_impl->fp);
+        fseek(_impl->fp, 0, SEEK_END);
+        const long end = ftell(_impl->fp);
+        fseek(_impl->fp, at, SEEK_SET);
+        return end < 0 ? 0 : (size_t)end;
+    }
+
+    void File::close() {
+        if (!_impl) return;
+        if (_impl->fp) fclose(_impl->fp);
+        _impl->fp = nullptr;
+        _impl->directory = false;
+    }
+
+    const char* File::path() const {
+        return _impl ? _impl->path.c_str() : nullptr;
+    }
+
+    const char* File::name() const {
+        return _impl ? _impl->name.c_str() : nullptr;
+    }
+
+    bool File::isDirectory() const {
+        return _impl && _impl->directory;
+    }
+
+    File File::openNextFile(const char* mode) {
+        if (!_impl || !_impl->directory || _impl->nextEntry >= _impl->entries.size()) return File();
+        std::string child = _impl->path;
+        if (child.empty() || child.back() != '/') child += '/';
+        child += _impl->entries[_impl->nextEntry++];
+
+        auto impl = std::make_shared<FileImpl>();
+        impl->path = child;
+        impl->name = child.substr(child.rfind('/') + 1);
+        const std::string host = _impl->hostDir + "/" + impl->name;
+        if (stdfs::is_directory(host)) {
+            impl->directory = true;
+            impl->hostDir = host;
+            for (const auto& e : stdfs::directory_iterator(host)) impl->entries.push_back(e.path().filename().string());
+        } else {
+            impl->fp = fopen(host.c_str(), strchr(mode, 'w') ? "wb" : strchr(mode, 'a') ? "ab" : "rb");
+        }
+        return File(impl);
+    }
+
+    void File::rewindDirectory() {
+        if (_impl) _impl->nextEntry = 0;
+    }
+
+    std::string FS::hostPath(const char* path) const {
+        std::string root = _root.empty() ? defaultRoot() : _root;
+        return root + (path && *path == '/' ? "" : "/") + (path ? path : "");
+    }
+
+    File FS::open(const char* path, const char* mode, bool create) {
+        if (!path || *path != '/') return File();
+        const std::string host = hostPath(path);
+        if (create && (strchr(mode, 'w') || strchr(mode, 'a'))) {
+            std::error_code ec;
+            stdfs::create_directories(stdfs::path(host).parent_path(), ec);
+        }
+
+        auto impl = std::make_shared<FileImpl>();
+        impl->path = path;
+        impl->name = impl->path.substr(impl->path.rfind('/') + 1);
+        if (stdfs::is_directory(host)) {
+            if (strchr(mode, 'w') || strchr(mode, 'a')) return File();
+            impl->directory = true;
+            impl->hostDir = host;
+            for (const auto& e : stdfs::directory_iterator(host)) impl->entries.push_back(e.path().filename().string());
+            return File(impl);
+        }
+
+        const char* hostMode = strchr(mode, 'w') ? "wb" : strchr(mode, 'a') ? "ab" : "rb";
+        impl->fp = fopen(host.c_str(), hostMode);
+        if (!impl->fp) return File();
+        return File(impl);
+    }
+
+    bool FS::exists(const char* path) {
+        std::error_code ec;
+        return path && stdfs::exists(hostPath(path), ec);
+    }
+
+    bool FS::remove(const char* path) {
+        const std::string host = hostPath(path);
+        if (stdfs::is_directory(host)) return false;
+        return ::remove(host.c_str()) == 0;
+    }
+
+    bool FS::rename(const char* from, const char* to) {
+        return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+    }
+
+    bool FS::mkdir(const char* path) {
+        std::error_code ec;
+        return stdfs::create_directory(hostPath(path), ec) || stdfs::is_directory(hostPath(path));
+    }
+
+    bool FS::rmdir(const char* path) {
+        std::error_code ec;
+        const std::string host = hostPath(path);
+        return stdfs::is_directory(host) && stdfs::remove(host, ec);
+    }
+}
+
+LittleFSFS LittleFS;
+
+LittleFSFS::~LittleFSFS() {
+    if (_root == defaultRoot()) {
+        std::error_code ec;
+        stdfs::remove_all(_root, ec);
+    }
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    (void)formatOnFail;
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+    if (_root.empty()) _root = defaultRoot();
+    std::error_code ec;
+    stdfs::create_directories(_root, ec);
+    _mounted = stdfs::is_directory(_root);
+    return _mounted;
+}
+
+bool LittleFSFS::format() {
+    if (_root.empty()) _root = defaultRoot();
+    std::error_code ec;
+    stdfs::remove_all(_root, ec);
+    return stdfs::create_directories(_root, ec);
+}
+
+size_t LittleFSFS::totalBytes() {
+    return TOTAL_BYTES;
+}
+
+size_t LittleFSFS::usedBytes() {
+    if (_root.empty()) return 0;
+    size_t used = 0;
+    std::error_code ec;
+    for (auto it = stdfs::recursive_directory_iterator(_root, ec); it != stdfs::recursive_directory_iterator();
+         it.increment(ec)) {
+        if (it->is_regular_file(ec)) used += (size_t)it->file_size(ec);
+    }
+    return used;
+}
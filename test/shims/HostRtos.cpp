@@ -0,0 +1,316 @@
+#include "HostRtos.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+#include "Hal.h"
+
+struct HostTask {
+    char name[16];
+    UBaseType_t priority;
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t notifications = 0;
+    bool deleted = false;
+};
+
+struct HostSemaphore {
+    std::recursive_timed_mutex mutex;
+};
+
+namespace {
+    static constexpr size_t MAX_TASKS = 64;
+
+    // Thrown in a task thread to end it (vTaskDelete); never crosses the thread function
+    struct TaskExit {};
+
+    // Tasks are never destroyed: at exit, threads may still block on them.
+    // The loop task lives in static storage so that operator new (HeapMonitor
+    // asks for the current task) never allocates while looking it up.
+    alignas(HostTask) unsigned char s_loopTaskStorage[sizeof(HostTask)];
+    HostTask* s_loopTask = nullptr;
+    thread_local HostTask* t_current = nullptr;
+
+    std::mutex s_registryMutex;
+    HostTask* s_tasks[MAX_TASKS];
+    size_t s_taskCount = 0;
+
+    std::atomic<bool> s_exiting{false};
+    HostRtos::SleepHook s_sleepHook;
+
+    struct LoopTaskInit {
+        LoopTaskInit() {
+            s_loopTask = new (s_loopTaskStorage) HostTask();
+            strcpy(s_loopTask->name, "loopTask");
+            s_loopTask->priority = 1;
+            t_current = s_loopTask;
+            s_tasks[s_taskCount++] = s_loopTask;
+        }
+    } s_loopTaskInit;
+
+    void registerTask(HostTask* task) {
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        if (s_taskCount < MAX_TASKS) s_tasks[s_taskCount++] = task;
+    }
+
+    void unregisterTask(HostTask* task) {
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        for (size_t i = 0; i < s_taskCount; i++) {
+            if (s_tasks[i] == task) {
+                s_tasks[i] = s_tasks[--s_taskCount];
+                break;
+            }
+        }
+    }
+
+    // Called with the task's mutex held, after every wait of a task thread
+    void checkExit(HostTask* self, std::unique_lock<std::mutex>& lock) {
+        if (s_exiting) {
+            lock.unlock();
+            for (;;) std::this_thread::sleep_for(std::chrono::hours(1));
+        }
+        if (self->deleted) throw TaskExit();
+    }
+
+    uint32_t consume(HostTask* self, BaseType_t clearOnExit) {
+        const uint32_t n = self->notifications;
+        if (n) self->notifications = clearOnExit ? 0 : n - 1;
+        return n;
+    }
+
+    // The loop task sleeps in virtual time
+    void loopSleep(uint64_t timeoutUs) {
+        if (s_sleepHook) {
+            s_sleepHook(timeoutUs);
+        } else if (timeoutUs != UINT64_MAX) {
+            Hal::VirtualClock::advanceUs(timeoutUs);
+        } else {
+            std::unique_lock<std::mutex> lock(s_loopTask->mutex);
+            s_loopTask->cv.wait(lock, [] { return s_loopTask->notifications > 0; });
+        }
+    }
+
+    uint64_t ticksToUs(TickType_t ticks) {
+        return ticks == portMAX_DELAY ? UINT64_MAX : (uint64_t)ticks * (1000000 / configTICK_RATE_HZ);
+    }
+
+    void atExit() {
+        s_exiting = true;
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        for (size_t i = 0; i < s_taskCount; i++) {
+            if (s_tasks[i] == s_loopTask) continue;
+            std::lock_guard<std::mutex> taskLock(s_tasks[i]->mutex);
+            s_tasks[i]->cv.notify_all();
+        }
+    }
+}
+
+namespace HostRtos {
+    void setSleepHook(SleepHook hook) {
+        s_sleepHook = std::move(hook);
+    }
+
+    bool loopTaskNotified() {
+        std::lock_guard<std::mutex> lock(s_loopTask->mutex);
+        return s_loopTask->notifications > 0;
+    }
+}
+
+void hostEnterCritical(portMUX_TYPE* mux) {
+    while (__atomic_exchange_n(&mux->locked, 1, __ATOMIC_ACQUIRE)) std::this_thread::yield();
+}
+
+void hostExitCritical(portMUX_TYPE* mux) {
+    __atomic_store_n(&mux->locked, 0, __ATOMIC_RELEASE);
+}
+
+void hostTaskYield() {
+    std::this_thread::yield();
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stackBytes, void* param,
+                                   UBaseType_t priority, TaskHandle_t* created, BaseType_t core) {
+    (void)stackBytes;
+    (void)core;
+    static std::once_flag atExitRegistered;
+    std::call_once(atExitRegistered, [] { atexit(atExit); });
+
+    HostTask* task = new HostTask();
+    strncpy(task->name, name ? name : "", sizeof(task->name) - 1);
+    task->name[sizeof(task->name) - 1] = 0;
+    task->priority = priority;
+    registerTask(task);
+    if (created) *created = task;
+
+    std::thread([task, code, param] {
+        t_current = task;
+        try {
+            code(param);
+        } catch (const TaskExit&) {
+        }
+        unregisterTask(task);
+    }).detach();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    HostTask* self = t_current;
+    if (!task) task = self;
+    if (!task || task == s_loopTask) return;
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->deleted = true;
+        task->cv.notify_all();
+    }
+    if (task == self) throw TaskExit();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    HostTask* self = t_current;
+    if (self == s_loopTask) {
+        // Notifications don't end a delay: park them, so the sleep hook keeps
+        // delivering events until the delay is over
+        uint32_t parked = 0;
+        const uint64_t untilUs = Hal::VirtualClock::nowUs() + ticksToUs(ticks);
+        while (Hal::VirtualClock::nowUs() < untilUs) {
+            {
+                std::lock_guard<std::mutex> lock(self->mutex);
+                parked += self->notifications;
+                self->notifications = 0;
+            }
+            const uint64_t before = Hal::VirtualClock::nowUs();
+            loopSleep(untilUs - before);
+            if (Hal::VirtualClock::nowUs() == before && !HostRtos::loopTaskNotified()) {
+                Hal::VirtualClock::advanceUs(untilUs - before);
+            }
+        }
+        std::lock_guard<std::mutex> lock(self->mutex);
+        self->notifications += parked;
+        return;
+    }
+    if (!self) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+        return;
+    }
+    std::unique_lock<std::mutex> lock(self->mutex);
+    self->cv.wait_for(lock, std::chrono::milliseconds(ticks), [self] { return self->deleted || s_exiting; });
+    checkExit(self, lock);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return t_current;
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+    if (!task) task = t_current;
+    return task ? task->name : nullptr;
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)Hal::millis();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    HostTask* self = t_current;
+    if (!self) return 0;
+
+    if (self == s_loopTask) {
+        {
+            std::lock_guard<std::mutex> lock(self->mutex);
+            if (self->notifications > 0 || ticksToWait == 0) return consume(self, clearOnExit);
+        }
+        loopSleep(ticksToUs(ticksToWait));
+        std::lock_guard<std::mutex> lock(self->mutex);
+        return consume(self, clearOnExit);
+    }
+
+    std::unique_lock<std::mutex> lock(self->mutex);
+    auto woken = [self] { return self->notifications > 0 || self->deleted || s_exiting; };
+    if (ticksToWait == portMAX_DELAY) {
+        self->cv.wait(lock, woken);
+    } else {
+        self->cv.wait_for(lock, std::chrono::milliseconds(ticksToWait), woken);
+    }
+    checkExit(self, lock);
+    return consume(self, clearOnExit);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (!task) return pdFAIL;
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notifications++;
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxTaskGetNumberOfTasks() {
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    return (UBaseType_t)s_taskCount;
+}
+
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* status, UBaseType_t size, uint32_t* totalRunTime) {
+    if (totalRunTime) *totalRunTime = 0;
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    if (size < s_taskCount) return 0;
+    for (size_t i = 0; i < s_taskCount; i++) {
+        TaskStatus_t& s = status[i];
+        memset(&s, 0, sizeof(s));
+        s.xHandle = s_tasks[i];
+        s.pcTaskName = s_tasks[i]->name;
+        s.xTaskNumber = (UBaseType_t)i + 1;
+        s.eCurrentState = s_tasks[i] == t_current ? eRunning : eBlocked;
+        s.uxCurrentPriority = s_tasks[i]->priority;
+        s.uxBasePriority = s_tasks[i]->priority;
+        s.xCoreID = tskNO_AFFINITY;
+    }
+    return (UBaseType_t)s_taskCount;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 0;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new HostSemaphore();
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    return new HostSemaphore();
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+    if (ticksToWait == portMAX_DELAY) {
+        semaphore->mutex.lock();
+        return pdTRUE;
+    }
+    return semaphore->mutex.try_lock_for(std::chrono::milliseconds(ticksToWait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    semaphore->mutex.unlock();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+    return xSemaphoreTake(semaphore, ticksToWait);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore) {
+    return xSemaphoreGive(semaphore);
+}
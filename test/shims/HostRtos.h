@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+
+/**
+ * Host back end of the FreeRTOS shim.
+ *
+ * Tasks created with xTaskCreate*() are threads that block in real time.
+ * The main thread is the loop task ("loopTask"): when it blocks in
+ * ulTaskNotifyTake() or vTaskDelay(), no real time passes. The sleep hook
+ * stands in for the time it would have slept - by default the virtual clock
+ * advances by the timeout. A simulation installs its own hook to deliver
+ * the events due meanwhile (UART bytes, uploads, ...); an event handler that
+ * calls LoopScheduler::wake() ends the sleep like on the ESP32:
+ *
+ *   HostRtos::setSleepHook([&](uint64_t timeoutUs) {
+ *       const uint64_t until = Hal::VirtualClock::nowUs() + timeoutUs;
+ *       while (!HostRtos::loopTaskNotified() && nextEventUs <= until) {
+ *           Hal::VirtualClock::advanceUs(nextEventUs - Hal::VirtualClock::nowUs());
+ *           deliverNextEvent();
+ *       }
+ *       if (!HostRtos::loopTaskNotified() && Hal::VirtualClock::nowUs() < until)
+ *           Hal::VirtualClock::advanceUs(until - Hal::VirtualClock::nowUs());
+ *   });
+ *
+ * vTaskDelay() is not ended by notifications, the hook is called again for
+ * the rest of the delay. test/test_scheduler runs a complete simulation.
+ * At exit, task threads park at their next blocking call.
+ */
+namespace HostRtos {
+    // timeoutUs: UINT64_MAX for portMAX_DELAY
+    using SleepHook = std::function<void(uint64_t timeoutUs)>;
+
+    // nullptr restores the default (advance the clock by the timeout)
+    void setSleepHook(SleepHook hook);
+
+    // A notification for the loop task is pending (its sleep ends)
+    bool loopTaskNotified();
+}
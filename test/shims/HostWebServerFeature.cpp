@@ -0,0 +1,50 @@
+#include "WebServerFeature.h"
+#include <string.h>
+
+// Host build of the web server: the routes other features add are kept and
+// can be called with getServer()->handle(); the device pages are left out.
+
+WebServerFeature::WebServerFeature(uint16_t port, const char* username, const char* password)
+    : _port(port)
+    , _username(username)
+    , _password(password)
+    , _authEnabled(strlen(username) > 0 && strlen(password) > 0)
+    , _ready(false)
+    , _setupDone(false)
+    , _server(nullptr)
+{
+}
+
+void WebServerFeature::setup() {
+    if (_setupDone) return;
+    _server = new AsyncWebServer(_port);
+    _server->begin();
+    _ready = true;
+    _setupDone = true;
+}
+
+void WebServerFeature::setupDefaultRoutes() {
+}
+
+AsyncWebServer* WebServerFeature::getServer() {
+    return _server;
+}
+
+void WebServerFeature::addHandler(AsyncWebHandler* handler) {
+    if (_server) {
+        _server->addHandler(handler);
+    }
+}
+
+void WebServerFeature::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest) {
+    if (_server) {
+        _server->on(uri, method, onRequest);
+    }
+}
+
+bool WebServerFeature::authenticate(AsyncWebServerRequest* request) {
+    if (!_authEnabled) {
+        return true;
+    }
+    return request->authenticate(_username, _password);
+}
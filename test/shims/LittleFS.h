@@ -0,0 +1,32 @@
+#pragma once
+
+#include "FS.h"
+
+/**
+ * LittleFS on a host directory.
+ *
+ * The "flash" is a directory (default: littlefs-<pid> in the temp
+ * directory, removed at exit), so tests can inspect and damage files with
+ * plain file I/O.
+ * Renames replace the target atomically, like LittleFS.
+ */
+class LittleFSFS : public fs::FS {
+public:
+    ~LittleFSFS();
+
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char* partitionLabel = "spiffs");
+    void end() { _mounted = false; }
+    bool format();
+    size_t totalBytes();
+    size_t usedBytes();
+
+    // Host only: directory holding the files, takes effect at the next begin()
+    void setRoot(const char* hostDir) { _root = hostDir; }
+    const char* root() const { return _root.c_str(); }
+
+private:
+    bool _mounted = false;
+};
+
+extern LittleFSFS LittleFS;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// NVS in memory: namespaces live as long as the process
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false) {
+        _ns = name ? name : "";
+        _readOnly = readOnly;
+        if (readOnly && store().find(_ns) == store().end()) return false;
+        store()[_ns];
+        _open = true;
+        return true;
+    }
+    void end() { _open = false; }
+    bool clear() { if (!_open || _readOnly) return false; store()[_ns].clear(); return true; }
+    bool remove(const char* key) { return _open && !_readOnly && store()[_ns].erase(key) > 0; }
+    bool isKey(const char* key) { return _open && store()[_ns].count(key) > 0; }
+
+    size_t putBytes(const char* key, const void* value, size_t len) {
+        if (!_open || _readOnly) return 0;
+        const uint8_t* p = (const uint8_t*)value;
+        store()[_ns][key].assign(p, p + len);
+        return len;
+    }
+
+    size_t getBytes(const char* key, void* buf, size_t maxLen) {
+        if (!_open) return 0;
+        auto& ns = store()[_ns];
+        auto it = ns.find(key);
+        if (it == ns.end() || it->second.size() > maxLen) return 0;
+        memcpy(buf, it->second.data(), it->second.size());
+        return it->second.size();
+    }
+
+    size_t getBytesLength(const char* key) {
+        if (!_open) return 0;
+        auto& ns = store()[_ns];
+        auto it = ns.find(key);
+        return it == ns.end() ? 0 : it->second.size();
+    }
+
+private:
+    using Namespace = std::map<std::string, std::vector<uint8_t>>;
+    static std::map<std::string, Namespace>& store() {
+        static std::map<std::string, Namespace> s;
+        return s;
+    }
+
+    std::string _ns;
+    bool _readOnly = false;
+    bool _open = false;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+// Station state follows Hal::VirtualClock::setNetworkConnected(); names resolve only as literals
+class WiFiClass {
+public:
+    wl_status_t status() { return Hal::networkConnected() ? WL_CONNECTED : WL_DISCONNECTED; }
+    bool isConnected() { return Hal::networkConnected(); }
+    int hostByName(const char* host, IPAddress& ip) { return ip.fromString(host) ? 1 : 0; }
+    IPAddress localIP() { return Hal::networkConnected() ? IPAddress(192, 168, 1, 2) : IPAddress(); }
+    int8_t RSSI() { return Hal::networkConnected() ? -60 : 0; }
+};
+
+inline WiFiClass WiFi;
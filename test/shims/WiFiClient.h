@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Connections are refused (no network on the host)
+class WiFiClient : public Stream {
+public:
+    int connect(IPAddress ip, uint16_t port) { (void)ip; (void)port; return 0; }
+    int connect(IPAddress ip, uint16_t port, int32_t timeoutMs) { (void)timeoutMs; return connect(ip, port); }
+    int connect(const char* host, uint16_t port) { (void)host; (void)port; return 0; }
+    uint8_t connected() { return 0; }
+    void stop() {}
+    size_t write(uint8_t c) override { (void)c; return 0; }
+    size_t write(const uint8_t* buffer, size_t size) override { (void)buffer; (void)size; return 0; }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    explicit operator bool() { return false; }
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Datagrams go nowhere; the last one is kept for inspection
+class WiFiUDP : public Print {
+public:
+    int beginPacket(IPAddress ip, uint16_t port) { _ip = ip; _port = port; _packet = String(); return 1; }
+    int beginPacket(const char* host, uint16_t port) { return _ip.fromString(host) ? beginPacket(_ip, port) : 0; }
+    size_t write(uint8_t c) override { _packet += (char)c; return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { _packet.concat((const char*)buffer, size); return size; }
+    using Print::write;
+    int endPacket() { _sent = _packet; return 1; }
+    void stop() {}
+
+    // Host only
+    const String& lastPacket() const { return _sent; }
+
+private:
+    IPAddress _ip;
+    uint16_t _port = 0;
+    String _packet;
+    String _sent;
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+// The host has no fixed heap; report the sizes of a healthy ESP32
+inline size_t heap_caps_get_free_size(uint32_t caps) { (void)caps; return 200 * 1024; }
+inline size_t heap_caps_get_minimum_free_size(uint32_t caps) { (void)caps; return 180 * 1024; }
+inline size_t heap_caps_get_largest_free_block(uint32_t caps) { (void)caps; return 110 * 1024; }
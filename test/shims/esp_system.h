@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "esp_heap_caps.h"
+
+typedef enum {
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+inline esp_reset_reason_t esp_reset_reason() { return ESP_RST_POWERON; }
+inline uint32_t esp_random() { return ((uint32_t)random() << 16) ^ (uint32_t)random(); }
+inline uint32_t esp_get_free_heap_size() { return (uint32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT); }
+inline void esp_restart() { exit(0); }
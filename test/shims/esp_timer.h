@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+#include "Hal.h"
+
+// Microseconds since the (virtual) boot
+inline int64_t esp_timer_get_time() {
+    return (int64_t)Hal::VirtualClock::nowUs();
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+// ROM reset reason codes; POWERON_RESET on the host
+typedef enum {
+    NO_MEAN = 0,
+    POWERON_RESET = 1,
+} RESET_REASON;
+
+inline RESET_REASON rtc_get_reset_reason(int cpu) { (void)cpu; return POWERON_RESET; }
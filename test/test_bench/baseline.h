@@ -0,0 +1,34 @@
+#pragma once
+
+// Stored baselines of the native micro-benchmarks (test_main.cpp).
+//
+// A benchmark fails when it allocates more per op than its baseline, or when
+// it runs slower than BENCH_TOLERANCE times its baseline ns/op. The tolerance
+// absorbs the difference between development machines; allocations are exact.
+// After an intended change, run `pio test -e native -f test_bench -v` and
+// copy the reported numbers here (rounded up).
+
+#ifndef BENCH_TOLERANCE
+#define BENCH_TOLERANCE 3.0
+#endif
+
+struct BenchBaseline {
+    const char* name;
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+static const BenchBaseline BENCH_BASELINES[] = {
+    {"crc16_256B", 3500.0, 0.0},
+    {"parseFrame_fc3_125regs", 3500.0, 0.0},
+    {"toValue_float32_be", 5.0, 0.0},
+    {"toRaw_int32_be", 50.0, 1.0},
+    {"planPollWindows_64regs", 2000.0, 1.0},
+    {"escapeTag_short", 50.0, 0.0},
+    {"mpsc_push_pop", 25.0, 0.0},
+    {"apiEncode_json", 8000.0, 0.0},
+    {"apiEncode_cbor", 4000.0, 0.0},
+    {"apiEncode_msgpack", 4000.0, 0.0},
+    {"logPack_6args", 5.0, 0.0},
+    {"logRender_6args", 1200.0, 0.0},
+};
@@ -0,0 +1,278 @@
+#include <unity.h>
+#include <chrono>
+#include <cstdio>
+#include <string.h>
+#include <vector>
+#include <ArduinoJson.h>
+#include "ModbusCodec.h"
+#include "InfluxLineProtocol.h"
+#include "MpscQueue.h"
+#include "ApiEncoding.h"
+#include "LogFormat.h"
+#include "LoggingFeature.h"
+#include "HeapMonitor.h"
+#include "baseline.h"
+
+// Micro-benchmarks of the hot paths, reporting ns/op and allocations/op and
+// checked against baseline.h. Each benchmark runs BENCH_ROUNDS rounds and
+// keeps the fastest, so a busy machine slows it less. Allocations are counted
+// by HeapMonitor's operator new, the same hooks as on the device.
+
+#ifndef BENCH_ROUNDS
+#define BENCH_ROUNDS 5
+#endif
+
+namespace {
+    // Keeps the optimizer from dropping a benchmarked result
+    volatile uint32_t s_sink = 0;
+
+    // Writes nowhere; counts bytes like a response stream would
+    class NullPrint : public Print {
+    public:
+        size_t write(uint8_t) override { bytes++; return 1; }
+        size_t write(const uint8_t*, size_t size) override { bytes += size; return size; }
+        size_t bytes = 0;
+    };
+
+    uint32_t allocations() {
+        uint32_t total = 0;
+        for (size_t i = 0; i < (size_t)HeapTag::Count; i++) total += HeapMonitor::tagStats((HeapTag)i).allocs;
+        return total;
+    }
+
+    struct BenchResult {
+        double nsPerOp;
+        double allocsPerOp;
+    };
+
+    template <typename Fn>
+    BenchResult measure(size_t iterations, Fn&& op) {
+        BenchResult best{1e30, 0};
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            const uint32_t allocsBefore = allocations();
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; i++) op();
+            const auto end = std::chrono::steady_clock::now();
+            const double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+            if (ns < best.nsPerOp) best.nsPerOp = ns;
+            best.allocsPerOp = (double)(allocations() - allocsBefore) / iterations;
+        }
+        return best;
+    }
+
+    const BenchBaseline* findBaseline(const char* name) {
+        for (const BenchBaseline& b : BENCH_BASELINES) {
+            if (strcmp(b.name, name) == 0) return &b;
+        }
+        return nullptr;
+    }
+
+    void check(const char* name, const BenchResult& r) {
+        const BenchBaseline* baseline = findBaseline(name);
+        char msg[160];
+        snprintf(msg, sizeof(msg), "%s: %.1f ns/op (baseline %.1f), %.2f allocs/op (baseline %.2f)",
+                 name, r.nsPerOp, baseline ? baseline->nsPerOp : 0.0,
+                 r.allocsPerOp, baseline ? baseline->allocsPerOp : 0.0);
+        TEST_MESSAGE(msg);
+
+        TEST_ASSERT_NOT_NULL_MESSAGE(baseline, "no baseline in baseline.h");
+        TEST_ASSERT_TRUE_MESSAGE(r.allocsPerOp <= baseline->allocsPerOp, "more allocations than the baseline");
+        TEST_ASSERT_TRUE_MESSAGE(r.nsPerOp <= baseline->nsPerOp * BENCH_TOLERANCE, "slower than the baseline");
+    }
+
+    ModbusRegisterDef makeReg(uint16_t address, uint16_t length, ModbusDataType type) {
+        ModbusRegisterDef def{};
+        strcpy(def.name, "bench");
+        def.address = address;
+        def.length = length;
+        def.functionCode = ModbusFC::READ_HOLDING_REGISTERS;
+        def.dataType = type;
+        def.conversionFactor = 0.1f;
+        def.offset = 0.0f;
+        def.pollIntervalMs = (address % 3 == 0) ? 10000 : 1000;
+        return def;
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void bench_crc16() {
+    uint8_t buf[256];
+    for (size_t i = 0; i < sizeof(buf); i++) buf[i] = (uint8_t)(i * 31);
+    check("crc16_256B", measure(20000, [&] {
+        s_sink = s_sink + ModbusCodec::crc16(buf, sizeof(buf));
+    }));
+}
+
+void bench_parse_frame() {
+    // Full FC3 response: unit, FC, byte count, 125 registers, CRC
+    uint8_t buf[3 + 250 + 2] = {0x01, 0x03, 250};
+    for (size_t i = 3; i < 253; i++) buf[i] = (uint8_t)i;
+    const uint16_t crc = ModbusCodec::crc16(buf, 253);
+    buf[253] = crc & 0xFF;
+    buf[254] = crc >> 8;
+
+    ModbusFrame frame;
+    check("parseFrame_fc3_125regs", measure(20000, [&] {
+        ModbusCodec::parseFrame(buf, sizeof(buf), frame);
+        s_sink = s_sink + frame.dataLen;
+    }));
+}
+
+void bench_to_value() {
+    const ModbusRegisterDef def = makeReg(0, 2, ModbusDataType::FLOAT32_BE);
+    uint16_t raw[2] = {0x4049, 0x0FDB};
+    check("toValue_float32_be", measure(200000, [&] {
+        raw[1]++;
+        s_sink = s_sink + (uint32_t)ModbusCodec::toValue(def, raw);
+    }));
+}
+
+void bench_to_raw() {
+    const ModbusRegisterDef def = makeReg(0, 2, ModbusDataType::INT32_BE);
+    float value = -1000.0f;
+    check("toRaw_int32_be", measure(100000, [&] {
+        value += 1.0f;
+        s_sink = s_sink + ModbusCodec::toRaw(def, value)[1];
+    }));
+}
+
+void bench_plan_poll_windows() {
+    std::vector<ModbusRegisterDef> regs;
+    for (uint16_t i = 0; i < 64; i++) {
+        regs.push_back(makeReg((uint16_t)(i * 2 + (i / 16) * 10), 2, ModbusDataType::UINT32_BE));
+    }
+    std::vector<ModbusCodec::PollWindow> windows;
+    ModbusCodec::planPollWindows(regs, windows);  // size the output once, as on a reload
+    check("planPollWindows_64regs", measure(5000, [&] {
+        ModbusCodec::planPollWindows(regs, windows);
+        s_sink = s_sink + (uint32_t)windows.size();
+    }));
+}
+
+void bench_escape_tag() {
+    check("escapeTag_short", measure(100000, [&] {
+        s_sink = s_sink + InfluxLineProtocol::escapeTag("kWh total").length();
+    }));
+}
+
+void bench_mpsc() {
+    MpscQueue<uint32_t> queue(32);
+    uint32_t value = 0;
+    check("mpsc_push_pop", measure(200000, [&] {
+        queue.push(value + 1);
+        queue.pop(value);
+    }));
+    s_sink = value;
+}
+
+// A device status response: nested objects, an array, numbers, hex fields
+void buildApiDocument(JsonDocument& doc) {
+    doc["uptimeS"] = 123456;
+    doc["bootIsoUtc"] = "2024-01-01T00:00:00Z";
+    doc["boot"] = 1704067200;
+    JsonObject heap = doc["heap"].to<JsonObject>();
+    heap["free"] = 181234;
+    heap["minFree"] = 150000;
+    heap["fragmentation"] = 12.5;
+    JsonArray devices = doc["devices"].to<JsonArray>();
+    for (int i = 0; i < 4; i++) {
+        JsonObject device = devices.add<JsonObject>();
+        device["unit"] = i + 1;
+        device["name"] = "SDM630";
+        device["online"] = i != 2;
+        device["power"] = 1234.5f + i;
+        device["energy"] = 98765.25;
+        device["crcHex"] = "A1B2";
+        device["lastFrameHex"] = "01 03 04 43 9A 50 00 8D 2E";
+    }
+}
+
+void benchApiEncoding(const char* name, ApiEncoding::Format format) {
+    JsonDocument doc;
+    buildApiDocument(doc);
+    NullPrint out;
+    check(name, measure(5000, [&] {
+        ApiEncoding::serialize(doc, out, format);
+    }));
+    s_sink = s_sink + (uint32_t)out.bytes;
+}
+
+void bench_api_encode_json() {
+    benchApiEncoding("apiEncode_json", ApiEncoding::Format::Json);
+}
+
+void bench_api_encode_cbor() {
+    benchApiEncoding("apiEncode_cbor", ApiEncoding::Format::Cbor);
+}
+
+void bench_api_encode_msgpack() {
+    benchApiEncoding("apiEncode_msgpack", ApiEncoding::Format::MsgPack);
+}
+
+// What a LOG_x call costs the caller, and what the drain task pays later
+static const char* LOG_BENCH_FORMAT = "Unit %u: read %d regs from 0x%04X in %lu us (%s), value %.2f";
+
+void bench_log_pack() {
+    uint8_t args[LOG_MESSAGE_MAX];
+    uint32_t unit = 0;
+    check("logPack_6args", measure(200000, [&] {
+        LogFormat::ArgWriter writer{args, args + sizeof(args)};
+        writer.put(++unit);
+        writer.put(125);
+        writer.put((uint16_t)0x1234);
+        writer.put(4711UL);
+        writer.put("timeout");
+        writer.put(230.25f);
+        s_sink = s_sink + (uint32_t)(writer.p - args);
+    }));
+}
+
+void bench_log_render() {
+    uint8_t args[LOG_MESSAGE_MAX];
+    LogFormat::ArgWriter writer{args, args + sizeof(args)};
+    writer.put(7u);
+    writer.put(125);
+    writer.put((uint16_t)0x1234);
+    writer.put(4711UL);
+    writer.put("timeout");
+    writer.put(230.25f);
+    const size_t argBytes = writer.p - args;
+
+    char out[LOG_MESSAGE_MAX];
+    check("logRender_6args", measure(50000, [&] {
+        LogFormat::render(LOG_BENCH_FORMAT, args, argBytes, out, sizeof(out));
+        s_sink = s_sink + (uint8_t)out[10];
+    }));
+    TEST_ASSERT_EQUAL_STRING("Unit 7: read 125 regs from 0x1234 in 4711 us (timeout), value 230.25", out);
+}
+
+// The counting itself: allocations of a scope land on its tag
+void test_allocations_counted_per_tag() {
+    const uint32_t before = HeapMonitor::tagStats(HeapTag::Modbus).allocs;
+    {
+        HeapMonitor::Scope heap(HeapTag::Modbus);
+        std::vector<int> v(16);
+        s_sink = s_sink + (uint32_t)v.size();
+    }
+    TEST_ASSERT_EQUAL_UINT32(before + 1, HeapMonitor::tagStats(HeapTag::Modbus).allocs);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(bench_crc16);
+    RUN_TEST(bench_parse_frame);
+    RUN_TEST(bench_to_value);
+    RUN_TEST(bench_to_raw);
+    RUN_TEST(bench_plan_poll_windows);
+    RUN_TEST(bench_escape_tag);
+    RUN_TEST(bench_mpsc);
+    RUN_TEST(bench_api_encode_json);
+    RUN_TEST(bench_api_encode_cbor);
+    RUN_TEST(bench_api_encode_msgpack);
+    RUN_TEST(bench_log_pack);
+    RUN_TEST(bench_log_render);
+    RUN_TEST(test_allocations_counted_per_tag);
+    return UNITY_END();
+}
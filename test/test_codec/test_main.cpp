@@ -0,0 +1,202 @@
+#include <unity.h>
+#include <string.h>
+#include "ModbusCodec.h"
+
+namespace {
+    ModbusRegisterDef makeReg(const char* name, uint16_t address, uint16_t length,
+                              ModbusDataType type, float factor = 1.0f, float offset = 0.0f,
+                              uint8_t fc = ModbusFC::READ_HOLDING_REGISTERS,
+                              uint32_t pollIntervalMs = 1000) {
+        ModbusRegisterDef def{};
+        strncpy(def.name, name, sizeof(def.name) - 1);
+        def.address = address;
+        def.length = length;
+        def.functionCode = fc;
+        def.dataType = type;
+        def.conversionFactor = factor;
+        def.offset = offset;
+        def.pollIntervalMs = pollIntervalMs;
+        return def;
+    }
+
+    // Appends the CRC (LSB first) to len bytes in buf, returns the frame length
+    size_t withCrc(uint8_t* buf, size_t len) {
+        const uint16_t crc = ModbusCodec::crc16(buf, len);
+        buf[len] = crc & 0xFF;
+        buf[len + 1] = crc >> 8;
+        return len + 2;
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_crc16_known_vectors() {
+    // Read holding registers 0..1 of unit 1: 01 03 00 00 00 01 84 0A
+    const uint8_t request[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x01};
+    TEST_ASSERT_EQUAL_HEX16(0x0A84, ModbusCodec::crc16(request, sizeof(request)));
+
+    // CRC-16/MODBUS check value
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    TEST_ASSERT_EQUAL_HEX16(0x4B37, ModbusCodec::crc16(check, sizeof(check)));
+
+    TEST_ASSERT_EQUAL_HEX16(0xFFFF, ModbusCodec::crc16(nullptr, 0));
+}
+
+void test_parse_read_response() {
+    uint8_t buf[16] = {0x11, 0x03, 0x04, 0x12, 0x34, 0xAB, 0xCD};
+    const size_t len = withCrc(buf, 7);
+
+    ModbusFrame frame;
+    TEST_ASSERT_TRUE(ModbusCodec::parseFrame(buf, len, frame));
+    TEST_ASSERT_TRUE(frame.isValid);
+    TEST_ASSERT_FALSE(frame.isException);
+    TEST_ASSERT_EQUAL_UINT8(0x11, frame.unitId);
+    TEST_ASSERT_EQUAL_UINT8(ModbusFC::READ_HOLDING_REGISTERS, frame.functionCode);
+    TEST_ASSERT_EQUAL_UINT16(5, frame.dataLen);
+    TEST_ASSERT_EQUAL(4, (int)frame.getByteCount());
+    TEST_ASSERT_EQUAL_HEX8(0x12, frame.getRegisterData()[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xCD, frame.getRegisterData()[3]);
+}
+
+void test_parse_read_request() {
+    uint8_t buf[16] = {0x01, 0x04, 0x00, 0x10, 0x00, 0x08};
+    const size_t len = withCrc(buf, 6);
+
+    ModbusFrame frame;
+    TEST_ASSERT_TRUE(ModbusCodec::parseFrame(buf, len, frame));
+    TEST_ASSERT_TRUE(frame.isValid);
+    TEST_ASSERT_EQUAL_UINT16(0x0010, frame.getStartRegister());
+    TEST_ASSERT_EQUAL_UINT16(8, frame.getQuantity());
+}
+
+void test_parse_crc_error_keeps_payload() {
+    uint8_t buf[16] = {0x01, 0x03, 0x02, 0x00, 0x2A};
+    size_t len = withCrc(buf, 5);
+    buf[len - 1] ^= 0xFF;
+
+    ModbusFrame frame;
+    TEST_ASSERT_TRUE(ModbusCodec::parseFrame(buf, len, frame));
+    TEST_ASSERT_FALSE(frame.isValid);
+    TEST_ASSERT_EQUAL_UINT16(3, frame.dataLen);
+    TEST_ASSERT_EQUAL_HEX8(0x2A, frame.data[2]);
+}
+
+void test_parse_exception() {
+    uint8_t buf[8] = {0x05, 0x83, 0x02};
+    const size_t len = withCrc(buf, 3);
+
+    ModbusFrame frame;
+    TEST_ASSERT_TRUE(ModbusCodec::parseFrame(buf, len, frame));
+    TEST_ASSERT_TRUE(frame.isValid);
+    TEST_ASSERT_TRUE(frame.isException);
+    TEST_ASSERT_EQUAL_UINT8(0x02, frame.exceptionCode);
+    TEST_ASSERT_EQUAL_UINT16(0, frame.dataLen);
+}
+
+void test_parse_too_short() {
+    const uint8_t buf[] = {0x01, 0x03, 0x00};
+    ModbusFrame frame;
+    TEST_ASSERT_FALSE(ModbusCodec::parseFrame(buf, sizeof(buf), frame));
+}
+
+void test_parse_data_type() {
+    TEST_ASSERT_EQUAL((int)ModbusDataType::INT16, (int)ModbusCodec::parseDataType("int16"));
+    TEST_ASSERT_EQUAL((int)ModbusDataType::FLOAT32_LE, (int)ModbusCodec::parseDataType("FLOAT32_LE"));
+    TEST_ASSERT_EQUAL((int)ModbusDataType::UINT16, (int)ModbusCodec::parseDataType("unknown"));
+}
+
+void test_to_value_scaling_and_sign() {
+    const uint16_t raw16[] = {0xFF38};  // -200
+    TEST_ASSERT_EQUAL_FLOAT(-20.0f, ModbusCodec::toValue(makeReg("t", 0, 1, ModbusDataType::INT16, 0.1f), raw16));
+    TEST_ASSERT_EQUAL_FLOAT(65336.0f, ModbusCodec::toValue(makeReg("u", 0, 1, ModbusDataType::UINT16), raw16));
+
+    const uint16_t be[] = {0x0001, 0x0002};
+    TEST_ASSERT_EQUAL_FLOAT(65538.0f, ModbusCodec::toValue(makeReg("a", 0, 2, ModbusDataType::UINT32_BE), be));
+    TEST_ASSERT_EQUAL_FLOAT(131073.0f, ModbusCodec::toValue(makeReg("b", 0, 2, ModbusDataType::UINT32_LE), be));
+
+    const uint16_t f[] = {0x4049, 0x0FDB};  // 3.14159274
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 3.1415927f, ModbusCodec::toValue(makeReg("f", 0, 2, ModbusDataType::FLOAT32_BE), f));
+
+    const uint16_t offset[] = {100};
+    TEST_ASSERT_EQUAL_FLOAT(-40.0f, ModbusCodec::toValue(makeReg("o", 0, 1, ModbusDataType::UINT16, 0.5f, -90.0f), offset));
+}
+
+void test_to_raw_round_trip() {
+    const ModbusDataType types[] = {
+        ModbusDataType::UINT16, ModbusDataType::INT16,
+        ModbusDataType::UINT32_BE, ModbusDataType::UINT32_LE,
+        ModbusDataType::INT32_BE, ModbusDataType::INT32_LE,
+        ModbusDataType::FLOAT32_BE, ModbusDataType::FLOAT32_LE,
+    };
+    for (ModbusDataType type : types) {
+        const bool isSigned = type == ModbusDataType::INT16 || type == ModbusDataType::INT32_BE ||
+                              type == ModbusDataType::INT32_LE || type == ModbusDataType::FLOAT32_BE ||
+                              type == ModbusDataType::FLOAT32_LE;
+        const float value = isSigned ? -123.0f : 1234.0f;
+        const ModbusRegisterDef def = makeReg("r", 0, 2, type, 0.5f, 10.0f);
+        std::vector<uint16_t> raw = ModbusCodec::toRaw(def, value);
+        TEST_ASSERT_FALSE(raw.empty());
+        TEST_ASSERT_EQUAL_FLOAT(value, ModbusCodec::toValue(def, raw.data()));
+    }
+
+    std::vector<uint16_t> b = ModbusCodec::toRaw(makeReg("b", 0, 1, ModbusDataType::BOOL), 0.7f);
+    TEST_ASSERT_EQUAL(1, (int)b.size());
+    TEST_ASSERT_EQUAL_UINT16(1, b[0]);
+}
+
+void test_plan_merges_contiguous() {
+    std::vector<ModbusRegisterDef> regs = {
+        makeReg("c", 4, 2, ModbusDataType::UINT32_BE),
+        makeReg("a", 0, 1, ModbusDataType::UINT16),
+        makeReg("b", 1, 3, ModbusDataType::UINT16),
+        makeReg("gap", 10, 1, ModbusDataType::UINT16),
+        makeReg("input", 0, 1, ModbusDataType::UINT16, 1.0f, 0.0f, ModbusFC::READ_INPUT_REGISTERS),
+        makeReg("slow", 6, 1, ModbusDataType::UINT16, 1.0f, 0.0f, ModbusFC::READ_HOLDING_REGISTERS, 60000),
+        makeReg("onDemand", 7, 1, ModbusDataType::UINT16, 1.0f, 0.0f, ModbusFC::READ_HOLDING_REGISTERS, 0),
+    };
+
+    std::vector<ModbusCodec::PollWindow> windows;
+    ModbusCodec::planPollWindows(regs, windows);
+
+    TEST_ASSERT_EQUAL(4, (int)windows.size());
+    TEST_ASSERT_EQUAL_UINT8(ModbusFC::READ_HOLDING_REGISTERS, windows[0].functionCode);
+    TEST_ASSERT_EQUAL_UINT16(0, windows[0].startAddress);
+    TEST_ASSERT_EQUAL_UINT16(6, windows[0].quantity);
+    TEST_ASSERT_EQUAL_UINT16(10, windows[1].startAddress);
+    TEST_ASSERT_EQUAL_UINT16(1, windows[1].quantity);
+    TEST_ASSERT_EQUAL_UINT32(60000, windows[2].pollIntervalMs);
+    TEST_ASSERT_EQUAL_UINT16(6, windows[2].startAddress);
+    TEST_ASSERT_EQUAL_UINT8(ModbusFC::READ_INPUT_REGISTERS, windows[3].functionCode);
+}
+
+void test_plan_splits_at_read_limit() {
+    std::vector<ModbusRegisterDef> regs;
+    for (uint16_t addr = 0; addr < 200; addr += 2) {
+        regs.push_back(makeReg("r", addr, 2, ModbusDataType::UINT32_BE));
+    }
+
+    std::vector<ModbusCodec::PollWindow> windows;
+    ModbusCodec::planPollWindows(regs, windows);
+
+    TEST_ASSERT_EQUAL(2, (int)windows.size());
+    TEST_ASSERT_EQUAL_UINT16(124, windows[0].quantity);
+    TEST_ASSERT_EQUAL_UINT16(124, windows[1].startAddress);
+    TEST_ASSERT_EQUAL_UINT16(76, windows[1].quantity);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc16_known_vectors);
+    RUN_TEST(test_parse_read_response);
+    RUN_TEST(test_parse_read_request);
+    RUN_TEST(test_parse_crc_error_keeps_payload);
+    RUN_TEST(test_parse_exception);
+    RUN_TEST(test_parse_too_short);
+    RUN_TEST(test_parse_data_type);
+    RUN_TEST(test_to_value_scaling_and_sign);
+    RUN_TEST(test_to_raw_round_trip);
+    RUN_TEST(test_plan_merges_contiguous);
+    RUN_TEST(test_plan_splits_at_read_limit);
+    return UNITY_END();
+}
@@ -0,0 +1,231 @@
+#include <unity.h>
+#include <stddef.h>
+#include <algorithm>
+#include <LittleFS.h>
+#include "DataCollection.h"
+#include "StorageFeature.h"
+#include "Hal.h"
+
+// DataCollection serialisation (JSON, line protocol) and its delayed
+// persistence, on the LittleFS shim and the virtual clock.
+
+namespace {
+    struct Sample {
+        uint32_t timestamp;
+        char phase[8];
+        float power;
+        int16_t temperature;
+        uint8_t status;
+        bool online;
+    };
+
+    const FieldDescriptor SAMPLE_SCHEMA[] = {
+        FIELD_UINT32(Sample, timestamp, TIMESTAMP),
+        FIELD_STRING(Sample, phase, TAG),
+        FIELD_FLOAT(Sample, power, FIELD),
+        FIELD_INT16(Sample, temperature, FIELD),
+        FIELD_UINT8(Sample, status, FIELD),
+        FIELD_BOOL(Sample, online, FIELD),
+    };
+
+    using Samples = DataCollection<Sample, 4>;
+
+    Samples makeCollection() {
+        return Samples("samples", SAMPLE_SCHEMA, sizeof(SAMPLE_SCHEMA) / sizeof(SAMPLE_SCHEMA[0]), "power");
+    }
+
+    Sample makeSample(const char* phase, float power, int16_t temperature) {
+        Sample s{};
+        strncpy(s.phase, phase, sizeof(s.phase) - 1);
+        s.power = power;
+        s.temperature = temperature;
+        s.status = 3;
+        s.online = true;
+        return s;
+    }
+
+    StorageFeature storage;
+}
+
+void setUp() {
+    Hal::VirtualClock::reset();
+    LittleFS.format();
+    storage.setup();
+}
+
+void tearDown() {}
+
+void test_entry_to_json() {
+    Hal::VirtualClock::setEpoch(1700000000);
+    Samples samples = makeCollection();
+    samples.add(makeSample("L1", 12.5f, -3));
+
+    JsonDocument doc;
+    TEST_ASSERT_FALSE((bool)deserializeJson(doc, samples.toJson(0)));
+    TEST_ASSERT_EQUAL_UINT32(1700000000, doc["timestamp"].as<uint32_t>());
+    TEST_ASSERT_EQUAL_STRING("2023-11-14T22:13:20Z", doc["timestampIsoUtc"].as<const char*>());
+    TEST_ASSERT_EQUAL_STRING("L1", doc["phase"].as<const char*>());
+    TEST_ASSERT_EQUAL_FLOAT(12.5f, doc["power"].as<float>());
+    TEST_ASSERT_EQUAL(-3, doc["temperature"].as<int>());
+    TEST_ASSERT_EQUAL(3, doc["status"].as<int>());
+    TEST_ASSERT_TRUE(doc["online"].as<bool>());
+
+    TEST_ASSERT_EQUAL_STRING("{}", samples.toJson(1).c_str());
+}
+
+void test_unsynced_timestamp_has_no_iso() {
+    Samples samples = makeCollection();
+    samples.add(makeSample("L1", 1.0f, 0));
+
+    JsonDocument doc;
+    TEST_ASSERT_FALSE((bool)deserializeJson(doc, samples.toJson(0)));
+    TEST_ASSERT_EQUAL_UINT32(0, doc["timestamp"].as<uint32_t>());
+    TEST_ASSERT_TRUE(doc["timestampIsoUtc"].isNull());
+}
+
+void test_ring_keeps_newest() {
+    Samples samples = makeCollection();
+    for (int i = 0; i < 6; i++) samples.add(makeSample("L1", (float)i, (int16_t)i));
+
+    TEST_ASSERT_TRUE(samples.isFull());
+    TEST_ASSERT_EQUAL(4, (int)samples.count());
+    TEST_ASSERT_EQUAL(2, samples.get(0).temperature);
+    TEST_ASSERT_EQUAL(5, samples.latest().temperature);
+
+    JsonDocument doc;
+    TEST_ASSERT_FALSE((bool)deserializeJson(doc, samples.toJson()));
+    TEST_ASSERT_EQUAL(4, (int)doc.size());
+    TEST_ASSERT_EQUAL(2, doc[0]["temperature"].as<int>());
+    TEST_ASSERT_EQUAL(5, doc[3]["temperature"].as<int>());
+}
+
+void test_json_round_trip() {
+    Hal::VirtualClock::setEpoch(1700000000);
+    Samples samples = makeCollection();
+    samples.add(makeSample("L1", 230.25f, 21));
+    samples.add(makeSample("L2 long", -0.5f, -40));
+
+    Samples loaded = makeCollection();
+    TEST_ASSERT_TRUE(loaded.fromJson(samples.toJson()));
+    TEST_ASSERT_EQUAL(2, (int)loaded.count());
+    for (size_t i = 0; i < 2; i++) {
+        const Sample& a = samples.get(i);
+        const Sample& b = loaded.get(i);
+        TEST_ASSERT_EQUAL_UINT32(a.timestamp, b.timestamp);
+        TEST_ASSERT_EQUAL_STRING(a.phase, b.phase);
+        TEST_ASSERT_EQUAL_FLOAT(a.power, b.power);
+        TEST_ASSERT_EQUAL(a.temperature, b.temperature);
+        TEST_ASSERT_EQUAL(a.status, b.status);
+        TEST_ASSERT_EQUAL(a.online, b.online);
+    }
+
+    TEST_ASSERT_FALSE(loaded.fromJson(String("[{\"power\":")));
+    TEST_ASSERT_EQUAL(2, (int)loaded.count());
+}
+
+void test_line_protocol() {
+    Hal::VirtualClock::setEpoch(1700000000);
+    Samples samples = makeCollection();
+    samples.setDeviceId("meter 1");
+    samples.add(makeSample("L1", 12.5f, -3));
+
+    const String expected = String("power,device_id=meter\\ 1,firmware=") + FIRMWARE_NAME + ",version=" +
+                            FIRMWARE_VERSION + ",phase=L1 power=12.500000,temperature=-3i,status=3i,online=true" +
+                            " 1700000000000000000";
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), samples.latestToLineProtocol().c_str());
+
+    samples.add(makeSample("L2", 1.0f, 4));
+    const String batch = samples.toLineProtocol();
+    TEST_ASSERT_EQUAL(1, (int)std::count(batch.begin(), batch.end(), '\n'));
+}
+
+void test_delayed_persistence() {
+    static const char* PATH = "/data/samples.json";
+    Samples samples = makeCollection();
+    samples.enablePersistence(&storage, PATH, 5000);
+    samples.add(makeSample("L1", 1.5f, 7));
+
+    samples.loop();
+    Hal::VirtualClock::advanceMs(4999);
+    samples.loop();
+    TEST_ASSERT_FALSE(storage.exists(PATH));
+
+    Hal::VirtualClock::advanceMs(1);
+    samples.loop();
+    TEST_ASSERT_TRUE(storage.exists(PATH));
+
+    // Not dirty any more: no rewrite
+    TEST_ASSERT_TRUE(storage.remove(PATH));
+    Hal::VirtualClock::advanceMs(10000);
+    samples.loop();
+    TEST_ASSERT_FALSE(storage.exists(PATH));
+
+    samples.add(makeSample("L1", 2.5f, 8));
+    samples.flush();
+
+    Samples loaded = makeCollection();
+    loaded.enablePersistence(&storage, PATH, 5000);
+    loaded.load();
+    TEST_ASSERT_EQUAL(2, (int)loaded.count());
+    TEST_ASSERT_EQUAL(8, loaded.latest().temperature);
+}
+
+void test_flushes_are_coalesced() {
+    static const char* PATH = "/data/samples.json";
+    Samples samples = makeCollection();
+    samples.enablePersistence(&storage, PATH, 0);
+    const StorageFeature::WriteBackStats before = storage.getWriteBackStats();
+
+    // Two flushes within the write-back window: one flash write with the newest data
+    samples.add(makeSample("L1", 1.5f, 7));
+    samples.loop();
+    Hal::VirtualClock::advanceMs(STORAGE_WRITE_BACK_MS / 2);
+    samples.add(makeSample("L2", 2.5f, 8));
+    samples.loop();
+    TEST_ASSERT_EQUAL_UINT32(before.commits, storage.getWriteBackStats().commits);
+
+    Hal::VirtualClock::advanceMs(STORAGE_WRITE_BACK_MS / 2);
+    TEST_ASSERT_EQUAL(0, (int)storage.dueInMs());
+    storage.loop();
+    const StorageFeature::WriteBackStats after = storage.getWriteBackStats();
+    TEST_ASSERT_EQUAL_UINT32(before.commits + 1, after.commits);
+    TEST_ASSERT_EQUAL_UINT32(before.coalesced + 1, after.coalesced);
+    TEST_ASSERT_EQUAL(0, (int)after.pending);
+
+    Samples loaded = makeCollection();
+    loaded.enablePersistence(&storage, PATH, 0);
+    loaded.load();
+    TEST_ASSERT_EQUAL(2, (int)loaded.count());
+    TEST_ASSERT_EQUAL(8, loaded.latest().temperature);
+}
+
+void test_setup_cleans_up_interrupted_writes() {
+    storage.writeFile("/data/kept.json", "new");
+    storage.writeFile("/data/replaced.json", "new");
+    storage.flush();
+    storage.appendFile("/data/kept.json.tmp", "half");          // reset during an atomic write
+    storage.appendFile("/data/restored.json.bak", "old");       // reset between the backup renames
+    storage.appendFile("/data/replaced.json.bak", "old");       // reset before the backup was removed
+
+    StorageFeature rebooted;
+    rebooted.setup();
+    TEST_ASSERT_FALSE(LittleFS.exists("/data/kept.json.tmp"));
+    TEST_ASSERT_EQUAL_STRING("new", rebooted.readFile("/data/kept.json").c_str());
+    TEST_ASSERT_FALSE(LittleFS.exists("/data/restored.json.bak"));
+    TEST_ASSERT_EQUAL_STRING("old", rebooted.readFile("/data/restored.json").c_str());
+    TEST_ASSERT_FALSE(LittleFS.exists("/data/replaced.json.bak"));
+    TEST_ASSERT_EQUAL_STRING("new", rebooted.readFile("/data/replaced.json").c_str());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_entry_to_json);
+    RUN_TEST(test_unsynced_timestamp_has_no_iso);
+    RUN_TEST(test_ring_keeps_newest);
+    RUN_TEST(test_json_round_trip);
+    RUN_TEST(test_line_protocol);
+    RUN_TEST(test_delayed_persistence);
+    RUN_TEST(test_flushes_are_coalesced);
+    RUN_TEST(test_setup_cleans_up_interrupted_writes);
+    return UNITY_END();
+}
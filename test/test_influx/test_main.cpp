@@ -0,0 +1,143 @@
+#include <unity.h>
+#include <HTTPClient.h>
+#include "InfluxDBFeature.h"
+#include "Hal.h"
+
+// InfluxDB batching on the virtual clock; HostHttp answers the uploads.
+
+namespace {
+    String header(const HostHttp::Request& request, const char* name) {
+        for (const auto& h : request.headers) {
+            if (h.first == name) return h.second;
+        }
+        return String();
+    }
+
+    // One scheduler pass of the upload task
+    void pass(InfluxDBFeature& influx) {
+        if (influx.dueInMs() == 0) influx.loop();
+    }
+}
+
+void setUp() {
+    Hal::VirtualClock::reset();
+    Hal::VirtualClock::setNetworkConnected(true);
+    HostHttp::reset();
+}
+
+void tearDown() {}
+
+void test_unconfigured_is_never_due() {
+    InfluxDBFeature influx("", "org", "bucket", "", 1000, 10);
+    influx.setup();
+    influx.queue("m v=1");
+    TEST_ASSERT_EQUAL_UINT32(Feature::NOT_DUE, influx.dueInMs());
+    TEST_ASSERT_EQUAL(0, (int)influx.pendingCount());
+    TEST_ASSERT_EQUAL(0, (int)influx.taskConfig().stackBytes);
+}
+
+void test_uploads_after_batch_interval() {
+    InfluxDBFeature influx("http://influx:8086", "home", "power", "secret", 10000, 100);
+    influx.setup();
+    TEST_ASSERT_EQUAL_UINT32(Feature::NOT_DUE, influx.dueInMs());
+
+    influx.queue("m v=1");
+    TEST_ASSERT_EQUAL_UINT32(0, influx.dueInMs());  // queued lines are picked up right away
+    pass(influx);
+    TEST_ASSERT_EQUAL(1, (int)influx.pendingCount());
+    TEST_ASSERT_EQUAL_UINT32(10000, influx.dueInMs());
+
+    Hal::VirtualClock::advanceMs(9999);
+    TEST_ASSERT_EQUAL_UINT32(1, influx.dueInMs());
+    pass(influx);
+    TEST_ASSERT_EQUAL(0, (int)HostHttp::requests.size());
+
+    Hal::VirtualClock::advanceMs(1);
+    pass(influx);
+    TEST_ASSERT_EQUAL(1, (int)HostHttp::requests.size());
+    const HostHttp::Request& request = HostHttp::requests[0];
+    TEST_ASSERT_EQUAL_STRING("POST", request.method.c_str());
+    TEST_ASSERT_EQUAL_STRING("http://influx:8086/api/v2/write?org=home&bucket=power&precision=ns", request.url.c_str());
+    TEST_ASSERT_EQUAL_STRING("Token secret", header(request, "Authorization").c_str());
+    TEST_ASSERT_EQUAL_STRING("m v=1", request.body.c_str());
+    TEST_ASSERT_EQUAL_UINT32(10000000, (uint32_t)request.atUs);
+
+    TEST_ASSERT_EQUAL(0, (int)influx.pendingCount());
+    TEST_ASSERT_TRUE(influx.isConnected());
+    TEST_ASSERT_EQUAL_UINT32(1, influx.getStats().totalPointsWritten);
+    TEST_ASSERT_EQUAL_UINT32(Feature::NOT_DUE, influx.dueInMs());
+}
+
+void test_batch_size_uploads_at_once() {
+    InfluxDBFeature influx("http://influx:8086", "home", "power", "secret", 60000, 3);
+    influx.setup();
+    influx.queue("a v=1\n  b v=2\n\n");
+    pass(influx);
+    TEST_ASSERT_EQUAL(0, (int)HostHttp::requests.size());
+
+    influx.queue(" c v=3 ");
+    pass(influx);
+    TEST_ASSERT_EQUAL(1, (int)HostHttp::requests.size());
+    TEST_ASSERT_EQUAL_STRING("a v=1\nb v=2\nc v=3", HostHttp::requests[0].body.c_str());
+    TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)HostHttp::requests[0].atUs);
+}
+
+void test_offline_waits_for_network() {
+    InfluxDBFeature influx("http://influx:8086", "home", "power", "secret", 1000, 100);
+    influx.setup();
+    influx.queue("m v=1");
+    pass(influx);
+
+    Hal::VirtualClock::setNetworkConnected(false);
+    Hal::VirtualClock::advanceMs(5000);
+    TEST_ASSERT_EQUAL_UINT32(Feature::NOT_DUE, influx.dueInMs());
+
+    Hal::VirtualClock::setNetworkConnected(true);
+    TEST_ASSERT_EQUAL_UINT32(0, influx.dueInMs());
+    pass(influx);
+    TEST_ASSERT_EQUAL(1, (int)HostHttp::requests.size());
+}
+
+void test_failed_upload_keeps_lines() {
+    InfluxDBFeature influx("http://influx:8086", "home", "power", "secret", 1000, 100);
+    influx.setup();
+    influx.queue("m v=1");
+    pass(influx);
+
+    HostHttp::responseCode = HTTPC_ERROR_CONNECTION_REFUSED;
+    Hal::VirtualClock::advanceMs(1000);
+    pass(influx);
+    TEST_ASSERT_EQUAL(1, (int)HostHttp::requests.size());
+    TEST_ASSERT_FALSE(influx.isConnected());
+    TEST_ASSERT_EQUAL_UINT32(1, influx.getStats().failCount);
+    TEST_ASSERT_EQUAL(1, (int)influx.pendingCount());
+
+    HostHttp::responseCode = 204;
+    influx.queue("m v=2");
+    pass(influx);
+    TEST_ASSERT_EQUAL(2, (int)HostHttp::requests.size());
+    TEST_ASSERT_EQUAL_STRING("m v=1\nm v=2", HostHttp::requests[1].body.c_str());
+    TEST_ASSERT_EQUAL(0, (int)influx.pendingCount());
+}
+
+void test_v1_url_and_basic_auth() {
+    InfluxDBFeature influx = InfluxDBFeature::createV1("http://influx:8086", "energy", "writer", "pw", "week", 1000, 1);
+    influx.setup();
+    influx.queue("m v=1");
+    pass(influx);
+    TEST_ASSERT_EQUAL(1, (int)HostHttp::requests.size());
+    TEST_ASSERT_EQUAL_STRING("http://influx:8086/write?db=energy&precision=ns&rp=week&u=writer&p=pw",
+                             HostHttp::requests[0].url.c_str());
+    TEST_ASSERT_EQUAL_STRING("writer:pw", HostHttp::requests[0].authorization.c_str());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_unconfigured_is_never_due);
+    RUN_TEST(test_uploads_after_batch_interval);
+    RUN_TEST(test_batch_size_uploads_at_once);
+    RUN_TEST(test_offline_waits_for_network);
+    RUN_TEST(test_failed_upload_keeps_lines);
+    RUN_TEST(test_v1_url_and_basic_auth);
+    return UNITY_END();
+}
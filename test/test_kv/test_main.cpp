@@ -0,0 +1,283 @@
+#include <unity.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <LittleFS.h>
+#include "BootStats.h"
+#include "KvRecord.h"
+#include "KvStore.h"
+#include "StorageFeature.h"
+#include "Hal.h"
+
+// KvStore recovery: the record codec against torn and corrupt logs, and the
+// store on the LittleFS shim with the log cut at random power-loss points.
+
+namespace {
+    using Values = std::map<std::string, std::string>;
+
+    struct Log {
+        std::vector<uint8_t> bytes;
+        std::vector<size_t> ends;       // offset after each record
+
+        void put(const char* key, const std::string& value) {
+            uint8_t record[KvRecord::MAX_SIZE];
+            add(record, KvRecord::encode(key, strlen(key), value.data(), (uint16_t)value.size(), record));
+        }
+
+        void remove(const char* key) {
+            uint8_t record[KvRecord::MAX_SIZE];
+            add(record, KvRecord::encode(key, strlen(key), nullptr, KvRecord::TOMBSTONE, record));
+        }
+
+        void add(const uint8_t* record, size_t n) {
+            TEST_ASSERT_TRUE(n > 0);
+            bytes.insert(bytes.end(), record, record + n);
+            ends.push_back(bytes.size());
+        }
+    };
+
+    // Replays the first len bytes of a log
+    size_t replay(const std::vector<uint8_t>& bytes, size_t len, Values& values) {
+        size_t pos = 0;
+        return KvRecord::replay(
+            [&](uint8_t* buffer, size_t n) {
+                n = std::min(n, len - pos);
+                memcpy(buffer, bytes.data() + pos, n);
+                pos += n;
+                return n;
+            },
+            [&](const char* key, const uint8_t* value, size_t valueLen) {
+                if (value) {
+                    values[key] = std::string((const char*)value, valueLen);
+                } else {
+                    values.erase(key);
+                }
+            });
+    }
+
+    // Whole records before offset
+    size_t recordsBefore(const std::vector<size_t>& ends, size_t offset) {
+        size_t n = 0;
+        while (n < ends.size() && ends[n] <= offset) n++;
+        return n;
+    }
+
+    Values storeValues(const KvStore& store, const std::vector<std::string>& keys) {
+        Values values;
+        for (const std::string& key : keys) {
+            if (store.contains(key.c_str())) values[key] = store.getString(key.c_str()).c_str();
+        }
+        return values;
+    }
+
+    std::string hostPath(const char* path) {
+        return std::string(LittleFS.root()) + path;
+    }
+
+    std::vector<uint8_t> readHostFile(const char* path) {
+        std::ifstream in(hostPath(path), std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    void writeHostFile(const char* path, const std::vector<uint8_t>& bytes, size_t len) {
+        std::ofstream out(hostPath(path), std::ios::binary | std::ios::trunc);
+        out.write((const char*)bytes.data(), (std::streamsize)len);
+    }
+
+    StorageFeature storage;
+}
+
+void setUp() {
+    Hal::VirtualClock::reset();
+    LittleFS.format();
+    storage.setup();
+}
+
+void tearDown() {}
+
+void test_record_round_trip() {
+    Log log;
+    log.put("a", "1");
+    log.put("b", std::string(KV_MAX_VALUE, 'x'));
+    log.put("a", "");
+    log.remove("b");
+    log.put("c", "3");
+
+    Values values;
+    TEST_ASSERT_EQUAL(log.bytes.size(), replay(log.bytes, log.bytes.size(), values));
+    TEST_ASSERT_EQUAL(2, (int)values.size());
+    TEST_ASSERT_EQUAL_STRING("", values["a"].c_str());
+    TEST_ASSERT_EQUAL_STRING("3", values["c"].c_str());
+
+    uint8_t record[KvRecord::MAX_SIZE];
+    const std::string key(KV_MAX_KEY + 1, 'k');
+    TEST_ASSERT_EQUAL(0, (int)KvRecord::encode(key.c_str(), key.size(), "v", 1, record));
+    TEST_ASSERT_EQUAL(0, (int)KvRecord::encode("k", 1, record, KV_MAX_VALUE + 1, record));
+    TEST_ASSERT_EQUAL(0, (int)KvRecord::encode("", 0, "v", 1, record));
+}
+
+void test_torn_tail_keeps_whole_records() {
+    Log log;
+    log.put("power", "1200");
+    log.put("energy", std::string(40, 'e'));
+    log.remove("power");
+    log.put("state", "on");
+
+    // A reset can cut the log at any byte
+    for (size_t cut = 0; cut <= log.bytes.size(); cut++) {
+        const size_t whole = recordsBefore(log.ends, cut);
+        Values values;
+        const size_t good = replay(log.bytes, cut, values);
+        TEST_ASSERT_EQUAL(whole ? log.ends[whole - 1] : 0, good);
+        TEST_ASSERT_EQUAL(whole >= 1 && whole < 3, values.count("power") == 1);
+        TEST_ASSERT_EQUAL(whole >= 2, values.count("energy") == 1);
+        TEST_ASSERT_EQUAL(whole >= 4, values.count("state") == 1);
+    }
+}
+
+void test_corruption_stops_at_damaged_record() {
+    Log log;
+    log.put("first", "1");
+    log.put("second", "22");
+    log.put("third", "333");
+
+    // Any flipped bit in the second record ends the log after the first
+    for (size_t pos = log.ends[0]; pos < log.ends[1]; pos++) {
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            std::vector<uint8_t> damaged = log.bytes;
+            damaged[pos] ^= (uint8_t)(1 << bit);
+            Values values;
+            TEST_ASSERT_EQUAL(log.ends[0], replay(damaged, damaged.size(), values));
+            TEST_ASSERT_EQUAL(1, (int)values.size());
+            TEST_ASSERT_EQUAL_STRING("1", values["first"].c_str());
+        }
+    }
+}
+
+void test_power_loss_at_random_points() {
+    static const char* const PATH = "/kv.log";
+    const std::vector<std::string> keys = {"boots", "uptime", "mode", "name", "energy"};
+    std::mt19937 rng(20240611);
+
+    // Random puts and removes (unchanged values append nothing); the state after each
+    std::vector<Values> states = {Values()};
+    std::vector<size_t> ends;
+    {
+        KvStore store(storage, PATH);
+        store.setup();
+        TEST_ASSERT_TRUE(store.isReady());
+        Values model;
+        for (int i = 0; i < 200; i++) {
+            const std::string& key = keys[rng() % keys.size()];
+            if (rng() % 5 == 0) {
+                if (!model.count(key)) continue;
+                TEST_ASSERT_TRUE(store.remove(key.c_str()));
+                model.erase(key);
+            } else {
+                const std::string value(rng() % 48, (char)('a' + rng() % 26));
+                TEST_ASSERT_TRUE(store.putString(key.c_str(), value.c_str()));
+                model[key] = value;
+            }
+            states.push_back(model);
+            ends.push_back(store.getStats().logBytes);
+        }
+    }
+    const std::vector<uint8_t> full = readHostFile(PATH);
+    TEST_ASSERT_EQUAL(ends.back(), full.size());
+
+    for (int trial = 0; trial < 100; trial++) {
+        const size_t cut = rng() % (full.size() + 1);
+        writeHostFile(PATH, full, cut);
+
+        // Reboot: the state after the last whole record
+        const size_t whole = recordsBefore(ends, cut);
+        const size_t good = whole ? ends[whole - 1] : 0;
+        KvStore store(storage, PATH);
+        store.setup();
+        TEST_ASSERT_TRUE(store.isReady());
+        TEST_ASSERT_TRUE(storeValues(store, keys) == states[whole]);
+        TEST_ASSERT_EQUAL_UINT32(cut - good, store.getStats().discardedBytes);
+
+        // The damaged tail is gone, so new appends are replayed at the next boot
+        TEST_ASSERT_TRUE(store.putString("after", "reset"));
+        KvStore next(storage, PATH);
+        next.setup();
+        TEST_ASSERT_EQUAL_UINT32(0, next.getStats().discardedBytes);
+        TEST_ASSERT_EQUAL_STRING("reset", next.getString("after").c_str());
+        TEST_ASSERT_TRUE(storeValues(next, keys) == states[whole]);
+    }
+}
+
+void test_compaction_keeps_live_values() {
+    KvStore store(storage);
+    store.setup();
+    for (uint32_t i = 0; i < 1000; i++) store.put("counter", i);
+    store.putString("name", "meter");
+    TEST_ASSERT_EQUAL(0, (int)store.dueInMs());
+
+    store.loop();
+    const KvStore::Stats stats = store.getStats();
+    TEST_ASSERT_EQUAL_UINT32(1, stats.compactions);
+    TEST_ASSERT_EQUAL(stats.liveBytes, stats.logBytes);
+    TEST_ASSERT_EQUAL(Feature::NOT_DUE, store.dueInMs());
+
+    KvStore reloaded(storage);
+    reloaded.setup();
+    TEST_ASSERT_EQUAL_UINT32(999, reloaded.get<uint32_t>("counter", 0));
+    TEST_ASSERT_EQUAL_STRING("meter", reloaded.getString("name").c_str());
+    TEST_ASSERT_EQUAL(stats.logBytes, reloaded.getStats().logBytes);
+}
+
+void test_boot_stats_continue_the_stored_counters() {
+    {
+        KvStore previous(storage);
+        previous.setup();
+        previous.put("boots", (uint32_t)4);
+        previous.put("boots.poweron", (uint32_t)3);
+        previous.put("uptime.total", (uint32_t)1000);
+        previous.put("uptime.last", (uint32_t)300);
+    }
+
+    static KvStore store(storage);
+    store.setup();
+    Hal::VirtualClock::advanceMs(5000);
+    BootStats::setup(store);
+    TEST_ASSERT_EQUAL_UINT32(5, BootStats::boots());
+    TEST_ASSERT_EQUAL_UINT32(4, BootStats::boots(ESP_RST_POWERON));
+    TEST_ASSERT_EQUAL_UINT32(300, BootStats::previousUptimeS());
+    TEST_ASSERT_EQUAL_UINT32(1005, BootStats::totalUptimeS());
+
+    // Saved once per interval, not on every loop
+    const uint32_t appends = store.getStats().appends;
+    Hal::VirtualClock::advanceMs(BOOT_STATS_SAVE_INTERVAL_MS - 1);
+    BootStats::loop();
+    TEST_ASSERT_EQUAL_UINT32(appends, store.getStats().appends);
+    Hal::VirtualClock::advanceMs(1);
+    BootStats::loop();
+    TEST_ASSERT_EQUAL_UINT32(appends + 2, store.getStats().appends);
+
+    const uint32_t upS = 5 + BOOT_STATS_SAVE_INTERVAL_MS / 1000;
+    KvStore reloaded(storage);
+    reloaded.setup();
+    TEST_ASSERT_EQUAL_UINT32(upS, reloaded.get<uint32_t>("uptime.last", 0));
+    TEST_ASSERT_EQUAL_UINT32(1000 + upS, reloaded.get<uint32_t>("uptime.total", 0));
+
+    JsonDocument doc;
+    BootStats::toJson(doc.to<JsonObject>());
+    TEST_ASSERT_EQUAL_UINT32(4, doc["reasons"]["poweron"].as<uint32_t>());
+    TEST_ASSERT_EQUAL_UINT32(1000 + upS, doc["totalUptimeS"].as<uint32_t>());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_record_round_trip);
+    RUN_TEST(test_torn_tail_keeps_whole_records);
+    RUN_TEST(test_corruption_stops_at_damaged_record);
+    RUN_TEST(test_power_loss_at_random_points);
+    RUN_TEST(test_compaction_keeps_live_values);
+    RUN_TEST(test_boot_stats_continue_the_stored_counters);
+    return UNITY_END();
+}
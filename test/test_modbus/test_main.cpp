@@ -0,0 +1,193 @@
+#include <unity.h>
+#include <algorithm>
+#include <vector>
+#include "ModbusRTUFeature.h"
+#include "ModbusCodec.h"
+#include "Hal.h"
+
+// The RTU state machine on the virtual clock: HostUart delivers the bytes
+// at their wire times and dueInMs() decides when the loop runs.
+
+namespace {
+    // Appends the CRC (LSB first)
+    std::vector<uint8_t> withCrc(std::vector<uint8_t> frame) {
+        const uint16_t crc = ModbusCodec::crc16(frame.data(), frame.size());
+        frame.push_back(crc & 0xFF);
+        frame.push_back(crc >> 8);
+        return frame;
+    }
+
+    // The bus side of the UART. Like the ESP32 UART driver with its RX
+    // timeout, a frame wakes the loop two characters after its last byte.
+    struct Bus {
+        Hal::HostUart uart;
+        std::vector<uint64_t> rxTimeoutsUs;
+
+        void receive(const std::vector<uint8_t>& frame, uint64_t atUs) {
+            uart.inject(frame.data(), frame.size(), atUs);
+            rxTimeoutsUs.push_back(atUs + (frame.size() + 2) * uart.charTimeUs());
+        }
+    };
+
+    // Runs the feature like the loop scheduler would until the virtual time
+    // reaches untilUs: a pass when dueInMs() is 0, else sleep until it is
+    // due or the UART wakes the loop.
+    void runUntil(ModbusRTUFeature& rtu, Bus& bus, uint64_t untilUs) {
+        while (Hal::VirtualClock::nowUs() < untilUs) {
+            if (rtu.dueInMs() == 0) rtu.loop();
+            const uint64_t nowUs = Hal::VirtualClock::nowUs();
+            uint64_t wakeUs = untilUs;
+            const uint32_t due = rtu.dueInMs();
+            if (due != Feature::NOT_DUE) wakeUs = std::min<uint64_t>(wakeUs, nowUs + due * 1000ULL);
+            for (uint64_t t : bus.rxTimeoutsUs) {
+                if (t > nowUs) wakeUs = std::min(wakeUs, t);
+            }
+            Hal::VirtualClock::advanceUs(std::max<uint64_t>(wakeUs - std::min(wakeUs, nowUs), 1));
+        }
+    }
+
+    void runForMs(ModbusRTUFeature& rtu, Bus& bus, uint32_t ms) {
+        runUntil(rtu, bus, Hal::VirtualClock::nowUs() + ms * 1000ULL);
+    }
+
+    const std::vector<uint8_t> READ_REQUEST = {0x01, 0x03, 0x01, 0x00, 0x00, 0x02};
+}
+
+void setUp() {
+    Hal::VirtualClock::reset();
+}
+
+void tearDown() {}
+
+void test_request_waits_for_bus_silence() {
+    Bus bus;
+    ModbusRTUFeature rtu(bus.uart, 9600);
+    rtu.setup();
+    TEST_ASSERT_TRUE(rtu.isReady());
+    TEST_ASSERT_TRUE(rtu.dueInMs() > 0);
+
+    TEST_ASSERT_TRUE(rtu.queueReadRegisters(1, ModbusFC::READ_HOLDING_REGISTERS, 0x0100, 2, nullptr));
+    TEST_ASSERT_EQUAL_UINT32(0, rtu.dueInMs());  // queued requests are picked up right away
+
+    // The line was busy until setup: the request goes out after 3.5 quiet characters
+    rtu.loop();
+    TEST_ASSERT_TRUE(bus.uart.takeWritten() == withCrc(READ_REQUEST));
+    TEST_ASSERT_TRUE(Hal::VirtualClock::nowUs() >= rtu.getCharTimeUs() * 35 / 10);
+    TEST_ASSERT_TRUE(rtu.isWaitingForResponse());
+    TEST_ASSERT_EQUAL_UINT32(1, rtu.getStats().ownRequestsSent);
+}
+
+void test_response_updates_register_map() {
+    Bus bus;
+    ModbusRTUFeature rtu(bus.uart, 9600);
+    rtu.setup();
+
+    bool called = false;
+    bool success = false;
+    uint16_t value = 0;
+    rtu.queueReadRegisters(1, ModbusFC::READ_HOLDING_REGISTERS, 0x0100, 2,
+                           [&](bool ok, const ModbusFrame& frame) {
+                               called = true;
+                               success = ok;
+                               value = (frame.data[1] << 8) | frame.data[2];
+                           });
+    runForMs(rtu, bus, 5);
+    TEST_ASSERT_TRUE(bus.uart.takeWritten() == withCrc(READ_REQUEST));
+
+    // The device answers 10 ms later; the frame ends 3.5 characters after its last byte
+    const std::vector<uint8_t> response = withCrc({0x01, 0x03, 0x04, 0x00, 0x0A, 0x00, 0x14});
+    const uint64_t answerUs = Hal::VirtualClock::nowUs() + 10000;
+    bus.receive(response, answerUs);
+    runUntil(rtu, bus, answerUs + response.size() * bus.uart.charTimeUs());
+    TEST_ASSERT_FALSE(called);
+
+    runForMs(rtu, bus, 5);
+    TEST_ASSERT_TRUE(called);
+    TEST_ASSERT_TRUE(success);
+    TEST_ASSERT_EQUAL(10, value);
+    TEST_ASSERT_FALSE(rtu.isWaitingForResponse());
+    TEST_ASSERT_EQUAL_UINT32(1, rtu.getStats().ownRequestsSuccess);
+
+    uint16_t cached = 0;
+    TEST_ASSERT_TRUE(rtu.readCachedRegister(1, ModbusFC::READ_HOLDING_REGISTERS, 0x0100, cached));
+    TEST_ASSERT_EQUAL(10, cached);
+    TEST_ASSERT_TRUE(rtu.readCachedRegister(1, ModbusFC::READ_HOLDING_REGISTERS, 0x0101, cached));
+    TEST_ASSERT_EQUAL(20, cached);
+}
+
+void test_timeouts_back_off_the_unit() {
+    Bus bus;
+    ModbusRTUFeature rtu(bus.uart, 9600, SERIAL_8N1, -1, -1, -1, 16, 1000);
+    rtu.setup();
+
+    for (uint32_t i = 1; i <= 3; i++) {
+        rtu.queueReadRegisters(1, ModbusFC::READ_HOLDING_REGISTERS, 0x0100, 2, nullptr);
+        runForMs(rtu, bus, 10);
+        TEST_ASSERT_EQUAL(8, (int)bus.uart.takeWritten().size());
+        TEST_ASSERT_TRUE(rtu.isWaitingForResponse());
+        // Quiet line: only the response deadline is due
+        TEST_ASSERT_TRUE(rtu.dueInMs() > 980 && rtu.dueInMs() <= 1001);
+
+        runForMs(rtu, bus, 1000);
+        TEST_ASSERT_FALSE(rtu.isWaitingForResponse());
+        TEST_ASSERT_EQUAL_UINT32(i, rtu.getStats().timeouts);
+        TEST_ASSERT_EQUAL_UINT32(i, rtu.getUnitConsecutiveTimeouts(1));
+    }
+
+    // Third timeout in a row: unit 1 pauses for 2 s, its requests wait
+    TEST_ASSERT_TRUE(rtu.isUnitQueueingPaused(1));
+    rtu.queueReadRegisters(1, ModbusFC::READ_HOLDING_REGISTERS, 0x0100, 2, nullptr);
+    runForMs(rtu, bus, 1);
+    TEST_ASSERT_TRUE(rtu.dueInMs() > 1900);
+    runForMs(rtu, bus, 1900);
+    TEST_ASSERT_EQUAL(0, (int)bus.uart.takeWritten().size());
+
+    runForMs(rtu, bus, 200);
+    TEST_ASSERT_EQUAL(8, (int)bus.uart.takeWritten().size());
+}
+
+void test_monitors_other_masters() {
+    Bus bus;
+    ModbusRTUFeature rtu(bus.uart, 9600);
+    rtu.setup();
+
+    std::vector<ModbusFrame> frames;
+    rtu.onFrame([&](const ModbusFrame& frame, bool) { frames.push_back(frame); });
+
+    // Another master reads unit 2, which answers 20 ms later
+    const std::vector<uint8_t> request = withCrc({0x02, 0x04, 0x00, 0x10, 0x00, 0x01});
+    const std::vector<uint8_t> response = withCrc({0x02, 0x04, 0x02, 0x12, 0x34});
+    const uint64_t requestUs = 1000;
+    const uint64_t responseUs = requestUs + request.size() * bus.uart.charTimeUs() + 20000;
+    bus.receive(request, requestUs);
+    bus.receive(response, responseUs);
+    runForMs(rtu, bus, 50);
+
+    TEST_ASSERT_EQUAL(2, (int)frames.size());
+    TEST_ASSERT_TRUE(frames[0].isRequest);
+    TEST_ASSERT_EQUAL(2, frames[0].unitId);
+    TEST_ASSERT_EQUAL_UINT16(0x0010, frames[0].getStartRegister());
+    TEST_ASSERT_FALSE(frames[1].isRequest);
+    TEST_ASSERT_TRUE(frames[1].isValid);
+
+    TEST_ASSERT_EQUAL_UINT32(1, rtu.getStats().otherRequestsSeen);
+    TEST_ASSERT_EQUAL_UINT32(1, rtu.getStats().otherResponsesSeen);
+    TEST_ASSERT_EQUAL_UINT32(1, rtu.getStats().otherResponsesPaired);
+    TEST_ASSERT_EQUAL(0, (int)bus.uart.takeWritten().size());
+
+    uint16_t cached = 0;
+    TEST_ASSERT_TRUE(rtu.readCachedRegister(2, ModbusFC::READ_INPUT_REGISTERS, 0x0010, cached));
+    TEST_ASSERT_EQUAL_HEX16(0x1234, cached);
+
+    // Quiet bus: only the statistics interval is due
+    TEST_ASSERT_TRUE(rtu.dueInMs() > 1000);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_request_waits_for_bus_silence);
+    RUN_TEST(test_response_updates_register_map);
+    RUN_TEST(test_timeouts_back_off_the_unit);
+    RUN_TEST(test_monitors_other_masters);
+    return UNITY_END();
+}
@@ -0,0 +1,232 @@
+#include <unity.h>
+#include <HTTPClient.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include "HostRtos.h"
+#include "InfluxDBFeature.h"
+#include "LoopScheduler.h"
+#include "ModbusCodec.h"
+#include "ModbusRTUFeature.h"
+#include "Hal.h"
+
+// Scheduler simulation on the virtual clock: a Modbus device answering the
+// poll of every second, an InfluxDB upload every 10 s. The same minute runs
+// once with the fixed delay(2) loop and once with LoopScheduler, and both
+// are compared by sleep share, passes and poll response latency.
+
+namespace {
+    constexpr uint32_t SIM_MS = 60000;
+    constexpr uint32_t POLL_MS = 1000;
+    constexpr uint32_t DEVICE_TURNAROUND_US = 20000;
+    constexpr uint32_t LOOP_CALL_US = 50;       // CPU time charged per feature loop() call
+
+    std::vector<uint8_t> withCrc(std::vector<uint8_t> frame) {
+        const uint16_t crc = ModbusCodec::crc16(frame.data(), frame.size());
+        frame.push_back(crc & 0xFF);
+        frame.push_back(crc >> 8);
+        return frame;
+    }
+
+    // Polls unit 1 every second and queues each reading for upload
+    class Poller : public Feature {
+    public:
+        Poller(ModbusRTUFeature& rtu, InfluxDBFeature& influx) : _rtu(rtu), _influx(influx) {}
+
+        void setup() override { _lastMs = (uint32_t)Hal::millis(); }
+        uint32_t dueInMs() override { return LoopScheduler::remainingMs((uint32_t)Hal::millis() - _lastMs, POLL_MS); }
+        void loop() override {
+            _lastMs += POLL_MS;
+            _rtu.queueReadRegisters(1, ModbusFC::READ_HOLDING_REGISTERS, 0x0100, 2,
+                                    [this](bool ok, const ModbusFrame& frame) {
+                                        if (!ok) return;
+                                        latenciesUs.push_back((uint32_t)(Hal::VirtualClock::nowUs() - responseEndUs));
+                                        _influx.queue(String("power value=") + (unsigned)frame.data[2]);
+                                    });
+        }
+        const char* getName() const override { return "Poller"; }
+
+        uint64_t responseEndUs = 0;             // last byte of the last response on the wire
+        std::vector<uint32_t> latenciesUs;      // response on the wire until its callback
+
+    private:
+        ModbusRTUFeature& _rtu;
+        InfluxDBFeature& _influx;
+        uint32_t _lastMs = 0;
+    };
+
+    struct Result {
+        uint32_t passes;
+        float sleepPercent;
+        uint32_t responses;
+        uint32_t maxLatencyUs;
+        uint32_t uploads;
+    };
+
+    // One simulated minute; the device answers each request after its turnaround
+    class Sim {
+    public:
+        Sim()
+            : _rtu(_uart, 9600),
+              _influx("http://influx:8086", "home", "power", "secret", 10000, 100),
+              _poller(_rtu, _influx) {
+            _features[0] = &_rtu;
+            _features[1] = &_influx;
+            _features[2] = &_poller;
+            for (Feature* f : _features) f->setup();
+            HostRtos::setSleepHook([this](uint64_t timeoutUs) { sleep(timeoutUs); });
+        }
+
+        ~Sim() { HostRtos::setSleepHook(nullptr); }
+
+        // The fixed loop: every feature checks its timers, then delay(2)
+        Result runDelayLoop() {
+            const uint64_t endUs = Hal::VirtualClock::nowUs() + SIM_MS * 1000ULL;
+            while (Hal::VirtualClock::nowUs() < endUs) {
+                for (Feature* f : _features) {
+                    Hal::VirtualClock::advanceUs(LOOP_CALL_US);
+                    if (f->dueInMs() == 0) f->loop();
+                }
+                deviceListens();
+                _passes++;
+                delay(2);
+            }
+            return result();
+        }
+
+        // LoopScheduler: only due features run, then sleep until the next deadline or wake()
+        Result runScheduler() {
+            LoopScheduler::setup();
+            const uint64_t endUs = Hal::VirtualClock::nowUs() + SIM_MS * 1000ULL;
+            while (Hal::VirtualClock::nowUs() < endUs) {
+                uint32_t next = Feature::NOT_DUE;
+                for (Feature* f : _features) {
+                    if (f->dueInMs() != 0) continue;
+                    Hal::VirtualClock::advanceUs(LOOP_CALL_US);
+                    f->loop();
+                }
+                for (Feature* f : _features) next = std::min(next, f->dueInMs());
+                deviceListens();
+                _passes++;
+                LoopScheduler::sleep(next);
+            }
+            return result();
+        }
+
+    private:
+        struct Response {
+            uint64_t rxTimeoutUs;   // the UART interrupt: two characters after the last byte
+            std::vector<uint8_t> frame;
+        };
+
+        // A request on the wire gets its response after the turnaround
+        void deviceListens() {
+            if (_uart.takeWritten().empty()) return;
+            Response r{0, withCrc({0x01, 0x03, 0x04, 0x00, (uint8_t)_pending.size(), 0x00, 0x14})};
+            r.rxTimeoutUs = Hal::VirtualClock::nowUs() + DEVICE_TURNAROUND_US + (r.frame.size() + 2) * _uart.charTimeUs();
+            _pending.push_back(r);
+        }
+
+        // Stands in for the loop task's sleep: delivers the responses due
+        // meanwhile, a received frame wakes the loop (UART onReceive)
+        void sleep(uint64_t timeoutUs) {
+            const uint64_t nowUs = Hal::VirtualClock::nowUs();
+            const uint64_t untilUs = timeoutUs == UINT64_MAX ? UINT64_MAX : nowUs + timeoutUs;
+            while (!HostRtos::loopTaskNotified() && !_pending.empty() && _pending.front().rxTimeoutUs <= untilUs) {
+                const Response r = _pending.front();
+                _pending.pop_front();
+                advanceTo(r.rxTimeoutUs);
+                const uint64_t startUs = r.rxTimeoutUs - (r.frame.size() + 2) * _uart.charTimeUs();
+                _poller.responseEndUs = startUs + r.frame.size() * _uart.charTimeUs();
+                _uart.inject(r.frame.data(), r.frame.size(), startUs);
+            }
+            if (!HostRtos::loopTaskNotified() && untilUs != UINT64_MAX) advanceTo(untilUs);
+        }
+
+        void advanceTo(uint64_t atUs) {
+            const uint64_t nowUs = Hal::VirtualClock::nowUs();
+            if (atUs <= nowUs) return;
+            Hal::VirtualClock::advanceUs(atUs - nowUs);
+            _sleptUs += atUs - nowUs;
+        }
+
+        Result result() const {
+            Result r{};
+            r.passes = _passes;
+            r.sleepPercent = (float)(_sleptUs * 100.0 / (SIM_MS * 1000.0));
+            r.responses = (uint32_t)_poller.latenciesUs.size();
+            for (uint32_t us : _poller.latenciesUs) r.maxLatencyUs = std::max(r.maxLatencyUs, us);
+            r.uploads = (uint32_t)HostHttp::requests.size();
+            return r;
+        }
+
+        Hal::HostUart _uart;
+        ModbusRTUFeature _rtu;
+        InfluxDBFeature _influx;
+        Poller _poller;
+        Feature* _features[3];
+        std::deque<Response> _pending;
+        uint64_t _sleptUs = 0;
+        uint32_t _passes = 0;
+    };
+
+    void report(const char* name, const Result& r) {
+        char line[160];
+        snprintf(line, sizeof(line), "%-9s passes %6u  sleep %6.2f%%  responses %2u  max latency %5u us  uploads %u",
+                 name, r.passes, r.sleepPercent, r.responses, r.maxLatencyUs, r.uploads);
+        TEST_MESSAGE(line);
+    }
+}
+
+void setUp() {
+    Hal::VirtualClock::reset();
+    Hal::VirtualClock::setNetworkConnected(true);
+    HostHttp::reset();
+}
+
+void tearDown() {}
+
+void test_scheduler_sleeps_more_without_adding_latency() {
+    Result fixed;
+    {
+        Sim sim;
+        fixed = sim.runDelayLoop();
+    }
+    setUp();
+    Result scheduled;
+    {
+        Sim sim;
+        scheduled = sim.runScheduler();
+    }
+    report("delay(2)", fixed);
+    report("scheduler", scheduled);
+
+    // Same work done (the last poll is still waiting for its response)
+    TEST_ASSERT_EQUAL_UINT32(SIM_MS / POLL_MS - 1, fixed.responses);
+    TEST_ASSERT_EQUAL_UINT32(fixed.responses, scheduled.responses);
+    TEST_ASSERT_EQUAL_UINT32(SIM_MS / 10000 - 1, scheduled.uploads);
+    TEST_ASSERT_EQUAL_UINT32(fixed.uploads, scheduled.uploads);
+
+    // Far fewer passes, more of the time asleep
+    TEST_ASSERT_TRUE(scheduled.passes * 3 < fixed.passes);
+    TEST_ASSERT_TRUE(scheduled.sleepPercent > fixed.sleepPercent);
+    TEST_ASSERT_TRUE(scheduled.sleepPercent > 99.0f);
+
+    // A response is handled once the frame end is detected (3.5 characters of
+    // silence after the RX interrupt), not later than with the fixed loop
+    TEST_ASSERT_TRUE(scheduled.maxLatencyUs <= fixed.maxLatencyUs + 1000);
+
+    // wake() (UART callback, queued upload lines) ends the sleep right away
+    JsonDocument doc;
+    LoopScheduler::toJson(doc.to<JsonObject>());
+    TEST_ASSERT_TRUE(doc["eventWakeups"].as<uint32_t>() >= scheduled.responses);
+    TEST_ASSERT_TRUE(doc["wakeLatency"]["count"].as<uint32_t>() >= scheduled.responses);
+    TEST_ASSERT_TRUE(doc["wakeLatency"]["maxUs"].as<uint32_t>() <= 3 * LOOP_CALL_US);
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, scheduled.sleepPercent, doc["sleepPercent"].as<float>());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_scheduler_sleeps_more_without_adding_latency);
+    return UNITY_END();
+}
@@ -0,0 +1,119 @@
+#include <unity.h>
+#include <thread>
+#include <vector>
+#include "InfluxLineProtocol.h"
+#include "MpscQueue.h"
+#include "Hal.h"
+#include "HalUart.h"
+
+void setUp() {
+    Hal::VirtualClock::reset();
+}
+
+void tearDown() {}
+
+void test_escape_tag() {
+    TEST_ASSERT_EQUAL_STRING("plain", InfluxLineProtocol::escapeTag("plain").c_str());
+    TEST_ASSERT_EQUAL_STRING("a\\ b\\,c\\=d\\\\e", InfluxLineProtocol::escapeTag("a b,c=d\\e").c_str());
+    TEST_ASSERT_EQUAL_STRING("", InfluxLineProtocol::escapeTag((const char*)nullptr).c_str());
+}
+
+void test_escape_measurement_keeps_equals() {
+    TEST_ASSERT_EQUAL_STRING("m=1\\,x\\ y", InfluxLineProtocol::escapeMeasurement("m=1,x y").c_str());
+}
+
+void test_mpsc_fifo_and_capacity() {
+    MpscQueue<int> queue(3);
+    TEST_ASSERT_EQUAL(4, (int)queue.capacity());
+    for (int i = 0; i < 4; i++) TEST_ASSERT_TRUE(queue.push(i));
+    TEST_ASSERT_FALSE(queue.push(99));
+    TEST_ASSERT_EQUAL(4, (int)queue.size());
+
+    int value = -1;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(queue.pop(value));
+        TEST_ASSERT_EQUAL(i, value);
+    }
+    TEST_ASSERT_FALSE(queue.pop(value));
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_mpsc_concurrent_producers() {
+    static constexpr int PRODUCERS = 4;
+    static constexpr int PER_PRODUCER = 20000;
+    MpscQueue<int> queue(64);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < PER_PRODUCER; i++) {
+                while (!queue.push(p * PER_PRODUCER + i)) std::this_thread::yield();
+            }
+        });
+    }
+
+    // Every element once, each producer's elements in order
+    std::vector<int> next(PRODUCERS, 0);
+    int received = 0;
+    while (received < PRODUCERS * PER_PRODUCER) {
+        int value;
+        if (!queue.pop(value)) continue;
+        const int p = value / PER_PRODUCER;
+        TEST_ASSERT_EQUAL(next[p], value % PER_PRODUCER);
+        next[p]++;
+        received++;
+    }
+    for (auto& t : producers) t.join();
+    TEST_ASSERT_TRUE(queue.empty());
+}
+
+void test_virtual_clock() {
+    TEST_ASSERT_EQUAL_UINT32(0, Hal::millis());
+    TEST_ASSERT_EQUAL(0, (int)Hal::time());
+
+    Hal::VirtualClock::advanceMs(1500);
+    TEST_ASSERT_EQUAL_UINT32(1500, Hal::millis());
+    TEST_ASSERT_EQUAL_UINT32(1500000, Hal::micros());
+
+    Hal::VirtualClock::setEpoch(1700000000);
+    Hal::VirtualClock::advanceMs(2500);
+    TEST_ASSERT_EQUAL(1700000002, (int)Hal::time());
+
+    TEST_ASSERT_FALSE(Hal::networkConnected());
+    Hal::VirtualClock::setNetworkConnected(true);
+    TEST_ASSERT_TRUE(Hal::networkConnected());
+}
+
+void test_host_uart_timing() {
+    Hal::HostUart uart;
+    uart.begin(9600, 0, -1, -1);
+    TEST_ASSERT_EQUAL_UINT32(1041, uart.charTimeUs());
+
+    const uint8_t bytes[] = {0x01, 0x03, 0x02};
+    uart.inject(bytes, sizeof(bytes), 1000);
+    TEST_ASSERT_EQUAL(0, uart.available());
+    TEST_ASSERT_EQUAL(-1, uart.read());
+
+    Hal::VirtualClock::advanceUs(1000 + uart.charTimeUs());
+    TEST_ASSERT_EQUAL(2, uart.available());
+    TEST_ASSERT_EQUAL(0x01, uart.read());
+    TEST_ASSERT_EQUAL(0x03, uart.read());
+    TEST_ASSERT_EQUAL(-1, uart.read());
+
+    uart.write(0x42);
+    std::vector<uint8_t> written = uart.takeWritten();
+    TEST_ASSERT_EQUAL(1, (int)written.size());
+    TEST_ASSERT_EQUAL_HEX8(0x42, written[0]);
+    TEST_ASSERT_TRUE(uart.takeWritten().empty());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_escape_tag);
+    RUN_TEST(test_escape_measurement_keeps_equals);
+    RUN_TEST(test_mpsc_fifo_and_capacity);
+    RUN_TEST(test_mpsc_concurrent_producers);
+    RUN_TEST(test_virtual_clock);
+    RUN_TEST(test_host_uart_timing);
+    return UNITY_END();
+}
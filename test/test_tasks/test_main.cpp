@@ -0,0 +1,86 @@
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "FeatureTasks.h"
+#include "LoopProfiler.h"
+#include "ResetDiagnostics.h"
+#include "Hal.h"
+
+// Detached features on the host RTOS: the task is a real thread, so its
+// passes are recorded while the test thread uses the same profiler.
+
+namespace {
+    // Runs PASSES passes of PASS_US virtual microseconds each, then waits
+    class CountingFeature : public Feature {
+    public:
+        static constexpr uint32_t PASSES = 2000;
+        static constexpr uint32_t PASS_US = 100;
+
+        void setup() override {}
+        void loop() override {
+            delayMicroseconds(PASS_US);
+            _passes++;
+        }
+        uint32_t dueInMs() override { return _passes < PASSES ? 0 : NOT_DUE; }
+        TaskConfig taskConfig() const override { return TaskConfig{4096, 1, -1}; }
+        const char* getName() const override { return "counting"; }
+
+        uint32_t passes() const { return _passes; }
+
+    private:
+        std::atomic<uint32_t> _passes{0};
+    };
+
+    CountingFeature s_feature;
+
+    JsonObject findEntry(JsonArray entries, const char* name) {
+        for (JsonObject e : entries) {
+            if (strcmp(e["name"] | "", name) == 0) return e;
+        }
+        return JsonObject();
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_detached_feature_is_profiled() {
+    Feature* features[] = {&s_feature};
+    FeatureTasks::start(features, 1, nullptr);
+    TEST_ASSERT_TRUE(FeatureTasks::isDetached(&s_feature));
+
+    // The loop task records its own names meanwhile, adding profiler slots concurrently
+    static const char* const LOOP_NAMES[] = {"a", "b", "c", "d", "e", "f", "g", "h"};
+    for (uint32_t i = 0; s_feature.passes() < CountingFeature::PASSES; i++) {
+        LoopProfiler::record(LOOP_NAMES[i % 8], 10);
+        ResetDiagnostics::recordLoopDurationUs(LOOP_NAMES[i % 8], 10);
+        if (i % 1000 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // Let the task finish its last pass (it sleeps until the next check)
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    JsonDocument doc;
+    LoopProfiler::toJson(doc.to<JsonObject>());
+    JsonArray entries = doc["entries"];
+    JsonObject counting = findEntry(entries, "counting");
+    TEST_ASSERT_FALSE(counting.isNull());
+    TEST_ASSERT_EQUAL_UINT32(CountingFeature::PASSES, counting["calls"].as<uint32_t>());
+    for (const char* name : LOOP_NAMES) TEST_ASSERT_FALSE(findEntry(entries, name).isNull());
+    TEST_ASSERT_EQUAL(9, (int)entries.size());
+
+    JsonDocument tasks;
+    FeatureTasks::toJson(tasks.to<JsonArray>());
+    TEST_ASSERT_EQUAL_UINT32(CountingFeature::PASSES, tasks[0]["passes"].as<uint32_t>());
+    TEST_ASSERT_EQUAL_UINT32(CountingFeature::PASSES * CountingFeature::PASS_US / 1000,
+                             tasks[0]["busyMs"].as<uint32_t>());
+
+    TEST_ASSERT_EQUAL_STRING("counting", ResetDiagnostics::maxLoopName());
+    TEST_ASSERT_EQUAL_UINT32(CountingFeature::PASS_US, ResetDiagnostics::maxLoopDurationUs());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_detached_feature_is_profiled);
+    return UNITY_END();
+}